@@ -31,7 +31,7 @@
 #include <QtWidgets/QStackedWidget>
 #include <QtWidgets/QStatusBar>
 #include <QtWidgets/QTabWidget>
-#include <QtWidgets/QTableWidget>
+#include <QtWidgets/QTableView>
 #include <QtWidgets/QTextEdit>
 #include <QtWidgets/QVBoxLayout>
 #include <QtWidgets/QWidget>
@@ -93,7 +93,7 @@ public:
     QLabel *decodedDisplayedLabel;
     QPushButton *decodedFiltersBtn;
     QSplitter *splitter;
-    QTableWidget *decodedListTable;
+    QTableView *decodedListTable;
     QTabWidget *decodedDetailsTab;
     QWidget *decodeAnalysisTab;
     QHBoxLayout *horizontalLayout_8;
@@ -441,20 +441,7 @@ public:
         splitter->setObjectName(QStringLiteral("splitter"));
         splitter->setOrientation(Qt::Vertical);
         splitter->setHandleWidth(2);
-        decodedListTable = new QTableWidget(splitter);
-        if (decodedListTable->columnCount() < 4)
-            decodedListTable->setColumnCount(4);
-        QBrush brush(QColor(0, 0, 0, 255));
-        brush.setStyle(Qt::SolidPattern);
-        QTableWidgetItem *__qtablewidgetitem = new QTableWidgetItem();
-        __qtablewidgetitem->setForeground(brush);
-        decodedListTable->setHorizontalHeaderItem(0, __qtablewidgetitem);
-        QTableWidgetItem *__qtablewidgetitem1 = new QTableWidgetItem();
-        decodedListTable->setHorizontalHeaderItem(1, __qtablewidgetitem1);
-        QTableWidgetItem *__qtablewidgetitem2 = new QTableWidgetItem();
-        decodedListTable->setHorizontalHeaderItem(2, __qtablewidgetitem2);
-        QTableWidgetItem *__qtablewidgetitem3 = new QTableWidgetItem();
-        decodedListTable->setHorizontalHeaderItem(3, __qtablewidgetitem3);
+        decodedListTable = new QTableView(splitter);
         decodedListTable->setObjectName(QStringLiteral("decodedListTable"));
         decodedListTable->setContextMenuPolicy(Qt::CustomContextMenu);
         decodedListTable->setLayoutDirection(Qt::LeftToRight);
@@ -768,7 +755,7 @@ public:
         QObject::connect(decodedListTable, SIGNAL(customContextMenuRequested(QPoint)), exileSniffer, SLOT(decodedTableMenuRequest(QPoint)));
         QObject::connect(stopDecryptBtn, SIGNAL(clicked()), exileSniffer, SLOT(stopDecrypting()));
         QObject::connect(settingsChoiceList, SIGNAL(itemSelectionChanged()), exileSniffer, SLOT(settingsSelectionChanged()));
-        QObject::connect(decodedListTable, SIGNAL(cellPressed(int,int)), exileSniffer, SLOT(decodedCellActivated(int,int)));
+        QObject::connect(decodedListTable, SIGNAL(pressed(QModelIndex)), exileSniffer, SLOT(decodedCellActivated(QModelIndex)));
         QObject::connect(hashUtilInputText, SIGNAL(textChanged(QString)), exileSniffer, SLOT(hashUtilInput()));
         QObject::connect(decodedAutoscrollCheck, SIGNAL(toggled(bool)), exileSniffer, SLOT(toggleDecodedAutoScroll(bool)));
         QObject::connect(decodedFiltersBtn, SIGNAL(clicked()), exileSniffer, SLOT(showRawFiltersDLG()));
@@ -806,14 +793,6 @@ public:
         decodedAutoscrollCheck->setText(QApplication::translate("exileSniffer", "Auto Scroll", Q_NULLPTR));
         decodedDisplayedLabel->setText(QApplication::translate("exileSniffer", "No packets decoded", Q_NULLPTR));
         decodedFiltersBtn->setText(QApplication::translate("exileSniffer", "Filters", Q_NULLPTR));
-        QTableWidgetItem *___qtablewidgetitem = decodedListTable->horizontalHeaderItem(0);
-        ___qtablewidgetitem->setText(QApplication::translate("exileSniffer", "Time", Q_NULLPTR));
-        QTableWidgetItem *___qtablewidgetitem1 = decodedListTable->horizontalHeaderItem(1);
-        ___qtablewidgetitem1->setText(QApplication::translate("exileSniffer", "Origin", Q_NULLPTR));
-        QTableWidgetItem *___qtablewidgetitem2 = decodedListTable->horizontalHeaderItem(2);
-        ___qtablewidgetitem2->setText(QApplication::translate("exileSniffer", "PktID", Q_NULLPTR));
-        QTableWidgetItem *___qtablewidgetitem3 = decodedListTable->horizontalHeaderItem(3);
-        ___qtablewidgetitem3->setText(QApplication::translate("exileSniffer", "Summary", Q_NULLPTR));
         decodedDetailsTab->setTabText(decodedDetailsTab->indexOf(decodeAnalysisTab), QApplication::translate("exileSniffer", "Analysis", Q_NULLPTR));
         decodedRawHex->setPlainText(QString());
         decodedDetailsTab->setTabText(decodedDetailsTab->indexOf(decodeRawTab), QApplication::translate("exileSniffer", "Raw", Q_NULLPTR));
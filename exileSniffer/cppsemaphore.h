@@ -3,6 +3,7 @@
 //https://gist.github.com/sguzman/9594227
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
 using namespace std;
 
 class semaphore
@@ -30,6 +31,25 @@ public:
 		--count;
 	}
 
+	//takes up to maxCount without waiting, returns how many it got
+	int try_wait_many(int maxCount)
+	{
+		unique_lock<mutex> lck(mtx);
+		int taken = (count < maxCount) ? count : maxCount;
+		count -= taken;
+		return taken;
+	}
+
+	//same but waits up to ms for there to be any
+	int wait_many_for(int maxCount, int ms)
+	{
+		unique_lock<mutex> lck(mtx);
+		cv.wait_for(lck, chrono::milliseconds(ms), [this] { return count > 0; });
+		int taken = (count < maxCount) ? count : maxCount;
+		count -= taken;
+		return taken;
+	}
+
 	bool empty()
 	{
 		return count == 0;
@@ -0,0 +1,393 @@
+#include "stdafx.h"
+#include "decodedListModel.h"
+
+int decodedListModel::rowCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : shownRows;
+}
+
+int decodedListModel::columnCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : DECODED_SECTION_COUNT;
+}
+
+QVariant decodedListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QVariant();
+
+	switch (section)
+	{
+	case DECODED_SECTION_TIME:
+		return "Time";
+	case DECODED_SECTION_SENDER:
+		return "Origin";
+	case DECODED_SECTION_MSGID:
+		return "PktID";
+	case DECODED_SECTION_SUMMARY:
+		return "Summary";
+	default:
+		return QVariant();
+	}
+}
+
+void decodedListModel::add_row(UIDecodedPkt *packet, bool filterable, bool displayed)
+{
+	byte flags = packet->isIncoming() ? DECODED_ROW_INCOMING : 0;
+	if (packet->decodeError())
+		flags |= DECODED_ROW_BAD;
+	else if (packet->wasAbandoned())
+		flags |= DECODED_ROW_ABANDONED;
+
+	uint32_t record = (uint32_t)timeMS.size();
+	if (filterable)
+		msgIDRows[packet->getMessageID()].push_back(record);
+	else
+	{
+		flags |= DECODED_ROW_UNFILTERABLE;
+		unfilterableRows.push_back(record);
+	}
+	streamRows[packet->getStreamID()].push_back(record);
+
+	timeMS.push_back(packet->time_processed_ms());
+	pid.push_back(packet->getClientProcessID());
+	streamID.push_back(packet->getStreamID());
+	streamServer.push_back((byte)packet->getStreamType());
+	rowFlags.push_back(flags);
+	msgID.push_back(packet->getMessageID());
+
+	recordOffset.push_back(recordData.size());
+	pktSize.push_back((uint32_t)packet->pktBytes.size());
+	recordData.insert(recordData.end(), packet->pktBytes.begin(), packet->pktBytes.end());
+	encode_value(packet->jsn);
+
+	if (displayed && (streamFilter == -1 || streamFilter == packet->getStreamID()))
+		visibleRows.push_back(record);
+}
+
+bool decodedListModel::flush_rows()
+{
+	int totalRows = (int)visibleRows.size();
+	if (totalRows == shownRows)
+		return false;
+
+	beginInsertRows(QModelIndex(), shownRows, totalRows - 1);
+	shownRows = totalRows;
+	endInsertRows();
+	return true;
+}
+
+static void set_row_bits(std::vector<uint64_t> &bits, const std::vector<uint32_t> &rows)
+{
+	for (uint32_t row : rows)
+		bits[row / 64] |= 1ULL << (row % 64);
+}
+
+void decodedListModel::set_filter(const std::vector<bool> &displayed, int streamID)
+{
+	displayedIDs = displayed;
+	streamFilter = streamID;
+
+	std::vector<uint64_t> visible((timeMS.size() + 63) / 64, 0);
+	for (auto &idRows : msgIDRows)
+		if (msgID_displayed(idRows.first))
+			set_row_bits(visible, idRows.second);
+	set_row_bits(visible, unfilterableRows);
+
+	if (streamFilter != -1)
+	{
+		std::vector<uint64_t> inStream(visible.size(), 0);
+		auto it = streamRows.find(streamFilter);
+		if (it != streamRows.end())
+			set_row_bits(inStream, it->second);
+		for (size_t i = 0; i < visible.size(); ++i)
+			visible[i] &= inStream[i];
+	}
+
+	beginResetModel();
+	visibleRows.clear();
+	for (size_t word = 0; word < visible.size(); ++word)
+	{
+		uint64_t bits = visible[word];
+		for (uint32_t row = (uint32_t)(word * 64); bits; ++row, bits >>= 1)
+			if (bits & 1)
+				visibleRows.push_back(row);
+	}
+	shownRows = (int)visibleRows.size();
+	endResetModel();
+}
+
+UIDecodedPkt *decodedListModel::packet(int row) const
+{
+	if (row < 0 || row >= shownRows)
+		return NULL;
+	return restore_packet(visibleRows.at(row));
+}
+
+UIDecodedPkt *decodedListModel::restore_packet(size_t record) const
+{
+	byte flags = rowFlags.at(record);
+	UIDecodedPkt *restored = new UIDecodedPkt(pid.at(record), (streamType)streamServer.at(record),
+		streamID.at(record), flags & DECODED_ROW_INCOMING, timeMS.at(record));
+
+	const char *bytes = recordData.data() + recordOffset.at(record);
+	restored->pktBytes.assign(bytes, bytes + pktSize.at(record));
+	const char *fields = bytes + pktSize.at(record);
+	decode_value(fields, restored->jsn, restored->jsn.GetAllocator());
+	restored->restore(msgID.at(record), flags & DECODED_ROW_BAD, flags & DECODED_ROW_ABANDONED);
+	return restored;
+}
+
+static void put_varint(std::vector<char> &out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((char)value);
+}
+
+static uint64_t get_varint(const char *&pos)
+{
+	uint64_t value = 0;
+	for (int shift = 0; ; shift += 7)
+	{
+		byte part = (byte)*pos++;
+		value |= (uint64_t)(part & 0x7f) << shift;
+		if (!(part & 0x80))
+			return value;
+	}
+}
+
+uint32_t decodedListModel::field_name_id(const wchar_t *name, size_t length)
+{
+	std::wstring fieldName(name, length);
+	auto it = fieldNameIDs.find(fieldName);
+	if (it != fieldNameIDs.end())
+		return it->second;
+
+	uint32_t id = (uint32_t)fieldNames.size();
+	fieldNames.push_back(fieldName);
+	fieldNameIDs.emplace(fieldName, id);
+	return id;
+}
+
+void decodedListModel::encode_value(const WValue &value)
+{
+	switch (value.GetType())
+	{
+	case rapidjson::kNullType:
+		recordData.push_back(FIELD_NULL);
+		break;
+	case rapidjson::kFalseType:
+		recordData.push_back(FIELD_FALSE);
+		break;
+	case rapidjson::kTrueType:
+		recordData.push_back(FIELD_TRUE);
+		break;
+	case rapidjson::kNumberType:
+		if (value.IsUint64())
+		{
+			recordData.push_back(FIELD_UINT);
+			put_varint(recordData, value.GetUint64());
+		}
+		else if (value.IsInt64())
+		{
+			//-1 is stored as 0
+			recordData.push_back(FIELD_NEGATIVE);
+			put_varint(recordData, (uint64_t)(-(value.GetInt64() + 1)));
+		}
+		else
+		{
+			double number = value.GetDouble();
+			recordData.push_back(FIELD_DOUBLE);
+			recordData.insert(recordData.end(), (char *)&number, (char *)&number + sizeof(number));
+		}
+		break;
+	case rapidjson::kStringType:
+	{
+		const char *chars = (const char *)value.GetString();
+		recordData.push_back(FIELD_STRING);
+		put_varint(recordData, value.GetStringLength());
+		recordData.insert(recordData.end(), chars, chars + value.GetStringLength() * sizeof(wchar_t));
+		break;
+	}
+	case rapidjson::kArrayType:
+		recordData.push_back(FIELD_ARRAY);
+		put_varint(recordData, value.Size());
+		for (auto &element : value.GetArray())
+			encode_value(element);
+		break;
+	case rapidjson::kObjectType:
+		recordData.push_back(FIELD_OBJECT);
+		put_varint(recordData, value.MemberCount());
+		for (auto &member : value.GetObject())
+		{
+			put_varint(recordData, field_name_id(member.name.GetString(), member.name.GetStringLength()));
+			encode_value(member.value);
+		}
+		break;
+	}
+}
+
+void decodedListModel::decode_value(const char *&pos, WValue &value, rapidjson::CrtAllocator &allocator) const
+{
+	switch (*pos++)
+	{
+	case FIELD_FALSE:
+		value.SetBool(false);
+		break;
+	case FIELD_TRUE:
+		value.SetBool(true);
+		break;
+	case FIELD_UINT:
+		value.SetUint64(get_varint(pos));
+		break;
+	case FIELD_NEGATIVE:
+		value.SetInt64(-(int64_t)get_varint(pos) - 1);
+		break;
+	case FIELD_DOUBLE:
+	{
+		double number;
+		memcpy(&number, pos, sizeof(number));
+		pos += sizeof(number);
+		value.SetDouble(number);
+		break;
+	}
+	case FIELD_STRING:
+	{
+		//the record buffer isn't aligned for wchar_t
+		size_t length = (size_t)get_varint(pos);
+		std::wstring chars(length, L'\0');
+		memcpy(&chars[0], pos, length * sizeof(wchar_t));
+		pos += length * sizeof(wchar_t);
+		value.SetString(chars.c_str(), (rapidjson::SizeType)length, allocator);
+		break;
+	}
+	case FIELD_ARRAY:
+	{
+		size_t count = (size_t)get_varint(pos);
+		value.SetArray();
+		value.Reserve((rapidjson::SizeType)count, allocator);
+		for (size_t i = 0; i < count; ++i)
+		{
+			WValue element;
+			decode_value(pos, element, allocator);
+			value.PushBack(element, allocator);
+		}
+		break;
+	}
+	case FIELD_OBJECT:
+	{
+		size_t count = (size_t)get_varint(pos);
+		value.SetObject();
+		for (size_t i = 0; i < count; ++i)
+		{
+			const std::wstring &fieldName = fieldNames.at((size_t)get_varint(pos));
+			WValue name(fieldName.c_str(), (rapidjson::SizeType)fieldName.size(), allocator);
+			WValue member;
+			decode_value(pos, member, allocator);
+			value.AddMember(name, member, allocator);
+		}
+		break;
+	}
+	default:
+		value.SetNull();
+		break;
+	}
+}
+
+QString decodedListModel::summary(size_t record) const
+{
+	auto cached = summaryCacheIndex.find((uint32_t)record);
+	if (cached != summaryCacheIndex.end())
+	{
+		summaryCache.splice(summaryCache.begin(), summaryCache, cached->second);
+		return cached->second->second;
+	}
+
+	QString text;
+	if (summaryRenderer)
+	{
+		UIDecodedPkt *restored = restore_packet(record);
+		text = summaryRenderer(*restored);
+		delete restored;
+	}
+
+	byte flags = rowFlags.at(record);
+	if (flags & DECODED_ROW_BAD)
+		text = "<!BAD!>" + text;
+	else if (flags & DECODED_ROW_ABANDONED)
+		text = "<!ABAND!>" + text;
+
+	summaryCache.emplace_front((uint32_t)record, text);
+	summaryCacheIndex[(uint32_t)record] = summaryCache.begin();
+	if (summaryCache.size() > DECODED_SUMMARY_CACHE_SIZE)
+	{
+		summaryCacheIndex.erase(summaryCache.back().first);
+		summaryCache.pop_back();
+	}
+	return text;
+}
+
+QColor decodedListModel::row_colour(size_t record) const
+{
+	byte flags = rowFlags.at(record);
+	if (flags & DECODED_ROW_BAD)
+		return QColor(255, 150, 150, 255);
+	if (flags & DECODED_ROW_ABANDONED)
+		return QColor(255, 175, 175, 255);
+
+	bool incoming = flags & DECODED_ROW_INCOMING;
+	switch (streamServer.at(record))
+	{
+	case eGame:
+		return incoming ? Qt::white : QColor(235, 235, 235, 255); //grey
+	case eLogin:
+		return incoming ? QColor(255, 255, 230, 255) : QColor(255, 255, 200, 255); //yellowy
+	default:
+		return Qt::red;
+	}
+}
+
+QVariant decodedListModel::data(const QModelIndex &index, int role) const
+{
+	int row = index.row();
+	if (!index.isValid() || row >= shownRows)
+		return QVariant();
+
+	size_t record = visibleRows.at(row);
+	if (role == Qt::BackgroundRole)
+		return QBrush(row_colour(record));
+
+	if (role != Qt::DisplayRole)
+		return QVariant();
+
+	switch (index.column())
+	{
+	case DECODED_SECTION_TIME:
+		return QString::number((timeMS.at(record) - sessionStartMS) / 1000.0, 'd', 4);
+
+	case DECODED_SECTION_SENDER:
+	{
+		QString stream = "[" + QString::number(streamID.at(record)) + "] ";
+		if (!(rowFlags.at(record) & DECODED_ROW_INCOMING))
+			return stream + "Client";
+		if (streamServer.at(record) == eGame)
+			return stream + "GameServer";
+		if (streamServer.at(record) == eLogin)
+			return stream + "LoginServer";
+		return "sender() Error";
+	}
+
+	case DECODED_SECTION_MSGID:
+		return "0x" + QString::number(msgID.at(record), 16);
+
+	case DECODED_SECTION_SUMMARY:
+		return summary(record);
+
+	default:
+		return QVariant();
+	}
+}
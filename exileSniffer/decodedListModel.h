@@ -0,0 +1,123 @@
+#pragma once
+#include "uiMsg.h"
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+#define DECODED_SECTION_TIME 0
+#define DECODED_SECTION_SENDER 1
+#define DECODED_SECTION_MSGID 2
+#define DECODED_SECTION_SUMMARY 3
+#define DECODED_SECTION_COUNT 4
+
+#define DECODED_ROW_INCOMING 1
+#define DECODED_ROW_BAD 2
+#define DECODED_ROW_ABANDONED 4
+//shown whatever message IDs are filtered (login packets)
+#define DECODED_ROW_UNFILTERABLE 8
+
+//summaries kept after they scroll out of view
+#define DECODED_SUMMARY_CACHE_SIZE 4096
+
+//type tags of the stored fields
+#define FIELD_NULL 0
+#define FIELD_FALSE 1
+#define FIELD_TRUE 2
+#define FIELD_UINT 3
+#define FIELD_NEGATIVE 4
+#define FIELD_DOUBLE 5
+#define FIELD_STRING 6
+#define FIELD_ARRAY 7
+#define FIELD_OBJECT 8
+
+/*
+Every decoded packet, stored a column at a time
+
+A row is a handful of fixed size fields plus its bytes and decoded fields
+in one shared record buffer, so the list can hold a long session without
+keeping the packets themselves. The fields are stored as type tagged
+varints and strings, with the field names swapped for ids into a table
+shared by every row, and are rebuilt straight into the packet's json
+without parsing anything. Summaries are only rendered when the view asks
+for a row, and only the most recently asked for are kept.
+
+Filtered packets are stored too. The view only sees the rows that pass
+the filter, which set_filter rebuilds from lists of the rows holding
+each message ID and each stream rather than looking at every row.
+New rows are only shown to the view in batches by flush_rows.
+*/
+class decodedListModel : public QAbstractTableModel
+{
+public:
+	decodedListModel(QObject *parent = Q_NULLPTR) : QAbstractTableModel(parent) {}
+
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+
+	void set_start_time(long long startMS) { sessionStartMS = startMS; }
+	//turns a rebuilt packet into its summary text
+	void set_summary_renderer(std::function<QString(UIDecodedPkt &)> renderer) { summaryRenderer = renderer; }
+	//displayed is whether the message ID filter lets it through right now
+	void add_row(UIDecodedPkt *packet, bool filterable, bool displayed);
+	//shows the view any rows added since the last flush, false if there weren't any
+	bool flush_rows();
+
+	//displayedIDs[msgID] false to hide it, streamID -1 for every stream
+	void set_filter(const std::vector<bool> &displayedIDs, int streamID);
+	int stream_filter() { return streamFilter; }
+
+	size_t total_rows() const { return timeMS.size(); }
+	size_t visible_rows() const { return visibleRows.size(); }
+
+	//these take view rows
+	//rebuilds the packet from its record, caller deletes it
+	UIDecodedPkt *packet(int row) const;
+	ushort message_id(int row) const { return msgID.at(visibleRows.at(row)); }
+	int stream_id(int row) const { return streamID.at(visibleRows.at(row)); }
+
+private:
+	UIDecodedPkt *restore_packet(size_t record) const;
+	uint32_t field_name_id(const wchar_t *name, size_t length);
+	//appends the value to recordData
+	void encode_value(const WValue &value);
+	//rebuilds a value from pos and moves pos past it
+	void decode_value(const char *&pos, WValue &value, rapidjson::CrtAllocator &allocator) const;
+	QString summary(size_t record) const;
+	QColor row_colour(size_t record) const;
+	bool msgID_displayed(ushort id) const { return id >= displayedIDs.size() || displayedIDs[id]; }
+
+	long long sessionStartMS = 0;
+	int shownRows = 0;
+
+	std::vector<long long> timeMS;
+	std::vector<DWORD> pid;
+	std::vector<int> streamID;
+	std::vector<byte> streamServer;
+	std::vector<byte> rowFlags;
+	std::vector<ushort> msgID;
+	//a record is the packet bytes then its encoded fields
+	std::vector<size_t> recordOffset;
+	std::vector<uint32_t> pktSize;
+
+	std::vector<char> recordData;
+	std::vector<std::wstring> fieldNames;
+	std::unordered_map<std::wstring, uint32_t> fieldNameIDs;
+
+	//view row -> stored row
+	std::vector<uint32_t> visibleRows;
+
+	//stored rows holding each filterable message ID, and in each stream
+	std::map<ushort, std::vector<uint32_t> > msgIDRows;
+	std::vector<uint32_t> unfilterableRows;
+	std::map<int, std::vector<uint32_t> > streamRows;
+
+	std::vector<bool> displayedIDs;
+	int streamFilter = -1;
+
+	std::function<QString(UIDecodedPkt &)> summaryRenderer;
+	//most recently used at the front
+	mutable std::list<std::pair<uint32_t, QString> > summaryCache;
+	mutable std::unordered_map<uint32_t, std::list<std::pair<uint32_t, QString> >::iterator> summaryCacheIndex;
+};
@@ -0,0 +1,587 @@
+#include "stdafx.h"
+#include "entity_store.h"
+#include "packetIDs.h"
+
+uint32_t entity_table::add(ENTITY_ID id, long long timeMs)
+{
+	auto it = rows.find(id);
+	if (it != rows.end())
+		return it->second;
+
+	uint32_t row = (uint32_t)ids.size();
+	ids.push_back(id);
+	objHashes.push_back(ENTITY_UNKNOWN);
+	categories.push_back(0);
+	names.push_back(0);
+	coord1s.push_back(ENTITY_UNKNOWN);
+	coord2s.push_back(ENTITY_UNKNOWN);
+	lifes.push_back(ENTITY_UNKNOWN);
+	manas.push_back(ENTITY_UNKNOWN);
+	shields.push_back(ENTITY_UNKNOWN);
+	updatedMs.push_back(timeMs);
+
+	++version;
+	addedVersions.push_back(version);
+	changedVersions.push_back(version);
+	for (int field = 0; field < ENTITY_FIELD_COUNT; ++field)
+		fieldVersions[field].push_back(version);
+
+	rows.emplace(id, row);
+	rowsByID1.emplace(id.id1, row);
+	return row;
+}
+
+//the entry for this row among those sharing its ID1
+static std::unordered_multimap<uint32_t, uint32_t>::iterator find_id1_row(
+	std::unordered_multimap<uint32_t, uint32_t> &index, uint32_t id1, uint32_t row)
+{
+	auto matches = index.equal_range(id1);
+	for (auto it = matches.first; it != matches.second; ++it)
+		if (it->second == row)
+			return it;
+	return index.end();
+}
+
+void entity_table::move_row(uint32_t to, uint32_t from)
+{
+	ids[to] = ids[from];
+	objHashes[to] = objHashes[from];
+	categories[to] = categories[from];
+	names[to] = names[from];
+	coord1s[to] = coord1s[from];
+	coord2s[to] = coord2s[from];
+	lifes[to] = lifes[from];
+	manas[to] = manas[from];
+	shields[to] = shields[from];
+	updatedMs[to] = updatedMs[from];
+	addedVersions[to] = addedVersions[from];
+	changedVersions[to] = changedVersions[from];
+	for (int field = 0; field < ENTITY_FIELD_COUNT; ++field)
+		fieldVersions[field][to] = fieldVersions[field][from];
+}
+
+void entity_table::pop_row()
+{
+	ids.pop_back();
+	objHashes.pop_back();
+	categories.pop_back();
+	names.pop_back();
+	coord1s.pop_back();
+	coord2s.pop_back();
+	lifes.pop_back();
+	manas.pop_back();
+	shields.pop_back();
+	updatedMs.pop_back();
+	addedVersions.pop_back();
+	changedVersions.pop_back();
+	for (int field = 0; field < ENTITY_FIELD_COUNT; ++field)
+		fieldVersions[field].pop_back();
+}
+
+bool entity_table::remove(ENTITY_ID id)
+{
+	auto it = rows.find(id);
+	if (it == rows.end())
+		return false;
+
+	uint32_t row = it->second;
+	rows.erase(it);
+	auto byID1 = find_id1_row(rowsByID1, id.id1, row);
+	if (byID1 != rowsByID1.end())
+		rowsByID1.erase(byID1);
+
+	++version;
+	removals.push_back({ version, addedVersions[row], id });
+	//readers further behind than this get a reset instead
+	if (removals.size() > ENTITY_REMOVALS_KEPT)
+	{
+		resetVersion = removals.front().version;
+		removals.pop_front();
+	}
+
+	//the last row fills the gap
+	uint32_t last = (uint32_t)ids.size() - 1;
+	if (row != last)
+	{
+		move_row(row, last);
+		rows[ids[row]] = row;
+		byID1 = find_id1_row(rowsByID1, ids[row].id1, last);
+		if (byID1 != rowsByID1.end())
+			byID1->second = row;
+	}
+	pop_row();
+	return true;
+}
+
+uint32_t entity_table::find(ENTITY_ID id)
+{
+	auto it = rows.find(id);
+	return it == rows.end() ? ENTITY_UNKNOWN : it->second;
+}
+
+uint32_t entity_table::find_id1(uint32_t id1)
+{
+	auto matches = rowsByID1.equal_range(id1);
+	if (matches.first == matches.second)
+		return ENTITY_UNKNOWN;
+	//no way to tell which one is meant
+	if (std::next(matches.first) != matches.second)
+	{
+		++ambiguousID1;
+		return ENTITY_UNKNOWN;
+	}
+	return matches.first->second;
+}
+
+void entity_table::new_instance()
+{
+	ids.clear();
+	objHashes.clear();
+	categories.clear();
+	names.clear();
+	coord1s.clear();
+	coord2s.clear();
+	lifes.clear();
+	manas.clear();
+	shields.clear();
+	updatedMs.clear();
+	addedVersions.clear();
+	changedVersions.clear();
+	for (int field = 0; field < ENTITY_FIELD_COUNT; ++field)
+		fieldVersions[field].clear();
+	rows.clear();
+	rowsByID1.clear();
+	removals.clear();
+
+	++instance;
+	areaCode = ENTITY_UNKNOWN;
+	areaName = 0;
+	resetVersion = ++version;
+}
+
+//only on an untouched table, readers that saw it without the area get it again as a reset
+void entity_table::set_area(uint32_t code, uint32_t name)
+{
+	areaCode = code;
+	areaName = name;
+	resetVersion = ++version;
+}
+
+void entity_table::changed(uint32_t row, unsigned int fields)
+{
+	++version;
+	changedVersions[row] = version;
+	for (int field = 0; field < ENTITY_FIELD_COUNT; ++field)
+		if (fields & (1 << field))
+			fieldVersions[field][row] = version;
+}
+
+void entity_table::set_object(uint32_t row, uint32_t objHash, uint32_t category, uint32_t name)
+{
+	if (objHashes[row] == objHash && categories[row] == category && names[row] == name)
+		return;
+	objHashes[row] = objHash;
+	categories[row] = category;
+	names[row] = name;
+	changed(row, ENTITY_FIELD_OBJECT);
+}
+
+void entity_table::set_position(uint32_t row, uint32_t coord1, uint32_t coord2, long long timeMs)
+{
+	updatedMs[row] = timeMs;
+	if (coord1s[row] == coord1 && coord2s[row] == coord2)
+		return;
+	coord1s[row] = coord1;
+	coord2s[row] = coord2;
+	changed(row, ENTITY_FIELD_POSITION);
+}
+
+void entity_table::set_stat(uint32_t row, int stat, uint32_t value, long long timeMs)
+{
+	std::vector<uint32_t> *column;
+	unsigned int field;
+	switch (stat)
+	{
+	case ENTITY_STAT_LIFE:
+		column = &lifes;
+		field = ENTITY_FIELD_LIFE;
+		break;
+	case ENTITY_STAT_MANA:
+		column = &manas;
+		field = ENTITY_FIELD_MANA;
+		break;
+	case ENTITY_STAT_SHIELD:
+		column = &shields;
+		field = ENTITY_FIELD_SHIELD;
+		break;
+	default:
+		return;
+	}
+	updatedMs[row] = timeMs;
+	if ((*column)[row] == value)
+		return;
+	(*column)[row] = value;
+	changed(row, field);
+}
+
+void entity_table::get(uint32_t row, ENTITY_STATE &state)
+{
+	state.id = ids[row];
+	state.objHash = objHashes[row];
+	state.category = categories[row];
+	state.name = names[row];
+	state.coord1 = coord1s[row];
+	state.coord2 = coord2s[row];
+	state.life = lifes[row];
+	state.mana = manas[row];
+	state.shield = shields[row];
+	state.updatedMs = updatedMs[row];
+}
+
+void entity_table::snapshot(std::vector<ENTITY_STATE> &out, uint32_t category)
+{
+	size_t start = out.size();
+	out.resize(start + ids.size());
+	size_t used = start;
+	for (uint32_t row = 0; row < ids.size(); ++row)
+	{
+		if (category != ENTITY_UNKNOWN && categories[row] != category)
+			continue;
+		get(row, out[used++]);
+	}
+	out.resize(used);
+}
+
+/*
+Rows changed since are found from changedVersions, then which fields from
+fieldVersions. Removed entities that were also added since are left out,
+the reader never saw them.
+*/
+void entity_table::delta(uint64_t since, ENTITY_DELTA &out)
+{
+	out.instance = instance;
+	out.areaCode = areaCode;
+	out.fromVersion = since;
+	out.toVersion = version;
+	out.reset = since < resetVersion || since > version;
+	if (out.reset)
+		since = 0;
+
+	for (uint32_t row = 0; row < ids.size(); ++row)
+	{
+		if (changedVersions[row] <= since)
+			continue;
+
+		out.changes.emplace_back();
+		ENTITY_CHANGE &change = out.changes.back();
+		get(row, change.state);
+		change.added = addedVersions[row] > since;
+		if (change.added)
+		{
+			change.fields = ENTITY_FIELD_ALL;
+			continue;
+		}
+		change.fields = 0;
+		for (int field = 0; field < ENTITY_FIELD_COUNT; ++field)
+			if (fieldVersions[field][row] > since)
+				change.fields |= 1 << field;
+	}
+
+	if (out.reset)
+		return;
+	//newest last, so only the tail can be since
+	auto it = removals.end();
+	while (it != removals.begin() && (it - 1)->version > since)
+		--it;
+	for (; it != removals.end(); ++it)
+		if (it->addedVersion <= since)
+			out.removed.push_back(it->id);
+}
+
+//the packets here are small enough that finding fields by name is cheap
+static bool payload_uint(WValue *payload, const wchar_t *name, uint32_t &value)
+{
+	auto it = payload->FindMember(name);
+	if (it == payload->MemberEnd() || !it->value.IsUint())
+		return false;
+	value = it->value.GetUint();
+	return true;
+}
+
+static bool payload_triplet(WValue *payload, const wchar_t *name1, const wchar_t *name2, const wchar_t *name3, ENTITY_ID &id)
+{
+	uint32_t id3;
+	if (!payload_uint(payload, name1, id.id1) || !payload_uint(payload, name2, id.id2) || !payload_uint(payload, name3, id3))
+		return false;
+	id.id3 = (uint16_t)id3;
+	return true;
+}
+
+void entity_store::apply(UIDecodedPkt *packet)
+{
+	if (packet->getStreamType() != eGame || !packet->isIncoming() || packet->decodeError() || !packet->payload)
+		return;
+
+	ushort msgID = packet->getMessageID();
+	if (msgID != SRV_ADD_OBJECT && msgID != SRV_MOVE_OBJECT && msgID != SRV_MOBILE_UPDATE_HMS &&
+		msgID != SRV_OBJ_REMOVED && msgID != SRV_AREA_INFO && msgID != SRV_TRANSFER_INSTANCE)
+		return;
+
+	WValue *payload = packet->payload;
+	long long timeMs = packet->time_processed_ms();
+	ENTITY_ID id;
+
+	std::lock_guard<std::mutex> lock(storeLock);
+	entity_table &table = tables[packet->getClientProcessID()];
+	++updateCount;
+
+	switch (msgID)
+	{
+	case SRV_ADD_OBJECT:
+	{
+		if (!payload_triplet(payload, L"ID1", L"ID2", L"ID3", id))
+			return;
+		uint32_t row = table.add(id, timeMs);
+		uint32_t objHash = ENTITY_UNKNOWN;
+		payload_uint(payload, L"objHash", objHash);
+		auto category = payload->FindMember(L"HashCategory");
+		auto name = payload->FindMember(L"HashResult");
+		table.set_object(row, objHash,
+			(category != payload->MemberEnd() && category->value.IsString()) ? intern(category->value.GetString()) : 0,
+			(name != payload->MemberEnd() && name->value.IsString()) ? intern(name->value.GetString()) : 0);
+
+		//only characters have their position decoded so far
+		uint32_t coord1, coord2;
+		if (payload_uint(payload, L"Coord1", coord1) && payload_uint(payload, L"Coord2", coord2))
+			table.set_position(row, coord1, coord2, timeMs);
+		break;
+	}
+
+	case SRV_MOVE_OBJECT:
+	{
+		uint32_t objectID, coord1, coord2;
+		if (!payload_uint(payload, L"ObjectID", objectID) || !payload_uint(payload, L"Coord1", coord1) ||
+			!payload_uint(payload, L"Coord2", coord2))
+			return;
+		uint32_t row = table.find_id1(objectID);
+		if (row != ENTITY_UNKNOWN)
+			table.set_position(row, coord1, coord2, timeMs);
+		break;
+	}
+
+	case SRV_MOBILE_UPDATE_HMS:
+	{
+		uint32_t stat, value;
+		if (!payload_triplet(payload, L"ID1", L"ID2", L"ID3", id) ||
+			!payload_uint(payload, L"Stat", stat) || !payload_uint(payload, L"NewValue", value))
+			return;
+		//objects from before we started listening turn up here first
+		table.set_stat(table.add(id, timeMs), stat, value, timeMs);
+		break;
+	}
+
+	case SRV_OBJ_REMOVED:
+		//the deserialiser names are guesses, the layout is the same as the triplet
+		if (!payload_triplet(payload, L"ItemID", L"Receiver", L"Unk2", id))
+			return;
+		if (!table.remove(id))
+		{
+			uint32_t row = table.find_id1(id.id1);
+			if (row != ENTITY_UNKNOWN)
+			{
+				ENTITY_STATE state;
+				table.get(row, state);
+				table.remove(state.id);
+			}
+		}
+		break;
+
+	//nothing from the last area is still around
+	case SRV_TRANSFER_INSTANCE:
+		table.new_instance();
+		break;
+
+	//usually straight after SRV_TRANSFER_INSTANCE, that doesn't need to be two instances
+	case SRV_AREA_INFO:
+	{
+		if (!table.untouched())
+			table.new_instance();
+		uint32_t areaCode = ENTITY_UNKNOWN;
+		payload_uint(payload, L"AreaCode", areaCode);
+		auto areaName = payload->FindMember(L"AreaName");
+		table.set_area(areaCode, (areaName != payload->MemberEnd() && areaName->value.IsString()) ?
+			intern(areaName->value.GetString()) : 0);
+		break;
+	}
+	}
+}
+
+uint32_t entity_store::intern(const std::wstring &text)
+{
+	auto it = stringIndex.find(text);
+	if (it != stringIndex.end())
+		return it->second;
+
+	//0 is the empty string
+	if (strings.empty())
+	{
+		strings.push_back(L"");
+		stringIndex.emplace(L"", 0);
+		if (text.empty())
+			return 0;
+	}
+	uint32_t index = (uint32_t)strings.size();
+	strings.push_back(text);
+	stringIndex.emplace(text, index);
+	return index;
+}
+
+void entity_store::clients(std::vector<DWORD> &pids)
+{
+	std::lock_guard<std::mutex> lock(storeLock);
+	for (auto &table : tables)
+		pids.push_back(table.first);
+}
+
+size_t entity_store::entity_count(DWORD pid)
+{
+	std::lock_guard<std::mutex> lock(storeLock);
+	auto it = tables.find(pid);
+	return it == tables.end() ? 0 : it->second.size();
+}
+
+unsigned long long entity_store::ambiguous_updates(DWORD pid)
+{
+	std::lock_guard<std::mutex> lock(storeLock);
+	auto it = tables.find(pid);
+	return it == tables.end() ? 0 : it->second.ambiguousID1;
+}
+
+bool entity_store::find(DWORD pid, ENTITY_ID id, ENTITY_STATE &state)
+{
+	std::lock_guard<std::mutex> lock(storeLock);
+	auto it = tables.find(pid);
+	if (it == tables.end())
+		return false;
+	uint32_t row = it->second.find(id);
+	if (row == ENTITY_UNKNOWN)
+		return false;
+	it->second.get(row, state);
+	return true;
+}
+
+void entity_store::snapshot(DWORD pid, std::vector<ENTITY_STATE> &out, std::wstring category)
+{
+	std::lock_guard<std::mutex> lock(storeLock);
+	auto it = tables.find(pid);
+	if (it == tables.end())
+		return;
+
+	uint32_t categoryIndex = ENTITY_UNKNOWN;
+	if (!category.empty())
+	{
+		auto found = stringIndex.find(category);
+		if (found == stringIndex.end())
+			return;
+		categoryIndex = found->second;
+	}
+	it->second.snapshot(out, categoryIndex);
+}
+
+std::wstring entity_store::string_at(uint32_t index)
+{
+	std::lock_guard<std::mutex> lock(storeLock);
+	return index < strings.size() ? strings[index] : L"";
+}
+
+void entity_store::delta(DWORD pid, uint64_t since, ENTITY_DELTA &out)
+{
+	std::lock_guard<std::mutex> lock(storeLock);
+	out.pid = pid;
+	auto it = tables.find(pid);
+	if (it == tables.end())
+	{
+		out.reset = true;
+		return;
+	}
+
+	entity_table &table = it->second;
+	table.delta(since, out);
+	out.areaName = strings.empty() ? L"" : strings[table.areaName];
+	for (auto &change : out.changes)
+	{
+		if (!(change.fields & ENTITY_FIELD_OBJECT))
+			continue;
+		change.category = strings.empty() ? L"" : strings[change.state.category];
+		change.name = strings.empty() ? L"" : strings[change.state.name];
+	}
+}
+
+static void add_known(WValue &object, const wchar_t *name, uint32_t value, rapidjson::CrtAllocator &allocator)
+{
+	if (value != ENTITY_UNKNOWN)
+		object.AddMember(rapidjson::GenericStringRef<wchar_t>(name), value, allocator);
+}
+
+/*
+{"MsgType":"ENTITY_DELTA", "ProcessID", "Instance", "AreaCode", "AreaName",
+"From", "To", "Reset", "Removed":[[ID1,ID2,ID3]...], "Added":[...], "Changed":[...]}
+Added entities have every known field, changed ones their ID and what changed.
+Removed goes first, an entity can be removed then added again with the same ID.
+*/
+void ENTITY_DELTA::to_json(rapidjson::GenericDocument<rapidjson::UTF16<>, rapidjson::CrtAllocator> &doc)
+{
+	rapidjson::CrtAllocator &allocator = doc.GetAllocator();
+	doc.SetObject();
+	doc.AddMember(L"MsgType", L"ENTITY_DELTA", allocator);
+	doc.AddMember(L"ProcessID", (unsigned int)pid, allocator);
+	doc.AddMember(L"Instance", instance, allocator);
+	add_known(doc, L"AreaCode", areaCode, allocator);
+	if (!areaName.empty())
+		doc.AddMember(L"AreaName", WValue(areaName.c_str(), (rapidjson::SizeType)areaName.size(), allocator), allocator);
+	doc.AddMember(L"From", (uint64_t)(reset ? 0 : fromVersion), allocator);
+	doc.AddMember(L"To", (uint64_t)toVersion, allocator);
+	doc.AddMember(L"Reset", reset, allocator);
+
+	WValue removedList(rapidjson::kArrayType);
+	for (auto &id : removed)
+	{
+		WValue triplet(rapidjson::kArrayType);
+		triplet.PushBack(id.id1, allocator).PushBack(id.id2, allocator).PushBack((unsigned int)id.id3, allocator);
+		removedList.PushBack(triplet, allocator);
+	}
+	doc.AddMember(L"Removed", removedList, allocator);
+
+	WValue addedList(rapidjson::kArrayType);
+	WValue changedList(rapidjson::kArrayType);
+	for (auto &change : changes)
+	{
+		ENTITY_STATE &state = change.state;
+		WValue entity(rapidjson::kObjectType);
+		entity.AddMember(L"ID1", state.id.id1, allocator);
+		entity.AddMember(L"ID2", state.id.id2, allocator);
+		entity.AddMember(L"ID3", (unsigned int)state.id.id3, allocator);
+		if (change.fields & ENTITY_FIELD_OBJECT)
+		{
+			add_known(entity, L"ObjHash", state.objHash, allocator);
+			if (!change.category.empty())
+				entity.AddMember(L"Category", WValue(change.category.c_str(), (rapidjson::SizeType)change.category.size(), allocator), allocator);
+			if (!change.name.empty())
+				entity.AddMember(L"Name", WValue(change.name.c_str(), (rapidjson::SizeType)change.name.size(), allocator), allocator);
+		}
+		if (change.fields & ENTITY_FIELD_POSITION)
+		{
+			add_known(entity, L"Coord1", state.coord1, allocator);
+			add_known(entity, L"Coord2", state.coord2, allocator);
+		}
+		if (change.fields & ENTITY_FIELD_LIFE)
+			add_known(entity, L"Life", state.life, allocator);
+		if (change.fields & ENTITY_FIELD_MANA)
+			add_known(entity, L"Mana", state.mana, allocator);
+		if (change.fields & ENTITY_FIELD_SHIELD)
+			add_known(entity, L"Shield", state.shield, allocator);
+		(change.added ? addedList : changedList).PushBack(entity, allocator);
+	}
+	doc.AddMember(L"Added", addedList, allocator);
+	doc.AddMember(L"Changed", changedList, allocator);
+}
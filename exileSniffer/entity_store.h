@@ -0,0 +1,208 @@
+#pragma once
+#include "uiMsg.h"
+#include <unordered_map>
+#include <map>
+#include <deque>
+
+//not heard yet, eg: no SRV_MOBILE_UPDATE_HMS since it was added
+#define ENTITY_UNKNOWN 0xffffffff
+
+#define ENTITY_STAT_LIFE 0
+#define ENTITY_STAT_MANA 1
+#define ENTITY_STAT_SHIELD 2
+
+//which parts of an entity a delta says have changed
+#define ENTITY_FIELD_OBJECT 0x1
+#define ENTITY_FIELD_POSITION 0x2
+#define ENTITY_FIELD_LIFE 0x4
+#define ENTITY_FIELD_MANA 0x8
+#define ENTITY_FIELD_SHIELD 0x10
+#define ENTITY_FIELD_COUNT 5
+#define ENTITY_FIELD_ALL 0x1f
+
+//removals remembered for deltas, anyone further behind gets a reset
+#define ENTITY_REMOVALS_KEPT 65536
+//asking for a delta since this always gets a reset
+#define ENTITY_VERSION_NONE 0xffffffffffffffffull
+
+//the ID1, ID2, ID3 triplet the server uses for objects
+struct ENTITY_ID {
+	uint32_t id1 = 0;
+	uint32_t id2 = 0;
+	uint16_t id3 = 0;
+
+	ENTITY_ID() {}
+	ENTITY_ID(uint32_t i1, uint32_t i2, uint16_t i3) : id1(i1), id2(i2), id3(i3) {}
+	bool operator==(const ENTITY_ID &other) const { return id1 == other.id1 && id2 == other.id2 && id3 == other.id3; }
+};
+
+struct ENTITY_ID_HASH {
+	size_t operator()(const ENTITY_ID &id) const {
+		uint64_t key = (((uint64_t)id.id1 << 32) | id.id2) * 0x9E3779B97F4A7C15ull ^ id.id3;
+		return (size_t)(key ^ (key >> 32));
+	}
+};
+
+//one entity as a snapshot gives it, category and name index entity_store::string_at
+struct ENTITY_STATE {
+	ENTITY_ID id;
+	uint32_t objHash;
+	uint32_t category;
+	uint32_t name;
+	uint32_t coord1, coord2;
+	uint32_t life, mana, shield;
+	long long updatedMs;
+};
+
+struct ENTITY_CHANGE {
+	ENTITY_STATE state;
+	//ENTITY_FIELD_ flags, everything for an entity added since the last delta
+	unsigned int fields;
+	bool added;
+	//when fields has ENTITY_FIELD_OBJECT
+	std::wstring category;
+	std::wstring name;
+};
+
+/*
+What changed in a client's table between two versions. A reset means the
+reader should forget what it has for the client and take this as the
+whole table, it comes with the first delta, after an area change and if
+the reader was too far behind.
+*/
+struct ENTITY_DELTA {
+	DWORD pid = 0;
+	//goes up every area change, with the area it is
+	unsigned int instance = 0;
+	uint32_t areaCode = ENTITY_UNKNOWN;
+	std::wstring areaName;
+	uint64_t fromVersion = 0;
+	uint64_t toVersion = 0;
+	bool reset = false;
+	std::vector<ENTITY_CHANGE> changes;
+	std::vector<ENTITY_ID> removed;
+
+	bool empty() { return !reset && changes.empty() && removed.empty(); }
+	//as a feed message
+	void to_json(rapidjson::GenericDocument<rapidjson::UTF16<>, rapidjson::CrtAllocator> &doc);
+};
+
+/*
+The objects one client can see, a column per field so the updates that come
+in floods (health, movement) only touch the columns they change
+
+Rows are found through the triplet map in O(1) and removed by moving the last
+row into the gap. SRV_MOVE_OBJECT only gives ID1 so that has its own index.
+Entities can share an ID1, a lookup that matches more than one is skipped
+and counted rather than applied to whichever was added last.
+Every change bumps the table's version and is stamped with it per field, so
+a delta since any version is a scan of one column plus the recent removals.
+Not thread safe, entity_store locks around it.
+*/
+class entity_table
+{
+public:
+	//the row of a new or existing entity
+	uint32_t add(ENTITY_ID id, long long timeMs);
+	bool remove(ENTITY_ID id);
+	//ENTITY_UNKNOWN if it isn't here
+	uint32_t find(ENTITY_ID id);
+	//also ENTITY_UNKNOWN if several entities have that ID1
+	uint32_t find_id1(uint32_t id1);
+	//empties it for a new area, area fields are ENTITY_UNKNOWN until known
+	void new_instance();
+	void set_area(uint32_t areaCode, uint32_t areaName);
+	size_t size() { return ids.size(); }
+	//nothing has happened since new_instance
+	bool untouched() { return version == resetVersion; }
+
+	void set_object(uint32_t row, uint32_t objHash, uint32_t category, uint32_t name);
+	void set_position(uint32_t row, uint32_t coord1, uint32_t coord2, long long timeMs);
+	void set_stat(uint32_t row, int stat, uint32_t value, long long timeMs);
+
+	void get(uint32_t row, ENTITY_STATE &state);
+	//every row, or just those with this category
+	void snapshot(std::vector<ENTITY_STATE> &out, uint32_t category = ENTITY_UNKNOWN);
+	//changes since a version, strings are filled in by entity_store
+	void delta(uint64_t since, ENTITY_DELTA &out);
+
+	unsigned int instance = 0;
+	uint32_t areaCode = ENTITY_UNKNOWN;
+	uint32_t areaName = 0;
+	//find_id1 lookups that matched more than one entity
+	unsigned long long ambiguousID1 = 0;
+
+private:
+	void changed(uint32_t row, unsigned int fields);
+	void move_row(uint32_t to, uint32_t from);
+	void pop_row();
+
+	std::vector<ENTITY_ID> ids;
+	std::vector<uint32_t> objHashes;
+	std::vector<uint32_t> categories;
+	std::vector<uint32_t> names;
+	std::vector<uint32_t> coord1s;
+	std::vector<uint32_t> coord2s;
+	std::vector<uint32_t> lifes;
+	std::vector<uint32_t> manas;
+	std::vector<uint32_t> shields;
+	std::vector<long long> updatedMs;
+	std::vector<uint64_t> addedVersions;
+	//the latest of fieldVersions, so unchanged rows are skipped quickly
+	std::vector<uint64_t> changedVersions;
+	std::vector<uint64_t> fieldVersions[ENTITY_FIELD_COUNT];
+
+	uint64_t version = 0;
+	//deltas from before this have to be resets
+	uint64_t resetVersion = 0;
+	struct REMOVAL {
+		uint64_t version;
+		uint64_t addedVersion;
+		ENTITY_ID id;
+	};
+	std::deque<REMOVAL> removals;
+
+	std::unordered_map<ENTITY_ID, uint32_t, ENTITY_ID_HASH> rows;
+	std::unordered_multimap<uint32_t, uint32_t> rowsByID1;
+};
+
+/*
+Live state of the objects around each client, kept up to date by the
+decode thread from SRV_ADD_OBJECT, SRV_MOVE_OBJECT, SRV_MOBILE_UPDATE_HMS
+and SRV_OBJ_REMOVED. A client's table is emptied and starts a new instance
+when it changes area (SRV_AREA_INFO or SRV_TRANSFER_INSTANCE).
+
+Queries can come from any thread.
+*/
+class entity_store
+{
+public:
+	//called by the decode thread for every decoded packet
+	void apply(UIDecodedPkt *packet);
+
+	void clients(std::vector<DWORD> &pids);
+	size_t entity_count(DWORD pid);
+	//moves and removals by ID1 skipped because the ID1 was shared
+	unsigned long long ambiguous_updates(DWORD pid);
+	bool find(DWORD pid, ENTITY_ID id, ENTITY_STATE &state);
+	//category is a HashCategory like L"Monster", empty for all of them
+	void snapshot(DWORD pid, std::vector<ENTITY_STATE> &out, std::wstring category = L"");
+	//category and name strings of snapshots
+	std::wstring string_at(uint32_t index);
+	//changes to a client's table since a version, ENTITY_VERSION_NONE for all of it
+	void delta(DWORD pid, uint64_t since, ENTITY_DELTA &out);
+
+	unsigned long long updates() {
+		std::lock_guard<std::mutex> lock(storeLock);
+		return updateCount;
+	}
+
+private:
+	uint32_t intern(const std::wstring &text);
+
+	std::mutex storeLock;
+	std::map<DWORD, entity_table> tables;
+	std::vector<std::wstring> strings;
+	std::unordered_map<std::wstring, uint32_t> stringIndex;
+	unsigned long long updateCount = 0;
+};
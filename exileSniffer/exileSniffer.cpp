@@ -7,6 +7,7 @@ This is the UI thread - try not to hang it
 #include "stdafx.h"
 #include "exileSniffer.h"
 #include "utilities.h"
+#include "hex_dump.h"
 #include "qtextedit.h"
 #include "packetIDs.h"
 #include <fstream>
@@ -28,6 +29,7 @@ exileSniffer::exileSniffer(QWidget *parent)
 	rawFiltersFormUI.setupUi(&filterFormObj);
 	filterFormObj.setUI(&rawFiltersFormUI, &uiMsgQueue);
 	initFilters();
+	connect(&filterFormObj, SIGNAL(applyFilters()), this, SLOT(refilterDecodedList()));
 
 	init_loginPkt_Actioners();
 	init_gamePkt_Actioners();
@@ -142,6 +144,13 @@ void exileSniffer::setup_settings_tab()
 	settings->setValue("PipeName", pipename);
 	ui.namedPipeChosenName->setText(pipename);
 	ui.namedPipePathResult->setText("\\\\.\\pipe\\" + pipename);
+	//no checkbox for this yet
+	settings->setValue("PipeUTF8", settings->value("PipeUTF8", false).toBool());
+	//or this, 0 for no TCP feed
+	settings->setValue("FeedTCPPort", settings->value("FeedTCPPort", 0).toInt());
+	//shared memory feed name, empty for none, and the subscription json it is written with
+	settings->setValue("FeedSharedMemory", settings->value("FeedSharedMemory", "").toString());
+	settings->setValue("FeedSharedMemorySubscription", settings->value("FeedSharedMemorySubscription", "").toString());
 
 	settings->sync();
 }
@@ -195,10 +204,19 @@ void exileSniffer::initFilters()
 		filterFormObj.populateFiltersList(*gameMessageTypes);
 		filterFormObj.populatePresetsList();
 	}
+	refilterDecodedList();
 }
 
 void exileSniffer::setup_decoded_messages_tab()
 {
+	decodedModel = new decodedListModel(this);
+	decodedModel->set_start_time(startMSSinceEpoch);
+	decodedModel->set_summary_renderer([this](UIDecodedPkt &packet) { return render_summary(packet); });
+	ui.decodedListTable->setModel(decodedModel);
+	//fixed row heights so the view never has to measure rows
+	ui.decodedListTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+	ui.decodedListTable->verticalHeader()->setDefaultSectionSize(ui.decodedListTable->fontMetrics().height() + 4);
+
 	ui.decodedListTable->horizontalScrollBar()->setFixedHeight(10);
 	ui.decodedListTable->horizontalHeader()->resizeSection(DECODED_SECTION_TIME, 70);
 	ui.decodedListTable->horizontalHeader()->resizeSection(DECODED_SECTION_SENDER, 95);
@@ -221,11 +239,28 @@ void exileSniffer::setup_decoded_messages_tab()
 
 void exileSniffer::start_threads()
 {
+	//keys and recordings are named like the hex logs
+	char timestamp[32];
+	time_t t = time(0);
+	strftime(timestamp, sizeof(timestamp), "%m%d-%H-%M-%S", gmtime(&t));
+	if (doLogging && !logDir.exists())
+		logDir.mkpath(".");
+
 	//start the packet capture thread to grab streams
 	packetSniffer = new packet_capture_thread(&uiMsgQueue, &gamePktQueue, &loginPktQueue);
+	if (settings->value("RecordCapture", false).toBool())
+	{
+		QString capturePath = logDir.filePath(QString(timestamp) + "_capture.pcapng");
+		packetSniffer->set_recording_file(capturePath.toStdString());
+	}
 	std::thread packetSnifferInstance(&packet_capture_thread::ThreadEntry, packetSniffer);
 	packetSnifferInstance.detach();
 
+	//hex logs are formatted and written off the UI thread
+	hexLogWriter = new hexlog_writer;
+	std::thread hexLogWriterInstance(&hexlog_writer::ThreadEntry, hexLogWriter);
+	hexLogWriterInstance.detach();
+
 	//start the keyscanner thread to grab keys from clients
 	keyGrabber = new key_grabber_thread(&uiMsgQueue);
 	std::thread keyGrabberInstance(&key_grabber_thread::ThreadEntry, keyGrabber);
@@ -233,6 +268,53 @@ void exileSniffer::start_threads()
 
 	//start a thread to process streams
 	packetProcessor = new packet_processor(keyGrabber, &uiMsgQueue, &gamePktQueue, &loginPktQueue, ggpk);
+	packetProcessor->set_stream_capture(packetSniffer);
+	entities = new entity_store;
+	packetProcessor->set_entity_store(entities);
+
+	QString shmName = settings->value("FeedSharedMemory", "").toString();
+	if (!shmName.isEmpty())
+	{
+		shmFeed = new shm_feed(&uiMsgQueue);
+		std::string error;
+		if (shmFeed->open(shmName.toStdString(), settings->value("FeedSharedMemorySubscription", "").toString().toStdString(), error))
+			packetProcessor->set_shm_feed(shmFeed);
+		else
+		{
+			UIaddLogMsg(error, 0, &uiMsgQueue);
+			delete shmFeed;
+			shmFeed = NULL;
+		}
+	}
+	if (doLogging)
+	{
+		//keys go next to the hex logs so the session can be decoded again from a capture
+		keyLog = new key_log;
+		QString keyLogPath = logDir.filePath(QString(timestamp) + "_keys.txt");
+		if (keyLog->open(keyLogPath.toStdString()))
+			packetProcessor->set_key_log(keyLog);
+		else
+			UIaddLogMsg("Failed to open key log " + keyLogPath, 0, &uiMsgQueue);
+
+		//decrypted data with message boundaries, so filtered messages can be recovered
+		if (settings->value("SessionArchive", true).toBool())
+		{
+			sessionArchive = new session_archive_writer;
+			QString archivePath = logDir.filePath(QString(timestamp) + "_session.esa");
+			if (sessionArchive->open(archivePath.toStdString()))
+			{
+				packetProcessor->set_session_archive(sessionArchive);
+				std::thread sessionArchiveInstance(&session_archive_writer::ThreadEntry, sessionArchive);
+				sessionArchiveInstance.detach();
+			}
+			else
+			{
+				UIaddLogMsg("Failed to create session archive " + archivePath, 0, &uiMsgQueue);
+				delete sessionArchive;
+				sessionArchive = NULL;
+			}
+		}
+	}
 	std::thread packetProcessorInstance(&packet_processor::ThreadEntry, packetProcessor);
 	packetProcessorInstance.detach();
 
@@ -242,29 +324,81 @@ void exileSniffer::start_threads()
 	timer->start(10);
 
 	bool usepipe = settings->value("PipeEnabled").toBool();
+	int feedPort = settings->value("FeedTCPPort", 0).toInt();
+	if (usepipe || feedPort)
+	{
+		feedBroker = new feed_broker(&uiMsgQueue);
+		feedBroker->set_entity_store(entities);
+		std::thread feedBrokerInstance(&feed_broker::ThreadEntry, feedBroker);
+		feedBrokerInstance.detach();
+	}
+
 	if (usepipe)
 	{
 		QString pipename = settings->value("PipeName").toString();
 
-		pipeThread = new json_pipe_thread(&uiMsgQueue, pipename);
+		pipeThread = new json_pipe_thread(&uiMsgQueue, feedBroker, pipename.toStdString(), settings->value("PipeUTF8", false).toBool());
 		std::thread pipeThreadInstance(&json_pipe_thread::ThreadEntry, pipeThread);
 		pipeThreadInstance.detach();
 	}
+
+	if (feedPort)
+	{
+		FEED_ENDPOINT endpoint;
+		std::string error;
+		if (endpoint.parse("tcp:" + std::to_string(feedPort), error))
+		{
+			socketFeed = new socket_feed_thread(&uiMsgQueue, feedBroker, endpoint);
+			std::thread socketFeedInstance(&socket_feed_thread::ThreadEntry, socketFeed);
+			socketFeedInstance.detach();
+		}
+		else
+			UIaddLogMsg(error, 0, &uiMsgQueue);
+	}
 }
 
 void exileSniffer::read_UI_Q()
 {
-	clock_t startTicks = clock();
-	while (!uiMsgQueue.empty())
+	QElapsedTimer frameTime;
+	frameTime.start();
+
+	std::vector<UI_MESSAGE *> batch;
+	while (uiMsgQueue.takeItems(batch, UI_BATCH_SIZE))
 	{
-		UI_MESSAGE *msg = uiMsgQueue.waitItem();
-		action_UI_Msg(msg);
+		for (UI_MESSAGE *msg : batch)
+			action_UI_Msg(msg);
+		batch.clear();
 
-		float secondsElapsed = ((float)clock() - startTicks) / CLOCKS_PER_SEC;
-		if (secondsElapsed > 0.15) //todo: season to taste
-		{
+		if (frameTime.elapsed() >= uiFrameBudgetMS)
 			break;
-		}
+	}
+
+	//take longer over each pass while we are falling behind, give the UI its time back once caught up
+	if (!uiMsgQueue.empty())
+		uiFrameBudgetMS = min(uiFrameBudgetMS * 2, UI_FRAME_BUDGET_MAX_MS);
+	else if (uiFrameBudgetMS > UI_FRAME_BUDGET_MIN_MS)
+		uiFrameBudgetMS = max(uiFrameBudgetMS / 2, UI_FRAME_BUDGET_MIN_MS);
+
+	flush_UI_updates();
+}
+
+//everything the messages in a pass changed goes to the widgets once
+void exileSniffer::flush_UI_updates()
+{
+	if (decodedModel->flush_rows() && ui.decodedAutoscrollCheck->isChecked())
+		ui.decodedListTable->scrollToBottom();
+
+	if (decodedLabelStale)
+	{
+		updateDecodedFilterLabel();
+		decodedLabelStale = false;
+	}
+
+	if (!pendingMetalog.isEmpty())
+	{
+		ui.metaLog->appendPlainText(pendingMetalog);
+		ui.processTabs->setTabText(2, "Log (" + QString::number(metalogEntries) + ")");
+		pendingMetalog.clear();
 	}
 }
 
@@ -319,7 +453,7 @@ void exileSniffer::setStateDecrypting(int streamID)
 	activeDecryption = true;
 	latestDecryptingStream = streamID;
 
-	DWORD decryptingProcess = packetProcessor->getLatestDecryptProcess();
+	DWORD decryptingProcess = packetProcessor->getStreamProcess(streamID);
 
 	UIaddLogMsg("UI State set to decrypting", decryptingProcess, &uiMsgQueue);
 
@@ -360,7 +494,7 @@ void exileSniffer::resumeScanningEvent()
 		streamStates[transitionStream] = eStreamEnded;
 		if (!activeDecryption)
 		{
-			keyGrabber->resume_scanning();
+			keyGrabber->resume_scanning(packetProcessor->getStreamProcess(transitionStream));
 		}
 		transitionStream = -1;
 	}
@@ -375,7 +509,7 @@ void exileSniffer::setStateNotDecrypting()
 
 	ui.decryptionStatusText->setText("Not Decrypting");
 
-	DWORD processID = packetProcessor->getLatestDecryptProcess();
+	DWORD processID = packetProcessor->getStreamProcess(latestDecryptingStream);
 
 	clientHexData * client = get_clientdata(processID);
 	if (client)
@@ -488,7 +622,7 @@ void exileSniffer::handle_stream_event(UI_STREAMEVENT_MSG *streamNote)
 	if (streamNote->state == eStreamState::eStreamEnded)
 	{
 		action_ended_stream(streamNote->streamID);
-		keyGrabber->resume_scanning();
+		keyGrabber->resume_scanning(packetProcessor->getStreamProcess(streamNote->streamID));
 		streamStates[streamNote->streamID] = streamNote->state;
 	}
 	else
@@ -523,7 +657,7 @@ void exileSniffer::action_UI_Msg(UI_MESSAGE *msg)
 		case uiMsgType::eMetaLog:
 		{
 			UI_METALOG_MSG *metalogmsg = (UI_METALOG_MSG *)msg;
-			add_metalog_update(metalogmsg->stringData, metalogmsg->pid);
+			add_metalog_update(QString::fromStdString(metalogmsg->stringData), metalogmsg->pid);
 			break;
 		}
 
@@ -543,7 +677,7 @@ void exileSniffer::action_UI_Msg(UI_MESSAGE *msg)
 		{
 			UI_SNIFF_NOTE *sniffnote = (UI_SNIFF_NOTE *)msg;
 			ui.sniffStatusWidget->setState(statusWidgetState::ePending);
-			ui.sniffStatusWidget->setText("Sniffing for new game streams on interface "+ sniffnote->iface);
+			ui.sniffStatusWidget->setText("Sniffing for new game streams on interface " + QString::fromStdString(sniffnote->iface));
 			break;
 		}
 
@@ -558,7 +692,9 @@ void exileSniffer::action_UI_Msg(UI_MESSAGE *msg)
 
 		case uiMsgType::ePacketHex:
 		{
-			handle_raw_packet_data((UI_RAWHEX_PKT *)msg);
+			//the log writer owns it now
+			if (handle_raw_packet_data((UI_RAWHEX_PKT *)msg))
+				deleteAfterUse = false;
 			break;
 		}
 
@@ -577,11 +713,9 @@ void exileSniffer::action_UI_Msg(UI_MESSAGE *msg)
 			}
 
 			//important: this should happen after action_decoded_packet as it adds analysis details
-			pipeThread->sendPacket(uiDecodedMsg.jsn);
-
-			if (!uiDecodedMsg.filtered)
+			//the feed broker owns it now. Reloaded packets were published the first time
+			if (feedBroker && !uiDecodedMsg.fromArchive() && feedBroker->publish(&uiDecodedMsg))
 				deleteAfterUse = false;
-
 			break;
 		}
 
@@ -628,8 +762,11 @@ void exileSniffer::add_metalog_update(QString msg, DWORD pid)
 		ss << " - PID:"<<std::dec << pid;
 	ss << "]: " << msg.toStdString() << std::endl;
 
-	ui.metaLog->appendPlainText(QString::fromStdString(ss.str()));
-	ui.processTabs->setTabText(2, "Log (" + QString::number(++metalogEntries) + ")");
+	//appended by flush_UI_updates
+	if (!pendingMetalog.isEmpty())
+		pendingMetalog += '\n';
+	pendingMetalog += QString::fromStdString(ss.str());
+	++metalogEntries;
 }
 
 void exileSniffer::handle_client_event(UI_CLIENTEVENT_MSG *cliEvtMsg)
@@ -638,7 +775,7 @@ void exileSniffer::handle_client_event(UI_CLIENTEVENT_MSG *cliEvtMsg)
 	DWORD processID = cliEvtMsg->pid;
 	if (processID)
 	{
-		if (!isRunning && activeDecryption && processID == packetProcessor->getLatestDecryptProcess())
+		if (!isRunning && activeDecryption && processID == packetProcessor->getStreamProcess(latestDecryptingStream))
 		{
 			setStateNotDecrypting();
 			streamStates[latestDecryptingStream] = eStreamEnded;
@@ -682,81 +819,6 @@ void exileSniffer::handle_client_event(UI_CLIENTEVENT_MSG *cliEvtMsg)
 }
 
 
-std::string serverString(streamType server, string IP)
-{
-	switch (server)
-	{
-	case streamType::eGame:
-		return "Server[Game]";
-	case streamType::eLogin:
-		return "Server[Login]";
-	case streamType::ePatch:
-		return "Server[Patch]";
-	default:
-		return "Server[Unknown]";
-	}
-}
-
-void exileSniffer::output_hex_to_file(UI_RAWHEX_PKT *pkt, std::ofstream& file)
-{
-	if (!file.is_open()) return;
-
-	std::stringstream mixeddump;
-
-	char timestamp[20];
-	struct tm *tm = gmtime(&pkt->createdtime);
-	strftime(timestamp, sizeof(timestamp), "%H:%M:%S", tm);
-
-	mixeddump << "#" << rawCount_Recorded_Filtered.first << " " << timestamp << " ";
-
-	if (pkt->incoming)
-		mixeddump << serverString(pkt->stream, "f") << " to PlayerClient";
-	else
-		mixeddump << "PlayerClient to " << serverString(pkt->stream, "f");
-	mixeddump << " (" << std::dec << pkt->pktBytes.size() << " bytes)" << std::endl;
-
-	stringstream::pos_type bytesStart = mixeddump.tellp();
-
-	mixeddump << std::setfill('0') << std::uppercase << "  ";
-	for (int i = 0; i < pkt->pktBytes.size(); ++i)
-	{
-		byte item = pkt->pktBytes.at(i);
-
-		if (item)
-			mixeddump << " " << std::hex << std::setw(2) << (int)item;
-		else
-			mixeddump << " 00";
-
-		if ((i + 1) % 16 == 0)
-		{
-			mixeddump << std::endl << "  ";
-		}
-	}
-	mixeddump << "\r\n" << std::endl << std::nouppercase;
-
-	mixeddump << "   ";
-	for (int i = 0; i < pkt->pktBytes.size(); ++i)
-	{
-		byte item = pkt->pktBytes.at(i);
-
-		if (item >= ' ' && item <= '~')
-			mixeddump << (char)item;
-		else
-			mixeddump << '.';//replace unprintable with dots
-
-		if ((i + 1) % 16 == 0)
-		{
-			mixeddump << std::endl << "   ";
-		}
-	}
-
-	mixeddump << "\n" << std::endl;
-
-	std::string hexdumpstring = mixeddump.str();
-
-	file << hexdumpstring << std::endl;
-}
-
 bool exileSniffer::packet_passes_decoded_filter(ushort msgID)
 {
 	return (filterFormObj.isDisplayed(msgID));
@@ -790,7 +852,7 @@ clientHexData * exileSniffer::get_clientdata(DWORD pid)
 	return client;
 }
 
-void exileSniffer::handle_raw_packet_data(UI_RAWHEX_PKT *pkt)
+bool exileSniffer::handle_raw_packet_data(UI_RAWHEX_PKT *pkt)
 {
 
 	clientHexData *client = get_clientdata(pkt->pid);
@@ -798,24 +860,26 @@ void exileSniffer::handle_raw_packet_data(UI_RAWHEX_PKT *pkt)
 	if (!client)
 	{
 		add_metalog_update("Warning: Dropped packet with no associated PID", pkt->pid);
-		return;
+		return false;
 	}
 
-	//output_hex_to_pane(pkt);
-	output_hex_to_file(pkt, client->get_unfiltered_hexlog());
-	++rawCount_Recorded_Filtered.first;
-
-	if (packet_passes_decoded_filter(pkt->startBytes))
-		output_hex_to_file(pkt, client->get_filtered_hexlog());
-	else
+	HEXLOG_ENTRY entry;
+	entry.pkt = std::shared_ptr<UI_RAWHEX_PKT>(pkt);
+	entry.client = client;
+	entry.recordNumber = rawCount_Recorded_Filtered.first++;
+	entry.toFiltered = packet_passes_decoded_filter(pkt->startBytes);
+	if (!entry.toFiltered)
 		++rawCount_Recorded_Filtered.second;
+
+	hexLogWriter->add_segment(entry);
+	return true;
 }
 
 void exileSniffer::updateDecodedFilterLabel()
 {
 	std::stringstream filterLabTxt;
-	filterLabTxt << std::dec << "Packets ( Displayed: " << decodedCount_Displayed_Filtered.first <<
-	" / Filtered: " << decodedCount_Displayed_Filtered.second <<
+	filterLabTxt << std::dec << "Packets ( Displayed: " << decodedModel->visible_rows() <<
+	" / Filtered: " << decodedModel->total_rows() - decodedModel->visible_rows() <<
 	" / Error: "<< decodedErrorPacketCount << " )";
 	ui.decodedDisplayedLabel->setText(QString::fromStdString(filterLabTxt.str()));
 }
@@ -841,13 +905,14 @@ void exileSniffer::decodedListClicked()
 		ui.decodedAutoscrollCheck->setChecked(false);
 }
 
-void exileSniffer::decodedCellActivated(int row, int col)
+void exileSniffer::decodedCellActivated(QModelIndex index)
 {
 	ui.decodedText->clear();
 
-	QTableWidgetItem *item = ui.decodedListTable->item(row, 0);
-	if (!item) return;
-	UIDecodedPkt* obj = (UIDecodedPkt*)item->data(Qt::UserRole).value<UIDecodedPkt*>();
+	delete detailsPacket;
+	detailsPacket = decodedModel->packet(index.row());
+	UIDecodedPkt* obj = detailsPacket;
+	if (!obj) return;
 
 	if (!obj->decodeError())
 	{
@@ -896,61 +961,54 @@ void exileSniffer::decodedCellActivated(int row, int col)
 	ui.decodedRawText->clear();
 	
 	size_t msgSize = obj->pktBytes.size();
-	std::wstringstream hexdump;
-	hexdump << epochms_to_timestring(pktTime);
-	hexdump << " (start +" << msToQStringSeconds(startMSSinceEpoch, pktTime).toStdWString() << "s)" << std::endl;
+	const byte *pktData = obj->pktBytes.data();
+	size_t rows = (msgSize + HEXDUMP_ROW - 1) / HEXDUMP_ROW;
+
+	std::wstringstream header;
+	header << epochms_to_timestring(pktTime);
+	header << " (start +" << msToQStringSeconds(startMSSinceEpoch, pktTime).toStdWString() << "s)" << std::endl;
 
 	if (obj->isIncoming())
-		hexdump << serverName << " -> PlayerClient";
+		header << serverName << " -> PlayerClient";
 	else
-		hexdump << "PlayerClient -> " << serverName;
-
-	hexdump << std::setfill(L'0') << std::uppercase << L" ";
-	hexdump << " (" << std::dec << obj->pktBytes.size() << " bytes)" << std::endl;
-	hexdump << std::endl;
-	hexdump << " ";
-
-	for (int i = 0; i < msgSize; ++i)
+		header << "PlayerClient -> " << serverName;
+	header << "  (" << std::dec << msgSize << " bytes)" << std::endl;
+	header << std::endl;
+
+	QString hexdump = QString::fromStdWString(header.str());
+	int headerLength = hexdump.size();
+	hexdump.resize(headerLength + 1 + (int)(msgSize * 3 + rows * 2));
+	ushort *hexStart = (ushort *)hexdump.data();
+	ushort *pos = write_text(" ", hexStart + headerLength);
+	for (size_t row = 0; row < msgSize; row += HEXDUMP_ROW)
 	{
-		byte item = obj->pktBytes.at(i);
-
-		if (item)
-			hexdump << " " << std::hex << std::setw(2) << (int)item;
-		else
-			hexdump << " 00";
-
-		int nextIndex = i + 1;
-		if ((nextIndex % 16 == 0) && nextIndex < msgSize)
-		{
-			hexdump << std::endl;
-			hexdump << " ";
-		}
+		size_t rowSize = min(msgSize - row, (size_t)HEXDUMP_ROW);
+		pos = write_hex_spaced(pktData + row, rowSize, pos);
+		if (row + HEXDUMP_ROW < msgSize)
+			pos = write_text("\n ", pos);
 	}
+	hexdump.truncate((int)(pos - hexStart));
 
-	ui.decodedRawHex->insertPlainText(QString::fromStdWString(hexdump.str()));
-
-	std::wstringstream asciiDump;
-	asciiDump << std::setfill(L'0') << std::hex << std::setw(3);
-	asciiDump << "\n\n\n 000:";
+	ui.decodedRawHex->insertPlainText(hexdump);
 
-	for (int i = 0; i < msgSize; ++i)
+	//each row after the first is labelled with its offset
+	QString asciiDump((int)(8 + msgSize + rows * 21), ' ');
+	ushort *asciiStart = (ushort *)asciiDump.data();
+	pos = write_text("\n\n\n 000:", asciiStart);
+	for (size_t row = 0; row < msgSize; row += HEXDUMP_ROW)
 	{
-		byte item = obj->pktBytes.at(i);
-
-		if (item >= ' ' && item <= '~')
-			asciiDump << (char)item;
-		else
-			asciiDump << '.';//replace unprintable with dots
-		
-		int nextIndex = i + 1;
-		if ((nextIndex % 16 == 0) && nextIndex < msgSize)
+		size_t rowSize = min(msgSize - row, (size_t)HEXDUMP_ROW);
+		pos = write_ascii(pktData + row, rowSize, pos);
+		if (row + HEXDUMP_ROW < msgSize)
 		{
-			asciiDump << std::endl;
-			asciiDump << " " << std::setw(3) << (i + 1) << ": ";
+			pos = write_text("\n ", pos);
+			pos = write_hex_number(row + HEXDUMP_ROW, 3, pos);
+			pos = write_text(": ", pos);
 		}
 	}
+	asciiDump.truncate((int)(pos - asciiStart));
 
-	ui.decodedRawText->insertPlainText(QString::fromStdWString(asciiDump.str()));
+	ui.decodedRawText->insertPlainText(asciiDump);
 }
 
 
@@ -958,7 +1016,6 @@ void exileSniffer::copySelected()
 {
 	QModelIndexList rowsSelected = ui.decodedListTable->selectionModel()->selectedRows();
 	if (rowsSelected.empty()) return;
-	QTableWidgetItem *rowitem = ui.decodedListTable->item(rowsSelected.front().row(), 0);
 
 	//todo - mush stuff on this row together on keyboard
 }
@@ -967,13 +1024,40 @@ void exileSniffer::filterSelected()
 {
 	QModelIndexList rowsSelected = ui.decodedListTable->selectionModel()->selectedRows();
 	if (rowsSelected.empty()) return;
-	QTableWidgetItem *rowitem = ui.decodedListTable->item(rowsSelected.front().row(), 0);
-	UIDecodedPkt* obj = (UIDecodedPkt*)rowitem->data(Qt::UserRole).value<UIDecodedPkt*>();
 
-	ushort msgid = obj->getMessageID();
+	ushort msgid = decodedModel->message_id(rowsSelected.front().row());
 	if (msgid < rawFiltersFormUI.filterTable->rowCount())
+	{
 		filterFormObj.setFilterRowState(msgid, eDisplayState::hidden);
+		refilterDecodedList();
+	}
+}
+
+void exileSniffer::filterSelectedStream()
+{
+	int streamID = -1;
+	if (decodedModel->stream_filter() == -1)
+	{
+		QModelIndexList rowsSelected = ui.decodedListTable->selectionModel()->selectedRows();
+		if (rowsSelected.empty()) return;
+		streamID = decodedModel->stream_id(rowsSelected.front().row());
+	}
+
+	std::vector<bool> displayedIDs;
+	filterFormObj.getDisplayedIDs(displayedIDs);
+	decodedModel->set_filter(displayedIDs, streamID);
+	updateDecodedFilterLabel();
+}
+
+void exileSniffer::refilterDecodedList()
+{
+	std::vector<bool> displayedIDs;
+	filterFormObj.getDisplayedIDs(displayedIDs);
+	decodedModel->set_filter(displayedIDs, decodedModel->stream_filter());
+	updateDecodedFilterLabel();
 
+	if (ui.decodedAutoscrollCheck->isChecked())
+		ui.decodedListTable->scrollToBottom();
 }
 
 void exileSniffer::decodedTableMenuRequest(QPoint pos)
@@ -990,23 +1074,75 @@ void exileSniffer::decodedTableMenuRequest(QPoint pos)
 	QAction action2("", this);
 	connect(&action2, SIGNAL(triggered()), this, SLOT(filterSelected()));
 
+	QAction loadAction("Load session archive...", this);
+	connect(&loadAction, SIGNAL(triggered()), this, SLOT(loadSessionArchive()));
+	loadAction.setEnabled(!archiveLoader || archiveLoader->ded);
+
 	QModelIndexList rowsSelected = ui.decodedListTable->selectionModel()->selectedRows();
 	if (rowsSelected.empty())
 	{
+		contextMenu.addAction(&loadAction);
 		contextMenu.exec(mapToGlobal(pos));
 		return;
 	}
 
-	QTableWidgetItem *rowitem = ui.decodedListTable->item(rowsSelected.front().row(), 0);
-	UIDecodedPkt* obj = (UIDecodedPkt*)rowitem->data(Qt::UserRole).value<UIDecodedPkt*>();
-
-	QString labeltext = "Filter PktID 0x" + QString::number(obj->getMessageID(), 16);
+	int row = rowsSelected.front().row();
+	QString labeltext = "Filter PktID 0x" + QString::number(decodedModel->message_id(row), 16);
 	action2.setText(labeltext);
 	contextMenu.addAction(&action2);
+
+	QAction action3("", this);
+	connect(&action3, SIGNAL(triggered()), this, SLOT(filterSelectedStream()));
+	if (decodedModel->stream_filter() == -1)
+		action3.setText("Only show stream " + QString::number(decodedModel->stream_id(row)));
+	else
+		action3.setText("Show all streams");
+	contextMenu.addAction(&action3);
+
+	contextMenu.addSeparator();
+	contextMenu.addAction(&loadAction);
+
 	contextMenu.exec(mapToGlobal(pos));
 	return;
 }
 
+/*
+Decodes a *_session.esa into the list on its own processor, a block at a
+time so the UI keeps up. Nothing is archived, logged or fed out again.
+*/
+void exileSniffer::loadSessionArchive()
+{
+	if (archiveLoader && !archiveLoader->ded)
+		return;
+
+	QString path = QFileDialog::getOpenFileName(this, tr("Load session archive"),
+		logDir.absolutePath(), tr("Session archives (*.esa)"));
+	if (path.isEmpty())
+		return;
+
+	//the last one has finished with them
+	delete archiveLoader;
+	delete archiveReader;
+	archiveLoader = NULL;
+
+	archiveReader = new session_archive_reader;
+	if (!archiveReader->open(path.toStdString()))
+	{
+		UIaddLogMsg("Failed to read session archive " + path, 0, &uiMsgQueue);
+		delete archiveReader;
+		archiveReader = NULL;
+		return;
+	}
+	if (archiveReader->was_recovered())
+		UIaddLogMsg("Session archive was not closed cleanly, recovered " +
+			QString::number(archiveReader->blocks().size()) + " blocks", 0, &uiMsgQueue);
+
+	archiveLoader = new packet_processor(NULL, &uiMsgQueue, NULL, NULL, ggpk);
+	archiveLoader->set_archive_replay(archiveReader);
+	std::thread archiveLoaderInstance(&packet_processor::ThreadEntry, archiveLoader);
+	archiveLoaderInstance.detach();
+}
+
 
 void exileSniffer::settingsSelectionChanged()
 {
@@ -6,9 +6,12 @@
 #include "packet_capture_thread.h"
 #include "key_grabber_thread.h"
 #include "json_pipe_thread.h"
+#include "socket_feed_thread.h"
 #include "packet_processor.h"
 #include "uiMsg.h"
 #include "clientHexData.h"
+#include "hexlog_writer.h"
+#include "decodedListModel.h"
 #include "gameDataStore.h"
 
 #include "ui_exileSniffer.h"
@@ -17,10 +20,11 @@
 #include "ui_rawfilterform.h"
 #include <fstream>
 
-#define DECODED_SECTION_TIME 0
-#define DECODED_SECTION_SENDER 1
-#define DECODED_SECTION_MSGID 2
-#define DECODED_SECTION_SUMMARY 3
+//messages taken off the UI queue at a time
+#define UI_BATCH_SIZE 256
+//how long read_UI_Q can spend per pass, grows while messages are backing up
+#define UI_FRAME_BUDGET_MIN_MS 8LL
+#define UI_FRAME_BUDGET_MAX_MS 150LL
 
 
 struct RAW_FILTERS {
@@ -38,13 +42,28 @@ class exileSniffer : public QMainWindow
 	public:
 		exileSniffer(QWidget *parent = Q_NULLPTR);
 		~exileSniffer() {
-			pipeThread->close();
+			if (pipeThread) pipeThread->close();
 			if (packetProcessor) packetProcessor->running = false;
 			if (packetSniffer) packetSniffer->stop_sniffing();
 			if (keyGrabber) keyGrabber->running = false;
 			if (pipeThread) pipeThread->running = false;
-			while (!keyGrabber->ded || !packetProcessor->ded || !packetSniffer->ded || !pipeThread->ded)
+			if (socketFeed) socketFeed->running = false;
+			if (feedBroker) feedBroker->running = false;
+			if (hexLogWriter) hexLogWriter->stop();
+			if (archiveLoader) archiveLoader->running = false;
+			while ((archiveLoader && !archiveLoader->ded) || !keyGrabber->ded || !packetProcessor->ded || !packetSniffer->ded || (pipeThread && !pipeThread->ded) || (socketFeed && !socketFeed->ded) ||
+				(feedBroker && !feedBroker->ded) || !hexLogWriter->ded)
 				Sleep(6);
+			//the processor has stopped writing to it
+			if (shmFeed)
+				delete shmFeed;
+			//after the processor so the last segments make it in
+			if (sessionArchive)
+			{
+				sessionArchive->stop();
+				while (!sessionArchive->ded)
+					Sleep(6);
+			}
 		}
 	
 	private slots:
@@ -54,10 +73,12 @@ class exileSniffer : public QMainWindow
 
 		void toggleDecodedAutoScroll(bool enabled);
 		void decodedListClicked();
-		void decodedCellActivated(int, int);
+		void decodedCellActivated(QModelIndex);
 		void decodedTableMenuRequest(QPoint);
 		void copySelected();
 		void filterSelected();
+		void filterSelectedStream();
+		void refilterDecodedList();
 		void stopDecrypting();
 		void resumeScanningEvent();
 		void settingsSelectionChanged(); 
@@ -65,6 +86,7 @@ class exileSniffer : public QMainWindow
 		void updateSettings(); 
 		void doLogSetDir();
 		void doLogOpenDir();
+		void loadSessionArchive();
 
 	private:
 
@@ -81,7 +103,6 @@ class exileSniffer : public QMainWindow
 		void action_ended_stream(int streamID);
 		void handle_stream_event(UI_STREAMEVENT_MSG *streamNote);
 		void handle_client_event(UI_CLIENTEVENT_MSG *cliEvtMsg);
-		void output_hex_to_file(UI_RAWHEX_PKT *pkt, std::ofstream& file);
 
 		void init_gamePkt_Actioners();
 		void init_loginPkt_Actioners();
@@ -90,16 +111,20 @@ class exileSniffer : public QMainWindow
 		void initFilters(); 
 
 		void action_UI_Msg(UI_MESSAGE *msg);
+		void flush_UI_updates();
 		void add_metalog_update(QString msg, DWORD pid);
-		void handle_raw_packet_data(UI_RAWHEX_PKT *pkt);
+		bool handle_raw_packet_data(UI_RAWHEX_PKT *pkt);
 		void action_undecoded_packet(UIDecodedPkt& decoded);
 		void action_decoded_packet(UIDecodedPkt& decoded);
 		void action_decoded_game_packet(UIDecodedPkt& decoded);
 		void action_decoded_login_packet(UIDecodedPkt& decoded);
+		bool payload_has_list(UIDecodedPkt& decoded, const wchar_t *listName, const char *warning);
+		bool game_payload_usable(UIDecodedPkt& decoded);
+		bool login_payload_usable(UIDecodedPkt& decoded);
 		
 		clientHexData * get_clientdata(DWORD pid);
-		void addDecodedListEntry(UIDecodedPkt *obj, bool isNewEntry = true);
-		void setRowColor(int row, QColor colour);
+		void addDecodedListEntry(UIDecodedPkt *obj);
+		QString render_summary(UIDecodedPkt& obj);
 
 		bool packet_passes_decoded_filter(ushort msgID);
 		void updateDecodedFilterLabel();
@@ -318,9 +343,11 @@ class exileSniffer : public QMainWindow
 		QString pipeName;
 		QDir logDir;
 		unsigned int metalogEntries = 0;
+		QString pendingMetalog;
+		bool decodedLabelStale = false;
+		long long uiFrameBudgetMS = UI_FRAME_BUDGET_MIN_MS;
 
 		std::pair <unsigned long, unsigned long> rawCount_Recorded_Filtered;
-		std::pair <int, int> decodedCount_Displayed_Filtered;	 //table row index is int
 		int decodedErrorPacketCount = 0;
 		
 		SafeQueue<UI_MESSAGE *> uiMsgQueue; //read by ui thread, written by all others
@@ -336,7 +363,9 @@ class exileSniffer : public QMainWindow
 		map<unsigned short, actionFunc> gamePktActioners;
 		map<unsigned short, actionFunc> loginPktActioners;
 		
-		std::vector<UIDecodedPkt *> decodedListEntries;
+		decodedListModel *decodedModel = NULL;
+		//rebuilt from the model for the details pane
+		UIDecodedPkt *detailsPacket = NULL;
 
 		const long long startMSSinceEpoch = ms_since_epoch();
 		bool activeDecryption = false;
@@ -350,7 +379,17 @@ private:
 	packet_capture_thread* packetSniffer;
 	key_grabber_thread* keyGrabber;
 	packet_processor* packetProcessor;
-	json_pipe_thread* pipeThread;
+	key_log *keyLog = NULL;
+	session_archive_writer *sessionArchive = NULL;
+	//a second processor that decodes an old session archive into the list
+	packet_processor *archiveLoader = NULL;
+	session_archive_reader *archiveReader = NULL;
+	hexlog_writer *hexLogWriter = NULL;
+	feed_broker* feedBroker = NULL;
+	json_pipe_thread* pipeThread = NULL;
+	socket_feed_thread* socketFeed = NULL;
+	shm_feed* shmFeed = NULL;
+	entity_store* entities = NULL;
 	gameDataStore *ggpk;
 };
 
@@ -0,0 +1,375 @@
+#include "stdafx.h"
+#include "feed_broker.h"
+
+bool FEED_SUBSCRIPTION::matches(UIDecodedPkt &packet)
+{
+	//deltas instead of the packets they come from
+	if (deltaMs && msgKeys.empty())
+		return false;
+	if (!msgKeys.empty() && !msgKeys.count(msg_key(packet.getStreamType(), packet.getMessageID())))
+		return false;
+	if (!streams.empty() && !streams.count(packet.getStreamID()))
+		return false;
+	if (direction == FEED_DIRECTION_INBOUND && !packet.isIncoming())
+		return false;
+	if (direction == FEED_DIRECTION_OUTBOUND && packet.isIncoming())
+		return false;
+	return true;
+}
+
+feed_subscriber::feed_subscriber(FEED_SUBSCRIPTION &request, std::string subscriberName)
+{
+	subscription = request;
+	name = subscriberName;
+	ring.resize(subscription.queueSize);
+}
+
+bool feed_subscriber::offer(const FEED_MESSAGE &message)
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	if (count == ring.size())
+	{
+		if (subscription.overflow == FEED_OVERFLOW_BLOCK)
+			return false;
+		ring[head].reset();
+		head = (head + 1) % ring.size();
+		--count;
+		++dropped;
+	}
+	ring[(head + count) % ring.size()] = message;
+	++count;
+	readyPending = true;
+	return true;
+}
+
+void feed_subscriber::set_preamble(const FEED_MESSAGE &message)
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	preamble = message;
+	readyPending = true;
+}
+
+void feed_subscriber::wait_for_space(int timeoutMS)
+{
+	std::unique_lock<std::mutex> lock(ringMutex);
+	spaceFree.wait_for(lock, std::chrono::milliseconds(timeoutMS),
+		[this] { return count < ring.size() || closed; });
+}
+
+size_t feed_subscriber::take(std::vector<char> &out, size_t maxBytes)
+{
+	size_t taken = 0;
+	bool tookPreamble = false;
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		if (preamble)
+		{
+			out.insert(out.end(), preamble->begin(), preamble->end());
+			preamble.reset();
+			tookPreamble = true;
+		}
+		while (count && out.size() < maxBytes)
+		{
+			const std::vector<char> &line = *ring[head];
+			out.insert(out.end(), line.begin(), line.end());
+			ring[head].reset();
+			head = (head + 1) % ring.size();
+			--count;
+			++taken;
+		}
+	}
+
+	if (taken)
+	{
+		delivered += taken;
+		spaceFree.notify_one();
+	}
+	return tookPreamble ? taken + 1 : taken;
+}
+
+size_t feed_subscriber::queued()
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	return preamble ? count + 1 : count;
+}
+
+void feed_subscriber::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		closed = true;
+	}
+	spaceFree.notify_all();
+}
+
+bool feed_broker::publish(UIDecodedPkt *packet)
+{
+	std::lock_guard<std::mutex> lock(subscribersMutex);
+	for (auto &subscriber : subscribers)
+	{
+		if (!subscriber->is_closed() && subscriber->subscription.matches(*packet))
+		{
+			++undelivered;
+			packetQ.addItem(packet);
+			return true;
+		}
+	}
+	return false;
+}
+
+std::shared_ptr<feed_subscriber> feed_broker::subscribe(std::string received, std::string subscriberName,
+	bool utf8, std::function<void()> onReady)
+{
+	//old subscribers never send anything and get the lot
+	FEED_SUBSCRIPTION request;
+	size_t lineEnd = received.find('\n');
+	if (lineEnd != std::string::npos)
+	{
+		received.resize(lineEnd);
+		std::string error;
+		if (!request.load(received, error))
+		{
+			UIaddLogMsg("Ignored bad feed subscription request: " + error, 0, uiMsgQueue);
+			request = FEED_SUBSCRIPTION();
+		}
+	}
+	request.utf8 = utf8;
+
+	std::shared_ptr<feed_subscriber> subscriber = std::make_shared<feed_subscriber>(request, subscriberName);
+	subscriber->onReady = onReady;
+	if (request.format == FEED_FORMAT_MSGPACK)
+		subscriber->set_preamble(feed_msgpack_header());
+	add_subscriber(subscriber);
+	return subscriber;
+}
+
+void feed_broker::add_subscriber(std::shared_ptr<feed_subscriber> subscriber)
+{
+	{
+		std::lock_guard<std::mutex> lock(subscribersMutex);
+		subscribers.push_back(subscriber);
+	}
+
+	FEED_SUBSCRIPTION &sub = subscriber->subscription;
+	std::stringstream note;
+	note << subscriber->name << " subscribed to " << sub.msgKeys.size() << " message types, " <<
+		sub.streams.size() << " streams, " << sub.fields.size() << " fields, queue of " << sub.queueSize <<
+		(sub.overflow == FEED_OVERFLOW_BLOCK ? " (blocking)" : "") << (sub.format == FEED_FORMAT_MSGPACK ? " as MsgPack" : "");
+	if (sub.deltaMs)
+		note << ", entity deltas every " << sub.deltaMs << "ms";
+	UIaddLogMsg(note.str(), 0, uiMsgQueue);
+}
+
+void feed_broker::remove_subscriber(std::shared_ptr<feed_subscriber> subscriber)
+{
+	subscriber->close();
+	{
+		std::lock_guard<std::mutex> lock(subscribersMutex);
+		auto it = std::find(subscribers.begin(), subscribers.end(), subscriber);
+		if (it != subscribers.end())
+			subscribers.erase(it);
+	}
+
+	if (!running)
+		return;
+	std::stringstream note;
+	note << subscriber->name << " disconnected after " << subscriber->delivered << " messages";
+	if (subscriber->dropped)
+		note << ", " << subscriber->dropped << " dropped";
+	UIaddLogMsg(note.str(), 0, uiMsgQueue);
+}
+
+size_t feed_broker::subscriber_count()
+{
+	std::lock_guard<std::mutex> lock(subscribersMutex);
+	return subscribers.size();
+}
+
+bool feed_broker::drained()
+{
+	if (undelivered)
+		return false;
+
+	std::lock_guard<std::mutex> lock(subscribersMutex);
+	for (auto &subscriber : subscribers)
+		if (subscriber->queued())
+			return false;
+	return true;
+}
+
+void feed_broker::main_loop()
+{
+	std::vector<UIDecodedPkt *> packets;
+	std::vector<std::shared_ptr<feed_subscriber> > targets;
+	unsigned long long lastDropReport = GetTickCount64();
+
+	while (running)
+	{
+		bool gotPackets = packetQ.waitItems(packets, FEED_BATCH_MESSAGES, wait_ms());
+		bool deltasDue = entities && GetTickCount64() >= nextDeltaDue;
+		if (gotPackets || deltasDue)
+		{
+			{
+				std::lock_guard<std::mutex> lock(subscribersMutex);
+				targets = subscribers;
+			}
+
+			for (UIDecodedPkt *packet : packets)
+			{
+				deliver(packet, targets);
+				delete packet;
+			}
+			if (deltasDue)
+				send_deltas(targets);
+			for (auto &subscriber : targets)
+				subscriber->wake();
+			undelivered -= packets.size();
+			packets.clear();
+			targets.clear();
+		}
+
+		if (GetTickCount64() - lastDropReport > FEED_DROP_REPORT_MS)
+		{
+			report_drops();
+			lastDropReport = GetTickCount64();
+		}
+	}
+
+	discard_queued();
+	ded = true;
+}
+
+void feed_broker::deliver(UIDecodedPkt *packet, std::vector<std::shared_ptr<feed_subscriber> > &targets)
+{
+	formats.clear();
+	for (auto &subscriber : targets)
+	{
+		if (subscriber->is_closed() || !subscriber->subscription.matches(*packet))
+			continue;
+
+		FEED_MESSAGE line;
+		for (auto &format : formats)
+		{
+			if (format.first->same_format(subscriber->subscription))
+			{
+				line = format.second;
+				break;
+			}
+		}
+
+		if (!line)
+		{
+			std::shared_ptr<std::vector<char> > serialised = std::make_shared<std::vector<char> >();
+			if (subscriber->subscription.format == FEED_FORMAT_MSGPACK)
+				serialise_feed_msgpack(packet, subscriber->subscription, *serialised);
+			else
+				serialise_feed_json(packet, subscriber->subscription, *serialised);
+			line = serialised;
+			formats.push_back(std::make_pair(&subscriber->subscription, line));
+		}
+
+		while (!subscriber->offer(line) && running && !subscriber->is_closed())
+		{
+			subscriber->wake();
+			subscriber->wait_for_space(FEED_BLOCK_WAIT_MS);
+		}
+	}
+	formats.clear();
+}
+
+int feed_broker::wait_ms()
+{
+	if (!entities)
+		return FEED_IDLE_WAIT_MS;
+	unsigned long long now = GetTickCount64();
+	if (now >= nextDeltaDue)
+		return 0;
+	return nextDeltaDue - now < FEED_IDLE_WAIT_MS ? (int)(nextDeltaDue - now) : FEED_IDLE_WAIT_MS;
+}
+
+void feed_broker::send_deltas(std::vector<std::shared_ptr<feed_subscriber> > &targets)
+{
+	unsigned long long now = GetTickCount64();
+	nextDeltaDue = now + FEED_IDLE_WAIT_MS;
+	for (auto &subscriber : targets)
+	{
+		if (!subscriber->subscription.deltaMs || subscriber->is_closed())
+			continue;
+		if (now >= subscriber->nextDeltaMs)
+		{
+			send_delta(*subscriber);
+			subscriber->nextDeltaMs = now + subscriber->subscription.deltaMs;
+		}
+		if (subscriber->nextDeltaMs < nextDeltaDue)
+			nextDeltaDue = subscriber->nextDeltaMs;
+	}
+}
+
+/*
+Each subscriber is at its own version of each client's table so deltas are
+made per subscriber, the scan only looks at rows that changed since.
+*/
+void feed_broker::send_delta(feed_subscriber &subscriber)
+{
+	//anything dropped since the last time could have been a delta, start it over
+	if (subscriber.dropped != subscriber.droppedAtDelta)
+	{
+		subscriber.deltaVersions.clear();
+		subscriber.droppedAtDelta = subscriber.dropped;
+	}
+
+	deltaClients.clear();
+	entities->clients(deltaClients);
+	for (DWORD pid : deltaClients)
+	{
+		auto version = subscriber.deltaVersions.find(pid);
+		ENTITY_DELTA delta;
+		entities->delta(pid, version == subscriber.deltaVersions.end() ? ENTITY_VERSION_NONE : version->second, delta);
+		if (delta.empty())
+			continue;
+
+		rapidjson::GenericDocument<rapidjson::UTF16<>, rapidjson::CrtAllocator> doc;
+		delta.to_json(doc);
+		std::shared_ptr<std::vector<char> > serialised = std::make_shared<std::vector<char> >();
+		if (subscriber.subscription.format == FEED_FORMAT_MSGPACK)
+			serialise_feed_msgpack_value(doc, *serialised);
+		else
+			serialise_feed_json_value(doc, subscriber.subscription, *serialised);
+
+		FEED_MESSAGE message = serialised;
+		while (!subscriber.offer(message) && running && !subscriber.is_closed())
+		{
+			subscriber.wake();
+			subscriber.wait_for_space(FEED_BLOCK_WAIT_MS);
+		}
+		subscriber.deltaVersions[pid] = delta.toVersion;
+	}
+}
+
+void feed_broker::report_drops()
+{
+	std::lock_guard<std::mutex> lock(subscribersMutex);
+	for (auto &subscriber : subscribers)
+	{
+		unsigned long long dropped = subscriber->dropped;
+		if (dropped == subscriber->droppedReported)
+			continue;
+
+		std::stringstream note;
+		note << subscriber->name << " is not keeping up, dropped " << (dropped - subscriber->droppedReported) <<
+			" messages (" << dropped << " so far)";
+		UIaddLogMsg(note.str(), 0, uiMsgQueue);
+		subscriber->droppedReported = dropped;
+	}
+}
+
+void feed_broker::discard_queued()
+{
+	std::vector<UIDecodedPkt *> packets;
+	while (packetQ.takeItems(packets, FEED_BATCH_MESSAGES))
+	{
+		for (UIDecodedPkt *packet : packets)
+			delete packet;
+		packets.clear();
+	}
+}
@@ -0,0 +1,206 @@
+#pragma once
+#include "base_thread.h"
+#include "safequeue.h"
+#include "uiMsg.h"
+#include "entity_store.h"
+#include <unordered_set>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+//packets taken off the queue at a time
+#define FEED_BATCH_MESSAGES 512
+//how long the broker waits for packets before checking if it should stop
+#define FEED_IDLE_WAIT_MS 50
+//how long a blocking subscriber is waited on before checking it is still there
+#define FEED_BLOCK_WAIT_MS 20
+//messages each subscriber can have waiting unless it asks for a different amount
+#define FEED_QUEUE_DEFAULT 8192
+#define FEED_QUEUE_MAX (1024 * 1024)
+//subscribers that are dropping messages get a warning at most this often
+#define FEED_DROP_REPORT_MS 5000
+//how long a new subscriber has to send its subscription request
+#define FEED_SUBSCRIBE_WAIT_MS 250
+#define FEED_REQUEST_MAX (64 * 1024)
+//fastest entity deltas can be asked for
+#define FEED_DELTA_MIN_MS 10
+
+#define FEED_DIRECTION_ANY 0
+#define FEED_DIRECTION_INBOUND 1
+#define FEED_DIRECTION_OUTBOUND 2
+
+#define FEED_FORMAT_JSON 0
+//see feed_msgpack.h
+#define FEED_FORMAT_MSGPACK 1
+
+//when a subscribers queue is full either its oldest message goes or the broker waits for it
+#define FEED_OVERFLOW_DROP_OLDEST 0
+#define FEED_OVERFLOW_BLOCK 1
+
+//a serialised line, shared by every subscriber that gets it
+typedef std::shared_ptr<const std::vector<char> > FEED_MESSAGE;
+
+/*
+What a subscriber asked for, sent as a line of json when it connects:
+	{"MsgTypes":["SRV_NOTIFY_PLAYERID"], "MsgIDs":[270], "Streams":[3],
+	 "Direction":"Inbound", "Fields":["ID1","NewValue"],
+	 "QueueSize":20000, "Overflow":"Block", "Format":"MsgPack", "Version":1,
+	 "Deltas":100}
+Every part is optional and an empty list means no restriction. MsgIDs
+are game message IDs, MsgTypes can be login or game names. Fields limits
+the Payload to those members, the metadata is always sent.
+QueueSize and Overflow ("DropOldest" or "Block") say what happens when
+it can't keep up. Format is "Json" (the default) or "MsgPack" and Version
+is the MsgPack layout it expects.
+Deltas asks for an ENTITY_DELTA message (see ENTITY_DELTA::to_json) for each
+client every that many ms that something changed. A subscriber that asks
+for deltas only gets packets if it names them in MsgTypes or MsgIDs.
+*/
+struct FEED_SUBSCRIPTION {
+	//streamType << 16 | msgID
+	std::unordered_set<unsigned int> msgKeys;
+	std::unordered_set<int> streams;
+	int direction = FEED_DIRECTION_ANY;
+	std::vector<std::wstring> fields;
+	size_t queueSize = FEED_QUEUE_DEFAULT;
+	int overflow = FEED_OVERFLOW_DROP_OLDEST;
+	int format = FEED_FORMAT_JSON;
+	//set by the transport, not the subscriber, MsgPack ignores it
+	bool utf8 = false;
+	//0 for no entity deltas
+	unsigned int deltaMs = 0;
+
+	//false with the reason in error if the request is no good
+	bool load(std::string request, std::string &error);
+	bool matches(UIDecodedPkt &packet);
+	//true if the two get byte for byte the same lines
+	bool same_format(FEED_SUBSCRIPTION &other) {
+		return format == other.format && (format == FEED_FORMAT_MSGPACK || utf8 == other.utf8) && fields == other.fields;
+	}
+	static unsigned int msg_key(streamType stream, ushort msgID) { return ((unsigned int)stream << 16) | msgID; }
+};
+
+/*
+One connected subscriber, a fixed size ring of lines waiting for its transport
+
+The broker offers lines, the transport takes them as it is able to write them.
+*/
+class feed_subscriber
+{
+public:
+	feed_subscriber(FEED_SUBSCRIPTION &request, std::string subscriberName);
+
+	//false if the ring is full and the subscriber wants the broker to wait
+	bool offer(const FEED_MESSAGE &message);
+	//sent before anything on the ring, never dropped
+	void set_preamble(const FEED_MESSAGE &message);
+	void wait_for_space(int timeoutMS);
+	//appends waiting lines to out until it has maxBytes, returns how many
+	size_t take(std::vector<char> &out, size_t maxBytes);
+	size_t queued();
+	//the transport calls this when the subscriber goes away
+	void close();
+	bool is_closed() { return closed; }
+	//the broker calls this after a batch, runs onReady if anything was added
+	void wake() { if (readyPending.exchange(false) && onReady) onReady(); }
+
+	FEED_SUBSCRIPTION subscription;
+	std::string name;
+	//set by the transport before adding the subscriber, so it can stop waiting
+	std::function<void()> onReady;
+	std::atomic<unsigned long long> delivered{ 0 };
+	std::atomic<unsigned long long> dropped{ 0 };
+	//what the last drop warning said
+	unsigned long long droppedReported = 0;
+
+	//only the broker thread uses these
+	//the version of each client's entities it last sent
+	std::map<DWORD, uint64_t> deltaVersions;
+	unsigned long long nextDeltaMs = 0;
+	//a dropped delta means the next one has to be a reset
+	unsigned long long droppedAtDelta = 0;
+
+private:
+	std::mutex ringMutex;
+	std::condition_variable spaceFree;
+	FEED_MESSAGE preamble;
+	std::vector<FEED_MESSAGE> ring;
+	size_t head = 0;
+	size_t count = 0;
+	std::atomic<bool> closed{ false };
+	std::atomic<bool> readyPending{ false };
+};
+
+/*
+Fans decoded packets out to every subscriber that wants them
+
+The UI thread hands packets over with publish. Here each packet is serialised
+once for each different format subscribers want (usually just one) and the
+same bytes are put on the ring of each of them. A slow subscriber loses its
+oldest lines or, if it asked to, holds up the broker until it catches up -
+which holds up everyone else too so it is only for things that can't miss
+anything.
+
+Transports own the connections, they add a subscriber when one arrives and
+write out whatever is on its ring.
+*/
+class feed_broker :
+	public base_thread
+{
+public:
+	feed_broker(SafeQueue<UI_MESSAGE *> *uiq) : uiMsgQueue(uiq) {};
+	//where subscribers that ask for deltas get them from, set before starting
+	void set_entity_store(entity_store *store) { entities = store; }
+
+	//false if nobody wants it, otherwise the broker deletes the packet when done
+	bool publish(UIDecodedPkt *packet);
+	/*
+	for transports, received is whatever the subscriber sent before the deadline
+	and onReady is run on the broker thread when there is something for it
+	*/
+	std::shared_ptr<feed_subscriber> subscribe(std::string received, std::string subscriberName,
+		bool utf8, std::function<void()> onReady);
+	void add_subscriber(std::shared_ptr<feed_subscriber> subscriber);
+	//logs what it was sent and what it missed
+	void remove_subscriber(std::shared_ptr<feed_subscriber> subscriber);
+	size_t subscriber_count();
+	//true once everything published has been taken by the transports
+	bool drained();
+
+	bool running = true;
+	bool ded = false;
+
+private:
+	void main_loop();
+	void deliver(UIDecodedPkt *packet, std::vector<std::shared_ptr<feed_subscriber> > &targets);
+	void send_deltas(std::vector<std::shared_ptr<feed_subscriber> > &targets);
+	void send_delta(feed_subscriber &subscriber);
+	//how long to wait for packets before a delta is due
+	int wait_ms();
+	void report_drops();
+	void discard_queued();
+
+	SafeQueue<UI_MESSAGE *> *uiMsgQueue;
+	SafeQueue<UIDecodedPkt *> packetQ;
+	//published packets that aren't on the subscribers queues yet
+	std::atomic<size_t> undelivered{ 0 };
+
+	std::mutex subscribersMutex;
+	std::vector<std::shared_ptr<feed_subscriber> > subscribers;
+
+	//formats serialised for the packet being delivered
+	std::vector<std::pair<FEED_SUBSCRIPTION *, FEED_MESSAGE> > formats;
+
+	entity_store *entities = NULL;
+	unsigned long long nextDeltaDue = 0;
+	std::vector<DWORD> deltaClients;
+};
+
+//append the packet in the subscription's format
+void serialise_feed_json(UIDecodedPkt *packet, FEED_SUBSCRIPTION &subscription, std::vector<char> &out);
+void serialise_feed_msgpack(UIDecodedPkt *packet, FEED_SUBSCRIPTION &subscription, std::vector<char> &out);
+//messages the broker makes itself, like entity deltas
+void serialise_feed_json_value(WValue &value, FEED_SUBSCRIPTION &subscription, std::vector<char> &out);
+void serialise_feed_msgpack_value(WValue &value, std::vector<char> &out);
+//what a MsgPack subscriber gets before any messages
+FEED_MESSAGE feed_msgpack_header();
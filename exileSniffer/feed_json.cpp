@@ -0,0 +1,238 @@
+#include "stdafx.h"
+#include "feed_broker.h"
+#include "feed_msgpack.h"
+#include "rapidjson/writer.h"
+
+//the json side of the feed, what subscribers ask for and the lines they get
+
+//lets a rapidjson writer serialise straight onto the end of a line
+template <typename CharT>
+struct line_stream {
+	typedef CharT Ch;
+	line_stream(std::vector<char> &out) : line(out) {}
+	void Put(Ch c) {
+		const char *bytes = (const char *)&c;
+		for (size_t i = 0; i < sizeof(Ch); ++i)
+			line.push_back(bytes[i]);
+	}
+	void Flush() {}
+
+	std::vector<char> &line;
+};
+
+//message IDs index their messageTypes list
+static bool find_msgType(rapidjson::GenericValue<rapidjson::UTF8<>> *types, const char *name, ushort &msgID)
+{
+	if (!types || !types->IsArray())
+		return false;
+
+	for (rapidjson::SizeType i = 0; i < types->Size(); ++i)
+	{
+		auto nameIt = (*types)[i].FindMember("Name");
+		if (nameIt != (*types)[i].MemberEnd() && nameIt->value.IsString() &&
+			strcmp(nameIt->value.GetString(), name) == 0)
+		{
+			msgID = (ushort)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FEED_SUBSCRIPTION::load(std::string request, std::string &error)
+{
+	rapidjson::Document doc;
+	doc.Parse(request.c_str());
+	if (doc.HasParseError() || !doc.IsObject())
+	{
+		error = "not a json object";
+		return false;
+	}
+
+	auto it = doc.FindMember("MsgTypes");
+	if (it != doc.MemberEnd() && it->value.IsArray())
+	{
+		for (auto &name : it->value.GetArray())
+		{
+			if (!name.IsString())
+				continue;
+			ushort msgID;
+			bool found = false;
+			if (find_msgType(UIDecodedPkt::gameMessageTypes, name.GetString(), msgID))
+			{
+				msgKeys.insert(msg_key(eGame, msgID));
+				found = true;
+			}
+			if (find_msgType(UIDecodedPkt::loginMessageTypes, name.GetString(), msgID))
+			{
+				msgKeys.insert(msg_key(eLogin, msgID));
+				found = true;
+			}
+			if (!found)
+			{
+				error = std::string("unknown MsgType ") + name.GetString();
+				return false;
+			}
+		}
+	}
+
+	it = doc.FindMember("MsgIDs");
+	if (it != doc.MemberEnd() && it->value.IsArray())
+		for (auto &msgID : it->value.GetArray())
+			if (msgID.IsUint())
+				msgKeys.insert(msg_key(eGame, (ushort)msgID.GetUint()));
+
+	it = doc.FindMember("Streams");
+	if (it != doc.MemberEnd() && it->value.IsArray())
+		for (auto &streamID : it->value.GetArray())
+			if (streamID.IsInt())
+				streams.insert(streamID.GetInt());
+
+	it = doc.FindMember("Direction");
+	if (it != doc.MemberEnd() && it->value.IsString())
+	{
+		std::string direction = it->value.GetString();
+		if (direction == "Inbound")
+			this->direction = FEED_DIRECTION_INBOUND;
+		else if (direction == "Outbound")
+			this->direction = FEED_DIRECTION_OUTBOUND;
+	}
+
+	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+	it = doc.FindMember("Fields");
+	if (it != doc.MemberEnd() && it->value.IsArray())
+		for (auto &field : it->value.GetArray())
+			if (field.IsString())
+				fields.push_back(converter.from_bytes(field.GetString()));
+
+	it = doc.FindMember("QueueSize");
+	if (it != doc.MemberEnd() && it->value.IsUint())
+	{
+		queueSize = it->value.GetUint();
+		if (queueSize < 1 || queueSize > FEED_QUEUE_MAX)
+		{
+			error = "QueueSize out of range";
+			return false;
+		}
+	}
+
+	it = doc.FindMember("Format");
+	if (it != doc.MemberEnd() && it->value.IsString())
+	{
+		std::string name = it->value.GetString();
+		if (name == "MsgPack")
+			format = FEED_FORMAT_MSGPACK;
+		else if (name != "Json")
+		{
+			error = "unknown Format " + name;
+			return false;
+		}
+	}
+
+	it = doc.FindMember("Version");
+	if (it != doc.MemberEnd() && format == FEED_FORMAT_MSGPACK &&
+		(!it->value.IsUint() || it->value.GetUint() != FEED_MSGPACK_VERSION))
+	{
+		error = "MsgPack Version " + std::to_string(it->value.IsUint() ? it->value.GetUint() : 0) +
+			" asked for, this is version " + std::to_string(FEED_MSGPACK_VERSION);
+		return false;
+	}
+
+	it = doc.FindMember("Deltas");
+	if (it != doc.MemberEnd())
+	{
+		if (!it->value.IsUint() || it->value.GetUint() < FEED_DELTA_MIN_MS)
+		{
+			error = "Deltas has to be at least " + std::to_string(FEED_DELTA_MIN_MS) + "ms";
+			return false;
+		}
+		deltaMs = it->value.GetUint();
+	}
+
+	it = doc.FindMember("Overflow");
+	if (it != doc.MemberEnd() && it->value.IsString())
+	{
+		std::string policy = it->value.GetString();
+		if (policy == "Block")
+			overflow = FEED_OVERFLOW_BLOCK;
+		else if (policy == "DropOldest")
+			overflow = FEED_OVERFLOW_DROP_OLDEST;
+		else
+		{
+			error = "unknown Overflow " + policy;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//the packets json with only the subscribed payload fields
+template <typename Writer>
+static void write_projection(UIDecodedPkt *packet, std::vector<std::wstring> &fields, Writer &writer)
+{
+	writer.StartObject();
+	for (auto member = packet->jsn.MemberBegin(); member != packet->jsn.MemberEnd(); ++member)
+	{
+		writer.Key(member->name.GetString(), member->name.GetStringLength());
+		if (&member->value != packet->payload)
+		{
+			member->value.Accept(writer);
+			continue;
+		}
+
+		writer.StartObject();
+		for (std::wstring &field : fields)
+		{
+			auto fieldIt = member->value.FindMember(field.c_str());
+			if (fieldIt == member->value.MemberEnd())
+				continue;
+			writer.Key(field.c_str(), (rapidjson::SizeType)field.size());
+			fieldIt->value.Accept(writer);
+		}
+		writer.EndObject();
+	}
+	writer.EndObject();
+}
+
+void serialise_feed_json(UIDecodedPkt *packet, FEED_SUBSCRIPTION &subscription, std::vector<char> &out)
+{
+	if (subscription.fields.empty())
+	{
+		serialise_feed_json_value(packet->jsn, subscription, out);
+		return;
+	}
+
+	if (subscription.utf8)
+	{
+		line_stream<char> stream(out);
+		rapidjson::Writer<line_stream<char>, rapidjson::UTF16<>, rapidjson::UTF8<>> writer(stream);
+		write_projection(packet, subscription.fields, writer);
+		stream.Put('\n');
+	}
+	else
+	{
+		line_stream<wchar_t> stream(out);
+		rapidjson::Writer<line_stream<wchar_t>, rapidjson::UTF16<>, rapidjson::UTF16<>> writer(stream);
+		write_projection(packet, subscription.fields, writer);
+		stream.Put(L'\r'); //ends the line for readers
+	}
+}
+
+void serialise_feed_json_value(WValue &value, FEED_SUBSCRIPTION &subscription, std::vector<char> &out)
+{
+	if (subscription.utf8)
+	{
+		line_stream<char> stream(out);
+		rapidjson::Writer<line_stream<char>, rapidjson::UTF16<>, rapidjson::UTF8<>> writer(stream);
+		value.Accept(writer);
+		stream.Put('\n');
+	}
+	else
+	{
+		line_stream<wchar_t> stream(out);
+		rapidjson::Writer<line_stream<wchar_t>, rapidjson::UTF16<>, rapidjson::UTF16<>> writer(stream);
+		value.Accept(writer);
+		stream.Put(L'\r');
+	}
+}
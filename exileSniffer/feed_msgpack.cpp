@@ -0,0 +1,70 @@
+#include "stdafx.h"
+#include "feed_broker.h"
+#include "feed_msgpack.h"
+
+FEED_MESSAGE feed_msgpack_header()
+{
+	static const char header[FEED_MSGPACK_HEADER_SIZE] = {
+		FEED_MSGPACK_MAGIC[0], FEED_MSGPACK_MAGIC[1], FEED_MSGPACK_MAGIC[2], FEED_MSGPACK_MAGIC[3],
+		FEED_MSGPACK_VERSION, FEED_MSGPACK_FORMAT_ID, 0, 0 };
+	static FEED_MESSAGE message = std::make_shared<const std::vector<char> >(header, header + sizeof(header));
+	return message;
+}
+
+//the length goes in front once it is known
+static void frame_length(std::vector<char> &out, size_t lengthAt)
+{
+	uint32_t length = (uint32_t)(out.size() - lengthAt - 4);
+	for (int i = 0; i < 4; ++i)
+		out[lengthAt + i] = (char)(length >> (i * 8));
+}
+
+void serialise_feed_msgpack_value(WValue &value, std::vector<char> &out)
+{
+	size_t lengthAt = out.size();
+	out.resize(lengthAt + 4);
+	msgpack_writer writer(out);
+	writer.value(value);
+	frame_length(out, lengthAt);
+}
+
+void serialise_feed_msgpack(UIDecodedPkt *packet, FEED_SUBSCRIPTION &subscription, std::vector<char> &out)
+{
+	if (subscription.fields.empty())
+	{
+		serialise_feed_msgpack_value(packet->jsn, out);
+		return;
+	}
+
+	size_t lengthAt = out.size();
+	out.resize(lengthAt + 4);
+	msgpack_writer writer(out);
+	//same as the json projection, metadata and the chosen payload fields
+	writer.map(packet->jsn.MemberCount());
+	for (auto member = packet->jsn.MemberBegin(); member != packet->jsn.MemberEnd(); ++member)
+	{
+		writer.str(member->name.GetString(), member->name.GetStringLength());
+		if (&member->value != packet->payload)
+		{
+			writer.value(member->value);
+			continue;
+		}
+
+		size_t found = 0;
+		for (std::wstring &field : subscription.fields)
+			if (member->value.HasMember(field.c_str()))
+				++found;
+
+		writer.map(found);
+		for (std::wstring &field : subscription.fields)
+		{
+			auto fieldIt = member->value.FindMember(field.c_str());
+			if (fieldIt == member->value.MemberEnd())
+				continue;
+			writer.str(field.c_str(), field.size());
+			writer.value(fieldIt->value);
+		}
+	}
+
+	frame_length(out, lengthAt);
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+/*
+The binary feed, for subscribers that ask for "Format":"MsgPack"
+
+The stream starts with an 8 byte header: "ESFD", the version, the format
+(1 for MessagePack) and two zero bytes. Then each message is a 4 byte little
+endian length followed by that many bytes of one MessagePack map with the
+same keys and values as the json line would have, strings in UTF-8 and
+numbers in the smallest type that holds them.
+
+A subscriber can send "Version" in its request to make sure it gets the
+layout it understands, it is refused if it doesn't match.
+*/
+#define FEED_MSGPACK_MAGIC "ESFD"
+#define FEED_MSGPACK_VERSION 1
+#define FEED_MSGPACK_FORMAT_ID 1
+#define FEED_MSGPACK_HEADER_SIZE 8
+
+//MessagePack onto the end of a buffer, only what the feed needs
+class msgpack_writer
+{
+public:
+	msgpack_writer(std::vector<char> &output) : out(output) {}
+
+	void nil() { out.push_back((char)0xc0); }
+	void boolean(bool value) { out.push_back(value ? (char)0xc3 : (char)0xc2); }
+
+	void unsigned_int(uint64_t value)
+	{
+		if (value < 0x80)
+			out.push_back((char)value);
+		else if (value <= 0xff)
+			tagged(0xcc, value, 1);
+		else if (value <= 0xffff)
+			tagged(0xcd, value, 2);
+		else if (value <= 0xffffffff)
+			tagged(0xce, value, 4);
+		else
+			tagged(0xcf, value, 8);
+	}
+
+	void signed_int(int64_t value)
+	{
+		if (value >= 0)
+			unsigned_int((uint64_t)value);
+		else if (value >= -32)
+			out.push_back((char)value);
+		else if (value >= INT8_MIN)
+			tagged(0xd0, (uint64_t)value, 1);
+		else if (value >= INT16_MIN)
+			tagged(0xd1, (uint64_t)value, 2);
+		else if (value >= INT32_MIN)
+			tagged(0xd2, (uint64_t)value, 4);
+		else
+			tagged(0xd3, (uint64_t)value, 8);
+	}
+
+	void floating(double value)
+	{
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		tagged(0xcb, bits, 8);
+	}
+
+	void map(size_t count) { header(count, 0x80, 16, 0xde, 0xdf); }
+	void array(size_t count) { header(count, 0x90, 16, 0xdc, 0xdd); }
+
+	//UTF-16 (or UTF-32 where wchar_t is that big) in, UTF-8 out
+	template <typename Ch>
+	void str(const Ch *text, size_t length)
+	{
+		//most strings are short enough for a one byte header, it is widened after if not
+		size_t start = out.size();
+		out.push_back(0);
+		for (size_t i = 0; i < length; ++i)
+		{
+			uint32_t code = (uint32_t)text[i];
+			if (code >= 0xd800 && code < 0xdc00 && i + 1 < length &&
+				(uint32_t)text[i + 1] >= 0xdc00 && (uint32_t)text[i + 1] < 0xe000)
+			{
+				code = 0x10000 + ((code - 0xd800) << 10) + ((uint32_t)text[i + 1] - 0xdc00);
+				++i;
+			}
+
+			if (code < 0x80)
+				out.push_back((char)code);
+			else if (code < 0x800)
+			{
+				out.push_back((char)(0xc0 | (code >> 6)));
+				out.push_back((char)(0x80 | (code & 0x3f)));
+			}
+			else if (code < 0x10000)
+			{
+				out.push_back((char)(0xe0 | (code >> 12)));
+				out.push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+				out.push_back((char)(0x80 | (code & 0x3f)));
+			}
+			else
+			{
+				out.push_back((char)(0xf0 | (code >> 18)));
+				out.push_back((char)(0x80 | ((code >> 12) & 0x3f)));
+				out.push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+				out.push_back((char)(0x80 | (code & 0x3f)));
+			}
+		}
+
+		size_t size = out.size() - start - 1;
+		if (size < 32)
+		{
+			out[start] = (char)(0xa0 | size);
+			return;
+		}
+
+		char wide[5];
+		int headerSize = size <= 0xff ? 2 : (size <= 0xffff ? 3 : 5);
+		wide[0] = (char)(headerSize == 2 ? 0xd9 : (headerSize == 3 ? 0xda : 0xdb));
+		for (int i = 1; i < headerSize; ++i)
+			wide[i] = (char)(size >> ((headerSize - 1 - i) * 8));
+		out[start] = wide[0];
+		out.insert(out.begin() + start + 1, wide + 1, wide + headerSize);
+	}
+
+	//any rapidjson value, members in document order
+	template <typename ValueT>
+	void value(const ValueT &val)
+	{
+		if (val.IsObject())
+		{
+			map(val.MemberCount());
+			for (auto member = val.MemberBegin(); member != val.MemberEnd(); ++member)
+			{
+				str(member->name.GetString(), member->name.GetStringLength());
+				value(member->value);
+			}
+		}
+		else if (val.IsArray())
+		{
+			array(val.Size());
+			for (auto element = val.Begin(); element != val.End(); ++element)
+				value(*element);
+		}
+		else if (val.IsString())
+			str(val.GetString(), val.GetStringLength());
+		else if (val.IsBool())
+			boolean(val.GetBool());
+		else if (val.IsUint64())
+			unsigned_int(val.GetUint64());
+		else if (val.IsInt64())
+			signed_int(val.GetInt64());
+		else if (val.IsNumber())
+			floating(val.GetDouble());
+		else
+			nil();
+	}
+
+private:
+	//tag then the low size bytes of value, big endian
+	void tagged(int tag, uint64_t value, int size)
+	{
+		out.push_back((char)tag);
+		for (int shift = (size - 1) * 8; shift >= 0; shift -= 8)
+			out.push_back((char)(value >> shift));
+	}
+
+	void header(size_t count, int fixTag, size_t fixLimit, int tag16, int tag32)
+	{
+		if (count < fixLimit)
+			out.push_back((char)(fixTag | count));
+		else if (count <= 0xffff)
+			tagged(tag16, count, 2);
+		else
+			tagged(tag32, count, 4);
+	}
+
+	std::vector<char> &out;
+};
@@ -55,6 +55,14 @@ bool filterForm::isDisplayed(ushort pktID)
 	return (it->second == eDisplayState::displayed);
 }
 
+void filterForm::getDisplayedIDs(std::vector<bool> &displayed)
+{
+	displayed.assign(USHRT_MAX + 1, true);
+	for (auto &state : filterStates)
+		if (state.second != eDisplayState::displayed)
+			displayed[state.first] = false;
+}
+
 void filterForm::populateFiltersList(rapidjson::GenericValue<rapidjson::UTF8<>> &msgInfo)
 {
 	ui->filterTable->horizontalHeader()->setSectionResizeMode(FILTER_SECTION_FUNCTION, QHeaderView::Stretch);
@@ -31,6 +31,8 @@ public:
 		void populateFiltersList(rapidjson::GenericValue<rapidjson::UTF8<>> &msgInfo);
 		void populatePresetsList();
 		bool isDisplayed(ushort pktID);
+		//isDisplayed for every ID at once
+		void getDisplayedIDs(std::vector<bool> &displayed);
 
 		void setFilterRowState(int row, eDisplayState newState);
 
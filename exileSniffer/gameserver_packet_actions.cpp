@@ -328,103 +328,56 @@ void exileSniffer::init_gamePkt_Actioners()
 
 }
 
-void exileSniffer::setRowColor(int tablerow, QColor colour)
+void exileSniffer::addDecodedListEntry(UIDecodedPkt *entry)
 {
+	//will only work for packets in the good range. 0x9F02 is still gonna show up
+	bool filterable;
+	if (entry->decodeError() && !entry->wasAbandoned())
+		filterable = entry->getMessageID() < rawFiltersFormUI.filterTable->rowCount();
+	else
+		filterable = entry->getStreamType() == eGame;
 
-	for (int tablecolumn = 0; tablecolumn < ui.decodedListTable->columnCount(); tablecolumn++)
-	{
-		QTableWidgetItem *item = ui.decodedListTable->item(tablerow, tablecolumn);
-		if(item)
-			item->setBackgroundColor(colour);
-	}
+	bool displayed = !filterable || packet_passes_decoded_filter(entry->getMessageID());
+	decodedModel->add_row(entry, filterable, displayed);
 }
 
-void exileSniffer::addDecodedListEntry(UIDecodedPkt *entry, bool isNewEntry)
+/*
+The decoded list asks for this when a row comes into view, long after the
+packet was actioned. The actioners only render text with analysis NULL,
+anything that has to happen as packets arrive goes in the action_decoded_*
+functions instead - including the payload checks that warn about or drop
+broken packets, so this never logs anything.
+*/
+QString exileSniffer::render_summary(UIDecodedPkt& obj)
 {
-	if (isNewEntry)
-		decodedListEntries.push_back(entry);
-
-	unsigned int rowIndex = ui.decodedListTable->rowCount();
-	ui.decodedListTable->setRowCount(rowIndex + 1);
-	if(ui.decodedAutoscrollCheck->isChecked())
-		ui.decodedListTable->scrollToBottom();
-
-	QTableWidgetItem *time = new QTableWidgetItem(entry->floatSeconds(startMSSinceEpoch));
-	time->setData(Qt::UserRole, QVariant::fromValue<UIDecodedPkt *>(entry)); //add object pointer to first column
-	ui.decodedListTable->setItem(rowIndex, DECODED_SECTION_TIME, time);
-
-	QTableWidgetItem *sender = new QTableWidgetItem(entry->senderString());
-	ui.decodedListTable->setItem(rowIndex, DECODED_SECTION_SENDER, sender);
-
-	QTableWidgetItem *pktIDItem = new QTableWidgetItem(entry->hexPktID());
-	ui.decodedListTable->setItem(rowIndex, DECODED_SECTION_MSGID, pktIDItem);
-
-	if (entry->decodeError())
-	{
-		entry->summary = "<!BAD!>" + entry->summary;
-
-		QTableWidgetItem *summary = new QTableWidgetItem(entry->summary);
-		ui.decodedListTable->setItem(rowIndex, DECODED_SECTION_SUMMARY, summary);
-
-		setRowColor(rowIndex, QColor(255, 150, 150, 255));
-		return;
-	}
-
-	if (entry->wasAbandoned())
+	if (obj.decodeError() && !obj.wasAbandoned())
 	{
-		entry->summary = "<!ABAND!>" + entry->summary;
-
-		QTableWidgetItem *summary = new QTableWidgetItem(entry->summary);
-		ui.decodedListTable->setItem(rowIndex, DECODED_SECTION_SUMMARY, summary);
-
-		setRowColor(rowIndex, QColor(255, 175, 175, 255));
-		return;
+		wstringstream summary;
+		summary << "Undecoded packet or poorly decoded previous packet (~ "
+			<< std::dec << obj.pktBytes.size() << " byte";
+		summary << ((obj.pktBytes.size() == 1) ? ")" : "s)");
+		return QString::fromStdWString(summary.str());
 	}
 
-	QTableWidgetItem *summary = new QTableWidgetItem(entry->summary);
-	ui.decodedListTable->setItem(rowIndex, DECODED_SECTION_SUMMARY, summary);
-
+	map<unsigned short, actionFunc>* actionerList;
+	if (obj.getStreamType() == eGame)
+		actionerList = &gamePktActioners;
+	else
+		actionerList = &loginPktActioners;
 
-	streamType streamServer = entry->getStreamType();
-	ushort msgid = entry->getMessageID();
+	auto it = actionerList->find(obj.getMessageID());
+	if (it == actionerList->end())
+		return QString();
 
-	if (streamServer == eGame)
-	{
-		if (entry->isIncoming())
-			setRowColor(rowIndex, Qt::white);
-		else
-			setRowColor(rowIndex, QColor(235, 235, 235, 255)); //grey
-	}
-	else
-	{
-		if (streamServer == eLogin)
-		{
-			if (entry->isIncoming())
-				setRowColor(rowIndex, QColor(255, 255, 230, 255));  //yellowy
-			else
-				setRowColor(rowIndex, QColor(255, 255, 200, 255));	//dark yellowy	
-		}
-		else
-			setRowColor(rowIndex, Qt::red);
-		//else if (flags & PKTBIT_PATCHSERVER)
-		//	setRowColor(rowIndex, QColor(153, 217, 234, 255));
-	}
+	exileSniffer::actionFunc f = it->second;
+	(this->*f)(obj, NULL);
+	if (obj.summary.isEmpty())
+		return "No summary for " + obj.hexPktID() + " (" + QString::number(obj.pktBytes.size()) + " bytes)";
+	return obj.summary;
 }
 
 void exileSniffer::action_undecoded_packet(UIDecodedPkt& obj)
 {
-	obj.toggle_payload_operations(true);
-
-	//will only work for packets in the good range. 0x9F02 is still gonna show up
-	ushort pktID = obj.getMessageID();
-	if (pktID < rawFiltersFormUI.filterTable->rowCount() && !packet_passes_decoded_filter(pktID))
-	{
-		++decodedCount_Displayed_Filtered.second;
-		obj.setFiltered();
-		updateDecodedFilterLabel();
-		return;
-	}
-
 	if (!obj.originalbuf) 
 	{
 		stringstream err;
@@ -433,17 +386,9 @@ void exileSniffer::action_undecoded_packet(UIDecodedPkt& obj)
 		return;
 	}
 
-	wstringstream summary;
-	summary << "Undecoded packet or poorly decoded previous packet (~ "
-		<< std::dec << obj.pktBytes.size() << " byte";
-	summary << ((obj.pktBytes.size() == 1) ? ")" : "s)");
-
-
-	obj.summary = QString::fromStdWString(summary.str());
 	addDecodedListEntry(&obj);
-
 	++decodedErrorPacketCount;
-	updateDecodedFilterLabel();
+	decodedLabelStale = true;
 }
 
 void exileSniffer::action_decoded_packet(UIDecodedPkt& decoded)
@@ -454,24 +399,67 @@ void exileSniffer::action_decoded_packet(UIDecodedPkt& decoded)
 		action_decoded_login_packet(decoded);
 }
 
-void exileSniffer::action_decoded_game_packet(UIDecodedPkt& decoded)
+//warns if the payload lacks a list its actioner reads
+bool exileSniffer::payload_has_list(UIDecodedPkt& decoded, const wchar_t *listName, const char *warning)
+{
+	if (decoded.payload && decoded.payload->HasMember(listName) && decoded.payload->FindMember(listName)->value.IsArray())
+		return true;
+	add_metalog_update(warning, decoded.getClientProcessID());
+	return false;
+}
+
+/*
+The payload checks for the actioners, done once as each packet arrives so
+rendering a summary never logs anything.
+False if the packet is too broken to list.
+*/
+bool exileSniffer::game_payload_usable(UIDecodedPkt& decoded)
 {
-	if (!packet_passes_decoded_filter(decoded.getMessageID()))
+	switch (decoded.getMessageID())
 	{
-		decoded.setFiltered();
-		++decodedCount_Displayed_Filtered.second;
-		updateDecodedFilterLabel();
-		return;
-	}
+	case SRV_AREA_INFO:
+		return payload_has_list(decoded, L"PreloadHashList", "Warning: No list found in payload of SRV_AREA_INFO");
 
-	auto it = gamePktActioners.find(decoded.getMessageID());
-	if (it != gamePktActioners.end())
+	case SRV_PRELOAD_MONSTER_LIST:
 	{
-		exileSniffer::actionFunc f = it->second;
-		(this->*f)(decoded, NULL);
+		if (!payload_has_list(decoded, L"PreloadList", "Warning: No list found in payload of SRV_PRELOAD_MONSTER_LIST"))
+			return false;
+		//only the analysis reads the entries
+		WValue &monsterList = decoded.payload->FindMember(L"PreloadList")->value;
+		for (auto it = monsterList.Begin(); it != monsterList.End(); it++)
+			if (!it->IsArray() || it->Size() != 3)
+			{
+				add_metalog_update("Warning: Bad pair dat array in SRV_PRELOAD_MONSTER_LIST", decoded.getClientProcessID());
+				break;
+			}
+		return true;
+	}
+
+	case SRV_SLOT_ITEMSLIST:
+		//the summary only needs the count
+		payload_has_list(decoded, L"ItemList", "Warning: No itemlist found in payload of action_SRV_SLOT_ITEMSLIST");
+		return true;
+
+	case SRV_UNK_0xCA:
+		return payload_has_list(decoded, L"ItemArray", "Warning: No itemlist found in payload of action_SRV_UNK_0xCA");
+
+	default:
+		return true;
+	}
+}
+
+void exileSniffer::action_decoded_game_packet(UIDecodedPkt& decoded)
+{
+	//the packets it wraps are actioned instead
+	if (decoded.getMessageID() == SRV_PKT_ENCAPSULATED)
+		return;
 
-		++decodedCount_Displayed_Filtered.first;
-		updateDecodedFilterLabel();
+	if (gamePktActioners.find(decoded.getMessageID()) != gamePktActioners.end())
+	{
+		if (!game_payload_usable(decoded))
+			return;
+		addDecodedListEntry(&decoded);
+		decodedLabelStale = true;
 	}
 	else
 	{
@@ -523,7 +511,6 @@ void exileSniffer::action_CLI_CHAT_MSG_ITEMS(UIDecodedPkt& obj, QString *analysi
 	if (!analysis)
 	{
 		obj.summary= "Player(You) sent chat message with with linked item ";
-		addDecodedListEntry(&obj);
 		return;
 	}
 	
@@ -554,7 +541,6 @@ void exileSniffer::action_CLI_CHAT_COMMAND(UIDecodedPkt& obj, QString *analysis)
 			" [Arg 0x: " << std::hex << arg << "]";
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -605,7 +591,6 @@ void exileSniffer::action_SRV_CHAT_MESSAGE(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -642,7 +627,6 @@ void exileSniffer::action_SRV_SERVER_MESSAGE(UIDecodedPkt& obj, QString *analysi
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -697,7 +681,6 @@ void exileSniffer::action_CLI_LOGGED_OUT(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Game client logged out. [Arg: 0x"+QString::number((byte)arg, 16)+"]";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -712,7 +695,6 @@ void exileSniffer::action_CLI_CHAT_MSG(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Player(You) spoke in chat: "+ QString::fromStdWString(obj.get_wstring(L"Message"));
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -739,7 +721,6 @@ void exileSniffer::action_CLI_HNC(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Game Client sent ping challenge 0x" + QString::number(challenge, 16);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -754,7 +735,6 @@ void exileSniffer::action_SRV_HNC(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Server sent HNC response 0x" + QString::number(response, 16);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -770,7 +750,6 @@ void exileSniffer::action_SRV_AREA_INFO(UIDecodedPkt& obj, QString *analysis)
 	auto it = obj.payload->FindMember(L"PreloadHashList");
 	if (it == obj.payload->MemberEnd())
 	{
-		add_metalog_update("Warning: No list found in payload of SRV_AREA_INFO", obj.getClientProcessID());
 		return;
 	}
 	WValue &preloadList = it->value;
@@ -784,7 +763,6 @@ void exileSniffer::action_SRV_AREA_INFO(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -925,7 +903,6 @@ void exileSniffer::action_SRV_PRELOAD_MONSTER_LIST(UIDecodedPkt& obj, QString *a
 	auto it = obj.payload->FindMember(L"PreloadList");
 	if (it == obj.payload->MemberEnd())
 	{
-		add_metalog_update("Warning: No list found in payload of SRV_PRELOAD_MONSTER_LIST", obj.getClientProcessID());
 		return;
 	}
 	
@@ -939,7 +916,6 @@ void exileSniffer::action_SRV_PRELOAD_MONSTER_LIST(UIDecodedPkt& obj, QString *a
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -950,7 +926,7 @@ void exileSniffer::action_SRV_PRELOAD_MONSTER_LIST(UIDecodedPkt& obj, QString *a
 		auto dayArray = it->GetArray();
 		if (dayArray.Size() != 3)
 		{
-			add_metalog_update("Warning: Bad pair dat array in SRV_PRELOAD_MONSTER_LIST", obj.getClientProcessID());
+			*analysis = "Bad pair dat array in the preload list";
 			return;
 		}
 		std::wstring varietyName = dayArray[1].GetString();
@@ -1008,7 +984,6 @@ void exileSniffer::action_SRV_UNK_0x13(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -1061,7 +1036,6 @@ void exileSniffer::action_SRV_ITEMS_LIST(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Server listing items held by obj ID: 0x"+QString::number(objID,16);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1090,7 +1064,6 @@ void exileSniffer::action_CLI_CLICKED_GROUND_ITEM(UIDecodedPkt& obj, QString *an
 		summary << " seq: 0x" << seq;
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1118,7 +1091,6 @@ void exileSniffer::action_CLI_ACTION_PREDICTIVE(UIDecodedPkt& obj, QString *anal
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1134,7 +1106,6 @@ void exileSniffer::action_SRV_TRANSFER_INSTANCE(UIDecodedPkt& obj, QString *anal
 	{
 
 		obj.summary= "Server transferred account to another instance. Arg 0x" + QString::number(arg, 16);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1146,7 +1117,6 @@ void exileSniffer::action_SRV_INSTANCE_SERVER_DATA(UIDecodedPkt& obj, QString *a
 	{
 
 		obj.summary= QString::fromStdWString(L"Server sent instance server data");
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1167,7 +1137,6 @@ void exileSniffer::action_CLI_PICKUP_ITEM(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1188,7 +1157,6 @@ void exileSniffer::action_CLI_PLACE_ITEM(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1202,7 +1170,6 @@ void exileSniffer::action_CLI_DROP_ITEM(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Dropped held item on ground";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1214,7 +1181,6 @@ void exileSniffer::action_CLI_REMOVE_SOCKET(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "Player(You) emptied socket";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1226,7 +1192,6 @@ void exileSniffer::action_CLI_INSERT_SOCKET(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "Player(You) inserted into socket";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1238,7 +1203,6 @@ void exileSniffer::action_CLI_LEVEL_SKILLGEM(UIDecodedPkt& obj, QString *analysi
 	{
 
 		obj.summary= "Player(You) levelled a skillgem";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1256,7 +1220,6 @@ void exileSniffer::action_SRV_UNK_0x20(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1269,7 +1232,6 @@ void exileSniffer::action_CLI_SKILLPOINT_CHANGE(UIDecodedPkt& obj, QString *anal
 	{
 
 		obj.summary= "Player(You) added a skillpoint";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1284,7 +1246,6 @@ void exileSniffer::action_CLI_CHOSE_ASCENDANCY(UIDecodedPkt& obj, QString *analy
 	{
 
 		obj.summary= "Player chose ascendancy "+QString::number(choice);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1306,7 +1267,6 @@ void exileSniffer::action_CLI_MERGE_STACK(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1321,7 +1281,6 @@ void exileSniffer::action_CLI_CANCEL_BUF(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Attempted to cancel buff "+QString::number(buffID,10);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1333,7 +1292,6 @@ void exileSniffer::action_SRV_UNK_0x2c(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Unknown packet 0x2c. Unk size bytes read (4 seen) + 13 bytes at end";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1357,7 +1315,6 @@ void exileSniffer::action_CLI_SELECT_MAPTRAVEL(UIDecodedPkt& obj, QString *analy
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1373,7 +1330,6 @@ void exileSniffer::action_CLI_SET_HOTBARSKILL(UIDecodedPkt& obj, QString *analys
 	{
 
 		obj.summary= "Set hotbar slot "+QString::number(slot)+" to 0x"+QString::number(skillID, 16);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1385,7 +1341,6 @@ void exileSniffer::action_SRV_SKILL_SLOTS_LIST(UIDecodedPkt& obj, QString *analy
 	{
 
 		obj.summary= "Server sent hotbar skill ID list";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -1418,7 +1373,6 @@ void exileSniffer::action_CLI_REVIVE_CHOICE(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "Player chose revive option " + QString::number(choice);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1466,7 +1420,6 @@ void exileSniffer::action_SRV_YOU_DIED(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= summary + " Arg: 0x"+QString::number(unk1, 16);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1486,7 +1439,6 @@ void exileSniffer::action_CLI_ACTIVATE_ITEM(UIDecodedPkt& obj, QString *analysis
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1501,7 +1453,6 @@ void exileSniffer::action_CLI_USE_BELT_SLOT(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "Activated belt slot "+QString::number(slot);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1524,7 +1475,6 @@ void exileSniffer::action_CLI_USE_ITEM_ON_ITEM(UIDecodedPkt& obj, QString *analy
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1544,7 +1494,6 @@ void exileSniffer::action_CLI_USE_ITEM_ON_OBJ(UIDecodedPkt& obj, QString *analys
 		summary << "Used item 0x" << std::hex << itemID << " on object 0x" << objectID << ", Unk: 0x"<< unk;
 
 		obj.summary = QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1559,7 +1508,6 @@ void exileSniffer::action_CLI_UNK_0x41(UIDecodedPkt& obj, QString* analysis)
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1574,7 +1522,6 @@ void exileSniffer::action_CLI_SELECT_NPC_DIALOG(UIDecodedPkt& obj, QString *anal
 	{
 
 		obj.summary= "Client selected dialog option "+QString::number(option);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1596,7 +1543,6 @@ void exileSniffer::action_SRV_SHOW_NPC_DIALOG(UIDecodedPkt& obj, QString *analys
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -1614,7 +1560,6 @@ void exileSniffer::action_CLI_CLOSE_NPC_DIALOG(UIDecodedPkt& obj, QString *analy
 	{
 
 		obj.summary= "Player closed dialog";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1644,7 +1589,6 @@ void exileSniffer::action_SRV_OPEN_UI_PANE(UIDecodedPkt& obj, QString* analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1670,7 +1614,6 @@ void exileSniffer::action_CLI_SPLIT_STACK(UIDecodedPkt& obj, QString* analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1690,7 +1633,6 @@ void exileSniffer::action_SRV_LIST_PORTALS(UIDecodedPkt& obj, QString* analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -1727,7 +1669,6 @@ void exileSniffer::action_CLI_SEND_PARTY_INVITE(UIDecodedPkt& obj, QString* anal
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1743,7 +1684,6 @@ void exileSniffer::action_CLI_TRY_JOIN_PARTY(UIDecodedPkt& obj, QString*analysis
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1758,7 +1698,6 @@ void exileSniffer::action_CLI_DISBAND_PUBLIC_PARTY(UIDecodedPkt& obj, QString*an
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1774,7 +1713,6 @@ void exileSniffer::action_CLI_CREATE_PUBLICPARTY(UIDecodedPkt& obj, QString*anal
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1791,7 +1729,6 @@ void exileSniffer::action_CLI_UNK_x56(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Sent packet 0x56 argument: " + QString::number(arg);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1806,7 +1743,6 @@ void exileSniffer::action_CLI_GET_PARTY_DETAILS(UIDecodedPkt& obj, QString*analy
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1823,7 +1759,6 @@ void exileSniffer::action_SRV_FRIENDSLIST(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -1869,7 +1804,6 @@ void exileSniffer::action_SRV_PARTY_DETAILS(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "Server sent details for public party (" + QString::number(listSize) + " members)";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -1899,7 +1833,6 @@ void exileSniffer::action_SRV_PARTY_ENDED(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Party ended";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1911,7 +1844,6 @@ void exileSniffer::action_CLI_REQUEST_PUBLICPARTIES(UIDecodedPkt& obj, QString *
 	{
 
 		obj.summary= "Client requested latest public parties - arg " + obj.get_UInt32(L"Arg");
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1923,7 +1855,6 @@ void exileSniffer::action_SRV_PUBLIC_PARTY_LIST(UIDecodedPkt& obj, QString *anal
 	{
 
 		obj.summary= "Server sent list of public parties";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -1949,7 +1880,6 @@ void exileSniffer::action_CLI_MOVE_ITEM_PANE(UIDecodedPkt& obj, QString *analysi
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -1969,7 +1899,6 @@ void exileSniffer::action_CLI_CONFIRM_SELL(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -1992,7 +1921,6 @@ void exileSniffer::action_SRV_UNK_0x67(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2020,7 +1948,6 @@ void exileSniffer::action_SRV_UNK_0x68(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2046,7 +1973,6 @@ void exileSniffer::action_SRV_UNK_0x6c(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2075,7 +2001,6 @@ void exileSniffer::action_SRV_CREATE_ITEM(UIDecodedPkt& obj, QString *analysis)
 		summary << "Server updated items in inventory";
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2149,14 +2074,12 @@ void exileSniffer::action_SRV_SLOT_ITEMSLIST(UIDecodedPkt& obj, QString *analysi
 		summary << "Server sent list of " << std::dec << itemCount << " items in slot " << container;
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
 	auto it = obj.payload->FindMember(L"ItemList");
 	if (it == obj.payload->MemberEnd())
 	{
-		add_metalog_update("Warning: No itemlist found in payload of action_SRV_SLOT_ITEMSLIST", obj.getClientProcessID());
 		return;
 	}
 	WValue &itemList = it->value;
@@ -2215,7 +2138,6 @@ void exileSniffer::action_SRV_INVENTORY_SET_REMOVE(UIDecodedPkt& obj, QString *a
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2234,7 +2156,6 @@ void exileSniffer::action_SRV_GRANTED_XP(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2253,7 +2174,6 @@ void exileSniffer::action_CLI_SELECT_STASHTAB(UIDecodedPkt& obj, QString *analys
 		summary << "Client changed stash tab. Data: 0x" << std::hex << unk1 << ", 0x"<<unk2<<", 0x"<<unk3;
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2272,7 +2192,6 @@ void exileSniffer::action_SRV_STASHTAB_DATA(UIDecodedPkt& obj, QString *analysis
 		summary << "Stash tab data: 0x" << std::hex << unk1 << ", 0x" << unk2 << ", 0x" << unk3;
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2292,7 +2211,6 @@ void exileSniffer::action_SRV_UNK_0x73(UIDecodedPkt& obj, QString *analysis)
 			<< ", String2: "<<string2 <<" (bad strings? Different length data...)";
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2308,7 +2226,6 @@ void exileSniffer::action_CLI_SET_STATUS_MESSAGE(UIDecodedPkt& obj, QString *ana
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2334,7 +2251,6 @@ void exileSniffer::action_SRV_MOVE_OBJECT(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2370,7 +2286,6 @@ void exileSniffer::action_CLI_ACTIVATE_MAP(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Player activate map device";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2387,7 +2302,6 @@ void exileSniffer::action_CLI_SWAPPED_WEAPONS(UIDecodedPkt& obj, QString *analys
 	{
 
 		obj.summary= "Swapped to weapon slot "+QString::number(arg,10);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2408,7 +2322,6 @@ void exileSniffer::action_SRV_ADJUST_LIGHTING(UIDecodedPkt& obj, QString *analys
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2435,7 +2348,6 @@ void exileSniffer::action_CLI_TRANSFER_ITEM(UIDecodedPkt& obj, QString *analysis
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2454,7 +2366,6 @@ void exileSniffer::action_SRV_INVENTORY_FULL(UIDecodedPkt& obj, QString *analysi
 	{
 
 		obj.summary= "'Inventory Full' notice";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2536,7 +2447,6 @@ void exileSniffer::action_SRV_PVP_MATCHLIST(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "List of "+ QString::number(listSize)+" available PVP match types";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2554,7 +2464,6 @@ void exileSniffer::action_SRV_EVENTSLIST(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "List of " + QString::number(listSize) + " available events to join";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2570,7 +2479,6 @@ void exileSniffer::action_CLI_SKILLPANE_ACTION(UIDecodedPkt& obj, QString *analy
 	{
 
 		obj.summary= "Used skillpane";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2585,7 +2493,6 @@ void exileSniffer::action_SRV_ACHIEVEMENT_1(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "Achievement_1 arg: 0x" + QString::number(arg,16);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2600,7 +2507,6 @@ void exileSniffer::action_SRV_ACHIEVEMENT_2(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "Achievement_2 arg: 0x" + QString::number(arg, 16);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2612,7 +2518,6 @@ void exileSniffer::action_SRV_SKILLPANE_DATA(UIDecodedPkt& obj, QString *analysi
 	{
 
 		obj.summary= "Skillpane data from server";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2639,7 +2544,6 @@ void exileSniffer::action_SRV_UNK_POSITION_LIST(UIDecodedPkt& obj, QString *anal
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2664,7 +2568,6 @@ void exileSniffer::action_CLI_MICROTRANSACTION_SHOP_ACTION(UIDecodedPkt& obj, QS
 	{
 
 		obj.summary= "Player(You) opened microtransaction pane";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2676,7 +2579,6 @@ void exileSniffer::action_SRV_MICROTRANSACTION_SHOP_DETAILS(UIDecodedPkt& obj, Q
 	{
 
 		obj.summary= "Transaction pane details from server";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2693,7 +2595,6 @@ void exileSniffer::action_CLI_UNK_A3(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2709,7 +2610,6 @@ void exileSniffer::action_SRV_UNK_A5(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Unknown list A5";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2762,7 +2662,6 @@ void exileSniffer::action_CLI_UNK_0xC6(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Client sent dataless message ID 0xC6";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2775,7 +2674,6 @@ void exileSniffer::action_CLI_UNK_0xC7(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Client sent dataless message ID 0xC7";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2791,7 +2689,6 @@ void exileSniffer::action_SRV_UNK_0xCA(UIDecodedPkt& obj, QString *analysis)
 	auto it = obj.payload->FindMember(L"ItemArray");
 	if (it == obj.payload->MemberEnd())
 	{
-		add_metalog_update("Warning: No itemlist found in payload of action_SRV_UNK_0xCA", obj.getClientProcessID());
 		return;
 	}
 	WValue &itemList = it->value;
@@ -2806,7 +2703,6 @@ void exileSniffer::action_SRV_UNK_0xCA(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2824,7 +2720,6 @@ void exileSniffer::action_SRV_EVENTSLIST_2(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "List of " + QString::number(listSize) + " available events to join";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2850,7 +2745,6 @@ void exileSniffer::action_CLI_USED_SKILL(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2874,7 +2768,6 @@ void exileSniffer::action_CLI_CLICK_OBJ(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2890,7 +2783,6 @@ void exileSniffer::action_CLI_MOUSE_HELD(UIDecodedPkt& obj, QString *analysis)
 		
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2902,7 +2794,6 @@ void exileSniffer::action_SRV_NOTIFY_AFK(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "You are AFK?";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2915,7 +2806,6 @@ void exileSniffer::action_CLI_MOUSE_RELEASE(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "Released mouse";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2927,7 +2817,6 @@ void exileSniffer::action_CLI_OPEN_WORLD_SCREEN(UIDecodedPkt& obj, QString *anal
 	{
 
 		obj.summary= "Player opened world screen";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2949,7 +2838,6 @@ void exileSniffer::action_SRV_CHAT_CHANNEL_ID(UIDecodedPkt& obj, QString *analys
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -2970,7 +2858,6 @@ void exileSniffer::action_SRV_GUILD_MEMBER_LIST(UIDecodedPkt& obj, QString *anal
 	{
 
 		obj.summary= "Guild member listing";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -2996,7 +2883,6 @@ void exileSniffer::action_CLI_GUILD_CREATE(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary= "Player(You) created guild";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3014,7 +2900,6 @@ void exileSniffer::action_SRV_UNK_0xE4(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3044,7 +2929,6 @@ void exileSniffer::action_SRV_UNK_0xE6(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3057,7 +2941,6 @@ void exileSniffer::action_CLI_EXIT_TO_CHARSCREEN(UIDecodedPkt& obj, QString *ana
 	{
 
 		obj.summary= "Client exited";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3069,7 +2952,6 @@ void exileSniffer::action_SRV_LOGINSRV_CRYPT(UIDecodedPkt& obj, QString *analysi
 	{
 
 		obj.summary= "Server sent loginserver data for character screen display";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3094,7 +2976,6 @@ void exileSniffer::action_CLI_DUEL_CHALLENGE(UIDecodedPkt& obj, QString *analysi
 	{
 
 		obj.summary= "Player initiated duel challenge";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3109,7 +2990,6 @@ void exileSniffer::action_SRV_DUEL_RESPONSE(UIDecodedPkt& obj, QString *analysis
 	{
 
 		obj.summary= "Player responded to duel challenge";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3124,7 +3004,6 @@ void exileSniffer::action_SRV_DUEL_CHALLENGE(UIDecodedPkt& obj, QString *analysi
 	{
 
 		obj.summary= "Duel challenge from server";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3151,7 +3030,6 @@ void exileSniffer::action_SRV_OBJ_REMOVED(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3196,7 +3074,6 @@ void exileSniffer::action_SRV_MOBILE_START_SKILL(UIDecodedPkt& obj, QString *ana
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3217,7 +3094,6 @@ void exileSniffer::action_SRV_MOBILE_FINISH_SKILL(UIDecodedPkt& obj, QString *an
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3245,7 +3121,6 @@ void exileSniffer::action_SRV_MOVE_CHANNELLED(UIDecodedPkt& obj, QString *analys
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3273,7 +3148,6 @@ void exileSniffer::action_SRV_END_CHANNELLED(UIDecodedPkt& obj, QString *analysi
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3316,7 +3190,6 @@ void exileSniffer::action_SRV_MOBILE_UNK_0xee(UIDecodedPkt& obj, QString *analys
 	{
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3344,7 +3217,6 @@ void exileSniffer::action_SRV_MOBILE_UNK_0xef(UIDecodedPkt& obj, QString *analys
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3387,7 +3259,6 @@ void exileSniffer::action_SRV_MOBILE_UPDATE_HMS(UIDecodedPkt& obj, QString *anal
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3414,7 +3285,6 @@ void exileSniffer::action_SRV_STAT_CHANGED(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3460,7 +3330,6 @@ void exileSniffer::action_SRV_UNK_0xf2(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3488,7 +3357,6 @@ void exileSniffer::action_SRV_UNK_0xf3(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3511,7 +3379,6 @@ void exileSniffer::action_SRV_UNK_0xf5(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3536,7 +3403,6 @@ void exileSniffer::action_SRV_UNK_0xf6(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3560,7 +3426,6 @@ void exileSniffer::action_SRV_UNK_0xf7(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3581,7 +3446,6 @@ void exileSniffer::action_SRV_UNK_0xf8(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3613,7 +3477,6 @@ void exileSniffer::action_SRV_START_BUFF(UIDecodedPkt& obj, QString *analysis) /
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3658,7 +3521,6 @@ void exileSniffer::action_SRV_END_EFFECT(UIDecodedPkt& obj, QString *analysis) /
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3681,7 +3543,6 @@ void exileSniffer::action_SRV_EVENT_TRIGGERED(UIDecodedPkt& obj, QString *analys
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3711,7 +3572,6 @@ void exileSniffer::action_SRV_UNK_0x106(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3750,7 +3610,6 @@ void exileSniffer::action_SRV_UNK_0x108(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3771,7 +3630,6 @@ void exileSniffer::action_CLI_FINISHED_LOADING(UIDecodedPkt& obj, QString *analy
 	{
 
 		obj.summary= "Client finished loading the zone";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3792,7 +3650,6 @@ void exileSniffer::action_SRV_NOTIFY_PLAYERID(UIDecodedPkt& obj, QString *analys
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3826,7 +3683,6 @@ void exileSniffer::action_SRV_UNKNOWN_0x111(UIDecodedPkt& obj, QString *analysis
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3856,7 +3712,6 @@ void exileSniffer::action_SRV_UNKNOWN_0x118(UIDecodedPkt& obj, QString *analysis
 		summary << "pkt 0x118 <item/gem/skill data> ";
 		summary << std::dec << index << ": " << converter.from_bytes(hashResult) << ". 0x" << unk1 << " 0x" << unk2a << unk2b;
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -3878,7 +3733,6 @@ void exileSniffer::action_CLI_OPTOUT_TUTORIALS(UIDecodedPkt &obj, QString *analy
 	if (!analysis)
 	{
 		obj.summary= "Player(You) opted out of tutorials";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3889,7 +3743,6 @@ void exileSniffer::action_SRV_BESTIARY_CAPTIVES(UIDecodedPkt& obj, QString *anal
 	if (!analysis)
 	{
 		obj.summary= "Server sent list of menagerie captives";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3900,7 +3753,6 @@ void exileSniffer::action_CLI_OPEN_BESTIARY(UIDecodedPkt& obj, QString *analysis
 	if (!analysis)
 	{
 		obj.summary= "Client requested bestiary data";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3911,7 +3763,6 @@ void exileSniffer::action_SRV_BESTIARY_UNLOCKED_LIST(UIDecodedPkt& obj, QString
 	if (!analysis)
 	{
 		obj.summary= "Server sent updated list of unlocked bestiary monsters";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3927,7 +3778,6 @@ void exileSniffer::action_SRV_SHOW_ENTERING_MSG(UIDecodedPkt& obj, QString *anal
 	if (!analysis)
 	{
 		obj.summary= "Starting transtion to area " + QString::fromStdWString(areaname);
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3939,7 +3789,6 @@ void exileSniffer::action_SRV_HEARTBEAT(UIDecodedPkt& obj, QString *analysis)
 	if (!analysis)
 	{
 		obj.summary= "Server Heartbeat";
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -3981,7 +3830,6 @@ void exileSniffer::action_SRV_ADD_OBJECT(UIDecodedPkt& obj, QString *analysis)
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -4206,7 +4054,6 @@ void exileSniffer::action_SRV_UPDATE_OBJECT(UIDecodedPkt& obj, QString *analysis
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -4226,7 +4073,6 @@ void exileSniffer::action_SRV_IDNOTIFY_0x137(UIDecodedPkt& obj, QString *analysi
 
 
 		obj.summary= QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -813,7 +813,7 @@ void packet_processor::deserialise_SRV_ITEMS_LIST(UIDecodedPkt* uipkt)
 
 void packet_processor::deserialise_CLI_LOGGED_OUT(UIDecodedPkt *uipkt)
 {
-	UInotifyStreamState(currentMsgStreamID, eStreamEnded, uiMsgQueue);
+	notify_stream_state(eStreamEnded);
 	consume_add_byte(L"Arg", uipkt);
 }
 
@@ -875,7 +875,7 @@ void packet_processor::deserialise_SRV_INSTANCE_SERVER_DATA(UIDecodedPkt *uipkt)
 
 	key1A->sourceProcess = key1B->sourceProcess = uipkt->getClientProcessID();
 	key1A->foundAddress = key1B->foundAddress = SENT_BY_SERVER;
-	pendingGameserverKeys[nextConnectionID] = make_pair(key1A, key1B);
+	add_pending_gameserver_keys(nextConnectionID, key1A, key1B);
 }
 
 void packet_processor::deserialise_CLI_PICKUP_ITEM(UIDecodedPkt *uipkt)
@@ -1634,7 +1634,7 @@ void packet_processor::deserialise_SRV_UNK_A5(UIDecodedPkt *uipkt)
 
 void packet_processor::deserialise_CLI_EXIT_TO_CHARSCREEN(UIDecodedPkt *uipkt)
 {
-	UInotifyStreamState(currentMsgStreamID, eStreamTransitionLogin, uiMsgQueue);
+	notify_stream_state(eStreamTransitionLogin);
 }
 
 
@@ -2289,7 +2289,7 @@ void packet_processor::deserialise_SRV_BESTIARY_UNLOCKED_LIST(UIDecodedPkt *uipk
 
 void packet_processor::deserialise_SRV_SHOW_ENTERING_MSG(UIDecodedPkt *uipkt)
 {
-	UInotifyStreamState(currentMsgStreamID, eStreamTransitionGame, uiMsgQueue);
+	notify_stream_state(eStreamTransitionGame);
 	consume_add_dword_ntoh(L"AreaCode", uipkt);
 }
 
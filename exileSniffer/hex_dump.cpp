@@ -0,0 +1,35 @@
+#include "stdafx.h"
+#include "hex_dump.h"
+
+static HEXDUMP_LUT build_lut()
+{
+	static const char digits[] = "0123456789ABCDEF";
+	HEXDUMP_LUT lut;
+	for (int i = 0; i < 256; ++i)
+	{
+		lut.hexpairs[i][0] = digits[i >> 4];
+		lut.hexpairs[i][1] = digits[i & 0xf];
+		lut.ascii[i] = (i >= ' ' && i <= '~') ? (char)i : '.';
+	}
+	return lut;
+}
+
+const HEXDUMP_LUT &hexdump_lut()
+{
+	static const HEXDUMP_LUT lut = build_lut();
+	return lut;
+}
+
+std::string hex_spaced_string(const byte *data, size_t size)
+{
+	std::string hex(size * 3, ' ');
+	write_hex_spaced(data, size, &hex[0]);
+	return hex;
+}
+
+std::wstring hex_spaced_wstring(const byte *data, size_t size)
+{
+	std::wstring hex(size * 3, L' ');
+	write_hex_spaced(data, size, &hex[0]);
+	return hex;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+//bytes per row in the hex/ascii dumps
+#define HEXDUMP_ROW 16
+
+/*
+Byte formatting shared by the hex logs, the decoded details pane,
+the key widgets and hex blob decoding
+
+Everything writes straight into a buffer the caller sized, one table
+lookup per byte. The character type is a template parameter so the
+same code produces UTF-8 for files and UTF-16 (wchar_t, QChar data)
+for the UI. Each writer returns the end of what it wrote.
+*/
+struct HEXDUMP_LUT {
+	char hexpairs[256][2];
+	char ascii[256];
+};
+const HEXDUMP_LUT &hexdump_lut();
+
+//" XX" for every byte - needs size*3 characters
+template <typename CharT>
+CharT *write_hex_spaced(const byte *data, size_t size, CharT *out)
+{
+	const HEXDUMP_LUT &lut = hexdump_lut();
+	for (size_t i = 0; i < size; ++i)
+	{
+		const char *pair = lut.hexpairs[data[i]];
+		out[0] = (CharT)' ';
+		out[1] = (CharT)pair[0];
+		out[2] = (CharT)pair[1];
+		out += 3;
+	}
+	return out;
+}
+
+//printable characters as themselves, anything else as '.' - needs size characters
+template <typename CharT>
+CharT *write_ascii(const byte *data, size_t size, CharT *out)
+{
+	const HEXDUMP_LUT &lut = hexdump_lut();
+	for (size_t i = 0; i < size; ++i)
+		out[i] = (CharT)lut.ascii[data[i]];
+	return out + size;
+}
+
+//lowercase hex, padded with zeros to minDigits - needs up to 16 characters
+template <typename CharT>
+CharT *write_hex_number(unsigned long long value, int minDigits, CharT *out)
+{
+	static const char digits[] = "0123456789abcdef";
+	int count = 1;
+	while (count < 16 && (value >> (count * 4)))
+		++count;
+	if (count < minDigits)
+		count = minDigits;
+
+	for (int i = count - 1; i >= 0; --i, value >>= 4)
+		out[i] = (CharT)digits[value & 0xf];
+	return out + count;
+}
+
+template <typename CharT>
+CharT *write_text(const char *text, CharT *out)
+{
+	while (*text)
+		*out++ = (CharT)*text++;
+	return out;
+}
+
+//space separated hex of the whole buffer
+std::string hex_spaced_string(const byte *data, size_t size);
+std::wstring hex_spaced_wstring(const byte *data, size_t size);
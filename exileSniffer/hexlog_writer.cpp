@@ -0,0 +1,143 @@
+#include "stdafx.h"
+#include "hexlog_writer.h"
+#include "hex_dump.h"
+
+static std::string serverString(streamType server)
+{
+	switch (server)
+	{
+	case streamType::eGame:
+		return "Server[Game]";
+	case streamType::eLogin:
+		return "Server[Login]";
+	case streamType::ePatch:
+		return "Server[Patch]";
+	default:
+		return "Server[Unknown]";
+	}
+}
+
+void hexlog_writer::format_segment(HEXLOG_ENTRY &entry, std::string &out)
+{
+	UI_RAWHEX_PKT *pkt = entry.pkt.get();
+	size_t size = pkt->pktBytes.size();
+	const byte *data = pkt->pktBytes.data();
+
+	char timestamp[20];
+	struct tm *tm = gmtime(&pkt->createdtime);
+	strftime(timestamp, sizeof(timestamp), "%H:%M:%S", tm);
+
+	out.clear();
+	out += "#" + std::to_string(entry.recordNumber) + " " + timestamp + " ";
+	if (pkt->incoming)
+		out += serverString(pkt->stream) + " to PlayerClient";
+	else
+		out += "PlayerClient to " + serverString(pkt->stream);
+	out += " (" + std::to_string(size) + " bytes)\n";
+
+	//3 chars per byte + 3 per row for the hex rows, 1 + 4 for the ascii rows
+	size_t headerSize = out.size();
+	size_t rows = size / HEXDUMP_ROW + 1;
+	out.resize(headerSize + size * 4 + rows * 7 + 16);
+	char *pos = &out[headerSize];
+
+	pos = write_text("  ", pos);
+	for (size_t row = 0; row < size; row += HEXDUMP_ROW)
+	{
+		size_t rowSize = min(size - row, (size_t)HEXDUMP_ROW);
+		pos = write_hex_spaced(data + row, rowSize, pos);
+		if (rowSize == HEXDUMP_ROW)
+			pos = write_text("\n  ", pos);
+	}
+	pos = write_text("\r\n\n   ", pos);
+
+	for (size_t row = 0; row < size; row += HEXDUMP_ROW)
+	{
+		size_t rowSize = min(size - row, (size_t)HEXDUMP_ROW);
+		pos = write_ascii(data + row, rowSize, pos);
+		if (rowSize == HEXDUMP_ROW)
+			pos = write_text("\n   ", pos);
+	}
+	pos = write_text("\n\n\n", pos);
+
+	out.resize(pos - out.data());
+}
+
+void hexlog_writer::queue_text(std::ofstream &file, std::string &text)
+{
+	if (!file.is_open()) return;
+
+	std::string &pending = pendingText[&file];
+	pending += text;
+	if (pending.size() >= HEXLOG_BLOCK_SIZE)
+		write_blocks(file, pending, false);
+}
+
+//whole blocks only unless partial is set
+void hexlog_writer::write_blocks(std::ofstream &file, std::string &pending, bool partial)
+{
+	size_t writeSize = partial ? pending.size() : (pending.size() / HEXLOG_BLOCK_SIZE) * HEXLOG_BLOCK_SIZE;
+	if (!writeSize) return;
+
+	file.write(pending.data(), writeSize);
+	if (partial)
+		file.flush();
+	pending.erase(0, writeSize);
+
+	bytesWritten += writeSize;
+	rateWindowBytes += writeSize;
+}
+
+void hexlog_writer::write_all()
+{
+	for (auto &filetext : pendingText)
+		write_blocks(*filetext.first, filetext.second, true);
+}
+
+void hexlog_writer::update_rate()
+{
+	unsigned long long now = GetTickCount64();
+	if (now - rateWindowStart < HEXLOG_RATE_WINDOW_MS)
+		return;
+
+	bytesPerSecond = (size_t)(rateWindowBytes * 1000 / (now - rateWindowStart));
+	rateWindowBytes = 0;
+	rateWindowStart = now;
+}
+
+void hexlog_writer::main_loop()
+{
+	rateWindowStart = lastFlush = GetTickCount64();
+
+	while (true)
+	{
+		bool stopping = !running;
+
+		while (!entryQ.empty())
+		{
+			HEXLOG_ENTRY entry = entryQ.waitItem();
+			format_segment(entry, segmentText);
+
+			queue_text(entry.client->get_unfiltered_hexlog(), segmentText);
+			if (entry.toFiltered)
+				queue_text(entry.client->get_filtered_hexlog(), segmentText);
+		}
+
+		if (stopping)
+			break;
+
+		if (GetTickCount64() - lastFlush > HEXLOG_FLUSH_MS)
+		{
+			write_all();
+			lastFlush = GetTickCount64();
+		}
+		update_rate();
+		Sleep(20);
+	}
+
+	write_all();
+	for (auto &filetext : pendingText)
+		filetext.first->close();
+
+	ded = true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "base_thread.h"
+#include "safequeue.h"
+#include "uiMsg.h"
+#include "clientHexData.h"
+#include <memory>
+
+//files are written in multiples of this
+#define HEXLOG_BLOCK_SIZE (64 * 1024)
+//and whatever is left over gets written at least this often
+#define HEXLOG_FLUSH_MS 500
+//window of the bytes per second counter
+#define HEXLOG_RATE_WINDOW_MS 1000
+
+struct HEXLOG_ENTRY {
+	//shared with whoever else still wants the packet
+	std::shared_ptr<UI_RAWHEX_PKT> pkt;
+	clientHexData *client;
+	unsigned long recordNumber;
+	bool toFiltered;
+};
+
+/*
+Writes the raw hex logs on its own thread
+
+Each segment is formatted once and the text goes to the unfiltered log
+and, if it passed the filter, the filtered one. Text is gathered per file
+and written in whole blocks rather than a flush per packet.
+*/
+class hexlog_writer :
+	public base_thread
+{
+public:
+	void add_segment(HEXLOG_ENTRY &entry) { entryQ.addItem(entry); }
+	//writes everything queued and closes the logs
+	void stop() { running = false; }
+
+	unsigned long long bytes_written() { return bytesWritten; }
+	size_t bytes_per_second() { return bytesPerSecond; }
+
+	bool running = true;
+	bool ded = false;
+
+private:
+	void main_loop();
+	void format_segment(HEXLOG_ENTRY &entry, std::string &out);
+	void queue_text(std::ofstream &file, std::string &text);
+	void write_blocks(std::ofstream &file, std::string &pending, bool partial);
+	void write_all();
+	void update_rate();
+
+	SafeQueue<HEXLOG_ENTRY> entryQ;
+	std::map<std::ofstream *, std::string> pendingText;
+	std::string segmentText;
+
+	unsigned long long lastFlush = 0;
+	unsigned long long rateWindowStart = 0;
+	size_t rateWindowBytes = 0;
+	std::atomic<unsigned long long> bytesWritten{ 0 };
+	std::atomic<size_t> bytesPerSecond{ 0 };
+};
@@ -1,148 +1,255 @@
 #include "stdafx.h"
 #include "json_pipe_thread.h"
-#include "rapidjson\writer.h"
-#include "rapidjson\stringbuffer.h"
 
-json_pipe_thread::json_pipe_thread(SafeQueue<UI_MESSAGE *>* uiq, QString pipename)
+json_pipe_thread::json_pipe_thread(SafeQueue<UI_MESSAGE *>* uiq, feed_broker *feedBroker, std::string pipename, bool utf8Output)
 {
 	uiMsgQueue = uiq;
+	broker = feedBroker;
 	pipepath = "\\\\.\\pipe\\" + pipename;
+	utf8 = utf8Output;
 }
 
 void json_pipe_thread::close()
 {
-	connected = false;
-	CloseHandle(JSONpipe);
+	//the pipe thread closes its own handles on the way out
+	running = false;
 }
 
 json_pipe_thread::~json_pipe_thread()
 {
 	close();
-	running = false;
 }
 
-void json_pipe_thread::setPipePath(QString pipename)
+void json_pipe_thread::setPipePath(std::string pipename)
 {
-	connected = false;
 	pipepath = "\\\\.\\pipe\\" + pipename;
-	CloseHandle(JSONpipe); //what could go wrong
+	pathChanged = true;
 }
 
 void json_pipe_thread::main_loop()
 {
-	
-	DWORD ignored;
+	memset(&connectOverlap, 0, sizeof(connectOverlap));
+	connectOverlap.hEvent = CreateEvent(0, true, false, 0);
+	queueEvent = CreateEvent(0, false, false, 0);
 
+	std::vector<HANDLE> waitHandles;
 	while (running)
 	{
-		HANDLE hEvent;
-		hEvent = CreateEvent(0, true, true, 0);
-		OVERLAPPED oOverlap;
-		oOverlap.hEvent = hEvent;
-		JSONpipe = CreateNamedPipeA(pipepath.toStdString().c_str(),
-			PIPE_ACCESS_OUTBOUND | FILE_FLAG_OVERLAPPED,
-			PIPE_TYPE_MESSAGE,
-			5,
-			4024 * 1024, 4024 * 1024, 10, 0);
-
-		if (JSONpipe == INVALID_HANDLE_VALUE)
+		if (pathChanged)
 		{
-			std::stringstream err;
-			err << "CreateNamedPipe " << pipepath.toStdString() << " error " << GetLastError();
-			UIaddLogMsg(err.str(), 0, uiMsgQueue);
-			running = false; 
-			break;
+			pathChanged = false;
+			close_listener();
+			while (!clients.empty())
+				drop_client(clients.size() - 1);
 		}
 
-		ConnectNamedPipe(JSONpipe, &oOverlap);
-
-		bool fConnected;
-		while (1)
+		if (listener == INVALID_HANDLE_VALUE && clients.size() < PIPE_MAX_SUBSCRIBERS)
 		{
-			WaitForSingleObject(JSONpipe, 400);
-		
-			fConnected = GetOverlappedResult(JSONpipe, &oOverlap, &ignored, false);
-				break;
-			if (fConnected || !running)
+			if (!create_listener())
+			{
+				running = false;
 				break;
+			}
+			if (start_connect())
+				accept_subscriber();
 		}
 
-		if (!running)
-			break;
-
-		if (fConnected)
+		for (size_t i = 0; i < clients.size();)
 		{
-			UIaddLogMsg("JSON Subscriber Connected", 0, uiMsgQueue);
-			connected = true;
-			bool pendingIO = false;
-			while (connected && running)
-			{
-				if (pendingIO)
-				{
-					DWORD mush3;
-					if (GetOverlappedResult(JSONpipe, &oOverlap, &mush3, true))
-					{
-						pendingIO = false;
-					}
-				}
-
-				if (entryQ.empty())
-				{
-					Sleep(100);
-					char awful[] = "Use overlapped pls";
-					connected = WriteFile(JSONpipe, awful, 0, &ignored, 0);
-					if (!connected)
-					{
-						CloseHandle(JSONpipe);
-						break;
-					}
-
-					continue;
-				}
-				std::wstring doc = entryQ.waitItem();
-				doc.append(L"\r"); //needed to make it a discrete pipe message
-
-				DWORD writtenBytes = 0;
-				DWORD byteSize = doc.size() * sizeof(wchar_t);
-				bool done = WriteFile(JSONpipe, doc.c_str(), byteSize, &writtenBytes, false);
-				if (!done || (writtenBytes != byteSize))
-				{
-					DWORD err = GetLastError();
-					if (err == ERROR_IO_PENDING)
-					{
-						pendingIO = true;
-						continue;
-					}
-					else
-					{
-						UIaddLogMsg("JSON Subscriber Disconnected", 0, uiMsgQueue);
-						connected = false;
-						CloseHandle(JSONpipe);
-						while (!entryQ.empty())
-							entryQ.pop();
-					}
-				}
-			}
+			if (service_client(*clients[i]))
+				++i;
+			else
+				drop_client(i);
 		}
-		else
+
+		waitHandles.clear();
+		waitHandles.push_back(queueEvent);
+		if (connectPending)
+			waitHandles.push_back(connectOverlap.hEvent);
+		for (auto &client : clients)
+			if (client->writePending)
+				waitHandles.push_back(client->writeOverlap.hEvent);
+		WaitForMultipleObjects((DWORD)waitHandles.size(), waitHandles.data(), false, PIPE_WRITE_WAIT_MS);
+
+		if (connectPending && WaitForSingleObject(connectOverlap.hEvent, 0) == WAIT_OBJECT_0)
 		{
-			connected = false;
-			CloseHandle(JSONpipe);
+			connectPending = false;
+			DWORD ignored;
+			if (GetOverlappedResult(listener, &connectOverlap, &ignored, false))
+				accept_subscriber();
+			else
+				close_listener();
 		}
 	}
 
+	close_listener();
+	while (!clients.empty())
+		drop_client(clients.size() - 1);
+	CloseHandle(connectOverlap.hEvent);
+	CloseHandle(queueEvent);
 	ded = true;
 }
 
+bool json_pipe_thread::create_listener()
+{
+	//duplex so subscribers can send their subscription
+	listener = CreateNamedPipeA(pipepath.c_str(),
+		PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+		PIPE_TYPE_BYTE,
+		PIPE_UNLIMITED_INSTANCES,
+		PIPE_BUFFER_SIZE, PIPE_BUFFER_SIZE, 10, 0);
+
+	if (listener == INVALID_HANDLE_VALUE)
+	{
+		std::stringstream err;
+		err << "CreateNamedPipe " << pipepath << " error " << GetLastError();
+		UIaddLogMsg(err.str(), 0, uiMsgQueue);
+		return false;
+	}
+	return true;
+}
+
+void json_pipe_thread::close_listener()
+{
+	if (listener == INVALID_HANDLE_VALUE)
+		return;
+
+	if (connectPending)
+	{
+		DWORD ignored;
+		CancelIo(listener);
+		GetOverlappedResult(listener, &connectOverlap, &ignored, true);
+		connectPending = false;
+	}
+	CloseHandle(listener);
+	listener = INVALID_HANDLE_VALUE;
+}
 
+bool json_pipe_thread::start_connect()
+{
+	ResetEvent(connectOverlap.hEvent);
+	if (ConnectNamedPipe(listener, &connectOverlap))
+		return true;
+
+	DWORD err = GetLastError();
+	if (err == ERROR_PIPE_CONNECTED)
+		return true;
+	if (err == ERROR_IO_PENDING)
+	{
+		connectPending = true;
+		return false;
+	}
+
+	//try again with a new instance
+	close_listener();
+	return false;
+}
+
+void json_pipe_thread::accept_subscriber()
+{
+	std::unique_ptr<PIPE_CLIENT> client(new PIPE_CLIENT);
+	client->pipe = listener;
+	listener = INVALID_HANDLE_VALUE;
+	memset(&client->writeOverlap, 0, sizeof(client->writeOverlap));
+	client->writeOverlap.hEvent = CreateEvent(0, true, false, 0);
+	client->writing.reserve(PIPE_BATCH_BYTES * 2);
+	client->lastWrite = GetTickCount64();
+
+	//the other subscribers queues can cover the short wait for this
+	std::string request = read_request(client->pipe);
+
+	std::stringstream name;
+	name << "JSON Subscriber " << ++subscriberCount;
+	HANDLE wakeEvent = queueEvent;
+	client->subscriber = broker->subscribe(request, name.str(), utf8, [wakeEvent] { SetEvent(wakeEvent); });
+	clients.push_back(std::move(client));
+}
 
-void json_pipe_thread::sendPacket(rapidjson::GenericDocument<rapidjson::UTF16<>, rapidjson::CrtAllocator> &doc)
+std::string json_pipe_thread::read_request(HANDLE pipe)
 {
-	if (!connected) return;
-	rapidjson::GenericStringBuffer<rapidjson::UTF16<>> buffer;
-	rapidjson::Writer<rapidjson::GenericStringBuffer<rapidjson::UTF16<>>, rapidjson::UTF16<>> writer(buffer);
-	doc.Accept(writer);
-
-	std::wstring resultstring = buffer.GetString();
-	entryQ.addItem(resultstring);
-}
\ No newline at end of file
+	OVERLAPPED readOverlap;
+	memset(&readOverlap, 0, sizeof(readOverlap));
+	readOverlap.hEvent = CreateEvent(0, true, false, 0);
+
+	std::vector<char> readBuf(4096);
+	std::string request;
+	unsigned long long deadline = GetTickCount64() + FEED_SUBSCRIBE_WAIT_MS;
+	while (request.find('\n') == std::string::npos && request.size() < FEED_REQUEST_MAX)
+	{
+		unsigned long long now = GetTickCount64();
+		if (now >= deadline)
+			break;
+
+		ResetEvent(readOverlap.hEvent);
+		if (!ReadFile(pipe, readBuf.data(), (DWORD)readBuf.size(), NULL, &readOverlap) &&
+			GetLastError() != ERROR_IO_PENDING)
+			break;
+
+		DWORD readBytes;
+		if (WaitForSingleObject(readOverlap.hEvent, (DWORD)(deadline - now)) == WAIT_TIMEOUT)
+		{
+			CancelIo(pipe);
+			GetOverlappedResult(pipe, &readOverlap, &readBytes, true);
+			break;
+		}
+		if (!GetOverlappedResult(pipe, &readOverlap, &readBytes, false))
+			break;
+		request.append(readBuf.data(), readBytes);
+	}
+	CloseHandle(readOverlap.hEvent);
+	return request;
+}
+
+bool json_pipe_thread::service_client(PIPE_CLIENT &client)
+{
+	if (client.writePending)
+	{
+		if (WaitForSingleObject(client.writeOverlap.hEvent, 0) == WAIT_TIMEOUT)
+			return true;
+
+		DWORD writtenBytes;
+		if (!GetOverlappedResult(client.pipe, &client.writeOverlap, &writtenBytes, false))
+			return false;
+		client.writePending = false;
+	}
+
+	client.writing.clear();
+	client.subscriber->take(client.writing, PIPE_BATCH_BYTES);
+
+	//a zero length write fails once the subscriber has gone
+	if (client.writing.empty() && GetTickCount64() - client.lastWrite < PIPE_IDLE_CHECK_MS)
+		return true;
+
+	if (!start_write(client))
+		return false;
+	client.writePending = true;
+	client.lastWrite = GetTickCount64();
+	return true;
+}
+
+bool json_pipe_thread::start_write(PIPE_CLIENT &client)
+{
+	static char nothing = 0;
+	const char *data = client.writing.empty() ? &nothing : client.writing.data();
+
+	ResetEvent(client.writeOverlap.hEvent);
+	if (WriteFile(client.pipe, data, (DWORD)client.writing.size(), NULL, &client.writeOverlap))
+		return true;
+	return GetLastError() == ERROR_IO_PENDING;
+}
+
+void json_pipe_thread::drop_client(size_t index)
+{
+	PIPE_CLIENT &client = *clients[index];
+	if (client.writePending)
+	{
+		DWORD ignored;
+		CancelIo(client.pipe);
+		GetOverlappedResult(client.pipe, &client.writeOverlap, &ignored, true);
+	}
+	CloseHandle(client.pipe);
+	CloseHandle(client.writeOverlap.hEvent);
+
+	broker->remove_subscriber(client.subscriber);
+	clients.erase(clients.begin() + index);
+}
@@ -1,31 +1,77 @@
 #pragma once
 #include "base_thread.h"
-#include "safequeue.h"
-#include "uiMsg.h"
+#include "feed_broker.h"
 
+#define PIPE_BUFFER_SIZE (4 * 1024 * 1024)
+//a write stops taking lines off the subscribers queue once it is this big
+#define PIPE_BATCH_BYTES (256 * 1024)
+//how long to wait on connections and writes before looking at the queues again
+#define PIPE_WRITE_WAIT_MS 5
+//how often an idle pipe is checked for the subscriber leaving
+#define PIPE_IDLE_CHECK_MS 100
+//WaitForMultipleObjects takes 64 handles, one is the listening instance
+#define PIPE_MAX_SUBSCRIBERS 32
+
+//a connected instance of the pipe
+struct PIPE_CLIENT {
+	HANDLE pipe = INVALID_HANDLE_VALUE;
+	OVERLAPPED writeOverlap;
+	bool writePending = false;
+	unsigned long long lastWrite = 0;
+	std::vector<char> writing;
+	std::shared_ptr<feed_subscriber> subscriber;
+};
+
+/*
+Feeds decoded packets to subscribers on a named pipe, a line of json each
+
+Every subscriber gets its own instance of the pipe and its own queue in
+the broker. When one connects another instance is created for the next.
+Each has at most one overlapped write in flight, made of whatever piled
+up on its queue while the last one was going.
+
+Lines are UTF-16LE ending in \r as they always were, or UTF-8 ending in \n
+when utf8Output is set. Subscribers that don't send a request get everything.
+*/
 class json_pipe_thread :
 	public base_thread
 {
 public:
-	json_pipe_thread(SafeQueue<UI_MESSAGE *>* uiq, QString pipename);
+	json_pipe_thread(SafeQueue<UI_MESSAGE *>* uiq, feed_broker *feedBroker, std::string pipename, bool utf8Output = false);
 	~json_pipe_thread();
 
-	void sendPacket(rapidjson::GenericDocument<rapidjson::UTF16<>, rapidjson::CrtAllocator > &doc);
-	void setPipePath(QString pipename);
+	void setPipePath(std::string pipename);
 	void close();
 
 	bool running = true;
 	bool ded = false;
 private:
 	void main_loop();
+	bool create_listener();
+	void close_listener();
+	//true if the connection is ready to take now
+	bool start_connect();
+	void accept_subscriber();
+	//whatever the subscriber sent before the deadline
+	std::string read_request(HANDLE pipe);
+	//false if the subscriber has gone
+	bool service_client(PIPE_CLIENT &client);
+	bool start_write(PIPE_CLIENT &client);
+	void drop_client(size_t index);
 
-	HANDLE JSONpipe = NULL;
-	bool connected = false;
-	QString pipepath;
-
-	SafeQueue<UI_MESSAGE *> *uiMsgQueue;
-	SafeQueue<std::wstring> entryQ; //should be rjson wvalue or a doc
+	std::string pipepath;
+	bool pathChanged = false;
+	bool utf8 = false;
+	unsigned int subscriberCount = 0;
 
+	//set by the broker when it has put something on a queue
+	HANDLE queueEvent = NULL;
+	//the instance waiting for the next subscriber
+	HANDLE listener = INVALID_HANDLE_VALUE;
+	OVERLAPPED connectOverlap;
+	bool connectPending = false;
+	std::vector<std::unique_ptr<PIPE_CLIENT> > clients;
 
+	SafeQueue<UI_MESSAGE *> *uiMsgQueue;
+	feed_broker *broker;
 };
-
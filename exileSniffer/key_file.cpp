@@ -0,0 +1,186 @@
+#include "stdafx.h"
+#include "key_file.h"
+#include "pcapng_recorder.h"
+
+bool hex_to_bytes(std::string hex, byte *out, size_t outSize)
+{
+	if (hex.size() != outSize * 2)
+		return false;
+
+	for (size_t i = 0; i < outSize; ++i)
+	{
+		char *end;
+		std::string pair = hex.substr(i * 2, 2);
+		unsigned long value = strtoul(pair.c_str(), &end, 16);
+		if (*end != 0)
+			return false;
+		out[i] = (byte)value;
+	}
+	return true;
+}
+
+std::string bytes_to_hex(const byte *data, size_t size)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string hex(size * 2, '0');
+	for (size_t i = 0; i < size; ++i)
+	{
+		hex[i * 2] = digits[data[i] >> 4];
+		hex[i * 2 + 1] = digits[data[i] & 0xf];
+	}
+	return hex;
+}
+
+bool key_file_source::load_stream_line(std::istringstream &fields)
+{
+	char type;
+	DWORD pid;
+	unsigned long connectionID;
+	std::string client, server, sendKeyHex, sendIVHex, recvKeyHex, recvIVHex;
+	if (!(fields >> type >> pid >> std::hex >> connectionID >> client >> server >>
+		sendKeyHex >> sendIVHex >> recvKeyHex >> recvIVHex))
+		return false;
+
+	KEYDATA *sendKey = new KEYDATA;
+	KEYDATA *recvKey = new KEYDATA;
+	if (!hex_to_bytes(sendKeyHex, (byte *)sendKey->salsakey, SALSA_KEY_SIZE) ||
+		!hex_to_bytes(sendIVHex, (byte *)sendKey->IV, SALSA_IV_SIZE) ||
+		!hex_to_bytes(recvKeyHex, (byte *)recvKey->salsakey, SALSA_KEY_SIZE) ||
+		!hex_to_bytes(recvIVHex, (byte *)recvKey->IV, SALSA_IV_SIZE))
+	{
+		delete sendKey;
+		delete recvKey;
+		return false;
+	}
+
+	sendKey->sourceProcess = recvKey->sourceProcess = pid;
+	sendKey->timeFound = recvKey->timeFound = GetTickCount64();
+
+	if (type == 'G')
+	{
+		sendKey->foundAddress = recvKey->foundAddress = SENT_BY_SERVER;
+		gameserverKeys[connectionID] = std::make_pair(sendKey, recvKey);
+		keysLoaded += 2;
+		return true;
+	}
+
+	//no address was recorded for these. 0 still keeps them apart in the store as the IVs differ
+	sendKey->foundAddress = recvKey->foundAddress = 0;
+	for (KEYDATA *key : { sendKey, recvKey })
+	{
+		if (fileKeys.insert(key) == eKeyInserted)
+			++keysLoaded;
+		else
+			delete key;
+	}
+	return true;
+}
+
+void key_file_source::load_line(std::string &line)
+{
+	if (line.empty() || line[0] == '#')
+		return;
+
+	std::istringstream fields(line);
+	if (line.compare(0, 7, "stream ") == 0)
+	{
+		std::string tag;
+		fields >> tag;
+		load_stream_line(fields);
+		return;
+	}
+
+	DWORD pid;
+	uint64_t address;
+	std::string keyHex, IVHex;
+	if (!(fields >> pid >> std::hex >> address >> keyHex >> IVHex))
+		return;
+
+	KEYDATA *key = new KEYDATA;
+	if (!hex_to_bytes(keyHex, (byte *)key->salsakey, SALSA_KEY_SIZE) ||
+		!hex_to_bytes(IVHex, (byte *)key->IV, SALSA_IV_SIZE))
+	{
+		delete key;
+		return;
+	}
+
+	key->sourceProcess = pid;
+	key->foundAddress = address;
+	key->timeFound = GetTickCount64();
+
+	if (fileKeys.insert(key) == eKeyInserted)
+		++keysLoaded;
+	else
+		delete key;
+}
+
+bool key_file_source::load(std::string path)
+{
+	std::ifstream keyFile(path);
+	if (!keyFile.is_open())
+		return false;
+
+	std::string line;
+	while (std::getline(keyFile, line))
+		load_line(line);
+	return true;
+}
+
+bool key_file_source::load_recording(std::string path)
+{
+	std::vector<std::string> keyLines;
+	if (!read_pcapng_key_lines(path, keyLines))
+		return false;
+
+	for (std::string &line : keyLines)
+		load_line(line);
+	return true;
+}
+
+bool key_file_source::gameserver_keys(unsigned long connectionID, std::pair<KEYDATA *, KEYDATA *> &keys)
+{
+	auto it = gameserverKeys.find(connectionID);
+	if (it == gameserverKeys.end())
+		return false;
+
+	keys = it->second;
+	gameserverKeys.erase(it);
+	return true;
+}
+
+bool key_log::open(std::string path)
+{
+	std::lock_guard<std::mutex> lock(logMutex);
+
+	bool fresh = !std::ifstream(path).good();
+	logFile.open(path, std::ofstream::out | std::ofstream::app);
+	if (!logFile.is_open())
+		return false;
+
+	if (fresh)
+		logFile << KEY_FILE_HEADER << std::endl;
+	return true;
+}
+
+void key_log::write_stream(char streamType, unsigned long connectionID, std::string client, std::string server,
+	KEYDATA *sendKey, KEYDATA *recvKey)
+{
+	std::lock_guard<std::mutex> lock(logMutex);
+	if (!logFile.is_open())
+		return;
+
+	logFile << stream_key_line(streamType, connectionID, client, server, sendKey, recvKey) << std::endl;
+}
+
+std::string stream_key_line(char streamType, unsigned long connectionID, std::string client, std::string server,
+	KEYDATA *sendKey, KEYDATA *recvKey)
+{
+	std::stringstream line;
+	line << "stream " << streamType << " " << std::dec << sendKey->sourceProcess << " " <<
+		std::hex << connectionID << " " << client << " " << server << " " <<
+		bytes_to_hex((byte *)sendKey->salsakey, SALSA_KEY_SIZE) << " " <<
+		bytes_to_hex((byte *)sendKey->IV, SALSA_IV_SIZE) << " " <<
+		bytes_to_hex((byte *)recvKey->salsakey, SALSA_KEY_SIZE) << " " <<
+		bytes_to_hex((byte *)recvKey->IV, SALSA_IV_SIZE);
+	return line.str();
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "key_source.h"
+#include <fstream>
+
+#define KEY_FILE_HEADER "#exileSniffer keys v1"
+
+/*
+Keys saved from an earlier session, for decrypting recorded traffic
+
+A key line holds a single login key:
+	pid address salsakey IV
+A stream line is written by key_log for each stream once it is decrypting:
+	stream type pid connectionID clientIP:port serverIP:port sendkey sendIV recvkey recvIV
+
+address and connectionID are hex, keys and IVs are the raw key bytes in hex.
+type is L or G. Login stream keys become candidates for any login stream,
+gameserver keys are matched to the stream by connection ID.
+*/
+class key_file_source : public key_source
+{
+public:
+	//false if the file couldn't be opened. Lines that don't parse are skipped
+	bool load(std::string path);
+	//the keys stored in a pcapng recording
+	bool load_recording(std::string path);
+	size_t key_count() { return keysLoaded; }
+	//keys dropped because the store was full
+	size_t keys_refused() { return fileKeys.refused_count(); }
+
+	KEYDATA *getUnusedMemoryKey(unsigned int streamID, bool recvKey, KEYDATA *hintKey = NULL) override {
+		return fileKeys.next_untested(streamID, recvKey, hintKey);
+	}
+	void claimKey(KEYDATA *key, unsigned int keyStreamID) override { fileKeys.claim(key); }
+	//everything there is was read at load
+	bool keys_pending() override { return false; }
+
+	bool gameserver_keys(unsigned long connectionID, std::pair<KEYDATA *, KEYDATA *> &keys) override;
+	bool has_gameserver_keys() override { return !gameserverKeys.empty(); }
+
+private:
+	void load_line(std::string &line);
+	bool load_stream_line(std::istringstream &fields);
+
+	key_store fileKeys;
+	size_t keysLoaded = 0;
+	std::map<unsigned long, std::pair<KEYDATA *, KEYDATA *> > gameserverKeys;
+};
+
+/*
+Sidecar log of the keys each stream was decrypted with, readable by key_file_source.
+Lines are flushed as they are written so the log survives a crash.
+*/
+class key_log
+{
+public:
+	~key_log() { logFile.close(); }
+
+	//appends to an existing log
+	bool open(std::string path);
+	bool is_open() { return logFile.is_open(); }
+
+	void write_stream(char streamType, unsigned long connectionID, std::string client, std::string server,
+		KEYDATA *sendKey, KEYDATA *recvKey);
+
+private:
+	std::mutex logMutex;
+	std::ofstream logFile;
+};
+
+std::string stream_key_line(char streamType, unsigned long connectionID, std::string client, std::string server,
+	KEYDATA *sendKey, KEYDATA *recvKey);
+bool hex_to_bytes(std::string hex, byte *out, size_t outSize);
+std::string bytes_to_hex(const byte *data, size_t size);
@@ -1,16 +1,17 @@
 #include "stdafx.h"
 #include "key_grabber_thread.h"
+#include "keyblob_scanner.h"
+#include "region_scheduler.h"
+#include "scan_worker.h"
 
 #include <tlhelp32.h>
 
-#define PLEASE_TERMINATE 0
-#define SCAN_WORKER_THREAD_COUNT 2
 #define MEMSCAN_FILTERS_IMPLEMENTED 6
+#define MAX_SCANNED_REGION_SIZE (80 * 1024 * 1024)
+//bytes scanned around the offset of a previously found key
+#define KEYSITE_PROBE_SIZE (64 * 1024)
 
-#define RECV_TESTED 0x1
-#define SEND_TESTED 0x2
-
-bool key_grabber_thread::insertKey(DWORD pid, DWORD *keyblobptr, DWORD foundAddress)
+bool key_grabber_thread::insertKey(DWORD pid, DWORD *keyblobptr, uint64_t foundAddress, const MEMREGION &region)
 {
 
 	KEYDATA *newKey = new KEYDATA;
@@ -31,45 +32,28 @@ bool key_grabber_thread::insertKey(DWORD pid, DWORD *keyblobptr, DWORD foundAddr
 	newKey->IV[1] = (keyblobptr[7]);
 	newKey->timeFound = GetTickCount64();
 	newKey->foundAddress = foundAddress;
+	newKey->sourceRegion = region;
 	newKey->sourceProcess = pid;
 
-	WaitForSingleObject(this->keyVecMutex, INFINITE);
-	
-	for (auto keyIt = unclaimedKeys.begin(); keyIt != unclaimedKeys.end(); ++keyIt)
+	eKeyInsert inserted = unclaimedKeys.insert(newKey);
+	if (inserted != eKeyInserted)
 	{
-		//this key already added
-		if (keyIt->key->foundAddress == foundAddress)
-		{
-			if (!memcmp(keyIt->key->IV, newKey->IV, SALSA_IV_SIZE))
-			{
-				//printf("Ignoring dupe\n");
-				delete newKey;
-				ReleaseMutex(keyVecMutex);
-				return false;
-			}
-		}
+		delete newKey;
+		//only the first refusal is logged, the rest would drown the log
+		if (inserted == eKeyStoreFull && unclaimedKeys.refused_count() == 1)
+			UIaddLogMsg("Warning: Key store is full of untested keys, ignoring new candidates", pid, uiMsgQueue);
+		return false;
 	}
 
 	std::stringstream resultMsg;
 	resultMsg << "Found candidate key blob at address: 0x" << std::hex << foundAddress;
 	UIaddLogMsg(resultMsg.str(), pid, uiMsgQueue);
-
-	//theory: pushing FIFO so old dud keys don't have to be tested by every thread
-	//reality: only 1 client supported at once so keys cleared as soon as login works 
-	UNCLAIMED_KEY newUnc(newKey);
-	unclaimedKeys.push_front(newUnc);
-	
-	ReleaseMutex(this->keyVecMutex);
 	return true;
 }
 
 bool key_grabber_thread::insertKey(KEYDATA *key)
 {
-	WaitForSingleObject(this->keyVecMutex, INFINITE);
-	UNCLAIMED_KEY newUnc(key);
-	unclaimedKeys.push_front(newUnc);
-	ReleaseMutex(this->keyVecMutex);
-	return true;
+	return unclaimedKeys.insert(key) == eKeyInserted;
 }
 
 /*
@@ -83,62 +67,7 @@ which can be used as a hint to force returning only keyblobs with that key.
 KEYDATA * key_grabber_thread::getUnusedMemoryKey(unsigned int streamID, bool recvKey,
 	KEYDATA *hintKey)
 {
-	KEYDATA *chosenCandidate = NULL;
-
-	DWORD waitResult = WaitForSingleObject(this->keyVecMutex, 200);
-	if (waitResult)
-		return NULL;
-
-	for (auto keyit = unclaimedKeys.begin(); keyit != unclaimedKeys.end(); keyit++)
-	{
-		//find stream/mask pairs in streamsTests where stream==streamID
-		auto streamIt = std::find_if(keyit->streamsTested.begin(), 
-									 keyit->streamsTested.end(), 
-						[&streamID](const std::pair<unsigned int, byte>& element)
-							{ return element.first == streamID; });
-
-		bool allowTest = false;
-		byte mask = recvKey ? RECV_TESTED : SEND_TESTED;
-		if (streamIt == keyit->streamsTested.end())
-		{
-			allowTest = true;
-			keyit->streamsTested.push_back(make_pair(streamID, mask));
-		}
-		else 
-		{
-
-			byte previousMask = streamIt->second;
-			if (recvKey && (previousMask & mask) == 0)
-			{
-				streamIt->second |= mask;
-				allowTest = true;
-			}
-			else if (!recvKey && (previousMask & mask) == 0)
-			{
-				streamIt->second |= mask;
-				allowTest = true;
-			}
-		}
-
-		if(allowTest)
-		{
-			//key was passed in a packet, not a login key
-			if (keyit->key->foundAddress == SENT_BY_SERVER)
-				continue;
-
-			if (hintKey)
-			{
-				if (memcmp(hintKey->salsakey, keyit->key->salsakey, SALSA_KEY_SIZE))
-					continue;
-			}
-
-			chosenCandidate = keyit->key;
-			break;
-		}
-	}
-
-	ReleaseMutex(keyVecMutex);
-	return chosenCandidate;
+	return unclaimedKeys.next_untested(streamID, recvKey, hintKey);
 }
 
 /*
@@ -148,25 +77,28 @@ Arguments: Pointer to key object, ID of claiming stream
 */
 void key_grabber_thread::claimKey(KEYDATA *key, unsigned int keyStreamID)
 {
-	DWORD waitResult = WaitForSingleObject(keyVecMutex, INFINITE);
-
-	auto keyit = unclaimedKeys.begin();
-	for (; keyit != unclaimedKeys.end(); keyit++)
-	{
-		if (keyit->key == key)
-			break;
-	}
-
-	if (keyit != unclaimedKeys.end())
-		unclaimedKeys.erase(keyit);
-	else
+	if (!unclaimedKeys.claim(key))
 	{
 		stringstream errmsg;
 		errmsg << "ERROR: Stream " << keyStreamID << " tried to claim a key not present in unclaimed list";
 		UIaddLogMsg(errmsg.str(), key->sourceProcess, uiMsgQueue);
 	}
 
-	ReleaseMutex(keyVecMutex);
+	if (key->foundAddress == SENT_BY_SERVER)
+		return;
+
+	keyHistory.record_valid_key(key->sourceRegion, key->foundAddress);
+	keyHistory.save(KEY_HISTORY_FILE);
+
+	GAMECLIENTINFO *client = get_process_obj(key->sourceProcess);
+	if (client && client->scanStats.ms_to_valid_key() < 0)
+	{
+		client->scanStats.mark_valid_key();
+
+		std::stringstream timingMsg;
+		timingMsg << "Valid key found " << client->scanStats.ms_to_valid_key() << "ms after scan start";
+		UIaddLogMsg(timingMsg.str(), key->sourceProcess, uiMsgQueue);
+	}
 }
 
 /*
@@ -186,7 +118,15 @@ bool key_grabber_thread::relaxScanFilters()
 		GAMECLIENTINFO *client = ((GAMECLIENTINFO*)*it);
 		if (client->needsLoginKey)
 		{
-			if (client->memScanFiltersRelaxed < MEMSCAN_FILTERS_IMPLEMENTED)
+			if (client->useLearnedFilter)
+			{
+				//the key has moved somewhere new, fall back to the fixed filters
+				client->useLearnedFilter = false;
+				UIaddLogMsg("INFO: Keygrabber dropped learned memory scan filter for unauthenticated client",
+					client->pid, uiMsgQueue);
+				relaxedAFilter = true;
+			}
+			else if (client->memScanFiltersRelaxed < MEMSCAN_FILTERS_IMPLEMENTED)
 			{
 				client->memScanFiltersRelaxed += 1;
 
@@ -207,251 +147,245 @@ bool key_grabber_thread::relaxScanFilters()
 
 
 /*
-This searches the memory of a gameclient using addresses passed to it in the
-gameClient address queue for salsa keys. Keys will be placed in this objects key vector.
+Searches one job's worth of a gameclient's memory for salsa keys.
+Called on the scheduler's worker threads. Keys will be placed in this objects key vector.
 
-Argument: gameclient object to scan for salsa keys
+Arguments: gameclient object to scan, the region chunk to scan, 
+	the calling worker's reusable read buffer and results vector
 */
-void key_grabber_thread::memoryScanWorker(GAMECLIENTINFO *gameClient)
+void key_grabber_thread::memoryScanWorker(GAMECLIENTINFO *gameClient, SCAN_JOB &job,
+	std::vector<uint8_t> &procesMemChunk, std::vector<size_t> &signatureOffsets)
 {
-	gameClient->handlesOpen.notify();
-
-	DWORD processID = gameClient->pid;
-	std::pair<void *, size_t> memRegion;
-	std::vector<DWORD> procesMemChunk;
-
-	//UIaddLogMsg("New memory scan worker thread started", processID, uiMsgQueue);
+	if (!gameClient->needsLoginKey)
+		return;
 
-	while (gameClient->needsLoginKey)
+	unsigned long readErr = 0;
+	signatureOffsets.clear();
+	size_t bytesRead = scan_job_for_keyblobs(gameClient->memSource, job, procesMemChunk, 
+		signatureOffsets, gameClient->scanStats, &readErr);
+	if (readErr)
 	{
-		DWORD waitResult = WaitForSingleObject(gameClient->addressQueueMutex, 2000);
-		if (gameClient->addressQueue.empty())
-		{
-			ReleaseMutex(gameClient->addressQueueMutex);
-			Sleep(100);
-			continue;
-		}
-
-		if (waitResult)
-		{
-			ReleaseMutex(gameClient->addressQueueMutex);
-
-			std::stringstream errMsg;
-			errMsg << "WARNING: memoryScanWorker - Wait on AddressMutex failed. Result: " << waitResult
-				<< " Error: " << GetLastError();
-			UIaddLogMsg(errMsg.str(), processID, uiMsgQueue);
-
-			Sleep(1000);
-			continue;
-		}
-
-		if (gameClient->addressQueue.empty())  //another thread got it first
-		{
-			ReleaseMutex(gameClient->addressQueueMutex);
-			Sleep(5);
-			continue;
-		}
-
-		memRegion = gameClient->addressQueue.front();
-		gameClient->addressQueue.pop();
-		ReleaseMutex(gameClient->addressQueueMutex);
-
-		//this is our exit signal
-		if (memRegion.first == (void *)PLEASE_TERMINATE && 
-			memRegion.second == PLEASE_TERMINATE)
-		{
-			break;
-		}
-		//printf("Scanning region %p (size %d)\n", memRegion.first, memRegion.second);
-
-		void * memAddr = memRegion.first;
-		size_t regionSize = memRegion.second;
-		if (regionSize > (80 * 1024 * 1024)) continue;
-		if (regionSize > procesMemChunk.size())
-			procesMemChunk.resize(regionSize);
-
-		SIZE_T bytesRead;
-
-		if (ReadProcessMemory(gameClient->processhandle, memAddr, 
-			&procesMemChunk[0], regionSize, &bytesRead))
-		{
-			//printf("Scanning chunk %lx (Size %d) (queuesize:%d)\n", memAddr, regionSize, gameClient->addressQueue.size());
-
-			for (size_t i = 0;
-				i < (((bytesRead - KEYBLOB_SIZE) / sizeof(DWORD)) - 1); 
-				i += 4) //string always starts on 16 byte boundary
-			{
-				if (procesMemChunk[i] != (DWORD)0x61707865) continue;//"expa" reversed
-				if (memcmp(procesMemChunk.data() + i, "expand 32-byte k", 16)) continue;
-				/*
-				std::stringstream resultMsg;
-				resultMsg << "Found candidate key blob in region size: " << 
-					((float)regionSize / 1024.0) << "KB";
-				UIaddLogMsg(resultMsg.str(), pid, uiMsgQueue);
-				*/
-				DWORD *keyBlob = procesMemChunk.data() + i + 4;
-				DWORD keyFoundAddr = (DWORD)memAddr+ i;
-				insertKey(processID, keyBlob, keyFoundAddr);
-			}
+		UIaddLogMsg("ReadProcessMem err " + std::to_string(readErr), gameClient->pid, uiMsgQueue);
+	}
+	if (!bytesRead)
+		return;
 
-		}
-		else
-		{
-			DWORD lasterr = GetLastError();
-			if (lasterr != ERROR_PARTIAL_COPY)
-			{
-				UIaddLogMsg("ReadProcessMem err " + QString::number(lasterr), processID, uiMsgQueue);
-			}
-		}
+	for (size_t signatureOffset : signatureOffsets)
+	{
+		DWORD *keyBlob = (DWORD *)(procesMemChunk.data() + signatureOffset + KEYBLOB_SIGNATURE_SIZE);
+		uint64_t keyFoundAddr = job.address + signatureOffset;
+		if (insertKey(gameClient->pid, keyBlob, keyFoundAddr, job.region))
+			gameClient->scanStats.mark_first_candidate();
 	}
-	//UIaddLogMsg("Memory scan worker thread terminating", processID, uiMsgQueue);
-	gameClient->handlesOpen.wait();
 }
 
 bool key_grabber_thread::openClientHandle(GAMECLIENTINFO *gameClient)
 {
-	MEMORY_BASIC_INFORMATION info;
-	char* p = 0;
-	DWORD processID = gameClient->pid;
+	memory_source *source = new win_process_memory_source(gameClient->pid);
 
-	gameClient->processhandle =
-		OpenProcess(PROCESS_VM_READ | PROCESS_QUERY_INFORMATION, FALSE, processID);
-	if (!gameClient->processhandle)
+	std::string openError;
+	if (!source->open(openError))
 	{
-		UIaddLogMsg("OpenProcess<VM_READ+QUERY_INFORMATION> of target game client failed", gameClient->pid, uiMsgQueue);
-		return false;
-	}
-
-	//an initial test for queryability
-	if (!(VirtualQueryEx(gameClient->processhandle, p, &info, sizeof(info)) == sizeof(info)))
-	{
-		UIaddLogMsg("VirtualQueryEx of target process failed", gameClient->pid, uiMsgQueue);
+		UIaddLogMsg(openError, gameClient->pid, uiMsgQueue);
+		delete source;
 		return false;
 	}
 
+	gameClient->memSource = source;
 	return true;
 }
 
 //some filters to avoid scanning memory where the key (hopefully) won't be
 //homework: narrow them down to be as restrictive as possible without missing any keys
-bool memory_passes_filters(MEMORY_BASIC_INFORMATION &info, int filterRelaxedCount)
+bool memory_passes_filters(MEMREGION &info, int filterRelaxedCount)
 {
 	switch (filterRelaxedCount)
 	{
 	case (MEMSCAN_FILTERS_IMPLEMENTED - 6):
-		if (info.AllocationProtect != PAGE_READWRITE) return false;
+		if (info.allocationProtect != MEMPROT_READWRITE) return false;
 	case (MEMSCAN_FILTERS_IMPLEMENTED - 5):
-		if (!(info.State & MEM_COMMIT))  return false;
+		if (!info.committed)  return false;
 	case (MEMSCAN_FILTERS_IMPLEMENTED - 4):
-		if (info.Type != MEM_PRIVATE)  return false;
+		if (info.type != eMemPrivate)  return false;
 	case (MEMSCAN_FILTERS_IMPLEMENTED - 3):
-		if (info.RegionSize > 20 * 1024 * 1024)  return false;
+		if (info.size > 20 * 1024 * 1024)  return false;
 	case (MEMSCAN_FILTERS_IMPLEMENTED - 2):
-		if (info.RegionSize <= 1024)  return false;
+		if (info.size <= 1024)  return false;
 	case (MEMSCAN_FILTERS_IMPLEMENTED - 1):
-		if (info.RegionSize > 60 * 1024 * 1024)  return false;
+		if (info.size > 60 * 1024 * 1024)  return false;
 	case MEMSCAN_FILTERS_IMPLEMENTED:
 		break;
 	}
 	return true;
 }
 
+/*
+Hand one pass worth of regions to the workers, most likely first
+
+Places keys were found before in identical regions are probed first. Then 
+whole regions, fresh allocations ahead of changed ones, each group in order 
+of how closely they resemble previous key regions
+*/
+void key_grabber_thread::queueScanPass(region_scheduler &scheduler, std::vector<MEMREGION> &passRegions,
+	std::vector<eRegionChange> &regionChanges)
+{
+	//(fresh, score) -> region index
+	std::vector<std::pair<std::pair<bool, unsigned int>, size_t>> regionRanks;
+	std::vector<uint64_t> likelyOffsets;
+
+	for (size_t i = 0; i < passRegions.size(); ++i)
+	{
+		MEMREGION &region = passRegions[i];
+		bool fresh = regionChanges[i] == eRegionNew;
+		regionRanks.push_back(make_pair(make_pair(fresh, keyHistory.region_score(region)), i));
+
+		likelyOffsets.clear();
+		keyHistory.likely_offsets(region, likelyOffsets);
+		for (uint64_t offset : likelyOffsets)
+		{
+			uint64_t probeStart = offset > KEYSITE_PROBE_SIZE / 2 ? offset - KEYSITE_PROBE_SIZE / 2 : 0;
+			probeStart &= ~(uint64_t)(KEYBLOB_ALIGNMENT - 1);
+			size_t probeSize = (size_t)min((uint64_t)KEYSITE_PROBE_SIZE, region.size - probeStart);
+			scheduler.submit_range(region, region.base + probeStart, probeSize,
+				KEYSCAN_CHUNK_SIZE, KEYSCAN_CHUNK_OVERLAP);
+		}
+	}
+
+	std::stable_sort(regionRanks.begin(), regionRanks.end(),
+		[](const std::pair<std::pair<bool, unsigned int>, size_t> &a, 
+			const std::pair<std::pair<bool, unsigned int>, size_t> &b)
+			{ return a.first > b.first; });
+
+	for (auto &rankedRegion : regionRanks)
+		scheduler.submit_region(passRegions[rankedRegion.second], KEYSCAN_CHUNK_SIZE, KEYSCAN_CHUNK_OVERLAP);
+}
+
 void key_grabber_thread::keyGrabController(GAMECLIENTINFO *gameClient)
 {
-	MEMORY_BASIC_INFORMATION info;
-	char* p = 0, *nextp = 0;
+	MEMREGION info;
+	uint64_t nextp = 0;
+	memory_source *memSource = gameClient->memSource;
 
-	if (!VirtualQueryEx(gameClient->processhandle, p, &info, sizeof(info)) == sizeof(info))
+	if (memSource->query_region(0, info) != eRegionFound)
 	{
-		//shouldn't happen as we already tested it when opening the handle
-		UIaddLogMsg("VirtualQueryEx of target process failed", gameClient->pid, uiMsgQueue);
+		//shouldn't happen as we already tested it when opening the source
+		UIaddLogMsg("Memory query of " + memSource->description() + " failed", gameClient->pid, uiMsgQueue);
 		return;
 	}
 
-	UIaddLogMsg("Starting key scan for game process", gameClient->pid, uiMsgQueue);
+	//workers sized to the machine, each with its own read buffer
+	region_scheduler scheduler;
+	std::vector<std::vector<uint8_t>> workerBuffers(scheduler.worker_count());
+	std::vector<std::vector<size_t>> workerResults(scheduler.worker_count());
 
-	WaitForSingleObject(gameClient->addressQueueMutex, INFINITE);
-	while (!gameClient->addressQueue.empty())
-		gameClient->addressQueue.pop();
-	ReleaseMutex(gameClient->addressQueueMutex);
+	LEARNED_FILTER learnedFilter;
+	bool haveLearnedFilter = keyHistory.learned_filter(learnedFilter);
+	std::vector<MEMREGION> passRegions;
+	std::vector<eRegionChange> regionChanges;
 
-	//start threads to scan memory from candidate addresses found by this thread
-	memWorkerParams paramStruct;
-	paramStruct.thisptr = (void*)this;
-	paramStruct.clientInfo = gameClient;
+	//regions unchanged since the last pass aren't read again
+	region_fingerprint_cache fingerprints;
+	uint64_t unchangedBytesSkipped = 0;
+	fingerprints.begin_pass();
 
-	for (int i = 0; i < SCAN_WORKER_THREAD_COUNT; i++)
-		CreateThread(NULL, 0, scanWorkerStart, (void*)&paramStruct, 0, 0);
+	std::stringstream startMsg;
+	startMsg << "Starting key scan for game process with " << scheduler.worker_count() << " workers";
+	if (haveLearnedFilter)
+		startMsg << " using filter learned from " << keyHistory.site_count() << " previous keys";
+	UIaddLogMsg(startMsg.str(), gameClient->pid, uiMsgQueue);
+	gameClient->scanStats.start();
+
+	scheduler.start([&](unsigned int workerIndex, SCAN_JOB &job) {
+		memoryScanWorker(gameClient, job, workerBuffers[workerIndex], workerResults[workerIndex]);
+	});
 
-	p = 0;
 	while (gameClient->needsLoginKey)
 	{
-		p = nextp;
-		if (VirtualQueryEx(gameClient->processhandle, p, &info, sizeof(info)) == sizeof(info))
+		unsigned long queryErr = 0;
+		eRegionQuery queryResult = memSource->query_region(nextp, info, &queryErr);
+		if (queryResult == eRegionFound)
 		{
-			nextp += info.RegionSize;
+			nextp = info.base + info.size;
 
+			if (haveLearnedFilter && gameClient->useLearnedFilter &&
+				!scan_history::passes_learned_filter(info, learnedFilter))
+				continue;
 			if (!memory_passes_filters(info, gameClient->memScanFiltersRelaxed))
 				continue;
+			if (info.size > MAX_SCANNED_REGION_SIZE) 
+				continue;
+
+			eRegionChange change = fingerprints.check(memSource, info);
+			if (change == eRegionUnchanged)
+			{
+				unchangedBytesSkipped += info.size;
+				continue;
+			}
 
-			//totalMem += info.RegionSize;
-			WaitForSingleObject(gameClient->addressQueueMutex, INFINITE);
-			gameClient->addressQueue.emplace(make_pair(info.BaseAddress, info.RegionSize));
-			ReleaseMutex(gameClient->addressQueueMutex);
+			passRegions.push_back(info);
+			regionChanges.push_back(change);
 		}
 		else
 		{
-			DWORD lasterr = GetLastError();
-			if (lasterr != ERROR_INVALID_PARAMETER)
+			if (queryResult != eRegionEnd)
 			{
 				std::stringstream errMsg;
-				errMsg << "Warning: VirtualQueryEx failed with error: " <<std::dec<< lasterr;
+				errMsg << "Warning: Memory query of " << memSource->description() << 
+					" failed with error: " << std::dec << queryErr;
 				UIaddLogMsg(errMsg.str(), gameClient->pid, uiMsgQueue);
 				
-				if (lasterr == ERROR_ACCESS_DENIED)
+				if (queryResult == eRegionDenied)
 					break;
 			}
-			p = 0, nextp = 0;
-			Sleep(1250);
-		}
 
-	}
+			queueScanPass(scheduler, passRegions, regionChanges);
+			passRegions.clear();
+			regionChanges.clear();
 
-	//tell the worker threads to terminate
-	WaitForSingleObject(gameClient->addressQueueMutex, INFINITE);
-	for (int i = 0; i < SCAN_WORKER_THREAD_COUNT; i++)
-		gameClient->addressQueue.emplace((void *)PLEASE_TERMINATE, PLEASE_TERMINATE);
-	ReleaseMutex(gameClient->addressQueueMutex);
+			//let the workers finish this pass before queueing the next one
+			while (scheduler.pending() && gameClient->needsLoginKey)
+				Sleep(20);
 
-	//wait for workers to terminate then cleanup
-	while (!gameClient->handlesOpen.empty())
-		Sleep(25);
+			fingerprints.end_pass();
+			fingerprints.begin_pass();
+			nextp = 0;
+			Sleep(1250);
+		}
 
-	UIaddLogMsg("Ended key scan for game process", gameClient->pid, uiMsgQueue);
+	}
 
-	if (gameClient->processhandle)
+	//workers finish their current job and are joined
+	scheduler.stop();
+
+	std::stringstream scanRateMsg;
+	scanRateMsg << "Ended key scan for game process. Scanned " << std::dec <<
+		(gameClient->scanStats.bytes() / (1024 * 1024)) << "MB at " << std::fixed << std::setprecision(1) <<
+		gameClient->scanStats.wallclock_MBps() << "MB/s (" << scan_kernel_name(best_scan_kernel()) <<
+		" search: " << gameClient->scanStats.kernel_MBps() << "MB/s). Skipped " << 
+		(unchangedBytesSkipped / (1024 * 1024)) << "MB unchanged";
+	if (gameClient->scanStats.ms_to_first_candidate() >= 0)
+		scanRateMsg << ". First candidate after " << gameClient->scanStats.ms_to_first_candidate() << "ms";
+	if (gameClient->scanStats.ms_to_valid_key() >= 0)
+		scanRateMsg << ", valid key after " << gameClient->scanStats.ms_to_valid_key() << "ms";
+	UIaddLogMsg(scanRateMsg.str(), gameClient->pid, uiMsgQueue);
+
+	if (gameClient->memSource)
 	{
-		CloseHandle(gameClient->processhandle);
-		gameClient->processhandle = NULL;
+		gameClient->memSource->close();
+		delete gameClient->memSource;
+		gameClient->memSource = NULL;
 	}
 }
 /*
-This thread starts the memory scanning worker threads, then searches through 
-address space for promising memory regions to pass to the workers
+This thread starts the memory scanning workers, then searches through 
+address space for promising memory regions to pass to them
 
 Argument: gameclient object to scan for salsa keys
 */
 void key_grabber_thread::grabKeys(GAMECLIENTINFO *gameClient)
 {
-	//start threads to scan memory from candidate addresses found by this thread
-	memWorkerParams paramStruct;
-	paramStruct.thisptr = (void*)this;
-	paramStruct.clientInfo = gameClient;
-	paramStruct.started = false;
-	
-	CreateThread(NULL, 0, scanControllerStart, (void*)&paramStruct, 0, 0);
-	while (!paramStruct.started)
-		Sleep(400);
+	//the controller starts the threads that scan memory from candidate addresses it finds
+	std::thread(&key_grabber_thread::keyGrabController, this, gameClient).detach();
 }
 
 /*
@@ -511,21 +445,9 @@ void key_grabber_thread::stopProcessScan(DWORD processID)
 	if (client)
 	{
 		client->needsLoginKey = false;
-		WaitForSingleObject(this->keyVecMutex, INFINITE);
 
 		//cleanup any unused keys
-		for (auto it = unclaimedKeys.begin(); it != unclaimedKeys.end(); it++)
-		{
-			if (it->key->sourceProcess == processID)
-			{
-				it = unclaimedKeys.erase(it);
-				if (it == unclaimedKeys.end())
-					break;
-			}
-		}
-
-		ReleaseMutex(this->keyVecMutex);
-
+		unclaimedKeys.remove_process(processID);
 	}
 	else
 	{
@@ -558,7 +480,6 @@ void key_grabber_thread::purge_ended_processes(std::vector <DWORD>& latestClient
 		{
 
 			GAMECLIENTINFO *client = (*knownProcessIt);
-
 			UInotifyClientRunning(client->pid, false, 0, 0, uiMsgQueue);
 
 			delete client;
@@ -576,6 +497,9 @@ void key_grabber_thread::purge_ended_processes(std::vector <DWORD>& latestClient
 void key_grabber_thread::restartScanOnClient(DWORD pid)
 {
 	GAMECLIENTINFO* client = get_process_obj(pid);
+	if (!client || client->needsLoginKey)
+		return;
+
 	client->needsLoginKey = true;
 
 	processListMutex.lock();
@@ -583,45 +507,23 @@ void key_grabber_thread::restartScanOnClient(DWORD pid)
 	processListMutex.unlock();
 }
 
-void key_grabber_thread::erase_client_objects()
+/*
+A client is being decrypted so stop looking for its keys. 
+Other clients carry on being scanned so they can be decrypted too.
+*/
+void key_grabber_thread::suspend_scanning(DWORD decryptingPID)
 {
-	while (!activeClients.empty())
-	{
-		processListMutex.lock();
-		for (auto it = activeClients.begin(); it != activeClients.end(); it++)
-		{
-			GAMECLIENTINFO *client = *it;
-			if (client->processhandle == NULL)
-			{
-				delete client;
-				it = activeClients.erase(it);
-				if (it == activeClients.end()) break;
-			}
-		}
-		processListMutex.unlock();
-		Sleep(500);
-	}
+	GAMECLIENTINFO* client = get_process_obj(decryptingPID);
+	if (client && client->needsLoginKey)
+		stopProcessScan(decryptingPID);
+	else
+		unclaimedKeys.remove_process(decryptingPID);
 }
 
-void key_grabber_thread::suspend_scanning(DWORD activeProcessPID)
+//the clients stream ended, it will need a fresh key to log in again
+void key_grabber_thread::resume_scanning(DWORD pid)
 {
-	keyRequired = false;
-	activeProcess = activeProcessPID;
-
-	WaitForSingleObject(this->keyVecMutex, INFINITE);
-	unclaimedKeys.clear();
-	ReleaseMutex(this->keyVecMutex);
-
-	processListMutex.lock();
-	for (auto it = activeClients.begin(); it != activeClients.end(); it++)
-	{
-		 ((GAMECLIENTINFO *)*it)->needsLoginKey = false;
-	}
-	processListMutex.unlock();
-
-	Sleep(500);
-
-	erase_client_objects();
+	restartScanOnClient(pid);
 }
 
 /*
@@ -636,26 +538,20 @@ void key_grabber_thread::main_loop()
 		std::vector <DWORD> latestClientPIDs;
 		getRunningClientPIDs(latestClientPIDs);
 
-		if (!keyRequired)
-		{
-			if (IS_IN_VECTOR(latestClientPIDs, activeProcess))
-			{
-				Sleep(1000);
-				continue;
-			}
-			else
-			{
-				UInotifyClientRunning(activeProcess, false, latestClientPIDs.size(), activeClients.size(), uiMsgQueue);
-
-			}
-		}
-
 		processListMutex.lock();
 		if (!restartProcessScanClients.empty())
 		{
+			std::vector <GAMECLIENTINFO *> stillStopping;
 			for (auto it = restartProcessScanClients.begin(); it != restartProcessScanClients.end(); it++)
 			{
 				GAMECLIENTINFO *client = *it;
+				//previous scan hasn't finished closing its memory source yet
+				if (client->memSource)
+				{
+					stillStopping.push_back(client);
+					continue;
+				}
+
 				if (openClientHandle(client))
 				{
 					UInotifyClientRunning(client->pid, true, latestClientPIDs.size(), activeClients.size(), uiMsgQueue);
@@ -668,7 +564,7 @@ void key_grabber_thread::main_loop()
 					ERASE_FROM_VECTOR(activeClients, client);
 				}
 			}
-			restartProcessScanClients.clear();
+			restartProcessScanClients = stillStopping;
 		}
 		processListMutex.unlock();
 
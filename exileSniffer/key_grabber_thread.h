@@ -1,70 +1,52 @@
 #pragma once
 #include "base_thread.h"
 #include "uiMsg.h"
-
-#define SENT_BY_SERVER 1
-#define SALSA_KEY_SIZE 32 
-#define SALSA_IV_SIZE 8
+#include "keyblob_scanner.h"
+#include "memory_source.h"
+#include "region_scheduler.h"
+#include "scan_history.h"
+#include "region_fingerprint.h"
+#include "key_store.h"
+#include "key_source.h"
 
 
 typedef DWORD PROCESS_ID;
 
-#define KEYBLOB_SIZE 12*4 //32 key bytes + 8 IV bytes + 8 unused
-struct KEYDATA {
-	DWORD salsakey[SALSA_KEY_SIZE/sizeof(DWORD)];
-	DWORD IV[SALSA_IV_SIZE/sizeof(DWORD)];
-	DWORD foundAddress;
-	DWORD64 timeFound;
-	bool used = false;
-	DWORD sourceProcess;
-};
-
-class UNCLAIMED_KEY {
-public:
-	UNCLAIMED_KEY(KEYDATA *newkey) { key = newkey; }
-	KEYDATA *key;
-	vector<std::pair<unsigned int, byte>> streamsTested;
-};
+#define KEYBLOB_SIZE KEYBLOB_DATA_SIZE //32 key bytes + 8 IV bytes + 8 unused
 
 class GAMECLIENTINFO 
 {
 public:
-	GAMECLIENTINFO(DWORD processID) { 
-		pid = processID;
-		addressQueueMutex = CreateMutex(0, 0, 0);
-	}
+	GAMECLIENTINFO(DWORD processID) { pid = processID; }
 	DWORD pid;
-	HANDLE processhandle;
+	memory_source *memSource = NULL;
 	bool needsLoginKey = true;
-	semaphore handlesOpen;
-	HANDLE addressQueueMutex;
 	unsigned int memScanFiltersRelaxed = 0;
-	std::queue<std::pair<void *, size_t>> addressQueue;
-};
-
-struct memWorkerParams {
-	void *thisptr;
-	GAMECLIENTINFO *clientInfo;
-	bool started = false;
+	//apply the filter learned from previous keys before the fixed tiers
+	bool useLearnedFilter = true;
+	keyscan_stats scanStats;
 };
 
 
 
 class key_grabber_thread :
-	public base_thread
+	public base_thread, public key_source
 {
 public:
-	key_grabber_thread(SafeQueue<UI_MESSAGE *>* uiq) {uiMsgQueue = uiq;}
+	key_grabber_thread(SafeQueue<UI_MESSAGE *>* uiq) {
+		uiMsgQueue = uiq;
+		keyHistory.load(KEY_HISTORY_FILE);
+	}
 	~key_grabber_thread();
-	KEYDATA * getUnusedMemoryKey(unsigned int streamID, bool recvKey, KEYDATA *hintKey = NULL);
+	KEYDATA * getUnusedMemoryKey(unsigned int streamID, bool recvKey, KEYDATA *hintKey = NULL) override;
 
-	void claimKey(KEYDATA *key, unsigned int keyStreamID);
+	void claimKey(KEYDATA *key, unsigned int keyStreamID) override;
 	bool insertKey(KEYDATA *key);
-	void stopProcessScan(DWORD pid);
-	bool relaxScanFilters();
+	void stopProcessScan(DWORD pid) override;
+	bool relaxScanFilters() override;
 	void restartScanOnClient(DWORD pid);
-	void suspend_scanning(DWORD activeProcessPID);
-	void resume_scanning() { keyRequired = true; }
+	void suspend_scanning(DWORD decryptingPID);
+	void resume_scanning(DWORD pid);
 
 	bool running = true;
 	bool ded = false;
@@ -73,31 +55,15 @@ private:
 	void main_loop();
 	void grabKeys(GAMECLIENTINFO *clientInfo);
 	void keyGrabController(GAMECLIENTINFO *gameClient);
-	bool insertKey(DWORD pid, DWORD *keyblobptr, DWORD foundAddress);
+	bool insertKey(DWORD pid, DWORD *keyblobptr, uint64_t foundAddress, const MEMREGION &region);
+	void queueScanPass(region_scheduler &scheduler, std::vector<MEMREGION> &passRegions,
+		std::vector<eRegionChange> &regionChanges);
 	bool openClientHandle(GAMECLIENTINFO *gameClient);
 	void getRunningClientPIDs(std::vector <DWORD>& resultsList);
 	GAMECLIENTINFO* get_process_obj(DWORD pid);
-	void memoryScanWorker(GAMECLIENTINFO *);
+	void memoryScanWorker(GAMECLIENTINFO *gameClient, SCAN_JOB &job, 
+		std::vector<uint8_t> &procesMemChunk, std::vector<size_t> &signatureOffsets);
 	void purge_ended_processes(std::vector <DWORD>& latestClientPIDs);
-	void erase_client_objects();
-
-	static DWORD WINAPI scanControllerStart(void* Param) {
-		memWorkerParams *paramsPtr = (memWorkerParams*)Param;
-		paramsPtr->started = true;
-		key_grabber_thread* This = (key_grabber_thread*)paramsPtr->thisptr;
-		This->keyGrabController(paramsPtr->clientInfo);
-		
-		return 0;
-	}
-	static DWORD WINAPI scanWorkerStart(void* Param) {
-		memWorkerParams *paramsPtr = (memWorkerParams*)Param;
-		key_grabber_thread* This = (key_grabber_thread*)paramsPtr->thisptr;
-		This->memoryScanWorker(paramsPtr->clientInfo);
-		return 0;
-	}
-
-	bool keyRequired = true;
-	DWORD activeProcess = 0;
 
 	SafeQueue<UI_MESSAGE *> *uiMsgQueue;
 
@@ -106,7 +72,8 @@ private:
 	std::vector <GAMECLIENTINFO *> restartProcessScanClients;
 	
 
-	HANDLE keyVecMutex = CreateMutex(0, 0, 0);
-	list<UNCLAIMED_KEY> unclaimedKeys;
+	key_store unclaimedKeys;
+
+	scan_history keyHistory;
 };
 
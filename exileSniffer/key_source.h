@@ -0,0 +1,33 @@
+#pragma once
+#include "key_store.h"
+
+/*
+Where the packet processor gets candidate login keys from
+
+The key grabber finds them in the memory of running clients, a key file
+provides keys that were recovered in an earlier session so recorded
+traffic can be decrypted without the game.
+*/
+class key_source
+{
+public:
+	virtual ~key_source() {}
+
+	//next key this half of the stream hasn't tried yet, or NULL
+	virtual KEYDATA *getUnusedMemoryKey(unsigned int streamID, bool recvKey, KEYDATA *hintKey = NULL) = 0;
+	virtual void claimKey(KEYDATA *key, unsigned int keyStreamID) = 0;
+
+	//the process has a working key so the source can stop looking
+	virtual void stopProcessScan(DWORD pid) {}
+	//search harder for a key, false if there is nothing left to relax
+	virtual bool relaxScanFilters() { return false; }
+	//false when no new keys will turn up, so waiting streams can give up
+	virtual bool keys_pending() { return true; }
+
+	/*
+	Keys for a gameserver connection that weren't seen on the login stream,
+	eg: a recording started after login. Handed out once.
+	*/
+	virtual bool gameserver_keys(unsigned long connectionID, std::pair<KEYDATA *, KEYDATA *> &keys) { return false; }
+	virtual bool has_gameserver_keys() { return false; }
+};
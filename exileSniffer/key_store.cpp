@@ -0,0 +1,282 @@
+#include "stdafx.h"
+#include "key_store.h"
+
+key_store::key_store()
+{
+	currentSlab = new_slab(1);
+}
+
+key_store::~key_store()
+{
+	free_retired();
+	retiredKeys.swap(removedKeys);
+	free_retired();
+	free_slab(currentSlab);
+}
+
+void key_store::free_slab(KEY_SLAB *slab)
+{
+	for (int i = 0; i < KEYSTORE_MAX_SEGMENTS; ++i)
+		delete[] slab->segments[i].load();
+	delete slab;
+}
+
+//indexMutex must be held
+void key_store::free_retired()
+{
+	if (retiredSlab)
+		free_slab(retiredSlab);
+	retiredSlab = NULL;
+
+	for (KEYDATA *key : retiredKeys)
+		delete key;
+	retiredKeys.clear();
+}
+
+key_store::KEY_SLAB *key_store::new_slab(unsigned int generation)
+{
+	KEY_SLAB *slab = new KEY_SLAB;
+	slab->generation = generation;
+	for (int i = 0; i < KEYSTORE_MAX_SEGMENTS; ++i)
+		slab->segments[i] = NULL;
+	return slab;
+}
+
+uint64_t key_store::salsa_index_key(KEYDATA *key)
+{
+	return ((uint64_t)key->salsakey[0] << 32) | key->salsakey[1];
+}
+
+//returns the previous state of the bit
+bool key_store::test_and_set(std::vector<uint64_t> &bitset, unsigned int id)
+{
+	size_t word = id / 64;
+	if (word >= bitset.size())
+		bitset.resize(word + 1, 0);
+
+	uint64_t mask = 1ULL << (id % 64);
+	bool wasSet = (bitset[word] & mask) != 0;
+	bitset[word] |= mask;
+	return wasSet;
+}
+
+void key_store::unindex(std::unordered_multimap<uint64_t, unsigned int> &index, uint64_t key, unsigned int id)
+{
+	auto matches = index.equal_range(key);
+	for (auto it = matches.first; it != matches.second; ++it)
+	{
+		if (it->second == id)
+		{
+			index.erase(it);
+			return;
+		}
+	}
+}
+
+//indexMutex must be held, the slab must have room
+void key_store::append(KEY_SLAB *slab, KEYDATA *key)
+{
+	unsigned int id = slab->published.load(std::memory_order_relaxed);
+	unsigned int segmentIdx = id / KEYSTORE_SEGMENT_SIZE;
+	if (!slab->segments[segmentIdx].load(std::memory_order_relaxed))
+		slab->segments[segmentIdx].store(new STORED_KEY[KEYSTORE_SEGMENT_SIZE], std::memory_order_release);
+
+	key->storeGeneration = slab->generation;
+	key->storeID = id;
+
+	STORED_KEY *entry = stored(slab, id);
+	entry->key = key;
+	entry->foundAddress = key->foundAddress;
+	entry->salsaIndexKey = salsa_index_key(key);
+	entry->sourceProcess = key->sourceProcess;
+	memcpy(entry->IV, key->IV, SALSA_IV_SIZE);
+	entry->live.store(true, std::memory_order_relaxed);
+
+	addressIndex.emplace(entry->foundAddress, id);
+	processIndex[entry->sourceProcess].push_back(id);
+	salsaIndex.emplace(entry->salsaIndexKey, id);
+
+	//readers can see the entry from here
+	slab->published.store(id + 1, std::memory_order_release);
+}
+
+/*
+Move the live keys of the full slab into a new generation, leaving the dead ones behind.
+Streams start testing the new generation from scratch.
+indexMutex must be held
+*/
+key_store::KEY_SLAB *key_store::roll_over()
+{
+	//nothing still holds what the last roll over left behind
+	free_retired();
+
+	KEY_SLAB *oldSlab = currentSlab.load(std::memory_order_relaxed);
+	KEY_SLAB *slab = new_slab(oldSlab->generation + 1);
+
+	addressIndex.clear();
+	processIndex.clear();
+	salsaIndex.clear();
+
+	unsigned int published = oldSlab->published.load(std::memory_order_relaxed);
+	for (unsigned int id = 0; id < published; ++id)
+	{
+		STORED_KEY *entry = stored(oldSlab, id);
+		if (entry->live.load(std::memory_order_acquire))
+			append(slab, entry->key);
+	}
+
+	currentSlab.store(slab, std::memory_order_release);
+	retiredSlab = oldSlab;
+	retiredKeys.swap(removedKeys);
+	return slab;
+}
+
+eKeyInsert key_store::insert(KEYDATA *key)
+{
+	std::unique_lock<std::shared_timed_mutex> lock(indexMutex);
+	KEY_SLAB *slab = currentSlab.load(std::memory_order_relaxed);
+
+	auto sameAddress = addressIndex.equal_range(key->foundAddress);
+	for (auto it = sameAddress.first; it != sameAddress.second; ++it)
+	{
+		STORED_KEY *existing = stored(slab, it->second);
+		if (existing->sourceProcess == key->sourceProcess &&
+			!memcmp(existing->IV, key->IV, SALSA_IV_SIZE))
+			return eKeyDuplicate;
+	}
+
+	auto claimedAddress = claimedKeys.equal_range(key->foundAddress);
+	for (auto it = claimedAddress.first; it != claimedAddress.second; ++it)
+	{
+		if (it->second.sourceProcess == key->sourceProcess &&
+			!memcmp(it->second.IV, key->IV, SALSA_IV_SIZE))
+			return eKeyDuplicate;
+	}
+
+	if (slab->published.load(std::memory_order_relaxed) >= KEYSTORE_SLAB_KEYS)
+	{
+		if (liveKeys > KEYSTORE_ROLLOVER_MAX_LIVE)
+		{
+			++refusedKeys;
+			return eKeyStoreFull;
+		}
+		slab = roll_over();
+	}
+
+	append(slab, key);
+	++liveKeys;
+	return eKeyInserted;
+}
+
+KEYDATA *key_store::next_untested(unsigned int streamID, bool recvKey, KEYDATA *hintKey)
+{
+	KEY_SLAB *slab = currentSlab.load(std::memory_order_acquire);
+	unsigned int published = slab->published.load(std::memory_order_acquire);
+	if (!published)
+		return NULL;
+
+	std::lock_guard<std::mutex> testsLock(streamTestsMutex);
+	STREAM_TESTS &tests = streamTests[streamID];
+	if (tests.generation != slab->generation)
+	{
+		tests.generation = slab->generation;
+		tests.tested[0].clear();
+		tests.tested[1].clear();
+	}
+	std::vector<uint64_t> &testedBits = tests.tested[recvKey ? 1 : 0];
+
+	if (hintKey)
+	{
+		//the other half of the stream was decrypted, only its salsa key will do
+		std::vector<unsigned int> sameSalsa;
+		{
+			std::shared_lock<std::shared_timed_mutex> lock(indexMutex);
+			if (currentSlab.load(std::memory_order_relaxed) != slab)
+				return NULL;
+			auto matches = salsaIndex.equal_range(salsa_index_key(hintKey));
+			for (auto it = matches.first; it != matches.second; ++it)
+				sameSalsa.push_back(it->second);
+		}
+
+		for (auto it = sameSalsa.rbegin(); it != sameSalsa.rend(); ++it)
+		{
+			STORED_KEY *entry = stored(slab, *it);
+			if (!entry->live.load(std::memory_order_acquire))
+				continue;
+			if (memcmp(hintKey->salsakey, entry->key->salsakey, SALSA_KEY_SIZE))
+				continue;
+			if (test_and_set(testedBits, *it))
+				continue;
+			return entry->key;
+		}
+		return NULL;
+	}
+
+	for (unsigned int id = published; id-- > 0; )
+	{
+		STORED_KEY *entry = stored(slab, id);
+		if (!entry->live.load(std::memory_order_acquire))
+			continue;
+		if (test_and_set(testedBits, id))
+			continue;
+		//key was passed in a packet, not a login key
+		if (entry->key->foundAddress == SENT_BY_SERVER)
+			continue;
+		return entry->key;
+	}
+	return NULL;
+}
+
+bool key_store::claim(KEYDATA *key)
+{
+	//a roll over moves keys, don't race it
+	std::unique_lock<std::shared_timed_mutex> lock(indexMutex);
+	KEY_SLAB *slab = currentSlab.load(std::memory_order_relaxed);
+	if (key->storeGeneration != slab->generation ||
+		key->storeID >= slab->published.load(std::memory_order_relaxed))
+		return false;
+
+	STORED_KEY *entry = stored(slab, key->storeID);
+	if (entry->key != key)
+		return false;
+
+	bool wasLive = true;
+	if (!entry->live.compare_exchange_strong(wasLive, false))
+		return false;
+
+	//remembered apart from the slab so it isn't inserted again after a roll over
+	CLAIMED_KEY claimed;
+	claimed.sourceProcess = entry->sourceProcess;
+	memcpy(claimed.IV, entry->IV, SALSA_IV_SIZE);
+	claimedKeys.emplace(entry->foundAddress, claimed);
+
+	unindex(addressIndex, entry->foundAddress, key->storeID);
+	unindex(salsaIndex, entry->salsaIndexKey, key->storeID);
+	--liveKeys;
+	return true;
+}
+
+void key_store::remove_process(DWORD pid)
+{
+	std::unique_lock<std::shared_timed_mutex> lock(indexMutex);
+	KEY_SLAB *slab = currentSlab.load(std::memory_order_relaxed);
+
+	auto processKeys = processIndex.find(pid);
+	if (processKeys == processIndex.end())
+		return;
+
+	for (unsigned int id : processKeys->second)
+	{
+		STORED_KEY *entry = stored(slab, id);
+		bool wasLive = true;
+		if (!entry->live.compare_exchange_strong(wasLive, false))
+			continue;
+
+		--liveKeys;
+		unindex(addressIndex, entry->foundAddress, id);
+		unindex(salsaIndex, entry->salsaIndexKey, id);
+		//the processor could be testing it, it goes with the next roll over
+		removedKeys.push_back(entry->key);
+	}
+	processIndex.erase(processKeys);
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "stdafx.h"
+#include "memory_source.h"
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_map>
+
+#define SENT_BY_SERVER 1
+#define SALSA_KEY_SIZE 32
+#define SALSA_IV_SIZE 8
+
+#define KEYSTORE_SEGMENT_SIZE 1024
+#define KEYSTORE_MAX_SEGMENTS 64
+#define KEYSTORE_SLAB_KEYS (KEYSTORE_SEGMENT_SIZE * KEYSTORE_MAX_SEGMENTS)
+//a full slab is only rolled over if it frees at least a quarter of it
+#define KEYSTORE_ROLLOVER_MAX_LIVE (KEYSTORE_SLAB_KEYS / 4 * 3)
+
+struct KEYDATA {
+	DWORD salsakey[SALSA_KEY_SIZE/sizeof(DWORD)];
+	DWORD IV[SALSA_IV_SIZE/sizeof(DWORD)];
+	uint64_t foundAddress;
+	MEMREGION sourceRegion; //where foundAddress was when the key was found
+	DWORD64 timeFound;
+	bool used = false;
+	DWORD sourceProcess;
+
+	//position in the key store, set on insert
+	unsigned int storeGeneration = 0;
+	unsigned int storeID = 0;
+};
+
+/*
+Unclaimed keys waiting to be tried against streams
+
+Keys are appended to fixed segments that are never moved, and a published
+count says how many are ready, so walking the candidates takes no locks.
+Claimed and removed keys are marked dead and dropped from the indexes.
+Where claimed keys were found is remembered outside the slab, across roll
+overs, so the same key isn't picked up from memory again.
+
+Inserts (from the scan workers) only lock the insert indexes. Stream test
+records are only touched by the packet processor so the scan workers never
+wait on it and vice versa.
+
+When the slab is full the live keys are moved to a fresh generation and
+the dead ones left behind. If most of them are still live new keys are
+refused instead. The old slab isn't freed straight away as a stream could
+still be walking it, and neither are removed keys as the processor could
+be testing one. Both are freed at the roll over after, a quarter of a slab
+of inserts later. Claimed keys are owned by the streams using them.
+*/
+enum eKeyInsert { eKeyInserted, eKeyDuplicate, eKeyStoreFull };
+
+class key_store
+{
+public:
+	key_store();
+	~key_store();
+
+	//eKeyStoreFull when the slab is full and too few of its keys are dead to roll it over
+	eKeyInsert insert(KEYDATA *key);
+
+	/*
+	Next key not yet tested on this half of the stream, newest first.
+	Marks it tested. With a hint only keys sharing its salsa key are returned.
+	*/
+	KEYDATA *next_untested(unsigned int streamID, bool recvKey, KEYDATA *hintKey = NULL);
+
+	//false if the key isn't live in the store
+	bool claim(KEYDATA *key);
+	void remove_process(DWORD pid);
+
+	size_t live_count() { return liveKeys; }
+	size_t refused_count() { return refusedKeys; }
+
+private:
+	struct STORED_KEY {
+		KEYDATA *key = NULL;
+		std::atomic<bool> live{ false };
+		//copied from the key so the indexes can be kept after the key is claimed and freed
+		uint64_t foundAddress = 0;
+		uint64_t salsaIndexKey = 0;
+		DWORD sourceProcess = 0;
+		DWORD IV[SALSA_IV_SIZE / sizeof(DWORD)];
+	};
+
+	struct KEY_SLAB {
+		unsigned int generation;
+		std::atomic<STORED_KEY *> segments[KEYSTORE_MAX_SEGMENTS];
+		std::atomic<unsigned int> published{ 0 };
+	};
+
+	//enough of a claimed key to know it if it is found again
+	struct CLAIMED_KEY {
+		DWORD sourceProcess;
+		DWORD IV[SALSA_IV_SIZE / sizeof(DWORD)];
+	};
+
+	struct STREAM_TESTS {
+		unsigned int generation = 0;
+		std::vector<uint64_t> tested[2]; //send, recv bitsets indexed by storeID
+	};
+
+	STORED_KEY *stored(KEY_SLAB *slab, unsigned int id) {
+		return &slab->segments[id / KEYSTORE_SEGMENT_SIZE].load(std::memory_order_acquire)[id % KEYSTORE_SEGMENT_SIZE];
+	}
+	static uint64_t salsa_index_key(KEYDATA *key);
+	static bool test_and_set(std::vector<uint64_t> &bitset, unsigned int id);
+	KEY_SLAB *new_slab(unsigned int generation);
+	void append(KEY_SLAB *slab, KEYDATA *key);
+	KEY_SLAB *roll_over();
+	static void free_slab(KEY_SLAB *slab);
+	void free_retired();
+	static void unindex(std::unordered_multimap<uint64_t, unsigned int> &index, uint64_t key, unsigned int id);
+
+	std::atomic<KEY_SLAB *> currentSlab;
+	//left behind by the last roll over, freed by the next
+	KEY_SLAB *retiredSlab = NULL;
+	std::vector<KEYDATA *> retiredKeys;
+	//removed since the last roll over
+	std::vector<KEYDATA *> removedKeys;
+	std::atomic<size_t> liveKeys{ 0 };
+	std::atomic<size_t> refusedKeys{ 0 };
+
+	//guards the slab appends, claims and the indexes below
+	std::shared_timed_mutex indexMutex;
+	std::unordered_multimap<uint64_t, unsigned int> addressIndex;
+	std::unordered_map<DWORD, std::vector<unsigned int>> processIndex;
+	std::unordered_multimap<uint64_t, unsigned int> salsaIndex;
+	//by found address
+	std::unordered_multimap<uint64_t, CLAIMED_KEY> claimedKeys;
+
+	std::mutex streamTestsMutex;
+	std::unordered_map<unsigned int, STREAM_TESTS> streamTests;
+};
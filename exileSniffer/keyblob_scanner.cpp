@@ -0,0 +1,201 @@
+/*
+Vectorised search for the salsa20 "expand 32-byte k" constant
+
+The key grabber reads client memory in chunks and hands each one to
+find_keyblob_signatures. Only 16 byte aligned positions are tested,
+each is a single compare against the whole signature.
+
+Not built with the precompiled header so it stays portable
+*/
+#include "keyblob_scanner.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define KEYSCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define KEYSCAN_TARGET_AVX2
+#else
+#define KEYSCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static const char keyblobSignature[] = "expand 32-byte k";
+
+//a signature is only useful if the whole blob after it is in the buffer
+static inline size_t last_candidate_offset(size_t length)
+{
+	return length - (KEYBLOB_SIGNATURE_SIZE + KEYBLOB_DATA_SIZE);
+}
+
+static size_t scan_scalar(const uint8_t *data, size_t start, size_t length, std::vector<size_t> &results)
+{
+	size_t found = 0;
+	uint32_t expa;
+	memcpy(&expa, keyblobSignature, sizeof(expa));
+
+	size_t lastOffset = last_candidate_offset(length);
+	for (size_t offset = start; offset <= lastOffset; offset += KEYBLOB_ALIGNMENT)
+	{
+		uint32_t firstDword;
+		memcpy(&firstDword, data + offset, sizeof(firstDword));
+		if (firstDword != expa) continue;
+		if (memcmp(data + offset, keyblobSignature, KEYBLOB_SIGNATURE_SIZE)) continue;
+
+		results.push_back(offset);
+		++found;
+	}
+	return found;
+}
+
+#ifdef KEYSCAN_X86
+static size_t scan_sse2(const uint8_t *data, size_t length, std::vector<size_t> &results)
+{
+	size_t found = 0;
+	const __m128i signature = _mm_loadu_si128((const __m128i *)keyblobSignature);
+
+	size_t lastOffset = last_candidate_offset(length);
+	size_t offset = 0;
+
+	//4 candidate positions per iteration
+	for (; offset + 3 * KEYBLOB_ALIGNMENT <= lastOffset; offset += 4 * KEYBLOB_ALIGNMENT)
+	{
+		const uint8_t *block = data + offset;
+		int m0 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block)), signature));
+		int m1 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 16)), signature));
+		int m2 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 32)), signature));
+		int m3 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 48)), signature));
+		if (m0 != 0xFFFF && m1 != 0xFFFF && m2 != 0xFFFF && m3 != 0xFFFF)
+			continue;
+
+		if (m0 == 0xFFFF) { results.push_back(offset); ++found; }
+		if (m1 == 0xFFFF) { results.push_back(offset + 16); ++found; }
+		if (m2 == 0xFFFF) { results.push_back(offset + 32); ++found; }
+		if (m3 == 0xFFFF) { results.push_back(offset + 48); ++found; }
+	}
+
+	return found + scan_scalar(data, offset, length, results);
+}
+
+KEYSCAN_TARGET_AVX2
+static size_t scan_avx2(const uint8_t *data, size_t length, std::vector<size_t> &results)
+{
+	size_t found = 0;
+	//the signature in both lanes so each load tests two candidate positions
+	const __m256i signature = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)keyblobSignature));
+
+	size_t lastOffset = last_candidate_offset(length);
+	size_t offset = 0;
+
+	//4 candidate positions per iteration
+	for (; offset + 3 * KEYBLOB_ALIGNMENT <= lastOffset; offset += 4 * KEYBLOB_ALIGNMENT)
+	{
+		const uint8_t *block = data + offset;
+		uint32_t m01 = (uint32_t)_mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(block)), signature));
+		uint32_t m23 = (uint32_t)_mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(block + 32)), signature));
+
+		//cheap reject: no lane had even a full 16 byte match
+		if ((m01 & 0xFFFF) != 0xFFFF && (m01 >> 16) != 0xFFFF &&
+			(m23 & 0xFFFF) != 0xFFFF && (m23 >> 16) != 0xFFFF)
+			continue;
+
+		if ((m01 & 0xFFFF) == 0xFFFF) { results.push_back(offset); ++found; }
+		if ((m01 >> 16) == 0xFFFF) { results.push_back(offset + 16); ++found; }
+		if ((m23 & 0xFFFF) == 0xFFFF) { results.push_back(offset + 32); ++found; }
+		if ((m23 >> 16) == 0xFFFF) { results.push_back(offset + 48); ++found; }
+	}
+
+	return found + scan_scalar(data, offset, length, results);
+}
+#endif
+
+eScanKernel best_scan_kernel()
+{
+#ifdef KEYSCAN_X86
+#ifdef _MSC_VER
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 0);
+	if (cpuInfo[0] >= 7)
+	{
+		__cpuid(cpuInfo, 1);
+		bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+		bool avx = (cpuInfo[2] & (1 << 28)) != 0;
+		__cpuidex(cpuInfo, 7, 0);
+		bool avx2 = (cpuInfo[1] & (1 << 5)) != 0;
+		//the OS also has to save the ymm registers on context switch
+		if (osxsave && avx && avx2 && ((_xgetbv(0) & 0x6) == 0x6))
+			return eScanAVX2;
+	}
+	return eScanSSE2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return eScanAVX2;
+	return eScanSSE2;
+#endif
+#else
+	return eScanScalar;
+#endif
+}
+
+const char *scan_kernel_name(eScanKernel kernel)
+{
+	switch (kernel)
+	{
+	case eScanAVX2:
+		return "AVX2";
+	case eScanSSE2:
+		return "SSE2";
+	default:
+		return "Scalar";
+	}
+}
+
+size_t find_keyblob_signatures(const uint8_t *data, size_t length, std::vector<size_t> &results, eScanKernel kernel)
+{
+	if (length < KEYBLOB_SIGNATURE_SIZE + KEYBLOB_DATA_SIZE)
+		return 0;
+
+	switch (kernel)
+	{
+#ifdef KEYSCAN_X86
+	case eScanAVX2:
+		return scan_avx2(data, length, results);
+	case eScanSSE2:
+		return scan_sse2(data, length, results);
+#endif
+	default:
+		return scan_scalar(data, 0, length, results);
+	}
+}
+
+size_t find_keyblob_signatures(const uint8_t *data, size_t length, std::vector<size_t> &results)
+{
+	static const eScanKernel kernel = best_scan_kernel();
+	return find_keyblob_signatures(data, length, results, kernel);
+}
+
+double keyscan_stats::kernel_MBps()
+{
+	long long ns = scanNanoseconds;
+	if (ns <= 0) return 0;
+	return ((double)bytesScanned / (1024.0 * 1024.0)) / ((double)ns / 1e9);
+}
+
+double keyscan_stats::wallclock_MBps()
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+	if (elapsed.count() <= 0) return 0;
+	return ((double)bytesScanned / (1024.0 * 1024.0)) / elapsed.count();
+}
+
+void keyscan_stats::mark_elapsed(std::atomic<long long> &mark)
+{
+	long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - startTime).count();
+	long long unset = -1;
+	mark.compare_exchange_strong(unset, elapsed);
+}
@@ -0,0 +1,79 @@
+#pragma once
+/*
+Signature search used by the key grabber to find salsa key blobs in client memory
+
+Deliberately free of Qt/Win32 so it can be built and benchmarked on its own
+against synthetic memory images
+*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+//"expand 32-byte k" - the salsa20 constant the client stores in front of the key blob
+#define KEYBLOB_SIGNATURE_SIZE 16
+#define KEYBLOB_DATA_SIZE 12*4
+//the signature always starts on a 16 byte boundary
+#define KEYBLOB_ALIGNMENT 16
+
+//size of the reusable buffer each scan worker reads regions into
+#define KEYSCAN_CHUNK_SIZE (4 * 1024 * 1024)
+//bytes each chunk shares with the previous one so a blob straddling the boundary is still found
+#define KEYSCAN_CHUNK_OVERLAP (KEYBLOB_SIGNATURE_SIZE + KEYBLOB_DATA_SIZE - KEYBLOB_ALIGNMENT)
+
+enum eScanKernel { eScanScalar, eScanSSE2, eScanAVX2 };
+
+/*
+Finds every aligned "expand 32-byte k" in data which is followed by a full key blob
+Offsets of the signatures (relative to data) are appended to results
+
+Returns the number of signatures found
+*/
+size_t find_keyblob_signatures(const uint8_t *data, size_t length, std::vector<size_t> &results);
+size_t find_keyblob_signatures(const uint8_t *data, size_t length, std::vector<size_t> &results, eScanKernel kernel);
+
+//the fastest kernel supported by this cpu
+eScanKernel best_scan_kernel();
+const char *scan_kernel_name(eScanKernel kernel);
+
+/*
+Throughput and latency counters shared by the workers scanning one client
+*/
+class keyscan_stats
+{
+public:
+	void start() {
+		bytesScanned = 0;
+		scanNanoseconds = 0;
+		firstCandidateMs = -1;
+		validKeyMs = -1;
+		startTime = std::chrono::steady_clock::now();
+	}
+	void add(size_t bytes, std::chrono::steady_clock::duration scanTime) {
+		bytesScanned += bytes;
+		scanNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(scanTime).count();
+	}
+
+	unsigned long long bytes() { return bytesScanned; }
+	//rate of the signature search itself
+	double kernel_MBps();
+	//rate of the whole scan including reading the memory, since start()
+	double wallclock_MBps();
+
+	//only the first call after start() is recorded
+	void mark_first_candidate() { mark_elapsed(firstCandidateMs); }
+	void mark_valid_key() { mark_elapsed(validKeyMs); }
+	//milliseconds from start(), -1 if it hasn't happened yet
+	long long ms_to_first_candidate() { return firstCandidateMs; }
+	long long ms_to_valid_key() { return validKeyMs; }
+
+private:
+	void mark_elapsed(std::atomic<long long> &mark);
+
+	std::atomic<unsigned long long> bytesScanned{ 0 };
+	std::atomic<long long> scanNanoseconds{ 0 };
+	std::atomic<long long> firstCandidateMs{ -1 };
+	std::atomic<long long> validKeyMs{ -1 };
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+};
@@ -22,16 +22,32 @@ void exileSniffer::init_loginPkt_Actioners()
 	loginPktActioners[LOGIN_CLI_REQUEST_LEAGUES] = &exileSniffer::action_LOGIN_CLI_REQUEST_LEAGUES;
 }
 
-void exileSniffer::action_decoded_login_packet(UIDecodedPkt& decoded)
+//as game_payload_usable
+bool exileSniffer::login_payload_usable(UIDecodedPkt& decoded)
 {
-	auto it = loginPktActioners.find(decoded.getMessageID());
-	if (it != loginPktActioners.end())
+	switch (decoded.getMessageID())
 	{
-		exileSniffer::actionFunc f = it->second;
-		(this->*f)(decoded, NULL);
+	case LOGIN_SRV_CHAR_LIST:
+		return payload_has_list(decoded, L"CharacterList", "Warning: No CharacterList found in payload of LOGIN_SRV_CHAR_LIST");
+
+	case LOGIN_SRV_NOTIFY_GAMESERVER:
+		//listed with a [BAD] summary
+		payload_has_list(decoded, L"ServerBlobs", "Warning: No ServerBlobs found in payload of LOGIN_SRV_NOTIFY_GAMESERVER");
+		return true;
 
-		++decodedCount_Displayed_Filtered.first;
-		updateDecodedFilterLabel();
+	default:
+		return true;
+	}
+}
+
+void exileSniffer::action_decoded_login_packet(UIDecodedPkt& decoded)
+{
+	if (loginPktActioners.find(decoded.getMessageID()) != loginPktActioners.end())
+	{
+		if (!login_payload_usable(decoded))
+			return;
+		addDecodedListEntry(&decoded);
+		decodedLabelStale = true;
 	}
 	else
 	{
@@ -49,7 +65,6 @@ void exileSniffer::action_LOGIN_CLI_KEEP_ALIVE(UIDecodedPkt& obj, QString *analy
 	if (!analysis)
 	{
 		obj.summary = "Client keepalive message";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -73,7 +88,6 @@ void exileSniffer::action_LOGIN_EPHERMERAL_PUBKEY(UIDecodedPkt& obj, QString *an
 
 
 		obj.summary = QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -109,7 +123,6 @@ void exileSniffer::action_LOGIN_CLI_AUTH_DATA(UIDecodedPkt& obj, QString *analys
 	{
 
 		obj.summary = "Client authentication data for account: "+QString::fromStdWString(accountName);
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -153,7 +166,6 @@ void exileSniffer::action_LOGIN_SRV_UNK0x4(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary = "Unknown packet 0x04";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -168,7 +180,6 @@ void exileSniffer::action_LOGIN_CLI_RESYNC(UIDecodedPkt& obj, QString *analysis)
 	{
 
 		obj.summary = "Character Select Resync. Arg 0x"+QString::number(obj.get_UInt32(L"Arg"));
-		addDecodedListEntry(&obj);
 		return;
 	}
 }
@@ -191,7 +202,6 @@ void exileSniffer::action_LOGIN_SRV_CHAR_LIST(UIDecodedPkt& obj, QString *analys
 	auto it = obj.payload->FindMember(L"CharacterList");
 	if (it == obj.payload->MemberEnd())
 	{
-		add_metalog_update("Warning: No CharacterList found in payload of LOGIN_SRV_CHAR_LIST", obj.getClientProcessID());
 		return;
 	}
 
@@ -202,7 +212,6 @@ void exileSniffer::action_LOGIN_SRV_CHAR_LIST(UIDecodedPkt& obj, QString *analys
 	{
 
 		obj.summary = "Character list with "+QString::number(listSize)+" characters";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -243,7 +252,6 @@ void exileSniffer::action_LOGIN_SRV_FINAL_PKT(UIDecodedPkt& obj, QString *analys
 	{
 
 		obj.summary = "Final loginserver packet. Arg: 0x"+QString::number(arg,16);
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -258,7 +266,6 @@ void exileSniffer::action_LOGIN_CLI_CHANGE_PASSWORD(UIDecodedPkt& obj, QString *
 	{
 
 		obj.summary = "Password change";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -273,7 +280,6 @@ void exileSniffer::action_LOGIN_CLI_DELETE_CHARACTER(UIDecodedPkt& obj, QString
 	{
 
 		obj.summary = "Delete character";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -288,7 +294,6 @@ void exileSniffer::action_LOGIN_CLI_CHARACTER_SELECTED(UIDecodedPkt& obj, QStrin
 	{
 
 		obj.summary = "Character selected";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -307,10 +312,7 @@ void exileSniffer::action_LOGIN_SRV_NOTIFY_GAMESERVER(UIDecodedPkt& obj, QString
 	auto gbit = obj.payload->FindMember(L"ServerBlobs");
 	if (gbit == obj.payload->MemberEnd())
 	{
-		add_metalog_update("Warning: No ServerBlobs found in payload of LOGIN_SRV_NOTIFY_GAMESERVER", obj.getClientProcessID());
-
 		obj.summary = "Gameserver connection information [BAD]";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -331,7 +333,6 @@ void exileSniffer::action_LOGIN_SRV_NOTIFY_GAMESERVER(UIDecodedPkt& obj, QString
 
 
 		obj.summary = QString::fromStdWString(summary.str());
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -351,7 +352,6 @@ void exileSniffer::action_LOGIN_CLI_CREATED_CHARACTER(UIDecodedPkt& obj, QString
 	{
 
 		obj.summary = "Character created: "+QString::fromStdWString(name);
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -372,7 +372,6 @@ void exileSniffer::action_LOGIN_CLI_REQUEST_RACE_DATA(UIDecodedPkt& obj, QString
 	{
 
 		obj.summary = "Client requested race data";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -392,7 +391,6 @@ void exileSniffer::action_LOGIN_SRV_LEAGUE_LIST(UIDecodedPkt& obj, QString *anal
 	{
 
 		obj.summary = "League list with "+QString::number(blobListSize)+" entries";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -410,7 +408,6 @@ void exileSniffer::action_LOGIN_CLI_REQUEST_LEAGUES(UIDecodedPkt& obj, QString *
 	{
 
 		obj.summary = "Client requested league list";
-		addDecodedListEntry(&obj);
 		return;
 	}
 
@@ -197,9 +197,9 @@ void packet_processor::deserialise_LOGIN_SRV_NOTIFY_GAMESERVER(UIDecodedPkt *uip
 		return;
 	}
 
-	key1A->sourceProcess = key1B->sourceProcess = currentStreamObj->workingRecvKey->sourceProcess;
+	key1A->sourceProcess = key1B->sourceProcess = stream_process();
 	key1A->foundAddress = key1B->foundAddress = SENT_BY_SERVER;
-	pendingGameserverKeys[connectionID] = make_pair(key1A, key1B);
+	add_pending_gameserver_keys(connectionID, key1A, key1B);
 
 	consume_blob(remainingDecrypted);
 }
@@ -217,7 +217,7 @@ void packet_processor::deserialise_LOGIN_CLI_CREATED_CHARACTER(UIDecodedPkt *uip
 
 void packet_processor::deserialise_LOGIN_SRV_FINAL_PKT(UIDecodedPkt *uipkt)
 {
-	UInotifyStreamState(currentMsgStreamID, eStreamTransitionGame, uiMsgQueue);
+	notify_stream_state(eStreamTransitionGame);
 	consume_add_word(L"Arg", uipkt);
 }
 
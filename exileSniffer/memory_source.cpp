@@ -0,0 +1,422 @@
+/*
+Memory sources for the key grabber
+
+Not built with the precompiled header so it stays portable
+*/
+#include "memory_source.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdio>
+#endif
+
+#ifdef _WIN32
+static unsigned int win_protect_flags(DWORD protect)
+{
+	unsigned int flags = 0;
+	switch (protect & 0xff)
+	{
+	case PAGE_READONLY:
+		flags = MEMPROT_READ;
+		break;
+	case PAGE_READWRITE:
+		flags = MEMPROT_READWRITE;
+		break;
+	case PAGE_WRITECOPY:
+		flags = MEMPROT_READWRITE | MEMPROT_COPYONWRITE;
+		break;
+	case PAGE_EXECUTE:
+		flags = MEMPROT_EXECUTE;
+		break;
+	case PAGE_EXECUTE_READ:
+		flags = MEMPROT_EXECUTE | MEMPROT_READ;
+		break;
+	case PAGE_EXECUTE_READWRITE:
+		flags = MEMPROT_EXECUTE | MEMPROT_READWRITE;
+		break;
+	case PAGE_EXECUTE_WRITECOPY:
+		flags = MEMPROT_EXECUTE | MEMPROT_READWRITE | MEMPROT_COPYONWRITE;
+		break;
+	default: //noaccess or unallocated
+		break;
+	}
+
+	if (protect & PAGE_GUARD)
+		flags |= MEMPROT_GUARD;
+	if (protect & (PAGE_NOCACHE | PAGE_WRITECOMBINE))
+		flags |= MEMPROT_NOCACHE;
+	return flags;
+}
+
+bool win_process_memory_source::open(std::string &error)
+{
+	processHandle = OpenProcess(PROCESS_VM_READ | PROCESS_QUERY_INFORMATION, FALSE, pid);
+	if (!processHandle)
+	{
+		error = "OpenProcess<VM_READ+QUERY_INFORMATION> of target game client failed";
+		return false;
+	}
+
+	//an initial test for queryability
+	MEMREGION firstRegion;
+	if (query_region(0, firstRegion) != eRegionFound)
+	{
+		error = "VirtualQueryEx of target process failed";
+		return false;
+	}
+	return true;
+}
+
+void win_process_memory_source::close()
+{
+	if (processHandle)
+	{
+		CloseHandle(processHandle);
+		processHandle = NULL;
+	}
+}
+
+eRegionQuery win_process_memory_source::query_region(uint64_t address, MEMREGION &region, unsigned long *errorCode)
+{
+	MEMORY_BASIC_INFORMATION info;
+	if (VirtualQueryEx(processHandle, (LPCVOID)address, &info, sizeof(info)) != sizeof(info))
+	{
+		DWORD lasterr = GetLastError();
+		if (errorCode) *errorCode = lasterr;
+
+		if (lasterr == ERROR_INVALID_PARAMETER)
+			return eRegionEnd;
+		if (lasterr == ERROR_ACCESS_DENIED)
+			return eRegionDenied;
+		return eRegionError;
+	}
+
+	region.base = (uint64_t)info.BaseAddress;
+	region.size = info.RegionSize;
+	region.protect = win_protect_flags(info.Protect);
+	region.allocationProtect = win_protect_flags(info.AllocationProtect);
+	region.committed = (info.State & MEM_COMMIT) != 0;
+
+	switch (info.Type)
+	{
+	case MEM_PRIVATE:
+		region.type = eMemPrivate;
+		break;
+	case MEM_MAPPED:
+		region.type = eMemMapped;
+		break;
+	case MEM_IMAGE:
+		region.type = eMemImage;
+		break;
+	default:
+		region.type = eMemUnknown;
+	}
+	return eRegionFound;
+}
+
+size_t win_process_memory_source::read(uint64_t address, void *buffer, size_t size, unsigned long *errorCode)
+{
+	SIZE_T bytesRead = 0;
+	if (!ReadProcessMemory(processHandle, (LPCVOID)address, buffer, size, &bytesRead))
+	{
+		DWORD lasterr = GetLastError();
+		if (errorCode && lasterr != ERROR_PARTIAL_COPY)
+			*errorCode = lasterr;
+	}
+	return bytesRead;
+}
+#endif //_WIN32
+
+
+
+#ifdef __linux__
+bool proc_pid_memory_source::open(std::string &error)
+{
+	unsigned long err = 0;
+	if (!reload_maps(&err))
+	{
+		error = "Failed to read /proc/" + std::to_string(pid) + "/maps. Error " + std::to_string(err);
+		return false;
+	}
+
+	std::string mempath = "/proc/" + std::to_string(pid) + "/mem";
+	memfd = ::open(mempath.c_str(), O_RDONLY);
+	if (memfd == -1)
+	{
+		error = "Failed to open " + mempath + ". Error " + std::to_string(errno);
+		return false;
+	}
+	return true;
+}
+
+void proc_pid_memory_source::close()
+{
+	if (memfd != -1)
+	{
+		::close(memfd);
+		memfd = -1;
+	}
+}
+
+bool proc_pid_memory_source::reload_maps(unsigned long *errorCode)
+{
+	std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+	if (!maps.is_open())
+	{
+		if (errorCode) *errorCode = errno;
+		return false;
+	}
+
+	regions.clear();
+	std::string line;
+	while (std::getline(maps, line))
+	{
+		unsigned long long start, end, offset, inode;
+		char perms[5] = { 0 };
+		unsigned int devMajor, devMinor;
+		int pathStart = 0;
+		if (sscanf(line.c_str(), "%llx-%llx %4s %llx %x:%x %llu %n",
+			&start, &end, perms, &offset, &devMajor, &devMinor, &inode, &pathStart) < 7)
+			continue;
+
+		MEMREGION region;
+		region.base = start;
+		region.size = end - start;
+		if (perms[0] == 'r') region.protect |= MEMPROT_READ;
+		if (perms[1] == 'w') region.protect |= MEMPROT_WRITE;
+		if (perms[2] == 'x') region.protect |= MEMPROT_EXECUTE;
+		region.allocationProtect = region.protect;
+		region.committed = true;
+
+		bool fileBacked = (inode != 0);
+		if (fileBacked)
+			region.type = eMemImage;
+		else if (perms[3] == 's')
+			region.type = eMemMapped;
+		else
+			region.type = eMemPrivate;
+
+		regions.push_back(region);
+	}
+	return true;
+}
+
+eRegionQuery proc_pid_memory_source::query_region(uint64_t address, MEMREGION &region, unsigned long *errorCode)
+{
+	std::lock_guard<std::mutex> lock(mapsMutex);
+
+	//walking back to the start means a new pass - pick up any changes to the mappings
+	if (address == 0 || address < lastQueryAddress)
+	{
+		if (!reload_maps(errorCode))
+			return (errno == EACCES) ? eRegionDenied : eRegionError;
+	}
+	lastQueryAddress = address;
+
+	auto it = std::find_if(regions.begin(), regions.end(),
+		[address](const MEMREGION &r) { return r.base + r.size > address; });
+	if (it == regions.end())
+		return eRegionEnd;
+
+	region = *it;
+	return eRegionFound;
+}
+
+size_t proc_pid_memory_source::read(uint64_t address, void *buffer, size_t size, unsigned long *errorCode)
+{
+	ssize_t bytesRead = pread(memfd, buffer, size, (off_t)address);
+	if (bytesRead < 0)
+	{
+		//EIO is the equivalent of a partial copy - unreadable pages in the range
+		if (errorCode && errno != EIO)
+			*errorCode = errno;
+		return 0;
+	}
+	return (size_t)bytesRead;
+}
+#endif //__linux__
+
+
+
+template <typename T>
+static T get_le(const uint8_t *ptr)
+{
+	T result = 0;
+	for (size_t i = 0; i < sizeof(T); ++i)
+		result |= ((T)ptr[i]) << (8 * i);
+	return result;
+}
+
+#define ELF_PT_LOAD 1
+#define ELF_PF_X 0x1
+#define ELF_PF_W 0x2
+#define ELF_PF_R 0x4
+#define ELF_ET_CORE 4
+#define ELF64_EHDR_SIZE 64
+#define ELF64_PHDR_SIZE 56
+
+bool dump_file_memory_source::open(std::string &error)
+{
+	dumpfile.open(path, std::ios::in | std::ios::binary);
+	if (!dumpfile.is_open())
+	{
+		error = "Failed to open memory dump " + path;
+		return false;
+	}
+
+	dumpfile.seekg(0, std::ios::end);
+	uint64_t fileLength = (uint64_t)dumpfile.tellg();
+	dumpfile.seekg(0, std::ios::beg);
+
+	char magic[4] = { 0 };
+	dumpfile.read(magic, sizeof(magic));
+	dumpfile.clear();
+
+	if (fileLength >= ELF64_EHDR_SIZE && !memcmp(magic, "\x7f" "ELF", 4))
+		return load_elf_core(error);
+
+	load_flat_image(fileLength);
+	return true;
+}
+
+void dump_file_memory_source::close()
+{
+	if (dumpfile.is_open())
+		dumpfile.close();
+	segments.clear();
+}
+
+bool dump_file_memory_source::load_elf_core(std::string &error)
+{
+	uint8_t header[ELF64_EHDR_SIZE];
+	dumpfile.seekg(0);
+	dumpfile.read((char *)header, sizeof(header));
+
+	//ELFCLASS64, ELFDATA2LSB
+	if (header[4] != 2 || header[5] != 1 || get_le<uint16_t>(header + 0x10) != ELF_ET_CORE)
+	{
+		error = path + " is an ELF file but not a 64 bit little endian core dump";
+		return false;
+	}
+
+	uint64_t phoff = get_le<uint64_t>(header + 0x20);
+	uint16_t phentsize = get_le<uint16_t>(header + 0x36);
+	uint16_t phnum = get_le<uint16_t>(header + 0x38);
+	if (phentsize < ELF64_PHDR_SIZE)
+	{
+		error = "Bad program header size in core dump " + path;
+		return false;
+	}
+
+	std::vector<uint8_t> phdr(phentsize);
+	for (uint16_t i = 0; i < phnum; ++i)
+	{
+		dumpfile.seekg(phoff + (uint64_t)i * phentsize);
+		if (!dumpfile.read((char *)phdr.data(), phentsize))
+		{
+			error = "Truncated program headers in core dump " + path;
+			return false;
+		}
+
+		if (get_le<uint32_t>(phdr.data()) != ELF_PT_LOAD)
+			continue;
+
+		uint32_t flags = get_le<uint32_t>(phdr.data() + 4);
+		DUMP_SEGMENT segment;
+		segment.fileOffset = get_le<uint64_t>(phdr.data() + 8);
+		segment.region.base = get_le<uint64_t>(phdr.data() + 16);
+		segment.fileSize = get_le<uint64_t>(phdr.data() + 32);
+		segment.region.size = get_le<uint64_t>(phdr.data() + 40);
+		if (!segment.region.size)
+			continue;
+
+		if (flags & ELF_PF_R) segment.region.protect |= MEMPROT_READ;
+		if (flags & ELF_PF_W) segment.region.protect |= MEMPROT_WRITE;
+		if (flags & ELF_PF_X) segment.region.protect |= MEMPROT_EXECUTE;
+		segment.region.allocationProtect = segment.region.protect;
+		//cores don't record what backed a mapping
+		segment.region.type = eMemPrivate;
+		segment.region.committed = true;
+		segments.push_back(segment);
+	}
+
+	std::sort(segments.begin(), segments.end(),
+		[](const DUMP_SEGMENT &a, const DUMP_SEGMENT &b) { return a.region.base < b.region.base; });
+	return true;
+}
+
+//one region, pieces of it would hide a blob that crosses from one to the next
+void dump_file_memory_source::load_flat_image(uint64_t fileLength)
+{
+	if (!fileLength)
+		return;
+
+	DUMP_SEGMENT segment;
+	segment.fileOffset = 0;
+	segment.fileSize = fileLength;
+	segment.region.base = flatBase;
+	segment.region.size = fileLength;
+	segment.region.protect = segment.region.allocationProtect = MEMPROT_READWRITE;
+	segment.region.type = eMemPrivate;
+	segment.region.committed = true;
+	segments.push_back(segment);
+}
+
+eRegionQuery dump_file_memory_source::query_region(uint64_t address, MEMREGION &region, unsigned long * /*errorCode*/)
+{
+	auto it = std::find_if(segments.begin(), segments.end(),
+		[address](const DUMP_SEGMENT &s) { return s.region.base + s.region.size > address; });
+	if (it == segments.end())
+		return eRegionEnd;
+
+	region = it->region;
+	return eRegionFound;
+}
+
+size_t dump_file_memory_source::read(uint64_t address, void *buffer, size_t size, unsigned long *errorCode)
+{
+	auto it = std::find_if(segments.begin(), segments.end(),
+		[address](const DUMP_SEGMENT &s) { return s.region.base + s.region.size > address; });
+	if (it == segments.end() || it->region.base > address)
+	{
+		if (errorCode) *errorCode = EFAULT;
+		return 0;
+	}
+
+	uint64_t segmentOffset = address - it->region.base;
+	size_t readable = (size_t)std::min((uint64_t)size, it->region.size - segmentOffset);
+
+	//in a core the tail of a segment past its file size wasn't dumped and reads as zero
+	size_t fromFile = 0;
+	if (segmentOffset < it->fileSize)
+		fromFile = (size_t)std::min((uint64_t)readable, it->fileSize - segmentOffset);
+
+	if (fromFile)
+	{
+		std::lock_guard<std::mutex> lock(fileMutex);
+		dumpfile.clear();
+		dumpfile.seekg(it->fileOffset + segmentOffset);
+		dumpfile.read((char *)buffer, fromFile);
+		size_t wanted = fromFile;
+		fromFile = (size_t)dumpfile.gcount();
+		if (fromFile < wanted)
+		{
+			//truncated dump
+			if (errorCode) *errorCode = EIO;
+			return fromFile;
+		}
+	}
+
+	memset((char *)buffer + fromFile, 0, readable - fromFile);
+	return readable;
+}
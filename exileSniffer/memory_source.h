@@ -0,0 +1,152 @@
+#pragma once
+/*
+Where the key grabber gets the memory it scans from
+
+A memory source enumerates regions (with the attributes the scan filters
+care about) and reads bytes out of them. Implementations exist for live
+windows processes, live linux processes and dump files, so the scanning
+pipeline can be run against recorded memory images off Windows.
+
+Not built with the precompiled header so it stays portable
+*/
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+
+#define MEMPROT_READ 0x1
+#define MEMPROT_WRITE 0x2
+#define MEMPROT_EXECUTE 0x4
+#define MEMPROT_COPYONWRITE 0x8
+#define MEMPROT_GUARD 0x10
+#define MEMPROT_NOCACHE 0x20
+#define MEMPROT_READWRITE (MEMPROT_READ | MEMPROT_WRITE)
+
+enum eMemRegionType { eMemPrivate, eMemMapped, eMemImage, eMemUnknown };
+
+struct MEMREGION {
+	uint64_t base = 0;
+	uint64_t size = 0;
+	unsigned int protect = 0; //MEMPROT_ flags
+	unsigned int allocationProtect = 0; //protection when first allocated, same as protect where the OS doesnt track it
+	eMemRegionType type = eMemUnknown;
+	bool committed = false;
+};
+
+enum eRegionQuery {
+	eRegionFound,  //region filled in
+	eRegionEnd,	   //no regions at or after the address
+	eRegionError,  //query failed, try again later
+	eRegionDenied  //query failed and will keep failing
+};
+
+class memory_source
+{
+public:
+	virtual ~memory_source() {};
+
+	virtual bool open(std::string &error) = 0;
+	virtual void close() {};
+
+	/*
+	Finds the region containing address, or failing that the first region after it
+	Walk the address space by querying region.base + region.size next
+	*/
+	virtual eRegionQuery query_region(uint64_t address, MEMREGION &region, unsigned long *errorCode = NULL) = 0;
+
+	/*
+	Returns the number of bytes copied into buffer.
+	A short read is not an error - the rest of the range was unreadable
+	*/
+	virtual size_t read(uint64_t address, void *buffer, size_t size, unsigned long *errorCode = NULL) = 0;
+
+	virtual std::string description() = 0;
+	//live processes can change between scan passes, recorded images can't
+	virtual bool is_live() { return true; }
+};
+
+#ifdef _WIN32
+//OpenProcess/VirtualQueryEx/ReadProcessMemory on a running process
+class win_process_memory_source : public memory_source
+{
+public:
+	win_process_memory_source(unsigned long processID) { pid = processID; }
+	~win_process_memory_source() { close(); }
+
+	bool open(std::string &error);
+	void close();
+	eRegionQuery query_region(uint64_t address, MEMREGION &region, unsigned long *errorCode = NULL);
+	size_t read(uint64_t address, void *buffer, size_t size, unsigned long *errorCode = NULL);
+	std::string description() { return "process " + std::to_string(pid); }
+
+private:
+	unsigned long pid;
+	void *processHandle = NULL;
+};
+#endif
+
+#ifdef __linux__
+//parses /proc/<pid>/maps and reads /proc/<pid>/mem
+class proc_pid_memory_source : public memory_source
+{
+public:
+	proc_pid_memory_source(int processID) { pid = processID; }
+	~proc_pid_memory_source() { close(); }
+
+	bool open(std::string &error);
+	void close();
+	eRegionQuery query_region(uint64_t address, MEMREGION &region, unsigned long *errorCode = NULL);
+	size_t read(uint64_t address, void *buffer, size_t size, unsigned long *errorCode = NULL);
+	std::string description() { return "/proc/" + std::to_string(pid); }
+
+private:
+	bool reload_maps(unsigned long *errorCode);
+
+	int pid;
+	int memfd = -1;
+	std::mutex mapsMutex;
+	std::vector<MEMREGION> regions;
+	uint64_t lastQueryAddress = 0;
+};
+#endif
+
+/*
+A recorded memory image on disk. Either:
+	An ELF core dump - each PT_LOAD segment becomes a region
+	Anything else is treated as a flat image of memory starting at baseAddress,
+	as one private read/write region
+*/
+
+class dump_file_memory_source : public memory_source
+{
+public:
+	dump_file_memory_source(std::string filepath, uint64_t baseAddress = 0) {
+		path = filepath; flatBase = baseAddress;
+	}
+	~dump_file_memory_source() { close(); }
+
+	bool open(std::string &error);
+	void close();
+	eRegionQuery query_region(uint64_t address, MEMREGION &region, unsigned long *errorCode = NULL);
+	size_t read(uint64_t address, void *buffer, size_t size, unsigned long *errorCode = NULL);
+	std::string description() { return path; }
+	bool is_live() { return false; }
+
+private:
+	struct DUMP_SEGMENT {
+		MEMREGION region;
+		uint64_t fileOffset;
+		uint64_t fileSize; //can be less than region size in a core, the rest is zeroes
+	};
+
+	bool load_elf_core(std::string &error);
+	void load_flat_image(uint64_t fileLength);
+
+	std::string path;
+	uint64_t flatBase;
+	std::ifstream dumpfile;
+	std::mutex fileMutex;
+	std::vector<DUMP_SEGMENT> segments;
+};
@@ -68,7 +68,7 @@ void packet_capture_thread::on_loginclient_data(Tins::TCPIP::Stream& stream)
 	pktobj.incoming = false;
 	pktobj.streamID = getStreamID(stream);
 	pktobj.data = std::vector<byte>(payload.begin(), payload.end());
-	pktobj.time = ms_since_epoch();
+	pktobj.time = packet_time();
 
 	loginQueue->addItem(pktobj);
 }
@@ -82,7 +82,7 @@ void packet_capture_thread::on_loginserver_data(Tins::TCPIP::Stream& stream)
 	pktobj.incoming = true;
 	pktobj.streamID = getStreamID(stream);
 	pktobj.data = std::vector<byte>(payload.begin(), payload.end());
-	pktobj.time = ms_since_epoch();
+	pktobj.time = packet_time();
 
 	loginQueue->addItem(pktobj);
 }
@@ -96,7 +96,7 @@ void packet_capture_thread::on_gameclient_data(Tins::TCPIP::Stream& stream)
 	pktobj.incoming = false;
 	pktobj.streamID = getStreamID(stream);
 	pktobj.data = std::vector<byte>(payload.begin(), payload.end());
-	pktobj.time = ms_since_epoch();
+	pktobj.time = packet_time();
 
 	gameQueue->addItem(pktobj);
 }
@@ -110,7 +110,7 @@ void packet_capture_thread::on_gameserver_data(Tins::TCPIP::Stream& stream)
 	pktobj.incoming = true;
 	pktobj.streamID = getStreamID(stream);
 	pktobj.data = std::vector<byte>(payload.begin(), payload.end());
-	pktobj.time = ms_since_epoch();
+	pktobj.time = packet_time();
 
 	gameQueue->addItem(pktobj);
 }
@@ -122,10 +122,12 @@ void packet_capture_thread::on_new_stream(Tins::TCPIP::Stream& stream)
 
 	streamList[stream.create_time()] = streamID;
 
-	EnterCriticalSection(&streamDataCritsec);
+	streamDataMutex.lock();
 	streamRecords[streamID].serverPort = stream.server_port();
 	streamRecords[streamID].serverIP = stream.server_addr_v4().to_string(); //ipv6 anyone? no? no.
-	LeaveCriticalSection(&streamDataCritsec);
+	streamRecords[streamID].clientPort = stream.client_port();
+	streamRecords[streamID].clientIP = stream.client_addr_v4().to_string();
+	streamDataMutex.unlock();
 
 	char serverType = portStreamType(stream.server_port());
 
@@ -193,6 +195,12 @@ void packet_capture_thread::main_loop()
 		this,
 		std::placeholders::_1, std::placeholders::_2));
 
+	if (!captureFile.empty())
+	{
+		replay_capture_file(follower);
+		return;
+	}
+
 	Tins::NetworkInterface& iface = Tins::NetworkInterface::default_interface(); //todo: allow choice of interface
 	Tins::IPv4Address hostAddr = iface.ipv4_address();
 
@@ -215,15 +223,153 @@ void packet_capture_thread::main_loop()
 	config.set_filter(filterString);
 	sniffer = new Tins::Sniffer(iface.name(), config);
 
-	UIsniffingStarted(QString::fromStdString(hostAddr.to_string()), uiMsgQueue);
+	UIsniffingStarted(hostAddr.to_string(), uiMsgQueue);
+	start_recorder();
+
+	sniffer->sniff_loop([&](Tins::Packet& packet) { 
+		follow_packet(packet, follower);
+		return true; 
+	});
+}
+
+//the link layers the sniffer can be asked for raw frames of, see parse_raw_frame
+static bool raw_frames_parseable(int linkType)
+{
+	switch (linkType)
+	{
+	case DLT_EN10MB:
+	case DLT_NULL:
+	case DLT_LOOP:
+	case DLT_LINUX_SLL:
+	case DLT_RAW:
+		return true;
+	default:
+		return false;
+	}
+}
+
+//NULL if the frame is malformed
+static Tins::PDU *parse_raw_frame(int linkType, const uint8_t *data, uint32_t size)
+{
+	try {
+		switch (linkType)
+		{
+		case DLT_EN10MB:
+			return new Tins::EthernetII(data, size);
+		case DLT_NULL:
+		case DLT_LOOP:
+			return new Tins::Loopback(data, size);
+		case DLT_LINUX_SLL:
+			return new Tins::SLL(data, size);
+		case DLT_RAW:
+			return new Tins::IP(data, size);
+		}
+	}
+	catch (Tins::malformed_packet &) {}
+	return NULL;
+}
+
+void packet_capture_thread::start_recorder()
+{
+	if (recordingFile.empty())
+		return;
+
+	linkType = sniffer->link_type();
+	if (!raw_frames_parseable(linkType))
+	{
+		UIaddLogMsg("Can't record captures on this interface, link type " + std::to_string(linkType) + 
+			" isn't supported", 0, uiMsgQueue);
+		return;
+	}
+
+	pcapng_recorder *newRecorder = new pcapng_recorder;
+	if (!newRecorder->open(recordingFile, linkType))
+	{
+		UIaddLogMsg("Failed to create capture recording " + recordingFile, 0, uiMsgQueue);
+		delete newRecorder;
+		return;
+	}
+
+	std::thread recorderInstance(&pcapng_recorder::ThreadEntry, newRecorder);
+	recorderInstance.detach();
 
-	sniffer->sniff_loop([&](Tins::PDU& pdu) { follower.process_packet(pdu); return true; });
+	//frames are written as captured, then parsed by follow_packet
+	sniffer->set_extract_raw_pdus(true);
+	recorder = newRecorder;
+	UIaddLogMsg("Recording capture to " + recordingFile, 0, uiMsgQueue);
+}
+
+/*
+Hands a sniffed packet to the stream follower.
+While recording the sniffer delivers the raw frame, which is recorded
+with its capture timestamp before being parsed
+*/
+void packet_capture_thread::follow_packet(Tins::Packet &packet, Tins::TCPIP::StreamFollower &follower)
+{
+	pcapng_recorder *activeRecorder = recorder;
+	if (!activeRecorder)
+	{
+		follower.process_packet(packet);
+		return;
+	}
+
+	Tins::RawPDU *raw = packet.pdu() ? packet.pdu()->find_pdu<Tins::RawPDU>() : NULL;
+	if (!raw)
+		return;
+
+	const Tins::RawPDU::payload_type &frame = raw->payload();
+	const Tins::Timestamp &ts = packet.timestamp();
+	long long timeUs = (long long)ts.seconds() * 1000000 + ts.microseconds();
+	activeRecorder->record_packet(frame.data(), frame.size(), timeUs);
+
+	Tins::PDU *parsed = parse_raw_frame(linkType, frame.data(), (uint32_t)frame.size());
+	if (!parsed)
+		return;
+	Tins::Packet parsedPacket(parsed, ts, Tins::Packet::own_pdu());
+	follower.process_packet(parsedPacket);
+}
+
+/*
+Feeds a recorded capture through the same stream callbacks as live sniffing.
+Packets are stamped with their capture time rather than the time they were read
+and ded is set once the whole file has been queued.
+*/
+void packet_capture_thread::replay_capture_file(Tins::TCPIP::StreamFollower &follower)
+{
+	std::string filterString = "tcp port " + std::to_string(LOGINSERVER_PORT) +
+		" or tcp port " + std::to_string(GAMESERVER_PORT);
+
+	Tins::SnifferConfiguration config;
+	config.set_filter(filterString);
+	try {
+		sniffer = new Tins::FileSniffer(captureFile, config);
+	}
+	catch (std::exception &e) {
+		UIaddLogMsg("Failed to open capture file " + captureFile + ": " + e.what(), 0, uiMsgQueue);
+		ded = true;
+		return;
+	}
+
+	UIaddLogMsg("Replaying capture file " + captureFile, 0, uiMsgQueue);
+	UIsniffingStarted(captureFile, uiMsgQueue);
+	start_recorder();
+
+	sniffer->sniff_loop([&](Tins::Packet& packet) {
+		const Tins::Timestamp &ts = packet.timestamp();
+		replayPacketTime = (long long)ts.seconds() * 1000 + ts.microseconds() / 1000;
+		follow_packet(packet, follower);
+		return running;
+	});
+
+	pcapng_recorder *activeRecorder = recorder;
+	if (activeRecorder)
+		activeRecorder->stop();
+	ded = true;
 }
 
 packet_capture_thread::packet_capture_thread(SafeQueue<UI_MESSAGE *>* uiq, 
 	SafeQueue<GAMEPACKET > *gameP, SafeQueue<GAMEPACKET > *loginP)
 {
-	InitializeCriticalSection(&streamDataCritsec);
 	uiMsgQueue = uiq;
 	gameQueue = gameP;
 	loginQueue = loginP;
@@ -240,17 +386,17 @@ STREAM_NETWORK_DATA* packet_capture_thread::get_stream_data(int streamID)
 {
 	STREAM_NETWORK_DATA* result = NULL;
 
-	EnterCriticalSection(&streamDataCritsec);
+	streamDataMutex.lock();
 	auto it = streamRecords.find(streamID);
 	if (it == streamRecords.end())
 	{
-		LeaveCriticalSection(&streamDataCritsec);
+		streamDataMutex.unlock();
 		UIaddLogMsg("Error: Tried to retrieve streamdata for nonexistant stream", 0, uiMsgQueue);
 	}
 	else
 	{
 		result = &it->second;
-		LeaveCriticalSection(&streamDataCritsec);
+		streamDataMutex.unlock();
 
 	}
 	return result;
@@ -260,5 +406,8 @@ void packet_capture_thread::stop_sniffing()
 {
 	if(sniffer)
 		sniffer->stop_sniff();
+	pcapng_recorder *activeRecorder = recorder;
+	if (activeRecorder)
+		activeRecorder->stop();
 	ded = true;
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "base_thread.h"
+#include "pcapng_recorder.h"
 
 typedef unsigned int networkStreamID;
 
@@ -17,6 +18,8 @@ using Tins::TCPIP::StreamFollower;
 struct STREAM_NETWORK_DATA {
 	std::string serverIP;
 	int serverPort;
+	std::string clientIP;
+	int clientPort;
 };
 
 class GAMEPACKET {
@@ -38,14 +41,27 @@ public:
 	~packet_capture_thread();
 	STREAM_NETWORK_DATA *get_stream_data(int streamID);
 	void stop_sniffing();
+	//read packets from a capture file instead of the network
+	//call before starting, only the capture thread reads it after that
+	void set_capture_file(std::string path) { captureFile = path; }
+	//record everything sniffed to a pcapng file, call before starting as above
+	void set_recording_file(std::string path) { recordingFile = path; }
+	//stream IDs count up from here so several captures can feed one processor, call before starting
+	void set_first_stream_id(int streamID) { connectionCount = streamID; }
+	//NULL unless recording. Set by the capture thread once the sniffer is open
+	pcapng_recorder *get_recorder() { return recorder; }
 
 	bool running = true;
 	bool ded = false;
 private:
 
 	void main_loop();
+	void replay_capture_file(Tins::TCPIP::StreamFollower &follower);
+	void start_recorder();
+	void follow_packet(Tins::Packet &packet, Tins::TCPIP::StreamFollower &follower);
+	long long packet_time() { return captureFile.empty() ? ms_since_epoch() : replayPacketTime; }
 
-	unsigned int packet_capture_thread::getStreamID(Tins::TCPIP::Stream& stream);
+	unsigned int getStreamID(Tins::TCPIP::Stream& stream);
 	void on_stream_terminated(Tins::TCPIP::Stream& stream, Tins::TCPIP::StreamFollower::TerminationReason reason);
 
 	void on_new_stream(Tins::TCPIP::Stream& stream);
@@ -60,9 +76,14 @@ private:
 	void on_gameserver_data(Tins::TCPIP::Stream& stream);
 
 private:
-	Tins::Sniffer *sniffer = NULL;
-
-	CRITICAL_SECTION streamDataCritsec;
+	Tins::BaseSniffer *sniffer = NULL;
+	std::string captureFile;
+	long long replayPacketTime = 0;
+	std::string recordingFile;
+	std::atomic<pcapng_recorder *> recorder{ NULL };
+	int linkType = 0;
+
+	std::mutex streamDataMutex;
 	map<int, STREAM_NETWORK_DATA> streamRecords;
 
 	SafeQueue<UI_MESSAGE *> *uiMsgQueue;
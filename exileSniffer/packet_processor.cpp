@@ -141,22 +141,8 @@ void packet_processor::handle_packet_from_loginserver(vector<byte> &nwkData, lon
 		hexmsg->setData(decryptedBuffer);
 		uiMsgQueue->addItem(hexmsg);
 
-		UIDecodedPkt *ui_decodedpkt = new UIDecodedPkt(0, eLogin, currentMsgStreamID, true, timems);
-
-		deserialisedPkts.push_back(ui_decodedpkt);
-		ui_decodedpkt->setBuffer(decryptedBuffer);
-		ui_decodedpkt->setStartOffset(0);
-		ui_decodedpkt->setEndOffset(dataLen);
-		ui_decodedpkt->set_validate_MessageID(LOGIN_EPHERMERAL_PUBKEY, uiMsgQueue);
-		ui_decodedpkt->toggle_payload_operations(true);
-
-		decryptedIndex = 2;
-		remainingDecrypted = dataLen - 2;
-		packet_processor::deserialiser deserialiserForPktID = loginPktDeserialisers.at(LOGIN_EPHERMERAL_PUBKEY);
-		(this->*deserialiserForPktID)(ui_decodedpkt);
-
-		uiMsgQueue->addItem(ui_decodedpkt);
-
+		//unencrypted, but archived and fed out like the rest
+		deserialise_packets_from_decrypted(eLogin, true, timems);
 		return;
 	}
 
@@ -169,8 +155,16 @@ void packet_processor::handle_packet_from_loginserver(vector<byte> &nwkData, lon
 	{
 		while (!currentStreamObj->workingRecvKey)
 		{
-			KEYDATA *keyCandidate = keyGrabber->getUnusedMemoryKey(currentMsgStreamID, true);
+			KEYDATA *keyCandidate = keySource->getUnusedMemoryKey(currentMsgStreamID, true);
 			if (!keyCandidate) {
+				if (!keySource->keys_pending())
+				{
+					UIaddLogMsg("No key in the key source decrypts the login response", 0, uiMsgQueue);
+					currentStreamObj->failed = true;
+					UInotifyStreamState(currentMsgStreamID, eStreamState::eStreamFailed, uiMsgQueue);
+					delete decryptedBuffer;
+					return;
+				}
 				UIaddLogMsg("Warning: No unused key from login!", 0, uiMsgQueue);
 				Sleep(1200);
 				continue;
@@ -187,18 +181,20 @@ void packet_processor::handle_packet_from_loginserver(vector<byte> &nwkData, lon
 			{
 				alreadyDecrypted = true;
 				keyCandidate->used = true;
-				keyGrabber->claimKey(keyCandidate, currentMsgStreamID);
+				keySource->claimKey(keyCandidate, currentMsgStreamID);
 
 				UIaddLogMsg("Loginserver receive key recovered", keyCandidate->sourceProcess,
 					uiMsgQueue);
 
 				UIrecordLogin(keyCandidate->sourceProcess, uiMsgQueue);
+				assign_stream_session(currentMsgStreamID, keyCandidate->sourceProcess, true);
 
-				keyGrabber->stopProcessScan(keyCandidate->sourceProcess);
+				keySource->stopProcessScan(keyCandidate->sourceProcess);
 				currentStreamObj->workingRecvKey = keyCandidate;
 
 				vector<byte> IVVec((byte*)keyCandidate->IV, ((byte*)keyCandidate->IV) + 8);
 				UIUpdateRecvIV(IVVec, uiMsgQueue);
+				log_stream_keys(eLogin, 0);
 				sendIterationToUI(currentStreamObj->recvSalsa, false);
 
 
@@ -206,6 +202,11 @@ void packet_processor::handle_packet_from_loginserver(vector<byte> &nwkData, lon
 
 				break;
 			}
+			else if (!keySource->keys_pending())
+			{
+				//a key file can hold keys for other sessions, keep trying those
+				continue;
+			}
 			else
 			{
 				std::stringstream err;
@@ -228,8 +229,8 @@ void packet_processor::handle_packet_from_loginserver(vector<byte> &nwkData, lon
 			currentStreamObj->recvSalsa.ProcessData(decryptedBuffer->data(), nwkData.data(), dataLen);
 		}
 		catch (...) {
-			QString msg = "An exception was caught during salsa decrypt. This is usually due to incorrect deserialisation";
-			UIaddLogMsg(msg, getLatestDecryptProcess(), uiMsgQueue);
+			std::string msg = "An exception was caught during salsa decrypt. This is usually due to incorrect deserialisation";
+			UIaddLogMsg(msg, stream_process(), uiMsgQueue);
 			currentStreamObj->failed = true;
 			UInotifyStreamState(currentMsgStreamID, eStreamState::eStreamFailed, uiMsgQueue);
 			return;
@@ -290,21 +291,7 @@ void packet_processor::handle_packet_to_loginserver(vector<byte> &nwkData, long
 		msg->setData(decryptedBuffer);
 		uiMsgQueue->addItem(msg);
 
-		UIDecodedPkt *ui_decodedpkt = new UIDecodedPkt(0, eLogin, currentMsgStreamID, false, timems);
-		ui_decodedpkt->setBuffer(decryptedBuffer);
-		ui_decodedpkt->setStartOffset(0);
-		ui_decodedpkt->setEndOffset(dataLen);
-		ui_decodedpkt->set_validate_MessageID(LOGIN_EPHERMERAL_PUBKEY, uiMsgQueue);
-		ui_decodedpkt->toggle_payload_operations(true);
-		deserialisedPkts.push_back(ui_decodedpkt);
-
-		decryptedIndex = 2;
-		remainingDecrypted = dataLen - 2;
-		packet_processor::deserialiser deserialiserForPktID = loginPktDeserialisers.at(LOGIN_EPHERMERAL_PUBKEY);
-		(this->*deserialiserForPktID)(ui_decodedpkt);
-
-		uiMsgQueue->addItem(ui_decodedpkt);
-
+		deserialise_packets_from_decrypted(eLogin, false, timems);
 		return;
 	}
 
@@ -318,15 +305,23 @@ void packet_processor::handle_packet_to_loginserver(vector<byte> &nwkData, long
 		unsigned int msWaited = 0;
 		while (true)
 		{
-			KEYDATA *keyCandidate = keyGrabber->getUnusedMemoryKey(currentMsgStreamID, false);
+			KEYDATA *keyCandidate = keySource->getUnusedMemoryKey(currentMsgStreamID, false);
 			if (!keyCandidate) {
+				if (!keySource->keys_pending())
+				{
+					UIaddLogMsg("No key in the key source decrypts the login stream", 0, uiMsgQueue);
+					currentStreamObj->failed = true;
+					UInotifyStreamState(currentMsgStreamID, eStreamState::eStreamFailed, uiMsgQueue);
+					delete decryptedBuffer;
+					return;
+				}
 
 				Sleep(200);
 				msWaited += 200;
 				//every two seconds relax the memory scan filters
 				if (msWaited % 2000 == 0)
 				{
-					keyGrabber->relaxScanFilters();
+					keySource->relaxScanFilters();
 					if (msWaited > 4000)
 					{
 						UIaddLogMsg("Pkt_to_login - Warning: Long wait for memory key", 0, uiMsgQueue);
@@ -355,8 +350,8 @@ void packet_processor::handle_packet_to_loginserver(vector<byte> &nwkData, long
 			if (firstPktID == LOGIN_CLI_AUTH_DATA || firstPktID == LOGIN_CLI_RESYNC)
 			{
 				keyCandidate->used = true;
-				keyGrabber->claimKey(keyCandidate, currentMsgStreamID);
-				activeClientPID = keyCandidate->sourceProcess;
+				keySource->claimKey(keyCandidate, currentMsgStreamID);
+				assign_stream_session(currentMsgStreamID, keyCandidate->sourceProcess, true);
 
 				currentStreamObj->workingSendKey = keyCandidate;
 
@@ -365,6 +360,7 @@ void packet_processor::handle_packet_to_loginserver(vector<byte> &nwkData, long
 
 				vector<byte> IVVec((byte *)keyCandidate->IV, (byte *)(keyCandidate->IV) + 8);
 				UIUpdateSendIV(IVVec, uiMsgQueue);
+				log_stream_keys(eLogin, 0);
 
 				UIaddLogMsg("Loginserver send key recovered", keyCandidate->sourceProcess, uiMsgQueue);
 
@@ -387,24 +383,9 @@ void packet_processor::handle_packet_to_loginserver(vector<byte> &nwkData, long
 		msg->setData(decryptedBuffer);
 		uiMsgQueue->addItem(msg);
 
-
-		
-		UIDecodedPkt *ui_decodedpkt = new UIDecodedPkt(0, eLogin, currentMsgStreamID, false, timems);
-
-		ui_decodedpkt->setBuffer(decryptedBuffer);
-		ui_decodedpkt->setStartOffset(0);
-		ui_decodedpkt->setEndOffset(dataLen);
-		ui_decodedpkt->set_validate_MessageID(firstPktID, uiMsgQueue);
-		ui_decodedpkt->toggle_payload_operations(true);
-		deserialisedPkts.push_back(ui_decodedpkt);
-
-		remainingDecrypted = dataLen - 2;
-		decryptedIndex = 2;
-		packet_processor::deserialiser deserialiserForPktID = loginPktDeserialisers.at(firstPktID);
-		(this->*deserialiserForPktID)(ui_decodedpkt);
-
-		uiMsgQueue->addItem(ui_decodedpkt);
-		
+		remainingDecrypted = dataLen;
+		decryptedIndex = 0;
+		deserialise_packets_from_decrypted(eLogin, false, timems);
 		return;
 	}
 
@@ -421,10 +402,150 @@ void packet_processor::handle_packet_to_loginserver(vector<byte> &nwkData, long
 	deserialise_packets_from_decrypted(eLogin, false, timems);
 }
 
+CLIENT_SESSION *packet_processor::get_session(DWORD pid)
+{
+	CLIENT_SESSION *session = &clientSessions[pid];
+	session->pid = pid;
+	return session;
+}
+
+//the decode state of a stream, from whichever session holds it
+STREAMDATA *packet_processor::get_stream(networkStreamID streamID)
+{
+	std::unique_ptr<STREAMDATA> &stream = get_session(getStreamProcess(streamID))->streams[streamID];
+	if (!stream)
+		stream.reset(new STREAMDATA);
+	return stream.get();
+}
+
+//moves a stream to the session of the client whose key decrypted it
+void packet_processor::assign_stream_session(networkStreamID streamID, DWORD pid, bool loginStream)
+{
+	CLIENT_SESSION *session = get_session(pid);
+	if (loginStream)
+	{
+		session->loggedIn = true;
+		session->loginStream = streamID;
+	}
+	CLIENT_SESSION *previous = get_session(getStreamProcess(streamID));
+	if (previous != session)
+	{
+		auto it = previous->streams.find(streamID);
+		if (it != previous->streams.end())
+		{
+			session->streams[streamID] = std::move(it->second);
+			previous->streams.erase(it);
+		}
+	}
+
+	sessionsMutex.lock();
+	streamSessions[streamID] = pid;
+	sessionsMutex.unlock();
+}
+
+DWORD packet_processor::getStreamProcess(networkStreamID streamID)
+{
+	DWORD pid = 0;
+	sessionsMutex.lock();
+	auto it = streamSessions.find(streamID);
+	if (it != streamSessions.end())
+		pid = it->second;
+	sessionsMutex.unlock();
+	return pid;
+}
+
+size_t packet_processor::session_count()
+{
+	std::set<DWORD> clients;
+	sessionsMutex.lock();
+	for (auto &streamSession : streamSessions)
+		clients.insert(streamSession.second);
+	sessionsMutex.unlock();
+	return clients.size();
+}
+
+void packet_processor::add_pending_gameserver_keys(unsigned long connectionID, KEYDATA *sendKey, KEYDATA *recvKey)
+{
+	//nothing will be decrypted with them
+	if (replaying())
+	{
+		delete sendKey;
+		delete recvKey;
+		return;
+	}
+	get_session(sendKey->sourceProcess)->pendingGameserverKeys[connectionID] = make_pair(sendKey, recvKey);
+}
+
+size_t packet_processor::pending_gameserver_key_count()
+{
+	size_t pending = 0;
+	for (auto &session : clientSessions)
+		pending += session.second.pendingGameserverKeys.size();
+	return pending;
+}
+
+//empty if the capture thread doesn't know it
+std::string packet_processor::stream_client_address(networkStreamID streamID)
+{
+	STREAM_NETWORK_DATA *network = streamCapture ? streamCapture->get_stream_data(streamID) : NULL;
+	return network ? network->clientIP : std::string();
+}
+
+/*
+Connection IDs are unique across clients so the first packet to a gameserver 
+says which session the stream belongs to. 
+
+If nothing matches, a clients only pending key pair is used anyway, but only
+when that client is the one the stream must belong to: the only logged in
+client, or the only one whose login stream came from the same address.
+*/
+bool packet_processor::take_pending_gameserver_keys(networkStreamID streamID, unsigned long connectionID, 
+	std::pair<KEYDATA *, KEYDATA *> &keys)
+{
+	for (auto &sessionIt : clientSessions)
+	{
+		CLIENT_SESSION &session = sessionIt.second;
+		auto keyIt = session.pendingGameserverKeys.find(connectionID);
+		if (keyIt != session.pendingGameserverKeys.end())
+		{
+			keys = keyIt->second;
+			session.pendingGameserverKeys.erase(keyIt);
+			return true;
+		}
+	}
+
+	std::string clientAddress = stream_client_address(streamID);
+	CLIENT_SESSION *owner = NULL;
+	for (auto &sessionIt : clientSessions)
+	{
+		CLIENT_SESSION &session = sessionIt.second;
+		if (!session.loggedIn)
+			continue;
+		if (!clientAddress.empty() && stream_client_address(session.loginStream) != clientAddress)
+			continue;
+		//can't tell which client it is
+		if (owner)
+			return false;
+		owner = &session;
+	}
+
+	if (!owner || owner->pendingGameserverKeys.size() != 1)
+		return false;
+
+	std::stringstream warn;
+	warn << "Warning: Connection ID " << connectionID << " didn't match pending " <<
+		owner->pendingGameserverKeys.begin()->first;
+	UIaddLogMsg(warn.str(), owner->pid, uiMsgQueue);
+
+	keys = owner->pendingGameserverKeys.begin()->second;
+	owner->pendingGameserverKeys.clear();
+	return true;
+}
+
 void packet_processor::handle_login_data(GAMEPACKET &pkt)
 {
 	currentMsgStreamID = pkt.streamID;
-	currentStreamObj = &streamDatas[currentMsgStreamID];
+	currentStreamObj = get_stream(currentMsgStreamID);
 	if (currentStreamObj->failed)
 		return;
 
@@ -444,11 +565,13 @@ void packet_processor::handle_login_data(GAMEPACKET &pkt)
 bool packet_processor::handle_game_data(GAMEPACKET &pkt)
 {
 	currentMsgStreamID = pkt.streamID;
-	currentStreamObj = &streamDatas[currentMsgStreamID];
+	currentStreamObj = get_stream(currentMsgStreamID);
+	//nothing more can be done with it, drop the packet so it doesn't hold up the others
 	if (currentStreamObj->failed)
-		return false;
+		return true;
 
-	if (currentStreamObj->workingSendKey == NULL && pendingGameserverKeys.empty())
+	if (currentStreamObj->workingSendKey == NULL && pending_gameserver_key_count() == 0 &&
+		!keySource->has_gameserver_keys())
 	{
 		UIaddLogMsg("Warning: Null send key with no pending gameserver keys. Pressed play too early?", 0, uiMsgQueue);
 		return false;
@@ -474,6 +597,35 @@ bool packet_processor::handle_game_data(GAMEPACKET &pkt)
 	return true;
 }
 
+/*
+Writes the current streams keys to the key log and capture recording once both
+halves are known so the session can be decrypted again later
+*/
+void packet_processor::log_stream_keys(streamType server, unsigned long connectionID)
+{
+	pcapng_recorder *recorder = streamCapture ? streamCapture->get_recorder() : NULL;
+	if ((!keyLog && !recorder) || currentStreamObj->keysLogged)
+		return;
+	if (!currentStreamObj->workingSendKey || !currentStreamObj->workingRecvKey)
+		return;
+
+	std::string client = "?", serverAddr = "?";
+	STREAM_NETWORK_DATA *network = streamCapture ? streamCapture->get_stream_data(currentMsgStreamID) : NULL;
+	if (network)
+	{
+		client = network->clientIP + ":" + std::to_string(network->clientPort);
+		serverAddr = network->serverIP + ":" + std::to_string(network->serverPort);
+	}
+
+	if (keyLog)
+		keyLog->write_stream((char)server, connectionID, client, serverAddr,
+			currentStreamObj->workingSendKey, currentStreamObj->workingRecvKey);
+	if (recorder)
+		recorder->record_keys(stream_key_line((char)server, connectionID, client, serverAddr,
+			currentStreamObj->workingSendKey, currentStreamObj->workingRecvKey));
+	currentStreamObj->keysLogged = true;
+}
+
 bool packet_processor::sanityCheckPacketID(unsigned short pktID)
 {
 	if (!pktID || pktID > 0x220)
@@ -488,11 +640,15 @@ bool packet_processor::sanityCheckPacketID(unsigned short pktID)
 void packet_processor::deserialise_packets_from_decrypted(streamType streamServer, bool incoming, long long timeSeen)
 {
 	unsigned int dataLen = remainingDecrypted;
+	unsigned int segmentEnd = decryptedIndex + remainingDecrypted;
+	size_t bufferSize = decryptedBuffer->size();
+	archiveMessages.clear();
 	while (remainingDecrypted > 0)
 	{
 		unsigned short pktIDWord = ntohs(consume_WORD());
 
-		DWORD sourceProcess = currentStreamObj->workingSendKey->sourceProcess;
+		//the login key exchange comes before there is a key
+		DWORD sourceProcess = stream_process();
 		UIDecodedPkt *ui_decodedpkt = new UIDecodedPkt(sourceProcess,	
 			streamServer, currentMsgStreamID, incoming, timeSeen);
 
@@ -543,13 +699,49 @@ void packet_processor::deserialise_packets_from_decrypted(streamType streamServe
 			ui_decodedpkt->setEndOffset(dataLen);
 		}
 
+		if (sessionArchive)
+		{
+			ARCHIVE_MESSAGE boundary;
+			boundary.msgID = pktIDWord;
+			boundary.flags = ui_decodedpkt->decodeError() ? ARCHIVE_MSG_FAILED : 0;
+			if (ui_decodedpkt->wasAbandoned())
+				boundary.flags |= ARCHIVE_MSG_ABANDONED;
+			boundary.start = ui_decodedpkt->origBufferOffset;
+			boundary.end = ui_decodedpkt->origBufferOffset + (uint32_t)ui_decodedpkt->pktBytes.size();
+			archiveMessages.push_back(boundary);
+		}
+
+		if (entities)
+			entities->apply(ui_decodedpkt);
+		if (shmFeed)
+			shmFeed->publish(ui_decodedpkt);
+		if (replaying())
+			ui_decodedpkt->setFromArchive();
 		uiMsgQueue->addItem(ui_decodedpkt);
 		currentStreamObj->lastPktID = pktIDWord;
 	}
 
+	//continuation data from the following packets was appended to the buffer
+	if (decryptedBuffer->size() != bufferSize)
+		segmentEnd = (unsigned int)decryptedBuffer->size();
+	if (sessionArchive)
+		archive_segment(streamServer, incoming, timeSeen, segmentEnd);
+
 	delete decryptedBuffer;
 }
 
+void packet_processor::archive_segment(streamType streamServer, bool incoming, long long timeSeen, unsigned int segmentEnd)
+{
+	ARCHIVE_SEGMENT segment;
+	segment.timeMs = timeSeen;
+	segment.pid = stream_process();
+	segment.streamID = currentMsgStreamID;
+	segment.dataSize = segmentEnd;
+	segment.streamType = (uint8_t)streamServer;
+	segment.incoming = incoming;
+	sessionArchive->add_segment(segment, decryptedBuffer->data(), archiveMessages);
+}
+
 void packet_processor::handle_packet_to_gameserver(vector<byte> &nwkData, long long timems)
 {
 	size_t dataLen = nwkData.size();
@@ -561,36 +753,21 @@ void packet_processor::handle_packet_to_gameserver(vector<byte> &nwkData, long l
 		{
 			unsigned long connectionID = ntohl(getUlong(nwkData.data() + 2));
 
-			if (pendingGameserverKeys.find(connectionID) == pendingGameserverKeys.end())
-			{
-				if (!pendingGameserverKeys.empty())
-				{
-					std::stringstream warn;
-					warn << "Warning: Connection ID " << connectionID << " didn't match pending " <<
-						pendingGameserverKeys.begin()->first << " (" << pendingGameserverKeys.size() << " pending)";
-					UIaddLogMsg(warn.str(),	activeClientPID, uiMsgQueue);
-
-					currentStreamObj->workingSendKey = pendingGameserverKeys.at(connectionID).first;
-					currentStreamObj->workingRecvKey = pendingGameserverKeys.at(connectionID).second;
-					UInotifyStreamState(currentMsgStreamID, eStreamDecrypting, uiMsgQueue);
-					pendingGameserverKeys.clear();
-				}
-				else
-				{
-					UIaddLogMsg("Error: No pending gameserver key. Set during login or previous instance server.",
-					activeClientPID, uiMsgQueue);
-					currentStreamObj->failed = true;
-					UInotifyStreamState(currentMsgStreamID, eStreamState::eStreamFailed, uiMsgQueue);
-					return; 
-				}
-
-			}
-			else
+			std::pair<KEYDATA *, KEYDATA *> gameserverKeys;
+			if (!take_pending_gameserver_keys(currentMsgStreamID, connectionID, gameserverKeys) &&
+				!keySource->gameserver_keys(connectionID, gameserverKeys))
 			{
-				currentStreamObj->workingSendKey = pendingGameserverKeys.at(connectionID).first;
-				currentStreamObj->workingRecvKey = pendingGameserverKeys.at(connectionID).second;
-				UInotifyStreamState(currentMsgStreamID, eStreamDecrypting, uiMsgQueue);
+				UIaddLogMsg("Error: No pending gameserver key. Set during login or previous instance server.",
+				getStreamProcess(currentMsgStreamID), uiMsgQueue);
+				currentStreamObj->failed = true;
+				UInotifyStreamState(currentMsgStreamID, eStreamState::eStreamFailed, uiMsgQueue);
+				return; 
 			}
+
+			currentStreamObj->workingSendKey = gameserverKeys.first;
+			currentStreamObj->workingRecvKey = gameserverKeys.second;
+			assign_stream_session(currentMsgStreamID, gameserverKeys.first->sourceProcess);
+			UInotifyStreamState(currentMsgStreamID, eStreamDecrypting, uiMsgQueue);
 			
 			byte *salsaSendKey = (byte *)currentStreamObj->workingSendKey->salsakey;
 			byte *salsaSendIV = (byte *)currentStreamObj->workingSendKey->IV;
@@ -605,11 +782,10 @@ void packet_processor::handle_packet_to_gameserver(vector<byte> &nwkData, long l
 			UIdisplaySalsaKey(keyVec, uiMsgQueue);
 			UIUpdateSendIV(IVsVec, uiMsgQueue);
 			UIUpdateRecvIV(IVrVec, uiMsgQueue);
+			log_stream_keys(eGame, connectionID);
 			sendIterationToUI(currentStreamObj->sendSalsa, true);
 			sendIterationToUI(currentStreamObj->recvSalsa, false);
 
-			pendingGameserverKeys.erase(connectionID);
-
 			UI_RAWHEX_PKT *msg = new UI_RAWHEX_PKT(
 				currentStreamObj->workingSendKey->sourceProcess, eGame, false);
 			vector<byte> *plainTextBuf = new vector<byte>(nwkData.begin(), nwkData.end());
@@ -620,7 +796,7 @@ void packet_processor::handle_packet_to_gameserver(vector<byte> &nwkData, long l
 		else
 		{
 			currentStreamObj->failed = true;
-			UIaddLogMsg("Failed to decrypt first packet - was sniffing started before login?", activeClientPID, uiMsgQueue);
+			UIaddLogMsg("Failed to decrypt first packet - was sniffing started before login?", getStreamProcess(currentMsgStreamID), uiMsgQueue);
 			UInotifyStreamState(currentMsgStreamID, eStreamState::eStreamFailed, uiMsgQueue);
 		}
 		return;
@@ -699,6 +875,9 @@ bool packet_processor::process_packet_loop()
 
 	while (running)
 	{
+		//read before the queues so nothing can be added between the check and the exit
+		bool inputDone = input_ended();
+
 		if (checkQueue(loginQueue, pendingPktQueue))
 		{
 			while (!pendingPktQueue.empty() && running)
@@ -727,10 +906,17 @@ bool packet_processor::process_packet_loop()
 				{
 					//tried to handle first response before first send so no key to read recv
 					//wait until first send done
-					while (!done)
+					while (!done && running)
 					{
 						Sleep(100);
+						size_t pendingCount = pendingPktQueue.size();
 						checkQueue(gameQueue, pendingPktQueue);
+						if (pendingPktQueue.size() == pendingCount && input_ended())
+						{
+							//replay is over and whatever it was waiting for isn't coming
+							pendingPktQueue.pop_front();
+							break;
+						}
 
 						auto it = pendingPktQueue.begin();
 						for (; it != pendingPktQueue.end(); it++)
@@ -767,6 +953,8 @@ bool packet_processor::process_packet_loop()
 			}
 		}
 		*/
+		if (inputDone)
+			break;
 		Sleep(10);
 	}
 	return true;
@@ -775,12 +963,81 @@ bool packet_processor::process_packet_loop()
 
 
 
+/*
+Decodes a session archive for the UI. The segments were stored decrypted and
+with any continuation data, so they go straight to the deserialisers.
+A replaying processor is given no archive, feed or entity store, so nothing
+is archived or published a second time, and its packets are marked so the UI
+doesn't publish them either.
+*/
+void packet_processor::replay_archive_loop()
+{
+	unsigned long long startTime = GetTickCount64();
+	size_t blockCount = replayArchive->blocks().size();
+	size_t messageCount = 0;
+
+	ARCHIVE_BLOCK block;
+	for (size_t i = 0; i < blockCount && running; ++i)
+	{
+		if (!replayArchive->read_block(i, block))
+		{
+			UIaddLogMsg("Skipped unreadable session archive block " + std::to_string(i), 0, uiMsgQueue);
+			continue;
+		}
+
+		for (ARCHIVE_SEGMENT_VIEW &segment : block.segments)
+		{
+			replay_segment(segment);
+			messageCount += segment.header->messageCount;
+		}
+
+		//the UI can't take a long session all at once
+		while (uiMsgQueue->size() > ARCHIVE_REPLAY_QUEUE_LIMIT && running)
+			Sleep(5);
+	}
+
+	stringstream done;
+	done << "Reloaded " << messageCount << " messages from " << blockCount << " archive blocks in "
+		<< std::fixed << std::setprecision(2) << (GetTickCount64() - startTime) / 1000.0 << "s";
+	UIaddLogMsg(done.str(), 0, uiMsgQueue);
+}
+
+void packet_processor::replay_segment(ARCHIVE_SEGMENT_VIEW &segment)
+{
+	ARCHIVE_SEGMENT &header = *segment.header;
+	//the segment can start partway into its data
+	if (!header.messageCount || segment.messages[0].start >= header.dataSize)
+		return;
+
+	currentMsgStreamID = header.streamID;
+	currentMsgIncoming = header.incoming != 0;
+	currentStreamObj = get_stream(currentMsgStreamID);
+	replayProcess = header.pid;
+
+	//deserialise_packets_from_decrypted frees it
+	decryptedBuffer = new vector<byte>(segment.data, segment.data + header.dataSize);
+	decryptedIndex = segment.messages[0].start;
+	remainingDecrypted = header.dataSize - decryptedIndex;
+	errorFlag = eNoErr;
+
+	deserialise_packets_from_decrypted((streamType)header.streamType, currentMsgIncoming, header.timeMs);
+}
+
+void packet_processor::notify_stream_state(eStreamState state)
+{
+	if (!replaying())
+		UInotifyStreamState(currentMsgStreamID, state, uiMsgQueue);
+}
+
 void packet_processor::main_loop()
 {
 	init_loginPkt_deserialisers();
 	init_gamePkt_deserialisers();
 
 	unsigned int errCount = 0;
-	process_packet_loop();
+	if (replaying())
+		replay_archive_loop();
+	else
+		process_packet_loop();
 	ded = true;
 }
\ No newline at end of file
@@ -1,9 +1,16 @@
 #pragma once
 #include "stdafx.h"
 #include "packet_capture_thread.h"
-#include "key_grabber_thread.h"
+#include "key_source.h"
+#include "key_file.h"
+#include "session_archive.h"
+#include "shm_feed.h"
+#include "entity_store.h"
 #include "gameDataStore.h"
 
+//an archive replay waits while this many messages are queued for the UI
+#define ARCHIVE_REPLAY_QUEUE_LIMIT 20000
+
 enum eDecodingErr{ eNoErr, eErrUnderflow, 
 	eBadPacketID, ePktIDUnimplemented, eAbandoned};
 
@@ -17,23 +24,59 @@ public:
 	unsigned short lastPktID = 0;
 	int ephKeys = 0;
 	bool failed = false;
+	bool keysLogged = false;
 	SafeQueue<GAMEPACKET > *queue = NULL;
 };
 
+/*
+Everything the processor keeps for one game client, keyed by process ID so
+any number of clients can be logged in and decrypted side by side.
+New streams sit in the session of process 0 until one of a clients keys
+decrypts them, then move to that clients session.
+*/
+class CLIENT_SESSION {
+public:
+	DWORD pid = 0;
+	//the decode state of each of its streams
+	map<networkStreamID, std::unique_ptr<STREAMDATA> > streams;
+	//keys handed out by the login/instance server for this clients next gameserver connection
+	map<unsigned long, std::pair<KEYDATA *, KEYDATA *> > pendingGameserverKeys;
+	//the stream it last logged in on
+	bool loggedIn = false;
+	networkStreamID loginStream = 0;
+};
+
 class packet_processor :
 	public base_thread
 {
 public:
 
-	packet_processor(key_grabber_thread *keyGrabPtr, SafeQueue<UI_MESSAGE *>* uiq, 
+	packet_processor(key_source *keySourcePtr, SafeQueue<UI_MESSAGE *>* uiq, 
 		SafeQueue<GAMEPACKET > *gameP, SafeQueue<GAMEPACKET > *loginP, gameDataStore* ggpkRef)
 	{
-		keyGrabber = keyGrabPtr; uiMsgQueue = uiq; ggpk = ggpkRef;
+		keySource = keySourcePtr; uiMsgQueue = uiq; ggpk = ggpkRef;
 		gameQueue = gameP; loginQueue = loginP;
 	}
 	~packet_processor() {};
-	DWORD getLatestDecryptProcess() { return activeClientPID; }
+	//the process a stream was decrypted with, 0 if it hasn't been
+	DWORD getStreamProcess(networkStreamID streamID);
+	//clients that have decrypted a stream
+	size_t session_count();
 	void requestIters(bool state) { displayingIters = state; }
+	//when replaying, the flag set by the capture thread once the whole file is queued
+	void set_input_ended_flag(bool *flag) { inputEnded = flag; }
+	//record the keys of each decrypting stream to the key log and any capture recording
+	void set_key_log(key_log *log) { keyLog = log; }
+	//provides the stream addresses and capture recorder
+	void set_stream_capture(packet_capture_thread *capture) { streamCapture = capture; }
+	//archive each decrypted segment and where its messages are
+	void set_session_archive(session_archive_writer *archive) { sessionArchive = archive; }
+	//decoded packets go to the shared memory feed before the UI queue
+	void set_shm_feed(shm_feed *feed) { shmFeed = feed; }
+	//object state tracked from the decoded packets
+	void set_entity_store(entity_store *store) { entities = store; }
+	//decode the segments of a session archive instead of the packet queues, to reload an old session
+	void set_archive_replay(session_archive_reader *archive) { replayArchive = archive; }
 
 	bool running = true;
 	bool ded = false;
@@ -46,6 +89,21 @@ private:
 	void init_loginPkt_deserialisers();
 
 	bool process_packet_loop();
+	bool input_ended() { return inputEnded && *inputEnded; }
+	void replay_archive_loop();
+	void replay_segment(ARCHIVE_SEGMENT_VIEW &segment);
+	bool replaying() { return replayArchive != NULL; }
+	//a replay leaves the state of the live streams alone
+	void notify_stream_state(eStreamState state);
+
+	CLIENT_SESSION *get_session(DWORD pid);
+	STREAMDATA *get_stream(networkStreamID streamID);
+	void assign_stream_session(networkStreamID streamID, DWORD pid, bool loginStream = false);
+	void add_pending_gameserver_keys(unsigned long connectionID, KEYDATA *sendKey, KEYDATA *recvKey);
+	bool take_pending_gameserver_keys(networkStreamID streamID, unsigned long connectionID, std::pair<KEYDATA *, KEYDATA *> &keys);
+	std::string stream_client_address(networkStreamID streamID);
+	size_t pending_gameserver_key_count();
+	void log_stream_keys(streamType server, unsigned long connectionID);
 	//void handle_patch_data(byte* data);
 	void handle_login_data(GAMEPACKET &pkt);
 	bool handle_game_data(GAMEPACKET &pkt);
@@ -273,6 +331,9 @@ private:
 	void deserialise_SRV_IDNOTIFY_0x137(UIDecodedPkt *uipkt);
 	
 	void deserialise_packets_from_decrypted(streamType, bool incoming, long long timeSeen);
+	void archive_segment(streamType streamServer, bool incoming, long long timeSeen, unsigned int segmentEnd);
+	//0 until a key decrypts the stream, or the archived process when replaying
+	DWORD stream_process() { return currentStreamObj->workingSendKey ? currentStreamObj->workingSendKey->sourceProcess : replayProcess; }
 
 	UINT8 consume_Byte();   
 	UINT16 consume_WORD();  
@@ -301,11 +362,21 @@ private:
 	std::deque< GAMEPACKET  > pendingPktQueue;
 	gameDataStore* ggpk = NULL;
 
-	key_grabber_thread *keyGrabber;
-
-	std::map<networkStreamID, STREAMDATA> streamDatas;
-	map<unsigned long, std::pair<KEYDATA *, KEYDATA *> > pendingGameserverKeys;
-	map<networkStreamID, unsigned long> connectionIDStreamIDmapping;
+	key_source *keySource;
+	bool *inputEnded = NULL;
+	key_log *keyLog = NULL;
+	packet_capture_thread *streamCapture = NULL;
+	session_archive_writer *sessionArchive = NULL;
+	shm_feed *shmFeed = NULL;
+	entity_store *entities = NULL;
+	std::vector<ARCHIVE_MESSAGE> archiveMessages;
+	session_archive_reader *replayArchive = NULL;
+	DWORD replayProcess = 0;
+
+	std::map<DWORD, CLIENT_SESSION> clientSessions;
+	//which session holds each stream, read from the UI thread
+	std::mutex sessionsMutex;
+	std::map<networkStreamID, DWORD> streamSessions;
 	SafeQueue<UI_MESSAGE *> *uiMsgQueue;
 	SafeQueue<GAMEPACKET > *gameQueue, *loginQueue;
 
@@ -318,7 +389,6 @@ private:
 	bool currentMsgIncoming = NULL;
 	STREAMDATA *currentStreamObj = NULL;
 
-	DWORD activeClientPID = 0;
 	vector<byte> *decryptedBuffer = NULL;
 	size_t remainingDecrypted = 0, decryptedIndex = 0;
 
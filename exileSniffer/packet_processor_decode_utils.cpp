@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "packet_processor.h"
 #include "utilities.h"
+#include "hex_dump.h"
 
 void packet_processor::emit_decoding_err_msg(unsigned short msgID, unsigned short lastMsgID)
 {
@@ -36,7 +37,7 @@ void packet_processor::emit_decoding_err_msg(unsigned short msgID, unsigned shor
 	}
 	errmsg << " while processing msgID 0x" << std::hex << msgID << " at index " <<
 		std::dec << decryptedIndex << " after previous packet ID 0x" << std::hex << lastMsgID;
-	UIaddLogMsg(QString::fromStdString(errmsg.str()), activeClientPID, uiMsgQueue);
+	UIaddLogMsg(errmsg.str(), stream_process(), uiMsgQueue);
 }
 
 /*
@@ -50,11 +51,18 @@ normal workflow and appends it to the remaining decrypted buffer so the decoder
 */
 void packet_processor::continue_buffer_next_packet()
 {
+	//archived segments already hold everything the live decode read
+	if (replaying())
+	{
+		errorFlag = eDecodingErr::eErrUnderflow;
+		return;
+	}
+
 	GAMEPACKET pkt;
 	int attemptsCount = 0;
 
 	pendingPktQueue.pop_front();
-	STREAMDATA *streamObj = &streamDatas[currentMsgStreamID];
+	STREAMDATA *streamObj = currentStreamObj;
 	streamObj->packetCount++;
 
 	while (true)
@@ -82,9 +90,9 @@ void packet_processor::continue_buffer_next_packet()
 					keyObj.ProcessData(decryptedBuffer->data()+originalSize, pkt.data.data(), dataLen);
 				}
 				catch (const CryptoPP::Exception& exception) {
-					QString msg = "An exception was caught during salsa decrypt of multipacket data.";
+					std::string msg = "An exception was caught during salsa decrypt of multipacket data.";
 					msg = msg + " This is usually due to incorrect deserialisation";
-					UIaddLogMsg(msg, getLatestDecryptProcess(), uiMsgQueue);
+					UIaddLogMsg(msg, stream_process(), uiMsgQueue);
 					currentStreamObj->failed = true;
 					UInotifyStreamState(currentMsgStreamID, eStreamState::eStreamFailed, uiMsgQueue);
 					return;
@@ -103,7 +111,7 @@ void packet_processor::continue_buffer_next_packet()
 			stringstream err;
 			err << "WARNING: Long wait for continuation data stream " << currentMsgStreamID <<
 				" incoming: " << currentMsgIncoming;
-			UIaddLogMsg(QString::fromStdString(err.str()), activeClientPID, uiMsgQueue);
+			UIaddLogMsg(err.str(), stream_process(), uiMsgQueue);
 		}
 		Sleep(50);
 	}
@@ -256,7 +264,7 @@ std::wstring packet_processor::consumeWString(size_t bytesLength)
 		{
 			std::stringstream err;
 			err << "Warning! Long string " << bytesLength << " possible bad byte order" << std::endl;
-			UIaddLogMsg(QString::fromStdString(err.str()), activeClientPID, uiMsgQueue);
+			UIaddLogMsg(err.str(), stream_process(), uiMsgQueue);
 		}
 
 		if (errorFlag != eDecodingErr::eNoErr) return 0;
@@ -456,17 +464,7 @@ std::wstring packet_processor::consume_hexblob(unsigned int size)
 	vector <byte> blob;
 	consume_blob(size, blob);
 
-	std::wstringstream keyhexss;
-	keyhexss << std::setfill(L'0') << std::uppercase << " ";
-	for (int i = 0; i < blob.size(); ++i)
-	{
-		byte item = blob.at(i);
-		if (item)
-			keyhexss << " " << std::hex << std::setw(2) << (int)item;
-		else
-			keyhexss << " 00";
-	}
-
-	std::wstring keyhex(keyhexss.str());
+	std::wstring keyhex(blob.size() * 3 + 1, L' ');
+	write_hex_spaced(blob.data(), blob.size(), &keyhex[1]);
 	return keyhex;
 }
\ No newline at end of file
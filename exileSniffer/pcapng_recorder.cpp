@@ -0,0 +1,169 @@
+#include "stdafx.h"
+#include "pcapng_recorder.h"
+
+#define PAD4(x) (((x) + 3) & ~(size_t)3)
+
+//callers hold bufferMutex for the append functions
+void pcapng_recorder::append_u32(uint32_t value)
+{
+	const byte *bytes = (const byte *)&value;
+	fillBuffer.insert(fillBuffer.end(), bytes, bytes + 4);
+}
+
+void pcapng_recorder::append_block_header(uint32_t type, uint32_t totalLength)
+{
+	append_u32(type);
+	append_u32(totalLength);
+}
+
+void pcapng_recorder::append_padded(const byte *data, size_t size)
+{
+	fillBuffer.insert(fillBuffer.end(), data, data + size);
+	fillBuffer.resize(fillBuffer.size() + (PAD4(size) - size), 0);
+}
+
+bool pcapng_recorder::open(std::string path, int linkType)
+{
+	captureFile = fopen(path.c_str(), "wb");
+	if (!captureFile)
+		return false;
+
+	std::lock_guard<std::mutex> lock(bufferMutex);
+
+	//section header, no options, unknown section length
+	append_block_header(PCAPNG_SHB_TYPE, 28);
+	append_u32(PCAPNG_BYTE_ORDER_MAGIC);
+	append_u32(1); //major 1, minor 0
+	append_u32(0xFFFFFFFF);
+	append_u32(0xFFFFFFFF);
+	append_u32(28);
+
+	//one interface, microsecond timestamps are the default
+	append_block_header(PCAPNG_IDB_TYPE, 20);
+	append_u32((uint32_t)linkType & 0xFFFF);
+	append_u32(0); //no snaplen
+	append_u32(20);
+	return true;
+}
+
+void pcapng_recorder::record_packet(const byte *data, size_t size, long long timeUs)
+{
+	uint32_t totalLength = (uint32_t)(32 + PAD4(size));
+
+	std::lock_guard<std::mutex> lock(bufferMutex);
+	if (!captureFile || !running)
+		return;
+
+	append_block_header(PCAPNG_EPB_TYPE, totalLength);
+	append_u32(0); //interface
+	append_u32((uint32_t)((uint64_t)timeUs >> 32));
+	append_u32((uint32_t)timeUs);
+	append_u32((uint32_t)size);
+	append_u32((uint32_t)size);
+	append_padded(data, size);
+	append_u32(totalLength);
+
+	if (fillBuffer.size() >= RECORDER_FLUSH_SIZE)
+		bufferReady.notify_one();
+}
+
+void pcapng_recorder::record_keys(std::string keyLine)
+{
+	keyLine.push_back('\n');
+	uint32_t totalLength = (uint32_t)(16 + PAD4(keyLine.size()));
+
+	std::lock_guard<std::mutex> lock(bufferMutex);
+	if (!captureFile || !running)
+		return;
+
+	append_block_header(PCAPNG_CUSTOM_TYPE, totalLength);
+	append_u32(PCAPNG_KEYS_PEN);
+	append_padded((const byte *)keyLine.data(), keyLine.size());
+	append_u32(totalLength);
+
+	//keys are worth more than a few ms of batching
+	bufferReady.notify_one();
+}
+
+void pcapng_recorder::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(bufferMutex);
+		running = false;
+	}
+	bufferReady.notify_one();
+}
+
+void pcapng_recorder::main_loop()
+{
+	bool finished = false;
+	while (!finished)
+	{
+		{
+			std::unique_lock<std::mutex> lock(bufferMutex);
+			bufferReady.wait_for(lock, std::chrono::milliseconds(RECORDER_FLUSH_MS),
+				[this] { return fillBuffer.size() >= RECORDER_FLUSH_SIZE || !running; });
+			fillBuffer.swap(writeBuffer);
+			finished = !running;
+		}
+
+		if (!writeBuffer.empty())
+		{
+			fwrite(writeBuffer.data(), 1, writeBuffer.size(), captureFile);
+			fflush(captureFile);
+			bytesWritten += writeBuffer.size();
+			writeBuffer.clear();
+		}
+	}
+
+	fclose(captureFile);
+	captureFile = NULL;
+	ded = true;
+}
+
+bool read_pcapng_key_lines(std::string path, std::vector<std::string> &keyLines)
+{
+	FILE *pFile = fopen(path.c_str(), "rb");
+	if (!pFile)
+		return false;
+
+	bool validSection = false;
+	std::vector<byte> body;
+	uint32_t header[2];
+	while (fread(header, sizeof(uint32_t), 2, pFile) == 2)
+	{
+		uint32_t type = header[0], totalLength = header[1];
+		if (totalLength < 12 || totalLength % 4)
+			break;
+
+		body.resize(totalLength - 8);
+		if (fread(body.data(), 1, body.size(), pFile) != body.size())
+			break;
+
+		if (type == PCAPNG_SHB_TYPE)
+		{
+			//only reading our own recordings so no byte swapping
+			validSection = *(uint32_t *)body.data() == PCAPNG_BYTE_ORDER_MAGIC;
+			if (!validSection)
+				break;
+			continue;
+		}
+
+		if (!validSection)
+			break;
+
+		if (type != PCAPNG_CUSTOM_TYPE || totalLength < 16 || *(uint32_t *)body.data() != PCAPNG_KEYS_PEN)
+			continue;
+
+		//custom data sits between the PEN and the trailing length
+		std::string keyText((char *)body.data() + 4, body.size() - 8);
+		std::istringstream lines(keyText.c_str()); //c_str drops the padding
+		std::string line;
+		while (std::getline(lines, line))
+			if (!line.empty())
+				keyLines.push_back(line);
+	}
+
+	fclose(pFile);
+	return validSection;
+}
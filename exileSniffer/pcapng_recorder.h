@@ -0,0 +1,65 @@
+#pragma once
+#include "base_thread.h"
+#include <condition_variable>
+
+#define PCAPNG_SHB_TYPE 0x0A0D0D0A
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_IDB_TYPE 0x00000001
+#define PCAPNG_EPB_TYPE 0x00000006
+#define PCAPNG_CUSTOM_TYPE 0x00000BAD
+
+//the IANA example enterprise number (RFC 5612) - marks our key blocks
+#define PCAPNG_KEYS_PEN 32473
+
+//the capture thread hands blocks over once this much is queued
+#define RECORDER_FLUSH_SIZE (256 * 1024)
+//and the writer picks up whatever is there at least this often
+#define RECORDER_FLUSH_MS 250
+
+/*
+Records the sniffed login/game traffic to pcapng for replaying later
+
+Packets are stored exactly as sniffed with the capture timestamps. The keys
+of each stream go in custom blocks holding key file stream lines (see key_file.h)
+so the file is all that's needed to decode the session again.
+
+The capture thread only appends encoded blocks to a buffer, the file
+is written on the recorders own thread.
+*/
+class pcapng_recorder :
+	public base_thread
+{
+public:
+	//false if the file can't be created
+	bool open(std::string path, int linkType);
+	void record_packet(const byte *data, size_t size, long long timeUs);
+	void record_keys(std::string keyLine);
+	//writes everything queued and closes the file
+	void stop();
+
+	size_t bytes_written() { return bytesWritten; }
+
+	bool running = true;
+	bool ded = false;
+
+private:
+	void main_loop();
+	void append_block_header(uint32_t type, uint32_t totalLength);
+	void append_u32(uint32_t value);
+	void append_padded(const byte *data, size_t size);
+
+	FILE *captureFile = NULL;
+
+	std::mutex bufferMutex;
+	std::condition_variable bufferReady;
+	std::vector<byte> fillBuffer;
+	std::vector<byte> writeBuffer;
+
+	std::atomic<size_t> bytesWritten{ 0 };
+};
+
+/*
+Reads back the key lines stored in a recording.
+Returns false if it isn't a pcapng file we can read.
+*/
+bool read_pcapng_key_lines(std::string path, std::vector<std::string> &keyLines);
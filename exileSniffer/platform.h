@@ -0,0 +1,54 @@
+#pragma once
+/*
+Stand-ins for the bits of Win32 the decode core uses so it can be
+built headless on other platforms (see exileSnifferCLI).
+
+Only included by stdafx.h when _WIN32 isn't defined
+*/
+#ifndef _WIN32
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <arpa/inet.h>
+
+typedef uint32_t DWORD;
+typedef uint64_t DWORD64;
+typedef int BOOL;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t INT32;
+typedef unsigned int UINT;
+typedef unsigned short ushort;
+typedef unsigned char byte;
+typedef void *HANDLE;
+
+#define WINAPI
+#define __stdcall
+#define strtok_s strtok_r
+#define _fseeki64 fseeko
+#define _ftelli64 ftello
+
+inline void Sleep(DWORD ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline unsigned long long GetTickCount64()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline int fopen_s(FILE **file, const char *filename, const char *mode)
+{
+	*file = fopen(filename, mode);
+	return *file ? 0 : errno;
+}
+#endif
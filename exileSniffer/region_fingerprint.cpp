@@ -0,0 +1,78 @@
+/*
+Sampled content hashes of scanned regions, used to skip unchanged memory
+
+Not built with the precompiled header so it stays portable
+*/
+#include "region_fingerprint.h"
+#include "MurmurHash2.h"
+
+uint32_t region_fingerprint_cache::sample_hash(memory_source *source, const MEMREGION &region)
+{
+	if (region.size <= FINGERPRINT_WHOLE_REGION_SIZE)
+	{
+		sampleBuffer.resize((size_t)region.size);
+		size_t bytesRead = source->read(region.base, sampleBuffer.data(), (size_t)region.size);
+		return MurmurHash2A(sampleBuffer.data(), (int)bytesRead, (uint32_t)bytesRead);
+	}
+
+	//evenly spaced, the first at the start and the last at the very end
+	sampleBuffer.resize(FINGERPRINT_SAMPLES * FINGERPRINT_SAMPLE_SIZE);
+	uint64_t stride = (region.size - FINGERPRINT_SAMPLE_SIZE) / (FINGERPRINT_SAMPLES - 1);
+
+	size_t totalRead = 0;
+	for (int i = 0; i < FINGERPRINT_SAMPLES; ++i)
+	{
+		uint64_t sampleAddress = region.base + i * stride;
+		totalRead += source->read(sampleAddress, sampleBuffer.data() + totalRead, FINGERPRINT_SAMPLE_SIZE);
+	}
+
+	//a short read hashes differently so unreadable samples count as a change
+	return MurmurHash2A(sampleBuffer.data(), (int)totalRead, (uint32_t)totalRead);
+}
+
+eRegionChange region_fingerprint_cache::check(memory_source *source, const MEMREGION &region)
+{
+	uint32_t hash = sample_hash(source, region);
+
+	auto it = fingerprints.find(region.base);
+	if (it == fingerprints.end() || it->second.size != region.size)
+	{
+		REGION_FINGERPRINT fresh;
+		fresh.size = region.size;
+		fresh.hash = hash;
+		fresh.passSeen = currentPass;
+		fresh.skips = 0;
+		fingerprints[region.base] = fresh;
+		return eRegionNew;
+	}
+
+	REGION_FINGERPRINT &known = it->second;
+	known.passSeen = currentPass;
+
+	if (known.hash != hash)
+	{
+		known.hash = hash;
+		known.skips = 0;
+		return eRegionChanged;
+	}
+
+	//recorded memory never changes, live memory might have changed between the samples
+	if (source->is_live() && ++known.skips >= FINGERPRINT_MAX_SKIPS)
+	{
+		known.skips = 0;
+		return eRegionChanged;
+	}
+
+	return eRegionUnchanged;
+}
+
+void region_fingerprint_cache::end_pass()
+{
+	for (auto it = fingerprints.begin(); it != fingerprints.end(); )
+	{
+		if (it->second.passSeen != currentPass)
+			it = fingerprints.erase(it);
+		else
+			++it;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+/*
+Tracks which regions have changed between key scan passes
+
+Each region is remembered by base and size along with a hash of a spread of
+small samples of its contents. A region with the same base, size and hash
+as last pass is assumed to hold nothing new and can be skipped.
+
+Sampling can miss a write that lands between samples so a live region is
+always rescanned after being skipped FINGERPRINT_MAX_SKIPS times in a row.
+
+Only used by the scan controller thread, so no locking.
+Not built with the precompiled header so it stays portable
+*/
+#include "memory_source.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#define FINGERPRINT_SAMPLES 32
+#define FINGERPRINT_SAMPLE_SIZE 64
+//regions smaller than this are hashed whole
+#define FINGERPRINT_WHOLE_REGION_SIZE (8 * 1024)
+#define FINGERPRINT_MAX_SKIPS 8
+
+enum eRegionChange {
+	eRegionNew,		  //not seen last pass - usually a fresh allocation
+	eRegionChanged,	  //seen before but the samples differ
+	eRegionUnchanged  //safe to skip this pass
+};
+
+class region_fingerprint_cache
+{
+public:
+	//call before enumerating regions for a pass
+	void begin_pass() { ++currentPass; }
+	//forgets regions that weren't seen this pass (freed, resized or filtered out)
+	void end_pass();
+
+	//samples the region and updates its entry
+	eRegionChange check(memory_source *source, const MEMREGION &region);
+
+	size_t size() { return fingerprints.size(); }
+
+private:
+	struct REGION_FINGERPRINT {
+		uint64_t size;
+		uint32_t hash;
+		unsigned int passSeen;
+		unsigned int skips;
+	};
+
+	uint32_t sample_hash(memory_source *source, const MEMREGION &region);
+
+	std::unordered_map<uint64_t, REGION_FINGERPRINT> fingerprints;
+	std::vector<uint8_t> sampleBuffer;
+	unsigned int currentPass = 0;
+};
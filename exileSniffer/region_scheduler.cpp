@@ -0,0 +1,133 @@
+/*
+Work stealing job queue for the key scan workers
+
+Not built with the precompiled header so it stays portable
+*/
+#include "region_scheduler.h"
+#include <algorithm>
+#include <chrono>
+
+unsigned int region_scheduler::hardware_worker_count()
+{
+	//leave a core for the game client and the packet processor
+	unsigned int cores = std::thread::hardware_concurrency();
+	if (cores <= 2)
+		return 1;
+	return std::min(cores - 1, (unsigned int)MAX_SCAN_WORKERS);
+}
+
+region_scheduler::region_scheduler(unsigned int workerCount)
+	: deques(workerCount ? std::min(workerCount, (unsigned int)MAX_SCAN_WORKERS) : hardware_worker_count())
+{
+}
+
+void region_scheduler::start(scanFunction func)
+{
+	scanner = func;
+	stopping = false;
+	for (unsigned int i = 0; i < deques.size(); ++i)
+		workers.emplace_back(&region_scheduler::worker_loop, this, i);
+}
+
+void region_scheduler::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(idleMutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+
+	for (auto &worker : workers)
+		if (worker.joinable())
+			worker.join();
+	workers.clear();
+
+	for (auto &dq : deques)
+	{
+		std::lock_guard<std::mutex> lock(dq.lock);
+		dq.jobs.clear();
+	}
+	queuedJobs = 0;
+}
+
+void region_scheduler::submit_range(const MEMREGION &region, uint64_t address, size_t size, size_t jobSize, size_t overlap)
+{
+	if (!size || deques.empty()) return;
+
+	size_t stride = jobSize - overlap;
+	size_t offset = 0;
+	while (true)
+	{
+		SCAN_JOB job;
+		job.address = address + offset;
+		job.size = std::min(jobSize, size - offset);
+		job.region = region;
+
+		//round robin so a big region is spread over every worker from the start
+		WORKER_DEQUE &dq = deques[nextDeque];
+		nextDeque = (nextDeque + 1) % deques.size();
+		{
+			std::lock_guard<std::mutex> lock(dq.lock);
+			dq.jobs.push_back(job);
+		}
+		++queuedJobs;
+
+		if (offset + job.size >= size)
+			break;
+		offset += stride;
+	}
+
+	workAvailable.notify_all();
+}
+
+//own deque first (oldest job first), then steal the newest job from a neighbour
+bool region_scheduler::take_job(unsigned int workerIndex, SCAN_JOB &job)
+{
+	WORKER_DEQUE &own = deques[workerIndex];
+	{
+		std::lock_guard<std::mutex> lock(own.lock);
+		if (!own.jobs.empty())
+		{
+			job = own.jobs.front();
+			own.jobs.pop_front();
+			++runningJobs;
+			--queuedJobs;
+			return true;
+		}
+	}
+
+	size_t dequeCount = deques.size();
+	for (size_t i = 1; i < dequeCount; ++i)
+	{
+		WORKER_DEQUE &victim = deques[(workerIndex + i) % dequeCount];
+		std::unique_lock<std::mutex> lock(victim.lock, std::try_to_lock);
+		if (!lock.owns_lock() || victim.jobs.empty())
+			continue;
+
+		job = victim.jobs.back();
+		victim.jobs.pop_back();
+		++runningJobs;
+		--queuedJobs;
+		return true;
+	}
+	return false;
+}
+
+void region_scheduler::worker_loop(unsigned int workerIndex)
+{
+	while (!stopping)
+	{
+		SCAN_JOB job;
+		if (take_job(workerIndex, job))
+		{
+			scanner(workerIndex, job);
+			--runningJobs;
+			continue;
+		}
+
+		//nothing to do anywhere. try_lock in take_job can miss a job so don't sleep forever
+		std::unique_lock<std::mutex> lock(idleMutex);
+		workAvailable.wait_for(lock, std::chrono::milliseconds(50),
+			[this] { return stopping || queuedJobs > 0; });
+	}
+}
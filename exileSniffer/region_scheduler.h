@@ -0,0 +1,82 @@
+#pragma once
+/*
+Hands memory regions to the key scan workers
+
+Regions are split into chunk sized jobs and spread over one deque per worker.
+A worker takes jobs from the front of its own deque and when that runs dry
+steals from the back of the others, so one huge region or one slow worker
+doesn't leave the rest idle.
+
+Not built with the precompiled header so it stays portable
+*/
+#include "memory_source.h"
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+#define MAX_SCAN_WORKERS 16
+
+struct SCAN_JOB {
+	uint64_t address;
+	size_t size;
+	MEMREGION region; //the region this job is part of
+};
+
+class region_scheduler
+{
+public:
+	typedef std::function<void(unsigned int workerIndex, SCAN_JOB &job)> scanFunction;
+
+	//workerCount of 0 sizes the pool to the machine
+	region_scheduler(unsigned int workerCount = 0);
+	~region_scheduler() { stop(); }
+
+	void start(scanFunction func);
+	//finish the current jobs, discard the rest and join the workers
+	void stop();
+
+	/*
+	Split a region into jobs of at most jobSize bytes, each overlapping the
+	previous by overlap bytes so nothing spanning a boundary is missed
+	*/
+	void submit_region(const MEMREGION &region, size_t jobSize, size_t overlap) {
+		submit_range(region, region.base, (size_t)region.size, jobSize, overlap);
+	}
+	//as above for just part of a region
+	void submit_range(const MEMREGION &region, uint64_t address, size_t size, size_t jobSize, size_t overlap);
+
+	//jobs queued or still being scanned, 0 once a pass is finished
+	size_t pending() {
+		//taking a job counts it as running before it stops counting as queued
+		size_t queued = queuedJobs;
+		return queued + runningJobs;
+	}
+	unsigned int worker_count() { return (unsigned int)deques.size(); }
+	static unsigned int hardware_worker_count();
+
+private:
+	struct WORKER_DEQUE {
+		std::mutex lock;
+		std::deque<SCAN_JOB> jobs;
+	};
+
+	void worker_loop(unsigned int workerIndex);
+	bool take_job(unsigned int workerIndex, SCAN_JOB &job);
+
+	scanFunction scanner;
+	std::vector<std::thread> workers;
+	std::vector<WORKER_DEQUE> deques;
+	unsigned int nextDeque = 0;
+
+	std::mutex idleMutex;
+	std::condition_variable workAvailable;
+	std::atomic<size_t> queuedJobs{ 0 };
+	std::atomic<size_t> runningJobs{ 0 };
+	std::atomic<bool> stopping{ false };
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include "cppsemaphore.h"
+#include <deque>
+#include <vector>
 //i wanted a platform independent, thread safe queue that you could check without waiting on
 //couldn't find one so hacked this up
 
@@ -21,7 +23,8 @@ public:
 	T waitItem() {
 		sem.wait();
 		mymutex.lock();
-		T item = q.dequeue();
+		T item = q.front();
+		q.pop_front();
 		mymutex.unlock();
 		return item;
 	}
@@ -37,15 +40,38 @@ public:
 	void pop() {
 		sem.wait();
 		mymutex.lock();
-		q.dequeue();
+		q.pop_front();
 		mymutex.unlock();
 	}
 
+	//moves whatever is waiting, up to maxItems, onto the end of out in one go
+	size_t takeItems(std::vector<T> &out, size_t maxItems)
+	{
+		return moveItems(out, sem.try_wait_many((int)maxItems));
+	}
+
+	//same but waits up to timeoutMS for something to arrive
+	size_t waitItems(std::vector<T> &out, size_t maxItems, int timeoutMS)
+	{
+		return moveItems(out, sem.wait_many_for((int)maxItems, timeoutMS));
+	}
+
 	bool empty() { return q.empty(); }
 	size_t size() { return q.size();  }
 
 private:
-	QQueue<T> q;
+	size_t moveItems(std::vector<T> &out, size_t count)
+	{
+		if (!count) return 0;
+
+		mymutex.lock();
+		out.insert(out.end(), q.begin(), q.begin() + count);
+		q.erase(q.begin(), q.begin() + count);
+		mymutex.unlock();
+		return count;
+	}
+
+	std::deque<T> q;
 	semaphore sem;
 	std::mutex mymutex;
 };
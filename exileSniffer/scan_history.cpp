@@ -0,0 +1,179 @@
+/*
+History of valid key locations used to order and filter key scans
+
+Not built with the precompiled header so it stays portable
+*/
+#include "scan_history.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <ctime>
+
+#define KEY_HISTORY_HEADER "#exileSniffer key sites v1"
+
+bool scan_history::load(std::string path)
+{
+	std::ifstream historyFile(path);
+	if (!historyFile.is_open())
+		return false;
+
+	std::lock_guard<std::mutex> lock(historyMutex);
+	sites.clear();
+
+	std::string line;
+	while (std::getline(historyFile, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		//type protect allocationProtect regionSize offset hits lastHit
+		std::istringstream fields(line);
+		KEYSITE site;
+		int type;
+		if (!(fields >> type >> site.protect >> site.allocationProtect >> site.regionSize >>
+			site.offset >> site.hits >> site.lastHit))
+			continue;
+		if (type < eMemPrivate || type > eMemUnknown)
+			continue;
+
+		site.type = (eMemRegionType)type;
+		sites.push_back(site);
+		if (sites.size() == MAX_KEY_SITES)
+			break;
+	}
+	return true;
+}
+
+bool scan_history::save(std::string path)
+{
+	std::ofstream historyFile(path, std::ofstream::out | std::ofstream::trunc);
+	if (!historyFile.is_open())
+		return false;
+
+	std::lock_guard<std::mutex> lock(historyMutex);
+	historyFile << KEY_HISTORY_HEADER << "\n";
+	for (KEYSITE &site : sites)
+	{
+		historyFile << (int)site.type << " " << site.protect << " " << site.allocationProtect << " " <<
+			site.regionSize << " " << site.offset << " " << site.hits << " " << site.lastHit << "\n";
+	}
+	return historyFile.good();
+}
+
+bool scan_history::same_attributes(const KEYSITE &site, const MEMREGION &region)
+{
+	return site.type == region.type &&
+		site.protect == region.protect &&
+		site.allocationProtect == region.allocationProtect;
+}
+
+void scan_history::record_valid_key(const MEMREGION &region, uint64_t keyAddress)
+{
+	if (keyAddress < region.base || keyAddress >= region.base + region.size)
+		return;
+
+	uint64_t offset = keyAddress - region.base;
+	uint64_t now = (uint64_t)time(NULL);
+
+	std::lock_guard<std::mutex> lock(historyMutex);
+	for (KEYSITE &site : sites)
+	{
+		if (same_attributes(site, region) && site.regionSize == region.size && site.offset == offset)
+		{
+			site.hits++;
+			site.lastHit = now;
+			return;
+		}
+	}
+
+	//full - forget the site that has gone unused longest
+	if (sites.size() >= MAX_KEY_SITES)
+	{
+		auto oldest = std::min_element(sites.begin(), sites.end(),
+			[](const KEYSITE &a, const KEYSITE &b) { return a.lastHit < b.lastHit; });
+		sites.erase(oldest);
+	}
+
+	KEYSITE site;
+	site.type = region.type;
+	site.protect = region.protect;
+	site.allocationProtect = region.allocationProtect;
+	site.regionSize = region.size;
+	site.offset = offset;
+	site.hits = 1;
+	site.lastHit = now;
+	sites.push_back(site);
+}
+
+unsigned int scan_history::region_score(const MEMREGION &region)
+{
+	unsigned int score = 0;
+
+	std::lock_guard<std::mutex> lock(historyMutex);
+	for (KEYSITE &site : sites)
+	{
+		if (!same_attributes(site, region))
+			continue;
+
+		unsigned int siteScore;
+		if (site.regionSize == region.size)
+			siteScore = 1000 + site.hits; //heap segments get reused at the same size
+		else if (region.size <= site.regionSize * 2 && region.size * 2 >= site.regionSize)
+			siteScore = 100 + site.hits;
+		else
+			siteScore = 10;
+
+		score = std::max(score, siteScore);
+	}
+	return score;
+}
+
+void scan_history::likely_offsets(const MEMREGION &region, std::vector<uint64_t> &offsets)
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+	for (KEYSITE &site : sites)
+	{
+		if (same_attributes(site, region) && site.regionSize == region.size && site.offset < region.size)
+			offsets.push_back(site.offset);
+	}
+}
+
+bool scan_history::learned_filter(LEARNED_FILTER &filter)
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+	if (sites.size() < MIN_SITES_FOR_FILTER)
+		return false;
+
+	filter = LEARNED_FILTER();
+	filter.minSize = UINT64_MAX;
+	for (KEYSITE &site : sites)
+	{
+		filter.typeMask |= (1 << site.type);
+		if (std::find(filter.allocationProtects.begin(), filter.allocationProtects.end(),
+			site.allocationProtect) == filter.allocationProtects.end())
+			filter.allocationProtects.push_back(site.allocationProtect);
+		filter.minSize = std::min(filter.minSize, site.regionSize);
+		filter.maxSize = std::max(filter.maxSize, site.regionSize);
+	}
+
+	//some slack either side so a slightly different allocation still gets scanned
+	filter.minSize /= 2;
+	filter.maxSize *= 2;
+	return true;
+}
+
+bool scan_history::passes_learned_filter(const MEMREGION &region, LEARNED_FILTER &filter)
+{
+	if (!(filter.typeMask & (1 << region.type)))
+		return false;
+	if (region.size < filter.minSize || region.size > filter.maxSize)
+		return false;
+	return std::find(filter.allocationProtects.begin(), filter.allocationProtects.end(),
+		region.allocationProtect) != filter.allocationProtects.end();
+}
+
+size_t scan_history::site_count()
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+	return sites.size();
+}
@@ -0,0 +1,67 @@
+#pragma once
+/*
+Remembers where in client memory valid keys have been found before
+
+Each validated key records the attributes of the region it was in and its
+offset into that region. Future scans use this to
+	scan regions that look like previous key regions first
+	probe the exact offsets keys were previously found at before anything else
+	build a filter much tighter than the fixed memory_passes_filters tiers
+
+Kept in a small text file next to the executable between runs.
+
+Not built with the precompiled header so it stays portable
+*/
+#include "memory_source.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#define KEY_HISTORY_FILE "keyhistory.txt"
+#define MAX_KEY_SITES 128
+//a learned filter is only trusted once this many keys have been found
+#define MIN_SITES_FOR_FILTER 3
+
+struct KEYSITE {
+	eMemRegionType type = eMemUnknown;
+	unsigned int protect = 0;
+	unsigned int allocationProtect = 0;
+	uint64_t regionSize = 0;
+	uint64_t offset = 0; //of the key signature from the region base
+	unsigned int hits = 0;
+	uint64_t lastHit = 0; //unix time
+};
+
+//regions that every previous key region would have passed
+struct LEARNED_FILTER {
+	unsigned int typeMask = 0; //1 << eMemRegionType
+	std::vector<unsigned int> allocationProtects;
+	uint64_t minSize = 0;
+	uint64_t maxSize = 0;
+};
+
+class scan_history
+{
+public:
+	bool load(std::string path);
+	bool save(std::string path);
+
+	void record_valid_key(const MEMREGION &region, uint64_t keyAddress);
+
+	//higher is more likely to hold a key, 0 if nothing like it has held one
+	unsigned int region_score(const MEMREGION &region);
+	//offsets into this region where keys have been found in regions just like it
+	void likely_offsets(const MEMREGION &region, std::vector<uint64_t> &offsets);
+
+	bool learned_filter(LEARNED_FILTER &filter);
+	static bool passes_learned_filter(const MEMREGION &region, LEARNED_FILTER &filter);
+
+	size_t site_count();
+
+private:
+	static bool same_attributes(const KEYSITE &site, const MEMREGION &region);
+
+	std::mutex historyMutex;
+	std::vector<KEYSITE> sites;
+};
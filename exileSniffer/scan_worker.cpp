@@ -0,0 +1,24 @@
+/*
+Key scan worker jobs
+
+Not built with the precompiled header so it stays portable
+*/
+#include "scan_worker.h"
+#include <algorithm>
+
+size_t scan_job_for_keyblobs(memory_source *source, const SCAN_JOB &job, std::vector<uint8_t> &buffer,
+	std::vector<size_t> &signatureOffsets, keyscan_stats &stats, unsigned long *readErr)
+{
+	//jobs are never bigger than a chunk, the scheduler split the region already
+	buffer.resize(KEYSCAN_CHUNK_SIZE);
+	size_t chunkSize = std::min(job.size, (size_t)KEYSCAN_CHUNK_SIZE);
+
+	size_t bytesRead = source->read(job.address, buffer.data(), chunkSize, readErr);
+	if (!bytesRead)
+		return 0;
+
+	auto scanStart = std::chrono::steady_clock::now();
+	find_keyblob_signatures(buffer.data(), bytesRead, signatureOffsets);
+	stats.add(bytesRead, std::chrono::steady_clock::now() - scanStart);
+	return bytesRead;
+}
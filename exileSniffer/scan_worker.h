@@ -0,0 +1,20 @@
+#pragma once
+/*
+The part of a key scan worker that doesn't need the key grabber: read one
+job's chunk from a memory source and search it for key blob signatures.
+Used by the key grabber's workers and by scanBench on dumps and processes.
+
+Not built with the precompiled header so it stays portable
+*/
+#include "keyblob_scanner.h"
+#include "region_scheduler.h"
+
+/*
+Reads the job (at most KEYSCAN_CHUNK_SIZE bytes) into buffer and appends
+the offsets of any signatures found, relative to job.address, to signatureOffsets.
+The search time is added to stats.
+
+Returns the bytes read. readErr is set if the source reported an error
+*/
+size_t scan_job_for_keyblobs(memory_source *source, const SCAN_JOB &job, std::vector<uint8_t> &buffer,
+	std::vector<size_t> &signatureOffsets, keyscan_stats &stats, unsigned long *readErr);
@@ -0,0 +1,362 @@
+#include "stdafx.h"
+#include "session_archive.h"
+#include "zdeflate.h"
+#include "zinflate.h"
+#include "filters.h"
+
+#define PAD8(x) (((x) + 7) & ~(size_t)7)
+#define ARCHIVE_HEADER_SIZE 16
+#define ARCHIVE_BLOCK_HEADER_SIZE 8
+//how often the writer checks for a stale block
+#define ARCHIVE_POLL_MS 250
+
+static_assert(sizeof(ARCHIVE_SEGMENT) % 8 == 0, "segment headers must keep the data 8 byte aligned");
+static_assert(sizeof(ARCHIVE_BLOCK_INDEX) % 8 == 0, "block index entries are written as an array");
+
+void ARCHIVE_BLOCK_INDEX::add_message(uint8_t streamType, ushort msgID)
+{
+	if (msgID < ARCHIVE_MSGID_MASK_BYTES * 8)
+		msgID_mask(streamType)[msgID / 8] |= 1 << (msgID % 8);
+}
+
+bool session_archive_writer::open(std::string path)
+{
+	archiveFile = fopen(path.c_str(), "wb");
+	if (!archiveFile)
+		return false;
+
+	uint32_t header[2] = { ARCHIVE_VERSION, 0 };
+	fwrite(ARCHIVE_MAGIC, 1, 8, archiveFile);
+	fwrite(header, sizeof(uint32_t), 2, archiveFile);
+	fileOffset = ARCHIVE_HEADER_SIZE;
+	return true;
+}
+
+void session_archive_writer::add_segment(ARCHIVE_SEGMENT &segment, const byte *data, std::vector<ARCHIVE_MESSAGE> &messages)
+{
+	segment.messageCount = (uint16_t)messages.size();
+	size_t messagesSize = messages.size() * sizeof(ARCHIVE_MESSAGE);
+
+	std::lock_guard<std::mutex> lock(blockMutex);
+	if (!archiveFile || !running)
+		return;
+
+	if (fillBlock.empty())
+	{
+		memset(&fillIndex, 0, sizeof(fillIndex));
+		fillIndex.firstTimeMs = segment.timeMs;
+		fillStarted = GetTickCount64();
+	}
+	fillIndex.lastTimeMs = segment.timeMs;
+	fillIndex.segmentCount++;
+	fillIndex.messageCount += segment.messageCount;
+	fillIndex.streamMask |= 1ULL << (segment.streamID & 63);
+	for (ARCHIVE_MESSAGE &message : messages)
+		fillIndex.add_message(segment.streamType, message.msgID);
+
+	const byte *segmentHeader = (const byte *)&segment;
+	fillBlock.insert(fillBlock.end(), segmentHeader, segmentHeader + sizeof(ARCHIVE_SEGMENT));
+	fillBlock.insert(fillBlock.end(), (const byte *)messages.data(), (const byte *)messages.data() + messagesSize);
+	fillBlock.insert(fillBlock.end(), data, data + segment.dataSize);
+	fillBlock.resize(PAD8(fillBlock.size()), 0);
+
+	if (fillBlock.size() >= ARCHIVE_BLOCK_SIZE)
+	{
+		close_fill_block();
+		blockReady.notify_one();
+	}
+}
+
+//callers hold blockMutex
+void session_archive_writer::close_fill_block()
+{
+	fullBlocks.push_back(std::make_pair(std::vector<byte>(), fillIndex));
+	fullBlocks.back().first.swap(fillBlock);
+	fillBlock.reserve(ARCHIVE_BLOCK_SIZE + ARCHIVE_BLOCK_SIZE / 4);
+}
+
+void session_archive_writer::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(blockMutex);
+		running = false;
+	}
+	blockReady.notify_one();
+}
+
+void session_archive_writer::write_block(std::vector<byte> &raw, ARCHIVE_BLOCK_INDEX &blockIndex)
+{
+	std::string deflated;
+	CryptoPP::Deflator deflator(new CryptoPP::StringSink(deflated), ARCHIVE_DEFLATE_LEVEL);
+	deflator.Put(raw.data(), raw.size());
+	deflator.MessageEnd();
+
+	blockIndex.fileOffset = fileOffset;
+	blockIndex.compressedSize = (uint32_t)deflated.size();
+	blockIndex.rawSize = (uint32_t)raw.size();
+
+	uint32_t blockHeader[2] = { blockIndex.compressedSize, blockIndex.rawSize };
+	fwrite(blockHeader, sizeof(uint32_t), 2, archiveFile);
+	fwrite(deflated.data(), 1, deflated.size(), archiveFile);
+	fflush(archiveFile);
+
+	fileOffset += ARCHIVE_BLOCK_HEADER_SIZE + deflated.size();
+	bytesWritten = (size_t)fileOffset;
+	index.push_back(blockIndex);
+}
+
+void session_archive_writer::write_index()
+{
+	ARCHIVE_TRAILER trailer;
+	trailer.indexOffset = fileOffset;
+	trailer.blockCount = (uint32_t)index.size();
+	trailer.magic = ARCHIVE_TRAILER_MAGIC;
+
+	fwrite(index.data(), sizeof(ARCHIVE_BLOCK_INDEX), index.size(), archiveFile);
+	fwrite(&trailer, sizeof(trailer), 1, archiveFile);
+}
+
+void session_archive_writer::main_loop()
+{
+	if (!archiveFile)
+	{
+		ded = true;
+		return;
+	}
+
+	bool finished = false;
+	std::deque<std::pair<std::vector<byte>, ARCHIVE_BLOCK_INDEX> > writeBlocks;
+	while (!finished)
+	{
+		{
+			std::unique_lock<std::mutex> lock(blockMutex);
+			blockReady.wait_for(lock, std::chrono::milliseconds(ARCHIVE_POLL_MS),
+				[this] { return !fullBlocks.empty() || !running; });
+			finished = !running;
+
+			//quiet sessions still get written out in reasonable time
+			bool stale = !fillBlock.empty() && (GetTickCount64() - fillStarted) > ARCHIVE_FLUSH_MS;
+			if (stale || (finished && !fillBlock.empty()))
+				close_fill_block();
+			fullBlocks.swap(writeBlocks);
+		}
+
+		for (auto &block : writeBlocks)
+			write_block(block.first, block.second);
+		writeBlocks.clear();
+	}
+
+	write_index();
+	fclose(archiveFile);
+	archiveFile = NULL;
+	ded = true;
+}
+
+bool parse_archive_block(ARCHIVE_BLOCK &block)
+{
+	block.segments.clear();
+
+	size_t offset = 0;
+	size_t blockSize = block.raw.size();
+	while (offset + sizeof(ARCHIVE_SEGMENT) <= blockSize)
+	{
+		ARCHIVE_SEGMENT_VIEW view;
+		view.header = (ARCHIVE_SEGMENT *)(block.raw.data() + offset);
+		offset += sizeof(ARCHIVE_SEGMENT);
+
+		size_t messagesSize = view.header->messageCount * sizeof(ARCHIVE_MESSAGE);
+		if (offset + messagesSize + view.header->dataSize > blockSize)
+			return false;
+
+		view.messages = (ARCHIVE_MESSAGE *)(block.raw.data() + offset);
+		view.data = block.raw.data() + offset + messagesSize;
+		offset = PAD8(offset + messagesSize + view.header->dataSize);
+		block.segments.push_back(view);
+	}
+	return offset == blockSize;
+}
+
+bool session_archive_reader::read_compressed(uint64_t offset, uint32_t size, std::vector<byte> &out)
+{
+	out.resize(size);
+	if (_fseeki64(archiveFile, (long long)offset, SEEK_SET) != 0)
+		return false;
+	return fread(out.data(), 1, size, archiveFile) == size;
+}
+
+bool session_archive_reader::inflate_block(ARCHIVE_BLOCK_INDEX &blockIndex, std::vector<byte> &raw)
+{
+	if (!read_compressed(blockIndex.fileOffset + ARCHIVE_BLOCK_HEADER_SIZE, blockIndex.compressedSize, compressed))
+		return false;
+
+	raw.resize(blockIndex.rawSize);
+	try
+	{
+		CryptoPP::ArraySink *sink = new CryptoPP::ArraySink(raw.data(), raw.size());
+		CryptoPP::Inflator inflator(sink);
+		inflator.Put(compressed.data(), compressed.size());
+		inflator.MessageEnd();
+		return sink->TotalPutLength() == raw.size();
+	}
+	catch (CryptoPP::Exception &)
+	{
+		return false;
+	}
+}
+
+bool session_archive_reader::read_index()
+{
+	if (_fseeki64(archiveFile, 0, SEEK_END) != 0)
+		return false;
+	long long fileSize = _ftelli64(archiveFile);
+	if (fileSize < (long long)(ARCHIVE_HEADER_SIZE + sizeof(ARCHIVE_TRAILER)))
+		return false;
+
+	ARCHIVE_TRAILER trailer;
+	_fseeki64(archiveFile, fileSize - sizeof(ARCHIVE_TRAILER), SEEK_SET);
+	if (fread(&trailer, sizeof(trailer), 1, archiveFile) != 1 || trailer.magic != ARCHIVE_TRAILER_MAGIC)
+		return false;
+
+	uint64_t indexSize = (uint64_t)trailer.blockCount * sizeof(ARCHIVE_BLOCK_INDEX);
+	if (trailer.indexOffset + indexSize + sizeof(ARCHIVE_TRAILER) != (uint64_t)fileSize)
+		return false;
+
+	index.resize(trailer.blockCount);
+	_fseeki64(archiveFile, (long long)trailer.indexOffset, SEEK_SET);
+	return fread(index.data(), sizeof(ARCHIVE_BLOCK_INDEX), index.size(), archiveFile) == index.size();
+}
+
+//walk the blocks of an archive that was never closed, stopping at the first damaged one
+bool session_archive_reader::rebuild_index()
+{
+	index.clear();
+
+	uint64_t offset = ARCHIVE_HEADER_SIZE;
+	ARCHIVE_BLOCK block;
+	while (true)
+	{
+		uint32_t blockHeader[2];
+		_fseeki64(archiveFile, (long long)offset, SEEK_SET);
+		if (fread(blockHeader, sizeof(uint32_t), 2, archiveFile) != 2)
+			break;
+
+		ARCHIVE_BLOCK_INDEX blockIndex;
+		memset(&blockIndex, 0, sizeof(blockIndex));
+		blockIndex.fileOffset = offset;
+		blockIndex.compressedSize = blockHeader[0];
+		blockIndex.rawSize = blockHeader[1];
+		if (!inflate_block(blockIndex, block.raw) || !parse_archive_block(block) || block.segments.empty())
+			break;
+
+		blockIndex.firstTimeMs = block.segments.front().header->timeMs;
+		blockIndex.lastTimeMs = block.segments.back().header->timeMs;
+		for (ARCHIVE_SEGMENT_VIEW &segment : block.segments)
+		{
+			blockIndex.segmentCount++;
+			blockIndex.messageCount += segment.header->messageCount;
+			blockIndex.streamMask |= 1ULL << (segment.header->streamID & 63);
+			for (int i = 0; i < segment.header->messageCount; ++i)
+				blockIndex.add_message(segment.header->streamType, segment.messages[i].msgID);
+		}
+
+		index.push_back(blockIndex);
+		offset += ARCHIVE_BLOCK_HEADER_SIZE + blockIndex.compressedSize;
+	}
+	return true;
+}
+
+bool session_archive_reader::open(std::string path)
+{
+	archiveFile = fopen(path.c_str(), "rb");
+	if (!archiveFile)
+		return false;
+
+	char magic[8];
+	uint32_t header[2];
+	if (fread(magic, 1, 8, archiveFile) != 8 || memcmp(magic, ARCHIVE_MAGIC, 8) != 0)
+		return false;
+	if (fread(header, sizeof(uint32_t), 2, archiveFile) != 2 || header[0] > ARCHIVE_VERSION)
+		return false;
+
+	//older archives have an index laid out differently, theirs is rebuilt
+	if (header[0] == ARCHIVE_VERSION && read_index())
+		return true;
+	recovered = header[0] == ARCHIVE_VERSION;
+	return rebuild_index();
+}
+
+bool session_archive_reader::read_block(size_t blockNumber, ARCHIVE_BLOCK &block)
+{
+	if (blockNumber >= index.size())
+		return false;
+	return inflate_block(index.at(blockNumber), block.raw) && parse_archive_block(block);
+}
+
+void session_archive_reader::copy_record(ARCHIVE_SEGMENT_VIEW &segment, ARCHIVE_MESSAGE &message,
+	std::vector<ARCHIVE_RECORD> &results)
+{
+	ARCHIVE_RECORD record;
+	record.segment = *segment.header;
+	record.message = message;
+
+	uint32_t end = message.end < segment.header->dataSize ? message.end : segment.header->dataSize;
+	if (message.start < end)
+		record.bytes.assign(segment.data + message.start, segment.data + end);
+	results.push_back(record);
+}
+
+size_t session_archive_reader::find_messages(uint8_t streamType, ushort msgID, int streamID, long long startMs, long long endMs,
+	std::vector<ARCHIVE_RECORD> &results)
+{
+	size_t found = 0;
+	ARCHIVE_BLOCK block;
+	for (size_t i = 0; i < index.size(); ++i)
+	{
+		if (!index[i].overlaps(startMs, endMs) || !index[i].has_msgID(streamType, msgID) ||
+			(streamID != -1 && !index[i].has_stream(streamID)))
+			continue;
+		if (!read_block(i, block))
+			continue;
+
+		for (ARCHIVE_SEGMENT_VIEW &segment : block.segments)
+		{
+			if (segment.header->streamType != streamType || (streamID != -1 && segment.header->streamID != streamID))
+				continue;
+			if (segment.header->timeMs < startMs || segment.header->timeMs > endMs)
+				continue;
+			for (int m = 0; m < segment.header->messageCount; ++m)
+			{
+				if (segment.messages[m].msgID != msgID)
+					continue;
+				copy_record(segment, segment.messages[m], results);
+				++found;
+			}
+		}
+	}
+	return found;
+}
+
+size_t session_archive_reader::read_time_range(long long startMs, long long endMs, std::vector<ARCHIVE_RECORD> &results)
+{
+	size_t found = 0;
+	ARCHIVE_BLOCK block;
+	for (size_t i = 0; i < index.size(); ++i)
+	{
+		if (!index[i].overlaps(startMs, endMs))
+			continue;
+		if (!read_block(i, block))
+			continue;
+
+		for (ARCHIVE_SEGMENT_VIEW &segment : block.segments)
+		{
+			if (segment.header->timeMs < startMs || segment.header->timeMs > endMs)
+				continue;
+			for (int m = 0; m < segment.header->messageCount; ++m)
+			{
+				copy_record(segment, segment.messages[m], results);
+				++found;
+			}
+		}
+	}
+	return found;
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include "base_thread.h"
+#include "uiMsg.h"
+#include <condition_variable>
+
+#define ARCHIVE_MAGIC "ESARCHV1"
+#define ARCHIVE_TRAILER_MAGIC 0x58415345 //ESAX
+#define ARCHIVE_VERSION 2
+
+//blocks are compressed once this much segment data is queued
+#define ARCHIVE_BLOCK_SIZE (256 * 1024)
+//or when they have been sitting around this long
+#define ARCHIVE_FLUSH_MS 5000
+//1 is the fastest deflate level, game data compresses well enough at it
+#define ARCHIVE_DEFLATE_LEVEL 1
+
+//covers every message ID sanityCheckPacketID allows
+#define ARCHIVE_MSGID_MASK_BYTES 72
+
+#define ARCHIVE_MSG_FAILED 1
+#define ARCHIVE_MSG_ABANDONED 2
+
+/*
+Decrypted segments are stored like this in the blocks, each header
+followed by its message boundaries then the segment data
+*/
+struct ARCHIVE_SEGMENT {
+	int64_t timeMs;
+	uint32_t pid;
+	int32_t streamID;
+	uint32_t dataSize;
+	uint16_t messageCount;
+	uint8_t streamType;
+	uint8_t incoming;
+};
+
+//offsets into the segment data
+struct ARCHIVE_MESSAGE {
+	uint16_t msgID;
+	uint16_t flags;
+	uint32_t start;
+	uint32_t end;
+};
+
+//what the footer index holds for each block, enough to skip blocks without reading them
+struct ARCHIVE_BLOCK_INDEX {
+	uint64_t fileOffset;
+	int64_t firstTimeMs;
+	int64_t lastTimeMs;
+	uint32_t compressedSize;
+	uint32_t rawSize;
+	uint32_t segmentCount;
+	uint32_t messageCount;
+	//bit streamID % 64 is set for each stream in the block
+	uint64_t streamMask;
+	//login and game servers reuse message IDs so they get a mask each
+	uint8_t gameMsgIDMask[ARCHIVE_MSGID_MASK_BYTES];
+	uint8_t loginMsgIDMask[ARCHIVE_MSGID_MASK_BYTES];
+
+	bool has_stream(int streamID) { return (streamMask >> (streamID & 63)) & 1; }
+	bool has_msgID(uint8_t streamType, ushort msgID) {
+		return msgID < ARCHIVE_MSGID_MASK_BYTES * 8 && (msgID_mask(streamType)[msgID / 8] >> (msgID % 8)) & 1;
+	}
+	bool overlaps(long long startMs, long long endMs) { return lastTimeMs >= startMs && firstTimeMs <= endMs; }
+	void add_message(uint8_t streamType, ushort msgID);
+	uint8_t *msgID_mask(uint8_t streamType) { return streamType == eLogin ? loginMsgIDMask : gameMsgIDMask; }
+};
+
+struct ARCHIVE_TRAILER {
+	uint64_t indexOffset;
+	uint32_t blockCount;
+	uint32_t magic;
+};
+
+/*
+Compressed archive of the decrypted session, with where each decoded message sits
+
+The file is a header, deflated blocks of segments then an index of the blocks
+at the end. A query only inflates the blocks the index says could hold what
+was asked for. If the session didn't end cleanly there is no index and the
+reader rebuilds it from the blocks.
+
+Segments are added from the processor thread, blocks are compressed
+and written on the archives own thread.
+*/
+class session_archive_writer :
+	public base_thread
+{
+public:
+	//false if the file can't be created
+	bool open(std::string path);
+	void add_segment(ARCHIVE_SEGMENT &segment, const byte *data, std::vector<ARCHIVE_MESSAGE> &messages);
+	//writes everything queued and the index, then closes the file
+	void stop();
+
+	size_t bytes_written() { return bytesWritten; }
+
+	bool running = true;
+	bool ded = false;
+
+private:
+	void main_loop();
+	void close_fill_block();
+	void write_block(std::vector<byte> &raw, ARCHIVE_BLOCK_INDEX &blockIndex);
+	void write_index();
+
+	FILE *archiveFile = NULL;
+	uint64_t fileOffset = 0;
+	std::vector<ARCHIVE_BLOCK_INDEX> index;
+
+	std::mutex blockMutex;
+	std::condition_variable blockReady;
+	std::vector<byte> fillBlock;
+	ARCHIVE_BLOCK_INDEX fillIndex;
+	unsigned long long fillStarted = 0;
+	//closed blocks waiting to be compressed
+	std::deque<std::pair<std::vector<byte>, ARCHIVE_BLOCK_INDEX> > fullBlocks;
+
+	std::atomic<size_t> bytesWritten{ 0 };
+};
+
+//a segment in an inflated block, pointing into the blocks data
+struct ARCHIVE_SEGMENT_VIEW {
+	ARCHIVE_SEGMENT *header;
+	ARCHIVE_MESSAGE *messages;
+	byte *data;
+};
+
+struct ARCHIVE_BLOCK {
+	std::vector<byte> raw;
+	std::vector<ARCHIVE_SEGMENT_VIEW> segments;
+};
+
+//a single message copied out of its segment
+struct ARCHIVE_RECORD {
+	ARCHIVE_SEGMENT segment;
+	ARCHIVE_MESSAGE message;
+	std::vector<byte> bytes;
+};
+
+class session_archive_reader
+{
+public:
+	~session_archive_reader() { if (archiveFile) fclose(archiveFile); }
+
+	//false if it isn't an archive
+	bool open(std::string path);
+	//true if the index was missing and had to be rebuilt
+	bool was_recovered() { return recovered; }
+
+	std::vector<ARCHIVE_BLOCK_INDEX> &blocks() { return index; }
+	bool read_block(size_t blockNumber, ARCHIVE_BLOCK &block);
+
+	//streamType is eGame or eLogin, streamID -1 for any stream
+	size_t find_messages(uint8_t streamType, ushort msgID, int streamID, long long startMs, long long endMs,
+		std::vector<ARCHIVE_RECORD> &results);
+	size_t read_time_range(long long startMs, long long endMs, std::vector<ARCHIVE_RECORD> &results);
+
+private:
+	bool read_index();
+	bool rebuild_index();
+	bool read_compressed(uint64_t offset, uint32_t size, std::vector<byte> &out);
+	bool inflate_block(ARCHIVE_BLOCK_INDEX &blockIndex, std::vector<byte> &raw);
+	void copy_record(ARCHIVE_SEGMENT_VIEW &segment, ARCHIVE_MESSAGE &message, std::vector<ARCHIVE_RECORD> &results);
+
+	FILE *archiveFile = NULL;
+	std::vector<ARCHIVE_BLOCK_INDEX> index;
+	std::vector<byte> compressed;
+	bool recovered = false;
+};
+
+//splits an inflated block into its segments, false if it doesn't parse
+bool parse_archive_block(ARCHIVE_BLOCK &block);
@@ -0,0 +1,345 @@
+#include "stdafx.h"
+#include "shm_feed.h"
+#include "feed_msgpack.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <ctime>
+#endif
+
+#define SHM_FEED_MAPPING_BYTES (sizeof(SHM_FEED_HEADER) + SHM_FEED_RING_BYTES)
+
+static uint64_t record_bytes(uint32_t length)
+{
+	return (sizeof(SHM_FEED_RECORD) + length + SHM_FEED_ALIGN - 1) & ~(uint64_t)(SHM_FEED_ALIGN - 1);
+}
+
+bool shm_feed_mapping::map(std::string name, bool create, std::string &error)
+{
+	mappedName = name;
+	creator = create;
+#ifdef _WIN32
+	std::string path = "Local\\" + name;
+	if (create)
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+			0, (DWORD)SHM_FEED_MAPPING_BYTES, path.c_str());
+	else
+		mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, path.c_str());
+	if (!mapping)
+	{
+		error = "Failed to " + std::string(create ? "create" : "open") + " shared memory " + path +
+			" error " + std::to_string(GetLastError());
+		return false;
+	}
+
+	std::string wakePath = path + "Wake";
+	wakeSemaphore = create ? CreateSemaphoreA(NULL, 0, LONG_MAX, wakePath.c_str()) :
+		OpenSemaphoreA(SYNCHRONIZE | SEMAPHORE_MODIFY_STATE, FALSE, wakePath.c_str());
+	if (!wakeSemaphore)
+	{
+		error = "Failed to open semaphore " + wakePath + " error " + std::to_string(GetLastError());
+		unmap();
+		return false;
+	}
+
+	void *view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, SHM_FEED_MAPPING_BYTES);
+#else
+	std::string path = "/" + name;
+	fd = shm_open(path.c_str(), create ? (O_CREAT | O_RDWR) : O_RDWR, 0600);
+	if (fd == -1 || (create && ftruncate(fd, SHM_FEED_MAPPING_BYTES) != 0))
+	{
+		error = "Failed to " + std::string(create ? "create" : "open") + " shared memory " + path +
+			" error " + std::to_string(errno);
+		unmap();
+		return false;
+	}
+
+	void *view = mmap(NULL, SHM_FEED_MAPPING_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (view == MAP_FAILED)
+		view = NULL;
+#endif
+	if (!view)
+	{
+		error = "Failed to map shared memory " + path;
+		unmap();
+		return false;
+	}
+
+	header = (SHM_FEED_HEADER *)view;
+	ring = (char *)view + sizeof(SHM_FEED_HEADER);
+	return true;
+}
+
+void shm_feed_mapping::unmap()
+{
+#ifdef _WIN32
+	if (header)
+		UnmapViewOfFile(header);
+	if (wakeSemaphore)
+		CloseHandle(wakeSemaphore);
+	if (mapping)
+		CloseHandle(mapping);
+	wakeSemaphore = mapping = NULL;
+#else
+	if (header)
+		munmap(header, SHM_FEED_MAPPING_BYTES);
+	//readers that still have it mapped keep it until they let go
+	if (creator && fd != -1)
+		shm_unlink(("/" + mappedName).c_str());
+	if (fd != -1)
+		close(fd);
+	fd = -1;
+#endif
+	header = NULL;
+	ring = NULL;
+}
+
+/*
+The writer bumps wakeCount then looks for sleepers, a reader counts itself
+a sleeper then looks at wakeCount and writePos. One of them always sees the
+other, so a reader never sleeps through a record and there are no system
+calls when nobody is waiting.
+*/
+void shm_feed_mapping::wake_sleepers()
+{
+	header->wakeCount.fetch_add(1);
+	unsigned int sleeping = header->sleepers.load();
+	if (!sleeping)
+		return;
+#ifdef _WIN32
+	ReleaseSemaphore(wakeSemaphore, sleeping, NULL);
+#else
+	syscall(SYS_futex, (uint32_t *)&header->wakeCount, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+bool shm_feed_mapping::sleep(uint64_t position, int ms)
+{
+	header->sleepers.fetch_add(1);
+	uint32_t seen = header->wakeCount.load();
+	bool ready = header->writePos.load() != position || !header->open.load();
+	if (!ready)
+	{
+#ifdef _WIN32
+		//a spare release from a reader that didn't need to sleep only makes a wake up early
+		ready = WaitForSingleObject(wakeSemaphore, ms) == WAIT_OBJECT_0;
+#else
+		timespec timeout;
+		timeout.tv_sec = ms / 1000;
+		timeout.tv_nsec = (ms % 1000) * 1000000L;
+		syscall(SYS_futex, (uint32_t *)&header->wakeCount, FUTEX_WAIT, seen, &timeout, NULL, 0);
+		ready = header->writePos.load() != position;
+#endif
+	}
+	header->sleepers.fetch_sub(1);
+	return ready;
+}
+
+bool shm_feed::open(std::string name, std::string subscriptionRequest, std::string &error)
+{
+	if (!subscriptionRequest.empty() && !subscription.load(subscriptionRequest, error))
+		return false;
+	subscription.format = FEED_FORMAT_MSGPACK;
+	//deltas come from the broker, this only has packets
+	subscription.deltaMs = 0;
+
+	if (!shared.map(name, true, error))
+		return false;
+	feedName = name;
+
+	SHM_FEED_HEADER *header = shared.header;
+	header->magic = 0;
+	header->version = SHM_FEED_VERSION;
+	header->ringBytes = SHM_FEED_RING_BYTES;
+	header->writePos.store(0);
+	header->reclaimPos.store(0);
+	header->open.store(1);
+	//readers check this first so it goes last
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = SHM_FEED_MAGIC;
+
+	UIaddLogMsg("Shared memory feed " + name + " open, " + std::to_string(SHM_FEED_RING_BYTES / 1024) + "KB ring", 0, uiMsgQueue);
+	return true;
+}
+
+void shm_feed::close()
+{
+	if (!shared.header)
+		return;
+
+	shared.header->open.store(0);
+	shared.wake_sleepers();
+	shared.unmap();
+
+	std::stringstream note;
+	note << "Shared memory feed " << feedName << " closed after " << published << " messages";
+	if (tooBig)
+		note << ", " << tooBig << " too big for the ring";
+	UIaddLogMsg(note.str(), 0, uiMsgQueue);
+}
+
+void shm_feed::publish(UIDecodedPkt *packet)
+{
+	if (!shared.header || !subscription.matches(*packet))
+		return;
+
+	frame.clear();
+	serialise_feed_msgpack(packet, subscription, frame);
+	//the record has its own length
+	write_record(frame.data() + 4, (uint32_t)(frame.size() - 4));
+}
+
+void shm_feed::write_record(const char *data, uint32_t length)
+{
+	SHM_FEED_HEADER *header = shared.header;
+	uint64_t size = record_bytes(length);
+	if (size > SHM_FEED_RING_BYTES / 2)
+	{
+		++tooBig;
+		return;
+	}
+
+	uint64_t position = header->writePos.load(std::memory_order_relaxed);
+	uint64_t offset = position % SHM_FEED_RING_BYTES;
+	uint64_t skip = offset + size > SHM_FEED_RING_BYTES ? SHM_FEED_RING_BYTES - offset : 0;
+	uint64_t end = position + skip + size;
+
+	//readers of anything about to be overwritten have to see this before the new bytes
+	if (end > SHM_FEED_RING_BYTES)
+	{
+		header->reclaimPos.store(end - SHM_FEED_RING_BYTES, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	if (skip >= sizeof(SHM_FEED_RECORD))
+	{
+		SHM_FEED_RECORD *skipRecord = (SHM_FEED_RECORD *)(shared.ring + offset);
+		skipRecord->sequence = sequence;
+		skipRecord->length = SHM_FEED_SKIP;
+	}
+
+	SHM_FEED_RECORD *record = (SHM_FEED_RECORD *)(shared.ring + (position + skip) % SHM_FEED_RING_BYTES);
+	record->sequence = sequence++;
+	record->length = length;
+	memcpy(record + 1, data, length);
+
+	header->writePos.store(end, std::memory_order_release);
+	shared.wake_sleepers();
+	++published;
+}
+
+bool shm_feed_reader::open(std::string name, std::string &error)
+{
+	if (!shared.map(name, false, error))
+		return false;
+
+	SHM_FEED_HEADER *header = shared.header;
+	if (header->magic != SHM_FEED_MAGIC || header->version != SHM_FEED_VERSION ||
+		header->ringBytes != SHM_FEED_RING_BYTES)
+	{
+		error = "Shared memory " + name + " isn't a version " + std::to_string(SHM_FEED_VERSION) + " feed";
+		shared.unmap();
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	header->readers.fetch_add(1);
+	position = header->writePos.load();
+	synced = false;
+	return true;
+}
+
+void shm_feed_reader::close()
+{
+	if (!shared.header)
+		return;
+	shared.header->readers.fetch_sub(1);
+	shared.unmap();
+}
+
+bool shm_feed_reader::read(std::vector<char> &out, int timeoutMS)
+{
+	if (!shared.header)
+		return false;
+
+	unsigned long long deadline = GetTickCount64() + timeoutMS;
+	while (true)
+	{
+		if (take_record(out))
+			return true;
+		if (feed_closed())
+			return false;
+
+		long long remaining = (long long)(deadline - GetTickCount64());
+		if (remaining <= 0)
+			return false;
+		shared.sleep(position, remaining < SHM_FEED_WAIT_MS ? (int)remaining : SHM_FEED_WAIT_MS);
+	}
+}
+
+/*
+Copies the record at position then checks the writer hadn't started
+reclaiming it in the meantime. If it had the copy may be torn, so it jumps
+to the newest record and counts the ones skipped when it next gets one.
+*/
+bool shm_feed_reader::take_record(std::vector<char> &out)
+{
+	SHM_FEED_HEADER *header = shared.header;
+	while (true)
+	{
+		uint64_t writePos = header->writePos.load(std::memory_order_acquire);
+		if (position == writePos)
+			return false;
+
+		if (header->reclaimPos.load(std::memory_order_relaxed) > position)
+		{
+			position = writePos;
+			continue;
+		}
+
+		uint64_t offset = position % SHM_FEED_RING_BYTES;
+		if (offset + sizeof(SHM_FEED_RECORD) > SHM_FEED_RING_BYTES)
+		{
+			position += SHM_FEED_RING_BYTES - offset;
+			continue;
+		}
+
+		SHM_FEED_RECORD record = *(SHM_FEED_RECORD *)(shared.ring + offset);
+		bool fits = record.length != SHM_FEED_SKIP && offset + record_bytes(record.length) <= SHM_FEED_RING_BYTES;
+		if (fits)
+			out.assign(shared.ring + offset + sizeof(SHM_FEED_RECORD),
+				shared.ring + offset + sizeof(SHM_FEED_RECORD) + record.length);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (header->reclaimPos.load(std::memory_order_relaxed) > position)
+		{
+			position = header->writePos.load(std::memory_order_acquire);
+			continue;
+		}
+
+		if (record.length == SHM_FEED_SKIP)
+		{
+			position += SHM_FEED_RING_BYTES - offset;
+			continue;
+		}
+		if (!fits)
+		{
+			//only a torn record can look like this and the check above rules that out
+			position = header->writePos.load(std::memory_order_acquire);
+			continue;
+		}
+
+		if (synced && record.sequence > expectedSequence)
+			lost += record.sequence - expectedSequence;
+		synced = true;
+		expectedSequence = record.sequence + 1;
+		position += record_bytes(record.length);
+		return true;
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "feed_broker.h"
+#include <atomic>
+
+/*
+The shared memory feed, for local readers like overlays that want packets
+as soon as they are decoded
+
+The decode thread writes each packet matching the feed's subscription as a
+MsgPack message (see feed_msgpack.h) straight into a ring in shared memory,
+with no queues or threads in between. Any number of readers can map it and
+follow along. Nothing waits for them, a reader that falls a whole ring
+behind finds it was overrun, skips to the newest message and is told how
+many it missed.
+
+The mapping is a SHM_FEED_HEADER then SHM_FEED_RING_BYTES of records, each a
+SHM_FEED_RECORD and the message padded to 8 bytes. Positions count bytes
+from the start and never wrap, the offset in the ring is pos % ringBytes.
+A record that doesn't fit before the end of the ring goes at the start,
+after a SHM_FEED_SKIP record if there is room for one.
+
+Windows: file mapping "Local\<name>", readers wait on semaphore "Local\<name>Wake"
+Linux: shm_open("/<name>"), readers wait on a futex on wakeCount
+*/
+#define SHM_FEED_MAGIC 0x53465345
+#define SHM_FEED_VERSION 1
+#define SHM_FEED_RING_BYTES (8 * 1024 * 1024)
+#define SHM_FEED_ALIGN 8
+#define SHM_FEED_SKIP 0xffffffff
+//readers look for the sniffer closing the feed at least this often
+#define SHM_FEED_WAIT_MS 100
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "shm feed needs lock free atomics to share them between processes");
+
+struct SHM_FEED_HEADER {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t ringBytes;
+	//0 once the sniffer has stopped writing
+	std::atomic<uint32_t> open;
+
+	//only the sniffer writes this line
+	alignas(64) std::atomic<uint64_t> writePos;
+	//anything before this may have been overwritten, readers check it after copying a record
+	std::atomic<uint64_t> reclaimPos;
+	//bumped after every record, the futex readers sleep on
+	std::atomic<uint32_t> wakeCount;
+
+	//the readers write this one
+	alignas(64) std::atomic<uint32_t> sleepers;
+	//readers that crash without closing stay counted
+	std::atomic<uint32_t> readers;
+};
+
+struct SHM_FEED_RECORD {
+	uint64_t sequence;
+	//bytes of message after this, or SHM_FEED_SKIP to go back to the start of the ring
+	uint32_t length;
+	uint32_t unused;
+};
+
+//the mapping and wake up object, shared by the writer and readers
+class shm_feed_mapping
+{
+public:
+	~shm_feed_mapping() { unmap(); }
+	bool map(std::string name, bool create, std::string &error);
+	void unmap();
+	void wake_sleepers();
+	//true unless nothing was published for ms
+	bool sleep(uint64_t position, int ms);
+
+	SHM_FEED_HEADER *header = NULL;
+	char *ring = NULL;
+
+private:
+	std::string mappedName;
+	bool creator = false;
+#ifdef _WIN32
+	HANDLE mapping = NULL;
+	HANDLE wakeSemaphore = NULL;
+#else
+	int fd = -1;
+#endif
+};
+
+/*
+Writes to the feed, only from the decode thread.
+Packets are published before they go on to the UI queue so this is the
+first place they appear.
+*/
+class shm_feed
+{
+public:
+	shm_feed(SafeQueue<UI_MESSAGE *> *uiq) : uiMsgQueue(uiq) {}
+	~shm_feed() { close(); }
+
+	//subscription is the same json the other feeds take, the format is always MsgPack
+	bool open(std::string name, std::string subscriptionRequest, std::string &error);
+	void close();
+	void publish(UIDecodedPkt *packet);
+	unsigned int reader_count() { return shared.header ? shared.header->readers.load() : 0; }
+
+private:
+	void write_record(const char *data, uint32_t length);
+
+	shm_feed_mapping shared;
+	std::string feedName;
+	FEED_SUBSCRIPTION subscription;
+	uint64_t sequence = 0;
+	std::vector<char> frame;
+	unsigned long long published = 0;
+	unsigned long long tooBig = 0;
+
+	SafeQueue<UI_MESSAGE *> *uiMsgQueue;
+};
+
+//follows the feed from another thread or process
+class shm_feed_reader
+{
+public:
+	~shm_feed_reader() { close(); }
+	//starts with the next message published
+	bool open(std::string name, std::string &error);
+	void close();
+	//puts the next message in out, false if nothing came within timeoutMS or the feed closed
+	bool read(std::vector<char> &out, int timeoutMS);
+	bool feed_closed() { return !shared.header || !shared.header->open.load(); }
+
+	//messages overwritten before they were read
+	unsigned long long lost = 0;
+
+private:
+	bool take_record(std::vector<char> &out);
+
+	shm_feed_mapping shared;
+	uint64_t position = 0;
+	//unknown until the first record
+	bool synced = false;
+	uint64_t expectedSequence = 0;
+};
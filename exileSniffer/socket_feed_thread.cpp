@@ -0,0 +1,507 @@
+#include "stdafx.h"
+#include "socket_feed_thread.h"
+
+#ifdef _WIN32
+#define FEED_BAD_SOCKET INVALID_SOCKET
+#define FEED_SEND_FLAGS 0
+static void close_socket(feed_socket fd) { closesocket(fd); }
+static int socket_error() { return WSAGetLastError(); }
+static bool would_block() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static bool set_nonblocking(feed_socket fd)
+{
+	u_long on = 1;
+	return ioctlsocket(fd, FIONBIO, &on) == 0;
+}
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define FEED_BAD_SOCKET (-1)
+//a subscriber leaving mid-send shouldn't kill us with SIGPIPE
+#define FEED_SEND_FLAGS MSG_NOSIGNAL
+static void close_socket(feed_socket fd) { close(fd); }
+static int socket_error() { return errno; }
+static bool would_block() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+static bool set_nonblocking(feed_socket fd)
+{
+	int flags = fcntl(fd, F_GETFL, 0);
+	return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+#define POLL_READ 1
+#define POLL_WRITE 2
+
+/*
+Just enough of epoll for the feed, with WSAPoll standing in on Windows
+
+Sockets are added with a tag that comes back when they are ready, they are
+always watched for reading and for writing only when asked.
+*/
+class feed_poller
+{
+public:
+	feed_poller();
+	~feed_poller();
+
+	bool ok();
+	void add(feed_socket fd, void *tag);
+	void want_write(feed_socket fd, void *tag, bool write);
+	void remove(feed_socket fd);
+	//ends a wait early, can be called from any thread
+	void wake();
+	//fills ready with the tags and POLL_ flags of the sockets that are ready
+	void wait(int timeoutMS, std::vector<std::pair<void *, int> > &ready);
+
+private:
+#ifdef _WIN32
+	std::vector<WSAPOLLFD> fds;
+	std::vector<void *> tags;
+#else
+	int epollFD = -1;
+	int wakeFD = -1;
+	std::vector<epoll_event> events;
+#endif
+};
+
+#ifdef _WIN32
+feed_poller::feed_poller() {}
+feed_poller::~feed_poller() {}
+bool feed_poller::ok() { return true; }
+
+void feed_poller::add(feed_socket fd, void *tag)
+{
+	WSAPOLLFD pollFD;
+	pollFD.fd = fd;
+	pollFD.events = POLLRDNORM;
+	pollFD.revents = 0;
+	fds.push_back(pollFD);
+	tags.push_back(tag);
+}
+
+void feed_poller::want_write(feed_socket fd, void *tag, bool write)
+{
+	for (WSAPOLLFD &pollFD : fds)
+		if (pollFD.fd == fd)
+			pollFD.events = write ? (POLLRDNORM | POLLWRNORM) : POLLRDNORM;
+}
+
+void feed_poller::remove(feed_socket fd)
+{
+	for (size_t i = 0; i < fds.size(); ++i)
+	{
+		if (fds[i].fd == fd)
+		{
+			fds.erase(fds.begin() + i);
+			tags.erase(tags.begin() + i);
+			return;
+		}
+	}
+}
+
+//nothing to do, the wait is short enough
+void feed_poller::wake() {}
+
+void feed_poller::wait(int timeoutMS, std::vector<std::pair<void *, int> > &ready)
+{
+	if (WSAPoll(fds.data(), (ULONG)fds.size(), timeoutMS) <= 0)
+		return;
+
+	for (size_t i = 0; i < fds.size(); ++i)
+	{
+		int flags = 0;
+		//hangups and errors show up as reads that fail
+		if (fds[i].revents & (POLLRDNORM | POLLHUP | POLLERR))
+			flags |= POLL_READ;
+		if (fds[i].revents & POLLWRNORM)
+			flags |= POLL_WRITE;
+		if (flags)
+			ready.push_back(std::make_pair(tags[i], flags));
+	}
+}
+#else
+feed_poller::feed_poller()
+{
+	epollFD = epoll_create1(EPOLL_CLOEXEC);
+	wakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (epollFD != -1 && wakeFD != -1)
+	{
+		epoll_event event;
+		event.events = EPOLLIN;
+		event.data.ptr = &wakeFD;
+		epoll_ctl(epollFD, EPOLL_CTL_ADD, wakeFD, &event);
+	}
+	events.resize(SOCKET_FEED_MAX_SUBSCRIBERS + 2);
+}
+
+feed_poller::~feed_poller()
+{
+	if (wakeFD != -1)
+		close(wakeFD);
+	if (epollFD != -1)
+		close(epollFD);
+}
+
+bool feed_poller::ok() { return epollFD != -1 && wakeFD != -1; }
+
+void feed_poller::add(feed_socket fd, void *tag)
+{
+	epoll_event event;
+	event.events = EPOLLIN;
+	event.data.ptr = tag;
+	epoll_ctl(epollFD, EPOLL_CTL_ADD, fd, &event);
+}
+
+void feed_poller::want_write(feed_socket fd, void *tag, bool write)
+{
+	epoll_event event;
+	event.events = write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+	event.data.ptr = tag;
+	epoll_ctl(epollFD, EPOLL_CTL_MOD, fd, &event);
+}
+
+void feed_poller::remove(feed_socket fd)
+{
+	epoll_event ignored;
+	epoll_ctl(epollFD, EPOLL_CTL_DEL, fd, &ignored);
+}
+
+void feed_poller::wake()
+{
+	uint64_t one = 1;
+	ssize_t ignored = write(wakeFD, &one, sizeof(one));
+	(void)ignored;
+}
+
+void feed_poller::wait(int timeoutMS, std::vector<std::pair<void *, int> > &ready)
+{
+	int count = epoll_wait(epollFD, events.data(), (int)events.size(), timeoutMS);
+	for (int i = 0; i < count; ++i)
+	{
+		if (events[i].data.ptr == &wakeFD)
+		{
+			uint64_t wakes;
+			ssize_t ignored = read(wakeFD, &wakes, sizeof(wakes));
+			(void)ignored;
+			continue;
+		}
+
+		int flags = 0;
+		//hangups and errors show up as reads that fail
+		if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+			flags |= POLL_READ;
+		if (events[i].events & EPOLLOUT)
+			flags |= POLL_WRITE;
+		void *tag = events[i].data.ptr;
+		ready.push_back(std::make_pair(tag, flags));
+	}
+}
+#endif
+
+bool FEED_ENDPOINT::parse(std::string spec, std::string &error)
+{
+	if (spec.compare(0, 4, "tcp:") == 0)
+	{
+		unixSocket = false;
+		port = atoi(spec.c_str() + 4);
+		if (port < 1 || port > 65535)
+		{
+			error = "bad TCP port in " + spec;
+			return false;
+		}
+		return true;
+	}
+
+	if (spec.compare(0, 5, "unix:") == 0)
+	{
+#ifdef _WIN32
+		error = "unix sockets aren't supported here, use tcp:port";
+		return false;
+#else
+		unixSocket = true;
+		path = spec.substr(5);
+		if (path.empty() || path.size() >= sizeof(((sockaddr_un *)0)->sun_path))
+		{
+			error = "bad unix socket path in " + spec;
+			return false;
+		}
+		return true;
+#endif
+	}
+
+	error = "feed endpoints look like tcp:port or unix:/path, not " + spec;
+	return false;
+}
+
+std::string FEED_ENDPOINT::describe()
+{
+	if (unixSocket)
+		return path;
+	return "127.0.0.1:" + std::to_string(port);
+}
+
+socket_feed_thread::socket_feed_thread(SafeQueue<UI_MESSAGE *> *uiq, feed_broker *feedBroker, FEED_ENDPOINT where)
+{
+	uiMsgQueue = uiq;
+	broker = feedBroker;
+	endpoint = where;
+	listener = FEED_BAD_SOCKET;
+#ifdef _WIN32
+	WSADATA wsaData;
+	WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+	poller = std::make_shared<feed_poller>();
+}
+
+socket_feed_thread::~socket_feed_thread()
+{
+	running = false;
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+void socket_feed_thread::main_loop()
+{
+	if (!poller->ok() || !open_listener())
+	{
+		running = false;
+		ded = true;
+		return;
+	}
+	UIaddLogMsg("Feed listening on " + endpoint.describe(), 0, uiMsgQueue);
+
+	std::vector<std::pair<void *, int> > ready;
+	while (running)
+	{
+		ready.clear();
+		poller->wait(SOCKET_FEED_POLL_MS, ready);
+
+		for (auto &event : ready)
+		{
+			if (!event.first)
+			{
+				accept_clients();
+				continue;
+			}
+
+			SOCKET_CLIENT *client = (SOCKET_CLIENT *)event.first;
+			if (client->gone)
+				continue;
+			if ((event.second & POLL_READ) && !read_client(*client))
+				client->gone = true;
+			if (event.second & POLL_WRITE)
+				client->waitingToWrite = false;
+		}
+
+		unsigned long long now = GetTickCount64();
+		for (auto &client : clients)
+		{
+			if (client->gone)
+				continue;
+			if (!client->subscriber)
+			{
+				//old subscribers never send anything and get the lot
+				if (now - client->connectedAt < FEED_SUBSCRIBE_WAIT_MS)
+					continue;
+				subscribe(*client);
+			}
+			if (!client->waitingToWrite && !flush_client(*client))
+				client->gone = true;
+		}
+
+		for (size_t i = clients.size(); i-- > 0;)
+			if (clients[i]->gone)
+				drop_client(i);
+	}
+
+	while (!clients.empty())
+		drop_client(clients.size() - 1);
+	close_listener();
+	ded = true;
+}
+
+bool socket_feed_thread::open_listener()
+{
+	std::stringstream err;
+#ifndef _WIN32
+	if (endpoint.unixSocket)
+	{
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, endpoint.path.c_str(), sizeof(address.sun_path) - 1);
+		//left over from a run that didn't end cleanly
+		unlink(endpoint.path.c_str());
+
+		listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener != FEED_BAD_SOCKET &&
+			bind(listener, (sockaddr *)&address, sizeof(address)) == 0 &&
+			listen(listener, SOMAXCONN) == 0 &&
+			set_nonblocking(listener))
+		{
+			poller->add(listener, NULL);
+			return true;
+		}
+	}
+	else
+#endif
+	{
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons((unsigned short)endpoint.port);
+		//never anything but loopback, there is no authentication
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		int on = 1;
+		if (listener != FEED_BAD_SOCKET &&
+			setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char *)&on, sizeof(on)) == 0 &&
+			bind(listener, (sockaddr *)&address, sizeof(address)) == 0 &&
+			listen(listener, SOMAXCONN) == 0 &&
+			set_nonblocking(listener))
+		{
+			poller->add(listener, NULL);
+			return true;
+		}
+	}
+
+	err << "Feed failed to listen on " << endpoint.describe() << " error " << socket_error();
+	UIaddLogMsg(err.str(), 0, uiMsgQueue);
+	close_listener();
+	return false;
+}
+
+void socket_feed_thread::close_listener()
+{
+	if (listener == FEED_BAD_SOCKET)
+		return;
+
+	poller->remove(listener);
+	close_socket(listener);
+	listener = FEED_BAD_SOCKET;
+#ifndef _WIN32
+	if (endpoint.unixSocket)
+		unlink(endpoint.path.c_str());
+#endif
+}
+
+void socket_feed_thread::accept_clients()
+{
+	while (true)
+	{
+		feed_socket fd = accept(listener, NULL, NULL);
+		if (fd == FEED_BAD_SOCKET)
+			return;
+
+		if (clients.size() >= SOCKET_FEED_MAX_SUBSCRIBERS || !set_nonblocking(fd))
+		{
+			close_socket(fd);
+			continue;
+		}
+
+		int sendBuffer = SOCKET_FEED_SEND_BUFFER;
+		setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (const char *)&sendBuffer, sizeof(sendBuffer));
+		if (!endpoint.unixSocket)
+		{
+			int on = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+		}
+
+		std::unique_ptr<SOCKET_CLIENT> client(new SOCKET_CLIENT);
+		client->fd = fd;
+		client->connectedAt = GetTickCount64();
+		client->writing.reserve(SOCKET_FEED_BATCH_BYTES * 2);
+		poller->add(fd, client.get());
+		clients.push_back(std::move(client));
+	}
+}
+
+bool socket_feed_thread::read_client(SOCKET_CLIENT &client)
+{
+	char readBuf[4096];
+	while (true)
+	{
+		int readBytes = recv(client.fd, readBuf, sizeof(readBuf), 0);
+		if (readBytes == 0)
+			return false;
+		if (readBytes < 0)
+			return would_block();
+
+		//anything after the request is ignored
+		if (client.subscriber)
+			continue;
+
+		client.request.append(readBuf, readBytes);
+		if (client.request.find('\n') != std::string::npos || client.request.size() >= FEED_REQUEST_MAX)
+			subscribe(client);
+	}
+}
+
+void socket_feed_thread::subscribe(SOCKET_CLIENT &client)
+{
+	std::stringstream name;
+	name << (endpoint.unixSocket ? "Unix" : "TCP") << " Subscriber " << ++subscriberCount;
+
+	std::shared_ptr<feed_poller> wakePoller = poller;
+	client.subscriber = broker->subscribe(client.request, name.str(), true, [wakePoller] { wakePoller->wake(); });
+	client.request.clear();
+	client.request.shrink_to_fit();
+}
+
+bool socket_feed_thread::flush_client(SOCKET_CLIENT &client)
+{
+	while (true)
+	{
+		if (client.written == client.writing.size())
+		{
+			client.writing.clear();
+			client.written = 0;
+			if (!client.subscriber->take(client.writing, SOCKET_FEED_BATCH_BYTES))
+			{
+				if (client.watchingWrite)
+				{
+					poller->want_write(client.fd, &client, false);
+					client.watchingWrite = false;
+				}
+				return true;
+			}
+		}
+
+		int sentBytes = send(client.fd, client.writing.data() + client.written,
+			(int)(client.writing.size() - client.written), FEED_SEND_FLAGS);
+		if (sentBytes > 0)
+		{
+			client.written += sentBytes;
+			continue;
+		}
+
+		if (sentBytes < 0 && would_block())
+		{
+			if (!client.watchingWrite)
+			{
+				poller->want_write(client.fd, &client, true);
+				client.watchingWrite = true;
+			}
+			client.waitingToWrite = true;
+			return true;
+		}
+		return false;
+	}
+}
+
+void socket_feed_thread::drop_client(size_t index)
+{
+	SOCKET_CLIENT &client = *clients[index];
+	poller->remove(client.fd);
+	close_socket(client.fd);
+	if (client.subscriber)
+		broker->remove_subscriber(client.subscriber);
+	clients.erase(clients.begin() + index);
+}
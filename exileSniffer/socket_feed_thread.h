@@ -0,0 +1,90 @@
+#pragma once
+#include "base_thread.h"
+#include "feed_broker.h"
+
+//a send stops taking lines off the subscribers queue once it is this big
+#define SOCKET_FEED_BATCH_BYTES (256 * 1024)
+#define SOCKET_FEED_SEND_BUFFER (4 * 1024 * 1024)
+#define SOCKET_FEED_MAX_SUBSCRIBERS 64
+#ifdef _WIN32
+//WSAPoll can't be woken by the broker so it has to look often
+#define SOCKET_FEED_POLL_MS 5
+#else
+//the broker wakes epoll when it has something to send
+#define SOCKET_FEED_POLL_MS 50
+#endif
+
+#ifdef _WIN32
+typedef SOCKET feed_socket;
+#else
+typedef int feed_socket;
+#endif
+
+//"tcp:port" to listen on 127.0.0.1 or "unix:/path/to/socket"
+struct FEED_ENDPOINT {
+	bool unixSocket = false;
+	int port = 0;
+	std::string path;
+
+	//false with the reason in error if it can't be used here
+	bool parse(std::string spec, std::string &error);
+	std::string describe();
+};
+
+struct SOCKET_CLIENT {
+	feed_socket fd;
+	//what it sent before it was subscribed
+	std::string request;
+	unsigned long long connectedAt = 0;
+	std::vector<char> writing;
+	size_t written = 0;
+	//the socket was full, waiting for the poller to say there is room
+	bool waitingToWrite = false;
+	bool watchingWrite = false;
+	bool gone = false;
+	std::shared_ptr<feed_subscriber> subscriber;
+};
+
+class feed_poller;
+
+/*
+Feeds decoded packets to subscribers on a unix domain socket or a
+127.0.0.1 TCP port, a line of UTF-8 json each
+
+Subscriptions work the same as on the named pipe. Everything is non-blocking
+on this one thread, which waits in epoll (WSAPoll on Windows) for new
+subscribers, their requests, the broker having lines for them and full
+sockets having room again. Lines for a subscriber with a full socket wait
+on its queue in the broker.
+*/
+class socket_feed_thread :
+	public base_thread
+{
+public:
+	socket_feed_thread(SafeQueue<UI_MESSAGE *> *uiq, feed_broker *feedBroker, FEED_ENDPOINT where);
+	~socket_feed_thread();
+
+	bool running = true;
+	bool ded = false;
+
+private:
+	void main_loop();
+	bool open_listener();
+	void close_listener();
+	void accept_clients();
+	//false if the subscriber has gone
+	bool read_client(SOCKET_CLIENT &client);
+	void subscribe(SOCKET_CLIENT &client);
+	bool flush_client(SOCKET_CLIENT &client);
+	void drop_client(size_t index);
+
+	FEED_ENDPOINT endpoint;
+	feed_socket listener;
+	//shared with the subscribers wake ups, which can outlive this
+	std::shared_ptr<feed_poller> poller;
+	unsigned int subscriberCount = 0;
+	std::vector<std::unique_ptr<SOCKET_CLIENT> > clients;
+
+	SafeQueue<UI_MESSAGE *> *uiMsgQueue;
+	feed_broker *broker;
+};
@@ -11,16 +11,25 @@ rapidjson for ggpk data
 #define TINS_STATIC
 #include "tins/tins.h"
 #include "tins/tcp_ip/stream_follower.h"
+#ifdef _MSC_VER
 #pragma comment(lib, "tins.lib")
 #pragma comment(lib, "Ws2_32.lib")
 #pragma comment(lib, "Iphlpapi.lib")
 #pragma comment(lib, "wpcap.lib")
+#endif
 
+#ifdef _WIN32
 #include <Windows.h>
 #include <WinSock2.h>
+#else
+#include "platform.h"
+#endif
 
+//the decode core builds without Qt for the command line tool
+#ifdef QT_WIDGETS_LIB
 //learned the hard way - this needs to come after the libtins stuff
 #include <QtWidgets> 
+#endif
 
 //#define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 
@@ -29,7 +38,9 @@ rapidjson for ggpk data
 #include <stdlib.h>
 #include <malloc.h>
 #include <memory.h>
+#ifdef _WIN32
 #include <tchar.h>
+#endif
 #include <string>
 #include <locale>
 #include <codecvt>
@@ -42,9 +53,9 @@ rapidjson for ggpk data
 #include <queue>
 #include <deque>
 
-#include "rapidjson\document.h"
-#include "rapidjson\filereadstream.h" 
-#include "rapidjson\allocators.h"
+#include "rapidjson/document.h"
+#include "rapidjson/filereadstream.h" 
+#include "rapidjson/allocators.h"
 
 #include "cryptlib.h"
 #include "salsa.h"
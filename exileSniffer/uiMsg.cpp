@@ -1,14 +1,14 @@
 #include "stdafx.h"
 #include "uiMsg.h"
 #include "utilities.h"
-#include "rapidjson\stringbuffer.h"
-#include "rapidjson\writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 
 //used to add packet name data when sending to json feed subscribers
 rapidjson::GenericValue<rapidjson::UTF8<>> *UIDecodedPkt::loginMessageTypes = NULL;
 rapidjson::GenericValue<rapidjson::UTF8<>> *UIDecodedPkt::gameMessageTypes = NULL;
 
-void UIaddLogMsg(QString msg, DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQueue)
+void UIaddLogMsg(std::string msg, DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQueue)
 {
 	UI_METALOG_MSG *initmsg = new UI_METALOG_MSG;
 	initmsg->msgType = uiMsgType::eMetaLog;
@@ -17,14 +17,16 @@ void UIaddLogMsg(QString msg, DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQue
 	uiMsgQueue->addItem(initmsg);
 }
 
-void UIaddLogMsg(std::string msg, DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQueue)
+#ifdef QT_CORE_LIB
+void UIaddLogMsg(QString msg, DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQueue)
 {
-	UIaddLogMsg(QString::fromStdString(msg), clientPID, uiMsgQueue);
+	UIaddLogMsg(msg.toStdString(), clientPID, uiMsgQueue);
 }
+#endif
 
 void UIaddLogMsg(const char* msg, DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQueue)
 {
-	UIaddLogMsg(QString(msg), clientPID, uiMsgQueue);
+	UIaddLogMsg(std::string(msg), clientPID, uiMsgQueue);
 }
 
 void UIrecordLogin(DWORD clientPID,  SafeQueue<UI_MESSAGE *> *uiMsgQueue)
@@ -35,7 +37,7 @@ void UIrecordLogin(DWORD clientPID,  SafeQueue<UI_MESSAGE *> *uiMsgQueue)
 	uiMsgQueue->addItem(loginmsg);
 }
 
-void UIsniffingStarted(QString iface, SafeQueue<UI_MESSAGE *> *uiMsgQueue)
+void UIsniffingStarted(std::string iface, SafeQueue<UI_MESSAGE *> *uiMsgQueue)
 {
 	UI_SNIFF_NOTE *sniffmsg = new UI_SNIFF_NOTE;
 	sniffmsg->msgType = uiMsgType::eSniffingStarted;
@@ -321,6 +323,29 @@ void UIDecodedPkt::set_validate_MessageID(ushort msgID, SafeQueue<UI_MESSAGE *>
 	}
 }
 
+void UIDecodedPkt::restore(ushort msgID, bool failed, bool wasAbandoned)
+{
+	if (!jsn.IsObject())
+		jsn.SetObject();
+
+	auto payloadIt = jsn.FindMember(L"Payload");
+	if (payloadIt == jsn.MemberEnd())
+	{
+		jsn.AddMember(L"Payload", WValue(rapidjson::kObjectType), jsn.GetAllocator());
+		payloadIt = jsn.FindMember(L"Payload");
+	}
+	payload = &payloadIt->value;
+
+	messageID = msgID;
+	failedDecode = failed;
+	abandoned = wasAbandoned;
+
+	//the decrypted buffer it came from is long gone
+	originalbuf = &pktBytes;
+	origBufferOffset = 0;
+}
+
+#ifdef QT_CORE_LIB
 QString UIDecodedPkt::senderString()
 {
 	if (!incoming) return "[" + QString::number(nwkstreamID) + "] Client";
@@ -328,6 +353,7 @@ QString UIDecodedPkt::senderString()
 	if (streamServer == eLogin) return "[" + QString::number(nwkstreamID) + "] LoginServer";
 	return "sender() Error";
 }
+#endif
 
 //move the decrypted bytes to this packets own buffer
 void UIDecodedPkt::setEndOffset(unsigned short endoffset)
@@ -17,7 +17,7 @@ public:
 class UI_METALOG_MSG : public UI_MESSAGE
 {
 public:
-	QString stringData;
+	std::string stringData;
 	DWORD pid;
 };
 
@@ -49,7 +49,7 @@ public:
 class UI_SNIFF_NOTE : public UI_MESSAGE
 {
 public:
-	QString iface;
+	std::string iface;
 	bool state;
 };
 
@@ -121,24 +121,31 @@ public:
 	void setEndOffset(unsigned short off);
 	void setFailedDecode() { failedDecode = true; }
 	void setAbandoned() { abandoned = true; }
-	void setFiltered() { filtered = true; }
 	bool decodeError() { return failedDecode; }
 	bool wasAbandoned() { return abandoned; }
+	//reloaded from a session archive rather than seen live
+	void setFromArchive() { archived = true; }
+	bool fromArchive() { return archived; }
 	DWORD getClientProcessID() { return PID; }
 	int getStreamID() { return nwkstreamID; }
 	void set_validate_MessageID(ushort msgID, SafeQueue<UI_MESSAGE *> *uiMsgQueue);
+	//refill a packet from what decodedListModel kept of it, pktBytes and jsn must be set first
+	void restore(ushort msgID, bool failed, bool wasAbandoned);
 	streamType getStreamType() { return streamServer; }
 	bool isIncoming() { return incoming; }
 
 	long long time_processed_ms() { return msTime; }
+	ushort getMessageID() { return messageID; }
+
+#ifdef QT_CORE_LIB
 	QString dayMonTime() { return QString::fromStdWString(epochms_to_timestring(msTime)); }
 	QString floatSeconds(long long start) { return QString::number((msTime - start) / 1000.0, 'd', 4); }
 
-	ushort getMessageID() { return messageID; }
 	QString hexPktID() { return "0x" + QString::number(messageID, 16); }
 	QString decPktID() { return QString::number(messageID); }
 
 	QString senderString();
+#endif
 
 	static rapidjson::GenericValue<rapidjson::UTF8<>> *loginMessageTypes;
 	static rapidjson::GenericValue<rapidjson::UTF8<>> *gameMessageTypes;
@@ -153,9 +160,10 @@ public:
 	rapidjson::GenericDocument<rapidjson::UTF16<>, rapidjson::CrtAllocator> jsn;
 	WValue* payload = NULL;
 
+#ifdef QT_CORE_LIB
 	QString summary;
 	QString fulltext;
-	bool filtered = false;
+#endif
 
 private:
 	ushort messageID;
@@ -164,16 +172,19 @@ private:
 	bool incoming;
 	bool failedDecode = false;
 	bool abandoned = false;
+	bool archived = false;
 	bool payloadOperations = false;
 	long long msTime;
 };
 
+#ifdef QT_CORE_LIB
 Q_DECLARE_METATYPE(UIDecodedPkt *);
-
 void UIaddLogMsg(QString msg, DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQueue);
+#endif
+
 void UIaddLogMsg(std::string msg, DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQueue);
 void UIaddLogMsg(const char* msg, DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQueue);
-void UIsniffingStarted(QString iface, SafeQueue<UI_MESSAGE *> *uiMsgQueue);
+void UIsniffingStarted(std::string iface, SafeQueue<UI_MESSAGE *> *uiMsgQueue);
 void UInotifyClientRunning(DWORD clientPID, bool running, int activeClients, 
 	int scanningClients, SafeQueue<UI_MESSAGE *> *uiMsgQueue);
 void UIrecordLogin(DWORD clientPID, SafeQueue<UI_MESSAGE *> *uiMsgQueue);
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "utilities.h"
+#include "hex_dump.h"
 
 
 std::string timestamp()
@@ -29,13 +30,19 @@ UINT16 getUshort(void *ptr)
 	return *(UINT16*)(ptr);
 }
 
+//wchar_t is 4 bytes outside windows so build it a code unit at a time
 std::wstring mb_to_utf8(std::string utf16_string)
 {
-	int size = utf16_string.size();
-	std::wstring url1(reinterpret_cast<wchar_t*>((byte *)utf16_string.data()), (size) / sizeof(wchar_t));
+	size_t units = utf16_string.size() / 2;
+	const byte *data = (const byte *)utf16_string.data();
+
+	std::wstring url1(units, 0);
+	for (size_t i = 0; i < units; ++i)
+		url1[i] = (wchar_t)(data[i * 2] | (data[i * 2 + 1] << 8));
 	return url1;
 }
 
+#ifdef _WIN32
 HANDLE connectPipe(std::wstring pipename)
 {
 	const wchar_t* szName = pipename.c_str();
@@ -138,6 +145,7 @@ bool checkPipe(HANDLE pipe, std::deque< std::vector<byte>> *pktQueue)
 		pktQueue->push_back(pkt);
 	}
 }
+#endif
 
 std::wstring epochms_to_timestring(long long epochms)
 {
@@ -175,21 +183,14 @@ std::wstring IPToString(DWORD ip)
 	return res.str();
 }
 
-
-QString byteVecToHex(std::vector<byte> data)
+#ifdef QT_CORE_LIB
+QString byteVecToHex(const std::vector<byte> &data)
 {
-	std::stringstream hexss;
-	hexss << std::setfill('0') << std::uppercase;
-	for (int i = 0; i < data.size(); ++i)
-	{
-		byte item = data.at(i);
-		if (item)
-			hexss << " " << std::hex << std::setw(2) << (int)item;
-		else
-			hexss << " 00";
-	}
-	return QString::fromStdString(hexss.str());
+	QString hex((int)data.size() * 3, ' ');
+	write_hex_spaced(data.data(), data.size(), (ushort *)hex.data());
+	return hex;
 }
+#endif
 
 //dirty dirty code. requires changing the crypto++ headers to unprotect the m_state object
 std::vector<byte> extract_Iter_from_salsaObj(CryptoPP::Salsa20::Encryption& keyblob)
@@ -209,7 +210,9 @@ std::vector<byte> extract_Iter_from_salsaObj(CryptoPP::Salsa20::Encryption& keyb
 	return iv;
 }
 
+#ifdef QT_CORE_LIB
 QString msToQStringSeconds(long long start, long long eventTime)
 { 
 	return QString::number((eventTime - start) / 1000.0, 'd', 4); 
 }
+#endif
@@ -11,14 +11,19 @@ UINT32 getUlong(void *ptr);
 UINT16 getUshort(void *ptr);
 
 std::wstring mb_to_utf8(std::string utf16_string);
+#ifdef _WIN32
 HANDLE connectPipe(std::wstring pipename);
 bool checkPipe(HANDLE pipe, std::deque< std::vector<byte>> *pktQueue);
+#endif
 
 std::wstring epochms_to_timestring(long long epochms);
 long long ms_since_epoch();
-QString msToQStringSeconds(long long start, long long eventTime);
 
 std::wstring IPToString(DWORD ip);
 
-QString byteVecToHex(std::vector<byte> data);
-std::vector<byte> extract_Iter_from_salsaObj(CryptoPP::Salsa20::Encryption& keyblob);
\ No newline at end of file
+std::vector<byte> extract_Iter_from_salsaObj(CryptoPP::Salsa20::Encryption& keyblob);
+
+#ifdef QT_CORE_LIB
+QString msToQStringSeconds(long long start, long long eventTime);
+QString byteVecToHex(const std::vector<byte> &data);
+#endif
\ No newline at end of file
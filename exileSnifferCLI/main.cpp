@@ -0,0 +1,467 @@
+/*
+Headless exileSniffer
+
+Replays a packet capture through the decode core using keys from a key file
+and writes every decoded message as a line of JSON.
+
+usage: exileSnifferCLI capture.pcap [keys.txt] [-o decoded.jsonl] [-b] [-a session.esa] [-f tcp:port|unix:/path] [-r shmName]
+       exileSnifferCLI session.esa [-m msgID [-l]] [-s streamID] [-t startMs endMs] [-o messages.jsonl]
+       exileSnifferCLI session.esa -d [-o decoded.jsonl] [-b]
+
+The key file can be the *_keys.txt log the GUI writes next to its hex logs.
+Without one the keys are read from the capture, which works for the
+*_capture.pcapng recordings the GUI makes with RecordCapture set.
+-b writes the binary feed format (see feed_msgpack.h) instead of json lines,
+the "ESFD" header then a length prefixed MessagePack map per message.
+-a also writes a session archive of the decrypted data.
+-f serves the decoded messages to subscribers like the GUI's pipe feed, on
+a 127.0.0.1 TCP port or a unix domain socket, and can be given more than once.
+-r writes them to the shared memory feed with that name as they are decoded.
+The replay waits for the first subscriber or shared memory reader and then
+for the subscribers to catch up before exiting. Shared memory readers are
+never waited for after that.
+
+Given a session archive (*_session.esa) it prints the raw bytes of the
+archived messages instead, optionally only those with one message ID
+(hex, a game message unless -l says login), on one stream or within a
+time range. -d decodes the whole archive again like a capture, without
+needing keys, and reports how long it took.
+
+Links the Qt-free decode core, exileSniffer/exileSnifferCore.vcxproj on
+Windows or the exileSnifferCore target of CMakeLists.txt elsewhere.
+Like the GUI it wants messageTypes.json and ggpk_exports.json in the working directory.
+*/
+#include "stdafx.h"
+#include "packet_capture_thread.h"
+#include "packet_processor.h"
+#include "gameDataStore.h"
+#include "key_file.h"
+#include "session_archive.h"
+#include "socket_feed_thread.h"
+#include "hex_dump.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+struct CLI_OUTPUT {
+	FILE *file = stdout;
+	//MsgPack frames like the binary feed instead of json lines
+	bool msgpack = false;
+	rapidjson::StringBuffer lineBuf;
+	std::vector<char> frame;
+	//no filters or projection, every message whole
+	FEED_SUBSCRIPTION everything;
+};
+
+static rapidjson::Document messageTypes;
+
+bool load_messagetypes_json()
+{
+	FILE* fp = fopen("messageTypes.json", "rb");
+	if (!fp)
+	{
+		std::cerr << "Failed to open messageTypes.json" << std::endl;
+		return false;
+	}
+
+	char readBuffer[65536];
+	rapidjson::FileReadStream is(fp, readBuffer, sizeof(readBuffer));
+	messageTypes.ParseStream(is);
+	fclose(fp);
+
+	if (!messageTypes.IsObject() ||
+		messageTypes.FindMember("Login") == messageTypes.MemberEnd() ||
+		messageTypes.FindMember("Game") == messageTypes.MemberEnd())
+	{
+		std::cerr << "Error: messageTypes.json needs Login and Game packet dicts" << std::endl;
+		return false;
+	}
+
+	UIDecodedPkt::loginMessageTypes = &messageTypes.FindMember("Login")->value;
+	UIDecodedPkt::gameMessageTypes = &messageTypes.FindMember("Game")->value;
+	return true;
+}
+
+//returns the number of decoded packets written
+size_t drain_ui_queue(SafeQueue<UI_MESSAGE *> &uiMsgQueue, CLI_OUTPUT &output, feed_broker *broker)
+{
+	size_t written = 0;
+	while (!uiMsgQueue.empty())
+	{
+		UI_MESSAGE *msg = uiMsgQueue.waitItem();
+		switch (msg->msgType)
+		{
+		case uiMsgType::eDecodedPacket:
+		{
+			UIDecodedPkt *decoded = (UIDecodedPkt *)msg;
+			if (output.msgpack)
+			{
+				output.frame.clear();
+				serialise_feed_msgpack(decoded, output.everything, output.frame);
+				fwrite(output.frame.data(), 1, output.frame.size(), output.file);
+			}
+			else
+			{
+				output.lineBuf.Clear();
+				rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF16<>, rapidjson::UTF8<>> writer(output.lineBuf);
+				decoded->jsn.Accept(writer);
+				fwrite(output.lineBuf.GetString(), 1, output.lineBuf.GetSize(), output.file);
+				fputc('\n', output.file);
+			}
+			++written;
+			//the broker owns it now
+			if (broker && broker->publish(decoded))
+				continue;
+			break;
+		}
+		case uiMsgType::eMetaLog:
+		{
+			UI_METALOG_MSG *logMsg = (UI_METALOG_MSG *)msg;
+			std::cerr << logMsg->stringData << std::endl;
+			break;
+		}
+		default:
+			break;
+		}
+		delete msg;
+	}
+	return written;
+}
+
+bool is_archive_path(std::string path)
+{
+	return path.size() > 4 && path.compare(path.size() - 4, 4, ".esa") == 0;
+}
+
+void write_archive_record(ARCHIVE_RECORD &record, FILE *output)
+{
+	std::string hex = hex_spaced_string(record.bytes.data(), record.bytes.size());
+	fprintf(output, "{\"time\":%lld,\"pid\":%u,\"stream\":%d,\"server\":\"%s\",\"incoming\":%s,"
+		"\"msgID\":%u,\"failed\":%s,\"hex\":\"%s\"}\n",
+		(long long)record.segment.timeMs, record.segment.pid, record.segment.streamID,
+		record.segment.streamType == eGame ? "game" : "login", record.segment.incoming ? "true" : "false",
+		record.message.msgID, (record.message.flags & ARCHIVE_MSG_FAILED) ? "true" : "false",
+		hex.empty() ? "" : hex.c_str() + 1);
+}
+
+int dump_archive(std::string archivePath, int argc, char **argv, FILE *output)
+{
+	long msgID = -1;
+	uint8_t server = eGame;
+	int streamID = -1;
+	long long startMs = LLONG_MIN, endMs = LLONG_MAX;
+	for (int i = 2; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-m" && i + 1 < argc)
+			msgID = strtol(argv[++i], NULL, 16);
+		else if (arg == "-l")
+			server = eLogin;
+		else if (arg == "-s" && i + 1 < argc)
+			streamID = atoi(argv[++i]);
+		else if (arg == "-t" && i + 2 < argc)
+		{
+			startMs = atoll(argv[++i]);
+			endMs = atoll(argv[++i]);
+		}
+	}
+
+	session_archive_reader archive;
+	if (!archive.open(archivePath))
+	{
+		std::cerr << "Failed to read session archive " << archivePath << std::endl;
+		return 1;
+	}
+	if (archive.was_recovered())
+		std::cerr << "Archive was not closed cleanly, recovered " << archive.blocks().size() << " blocks" << std::endl;
+
+	std::vector<ARCHIVE_RECORD> records;
+	if (msgID != -1)
+		archive.find_messages(server, (ushort)msgID, streamID, startMs, endMs, records);
+	else
+		archive.read_time_range(startMs, endMs, records);
+
+	size_t written = 0;
+	for (ARCHIVE_RECORD &record : records)
+	{
+		if (streamID != -1 && record.segment.streamID != streamID)
+			continue;
+		write_archive_record(record, output);
+		++written;
+	}
+
+	std::cerr << "Wrote " << written << " archived messages" << std::endl;
+	return 0;
+}
+
+//runs the archive back through the deserialisers the way the GUI reloads one
+int decode_archive(std::string archivePath, CLI_OUTPUT &output)
+{
+	if (!load_messagetypes_json())
+		return 1;
+
+	session_archive_reader archive;
+	if (!archive.open(archivePath))
+	{
+		std::cerr << "Failed to read session archive " << archivePath << std::endl;
+		return 1;
+	}
+
+	if (output.msgpack)
+	{
+		FEED_MESSAGE header = feed_msgpack_header();
+		fwrite(header->data(), 1, header->size(), output.file);
+	}
+
+	SafeQueue<UI_MESSAGE *> uiMsgQueue;
+	gameDataStore ggpk(&uiMsgQueue);
+	packet_processor processor(NULL, &uiMsgQueue, NULL, NULL, &ggpk);
+	processor.set_archive_replay(&archive);
+	std::thread processorInstance(&packet_processor::ThreadEntry, &processor);
+
+	size_t written = 0;
+	while (!processor.ded)
+	{
+		written += drain_ui_queue(uiMsgQueue, output, NULL);
+		Sleep(5);
+	}
+	processorInstance.join();
+	written += drain_ui_queue(uiMsgQueue, output, NULL);
+
+	std::cerr << "Wrote " << written << " decoded messages" << std::endl;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " capture.pcap [keys.txt] [-o decoded.jsonl] [-b] [-a session.esa] [-f tcp:port|unix:/path] [-r shmName]" << std::endl;
+		std::cerr << "       " << argv[0] << " session.esa [-m msgID [-l]] [-s streamID] [-t startMs endMs] [-o messages.jsonl]" << std::endl;
+		std::cerr << "       " << argv[0] << " session.esa -d [-o decoded.jsonl] [-b]" << std::endl;
+		return 1;
+	}
+
+	std::string capturePath = argv[1];
+	std::string keyPath;
+	std::string outputPath;
+	std::string archivePath;
+	std::vector<std::string> feedSpecs;
+	std::string shmName;
+	CLI_OUTPUT output;
+	bool decodeArchive = false;
+	for (int i = 2; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-o" && i + 1 < argc)
+			outputPath = argv[++i];
+		else if (arg == "-b")
+			output.msgpack = true;
+		else if (arg == "-d")
+			decodeArchive = true;
+		else if (arg == "-l")
+			continue;
+		else if (arg == "-f" && i + 1 < argc)
+			feedSpecs.push_back(argv[++i]);
+		else if (arg == "-a" && i + 1 < argc)
+			archivePath = argv[++i];
+		else if (arg == "-r" && i + 1 < argc)
+			shmName = argv[++i];
+		else if (arg == "-t" && i + 2 < argc)
+			i += 2;
+		else if ((arg == "-m" || arg == "-s") && i + 1 < argc)
+			++i;
+		else
+			keyPath = argv[i];
+	}
+
+	std::vector<FEED_ENDPOINT> endpoints(feedSpecs.size());
+	for (size_t i = 0; i < feedSpecs.size(); ++i)
+	{
+		std::string error;
+		if (!endpoints[i].parse(feedSpecs[i], error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+	}
+
+	if (!outputPath.empty())
+	{
+		output.file = fopen(outputPath.c_str(), "wb");
+		if (!output.file)
+		{
+			std::cerr << "Failed to open " << outputPath << " for writing" << std::endl;
+			return 1;
+		}
+	}
+#ifdef _WIN32
+	//the binary format would get its newlines mangled
+	else if (output.msgpack)
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	std::vector<char> outputBuffer(OUTPUT_BUFFER_SIZE);
+	setvbuf(output.file, outputBuffer.data(), _IOFBF, outputBuffer.size());
+
+	if (is_archive_path(capturePath))
+	{
+		int result = decodeArchive ? decode_archive(capturePath, output) : dump_archive(capturePath, argc, argv, output.file);
+		fflush(output.file);
+		if (output.file != stdout)
+			fclose(output.file);
+		return result;
+	}
+
+	if (output.msgpack)
+	{
+		FEED_MESSAGE header = feed_msgpack_header();
+		fwrite(header->data(), 1, header->size(), output.file);
+	}
+
+	if (!load_messagetypes_json())
+		return 1;
+
+	key_file_source keys;
+	if (keyPath.empty())
+	{
+		if (!keys.load_recording(capturePath))
+		{
+			std::cerr << "No key file given and " << capturePath << " isn't an exileSniffer recording" << std::endl;
+			return 1;
+		}
+		keyPath = capturePath;
+	}
+	else if (!keys.load(keyPath))
+	{
+		std::cerr << "Failed to open key file " << keyPath << std::endl;
+		return 1;
+	}
+	std::cerr << "Loaded " << keys.key_count() << " keys from " << keyPath << std::endl;
+	if (keys.keys_refused())
+		std::cerr << "Warning: " << keys.keys_refused() << " keys ignored, the key store is full" << std::endl;
+
+
+	SafeQueue<UI_MESSAGE *> uiMsgQueue;
+	SafeQueue<GAMEPACKET> gamePktQueue, loginPktQueue;
+
+	gameDataStore ggpk(&uiMsgQueue);
+
+	packet_capture_thread capture(&uiMsgQueue, &gamePktQueue, &loginPktQueue);
+	capture.set_capture_file(capturePath);
+
+	packet_processor processor(&keys, &uiMsgQueue, &gamePktQueue, &loginPktQueue, &ggpk);
+	processor.set_input_ended_flag(&capture.ded);
+	entity_store entities;
+	processor.set_entity_store(&entities);
+
+	session_archive_writer archive;
+	if (!archivePath.empty())
+	{
+		if (!archive.open(archivePath))
+		{
+			std::cerr << "Failed to create session archive " << archivePath << std::endl;
+			return 1;
+		}
+		processor.set_session_archive(&archive);
+	}
+
+	shm_feed shmFeed(&uiMsgQueue);
+	if (!shmName.empty())
+	{
+		std::string error;
+		if (!shmFeed.open(shmName, "", error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		processor.set_shm_feed(&shmFeed);
+	}
+
+	feed_broker broker(&uiMsgQueue);
+	broker.set_entity_store(&entities);
+	std::vector<std::unique_ptr<socket_feed_thread> > feeds;
+	std::vector<std::thread> feedInstances;
+	if (!endpoints.empty())
+	{
+		feedInstances.push_back(std::thread(&feed_broker::ThreadEntry, &broker));
+		for (FEED_ENDPOINT &endpoint : endpoints)
+		{
+			feeds.push_back(std::unique_ptr<socket_feed_thread>(new socket_feed_thread(&uiMsgQueue, &broker, endpoint)));
+			feedInstances.push_back(std::thread(&socket_feed_thread::ThreadEntry, feeds.back().get()));
+		}
+	}
+
+	if (!endpoints.empty() || !shmName.empty())
+	{
+		//so it doesn't miss the start of the replay
+		std::cerr << "Waiting for a feed subscriber" << std::endl;
+		while (!broker.subscriber_count() && !shmFeed.reader_count())
+		{
+			drain_ui_queue(uiMsgQueue, output, NULL);
+			Sleep(50);
+
+			bool listening = !shmName.empty();
+			for (auto &feed : feeds)
+				listening |= !feed->ded;
+			if (!listening)
+			{
+				broker.running = false;
+				for (std::thread &instance : feedInstances)
+					instance.join();
+				drain_ui_queue(uiMsgQueue, output, NULL);
+				return 1;
+			}
+		}
+	}
+
+	std::thread captureInstance(&packet_capture_thread::ThreadEntry, &capture);
+	std::thread processorInstance(&packet_processor::ThreadEntry, &processor);
+	std::thread archiveInstance(&session_archive_writer::ThreadEntry, &archive);
+
+	size_t written = 0;
+	feed_broker *feedBroker = feeds.empty() ? NULL : &broker;
+	while (!processor.ded)
+	{
+		written += drain_ui_queue(uiMsgQueue, output, feedBroker);
+		Sleep(5);
+	}
+
+	captureInstance.join();
+	processorInstance.join();
+	archive.stop();
+	archiveInstance.join();
+	shmFeed.close();
+	written += drain_ui_queue(uiMsgQueue, output, feedBroker);
+
+	if (feedBroker)
+	{
+		while (broker.subscriber_count() && !broker.drained())
+			Sleep(5);
+		for (auto &feed : feeds)
+			feed->running = false;
+		broker.running = false;
+		for (std::thread &instance : feedInstances)
+			instance.join();
+		drain_ui_queue(uiMsgQueue, output, NULL);
+	}
+
+	fflush(output.file);
+	if (output.file != stdout)
+		fclose(output.file);
+
+	std::cerr << "Wrote " << written << " decoded messages" << std::endl;
+	std::vector<DWORD> clients;
+	entities.clients(clients);
+	for (DWORD pid : clients)
+	{
+		std::cerr << "Client " << pid << " ended with " << entities.entity_count(pid) << " entities" << std::endl;
+		if (entities.ambiguous_updates(pid))
+			std::cerr << "  " << entities.ambiguous_updates(pid) << " moves/removals skipped, their ID1 was shared" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,259 @@
+'''
+Reference reader for the exileSniffer feed
+
+Opens the feed, sends a subscription and yields each message as a dict,
+in either format:
+
+Json     one line per message, UTF-8 ending in \\n or, on the named pipe
+         without PipeUTF8 set, UTF-16LE ending in \\r
+MsgPack  an 8 byte header - b"ESFD", version, format (1), two zero bytes -
+         then for each message a 4 byte little endian length and that many
+         bytes of one MessagePack map with the same keys as the json
+
+The MessagePack decoding here is plain python so it works anywhere. If the
+msgpack package is installed that is used instead as it is much faster.
+
+    for msg in read_feed("tcp:5000", {"MsgTypes": ["SRV_MOBILE_UPDATE_HMS"], "Format": "MsgPack"}):
+        print(msg["Payload"])
+
+Addresses are tcp:port (on 127.0.0.1), unix:/path or pipe:name.
+'''
+import json
+import socket
+import struct
+
+MAGIC = b'ESFD'
+VERSION = 1
+FORMAT_MSGPACK = 1
+HEADER_SIZE = 8
+
+try:
+    import msgpack
+except ImportError:
+    msgpack = None
+
+
+class FeedError(Exception):
+    pass
+
+
+def _unpack_value(data, pos):
+    tag = data[pos]
+    pos += 1
+    if tag < 0x80:
+        return tag, pos
+    if tag >= 0xe0:
+        return tag - 0x100, pos
+    if tag & 0xe0 == 0xa0:
+        end = pos + (tag & 0x1f)
+        return data[pos:end].decode('utf-8'), end
+    if tag & 0xf0 == 0x80:
+        return _unpack_map(data, pos, tag & 0x0f)
+    if tag & 0xf0 == 0x90:
+        return _unpack_array(data, pos, tag & 0x0f)
+    if tag == 0xc0:
+        return None, pos
+    if tag == 0xc2:
+        return False, pos
+    if tag == 0xc3:
+        return True, pos
+    if tag in _FIXED:
+        fmt, size = _FIXED[tag]
+        return struct.unpack_from(fmt, data, pos)[0], pos + size
+    if tag in _STR:
+        fmt, size = _STR[tag]
+        length = struct.unpack_from(fmt, data, pos)[0]
+        pos += size
+        return data[pos:pos + length].decode('utf-8'), pos + length
+    if tag in (0xde, 0xdf):
+        fmt, size = ('>H', 2) if tag == 0xde else ('>I', 4)
+        return _unpack_map(data, pos + size, struct.unpack_from(fmt, data, pos)[0])
+    if tag in (0xdc, 0xdd):
+        fmt, size = ('>H', 2) if tag == 0xdc else ('>I', 4)
+        return _unpack_array(data, pos + size, struct.unpack_from(fmt, data, pos)[0])
+    raise FeedError('unexpected MessagePack type 0x%02x' % tag)
+
+
+_FIXED = {
+    0xcc: ('>B', 1), 0xcd: ('>H', 2), 0xce: ('>I', 4), 0xcf: ('>Q', 8),
+    0xd0: ('>b', 1), 0xd1: ('>h', 2), 0xd2: ('>i', 4), 0xd3: ('>q', 8),
+    0xca: ('>f', 4), 0xcb: ('>d', 8),
+}
+_STR = {0xd9: ('>B', 1), 0xda: ('>H', 2), 0xdb: ('>I', 4)}
+
+
+def _unpack_map(data, pos, count):
+    result = {}
+    for _ in range(count):
+        key, pos = _unpack_value(data, pos)
+        result[key], pos = _unpack_value(data, pos)
+    return result, pos
+
+
+def _unpack_array(data, pos, count):
+    result = []
+    for _ in range(count):
+        value, pos = _unpack_value(data, pos)
+        result.append(value)
+    return result, pos
+
+
+def unpack(frame):
+    '''one message from the bytes after its length prefix'''
+    if msgpack:
+        return msgpack.unpackb(frame, raw=False)
+    value, end = _unpack_value(frame, 0)
+    if end != len(frame):
+        raise FeedError('%d bytes left over in a frame' % (len(frame) - end))
+    return value
+
+
+def pack(value, out=None):
+    '''what the sniffer would send for value, without the length prefix'''
+    out = bytearray() if out is None else out
+    if value is None:
+        out.append(0xc0)
+    elif value is True or value is False:
+        out.append(0xc3 if value else 0xc2)
+    elif isinstance(value, int):
+        if 0 <= value < 0x80 or -32 <= value < 0:
+            out += struct.pack('>b' if value < 0 else '>B', value)
+        elif value >= 0:
+            for limit, tag, fmt in ((0xff, 0xcc, '>B'), (0xffff, 0xcd, '>H'), (0xffffffff, 0xce, '>I'), (None, 0xcf, '>Q')):
+                if limit is None or value <= limit:
+                    out.append(tag)
+                    out += struct.pack(fmt, value)
+                    break
+        else:
+            for limit, tag, fmt in ((-0x80, 0xd0, '>b'), (-0x8000, 0xd1, '>h'), (-0x80000000, 0xd2, '>i'), (None, 0xd3, '>q')):
+                if limit is None or value >= limit:
+                    out.append(tag)
+                    out += struct.pack(fmt, value)
+                    break
+    elif isinstance(value, float):
+        out.append(0xcb)
+        out += struct.pack('>d', value)
+    elif isinstance(value, str):
+        text = value.encode('utf-8')
+        if len(text) < 32:
+            out.append(0xa0 | len(text))
+        elif len(text) <= 0xff:
+            out += struct.pack('>BB', 0xd9, len(text))
+        elif len(text) <= 0xffff:
+            out += struct.pack('>BH', 0xda, len(text))
+        else:
+            out += struct.pack('>BI', 0xdb, len(text))
+        out += text
+    elif isinstance(value, dict):
+        _pack_count(out, len(value), 0x80, 0xde, 0xdf)
+        for key, item in value.items():
+            pack(key, out)
+            pack(item, out)
+    elif isinstance(value, (list, tuple)):
+        _pack_count(out, len(value), 0x90, 0xdc, 0xdd)
+        for item in value:
+            pack(item, out)
+    else:
+        raise FeedError('can\'t pack %r' % (value,))
+    return out
+
+
+def _pack_count(out, count, fixtag, tag16, tag32):
+    if count < 16:
+        out.append(fixtag | count)
+    elif count <= 0xffff:
+        out += struct.pack('>BH', tag16, count)
+    else:
+        out += struct.pack('>BI', tag32, count)
+
+
+def frame(value):
+    '''a whole message as it appears on the feed'''
+    body = pack(value)
+    return struct.pack('<I', len(body)) + body
+
+
+def _read_exactly(stream, size):
+    data = b''
+    while len(data) < size:
+        chunk = stream.read(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def read_msgpack(stream):
+    '''messages from a binary stream positioned at the feed header'''
+    header = _read_exactly(stream, HEADER_SIZE)
+    if header is None:
+        return
+    if header[:4] != MAGIC:
+        raise FeedError('not a MsgPack feed, was the subscription refused? (check the sniffer log)')
+    if header[4] != VERSION or header[5] != FORMAT_MSGPACK:
+        raise FeedError('feed is version %d format %d, this reads version %d' % (header[4], header[5], VERSION))
+
+    while True:
+        prefix = _read_exactly(stream, 4)
+        if prefix is None:
+            return
+        body = _read_exactly(stream, struct.unpack('<I', prefix)[0])
+        if body is None:
+            return
+        yield unpack(body)
+
+
+def read_json(stream, utf16=False):
+    '''messages from a stream of json lines'''
+    if utf16:
+        line = bytearray()
+        while True:
+            unit = _read_exactly(stream, 2)
+            if unit is None:
+                return
+            if unit == b'\r\x00':
+                yield json.loads(line.decode('utf-16-le'))
+                line = bytearray()
+            else:
+                line += unit
+    for line in stream:
+        yield json.loads(line)
+
+
+def open_feed(address, request=None):
+    '''a binary file object for the feed with the subscription sent'''
+    kind, _, where = address.partition(':')
+    if kind == 'pipe':
+        stream = open('\\\\.\\pipe\\' + where, 'r+b', buffering=0)
+        if request is not None:
+            stream.write((json.dumps(request) + '\n').encode('utf-8'))
+        return stream
+
+    if kind == 'tcp':
+        sock = socket.create_connection(('127.0.0.1', int(where)))
+    elif kind == 'unix':
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.connect(where)
+    else:
+        raise FeedError('addresses look like tcp:port, unix:/path or pipe:name')
+    if request is not None:
+        sock.sendall((json.dumps(request) + '\n').encode('utf-8'))
+    return sock.makefile('rb', buffering=1024 * 1024)
+
+
+def read_feed(address, request=None, utf16=False):
+    '''every message the subscription asks for, as dicts'''
+    stream = open_feed(address, request)
+    if request and request.get('Format') == 'MsgPack':
+        return read_msgpack(stream)
+    return read_json(stream, utf16)
+
+
+if __name__ == '__main__':
+    import sys
+    if len(sys.argv) < 2:
+        print('usage: exilefeed.py tcp:port|unix:/path|pipe:name [subscription json]')
+        sys.exit(1)
+    subscription = json.loads(sys.argv[2]) if len(sys.argv) > 2 else {'Format': 'MsgPack'}
+    for message in read_feed(sys.argv[1], subscription, utf16=sys.argv[1].startswith('pipe:')):
+        print(message)
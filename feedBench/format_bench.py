@@ -0,0 +1,117 @@
+'''
+Compares the feed formats on the same messages: how many bytes each
+message takes on the wire and how long python takes to turn it back
+into a dict
+
+    format_bench.py [decoded.jsonl]
+
+With a file of json lines (what exileSnifferCLI writes) it uses those,
+otherwise a made up mix weighted like a busy map: mostly life/mana
+updates and movement, some new objects and the odd chat line.
+
+The MsgPack numbers are for the plain python decoder in exilefeed.py and,
+if it is installed, the msgpack package.
+'''
+import json
+import random
+import sys
+import time
+
+import exilefeed
+
+try:
+    import msgpack
+except ImportError:
+    msgpack = None
+
+REPEATS = 5
+
+
+def header(msgID, msgType, direction='Inbound'):
+    return {'ProcessID': 4242, 'Direction': direction, 'Stream': 'Game', 'StreamID': 1,
+            'MsgID': msgID, 'MsgType': msgType}
+
+
+def made_up_messages(count=20000):
+    rand = random.Random(1)
+    messages = []
+    for i in range(count):
+        roll = rand.random()
+        if roll < 0.55:
+            msg = header(270, 'SRV_MOBILE_UPDATE_HMS')
+            msg['Payload'] = {'ID1': rand.randrange(1, 60000), 'ID2': 0, 'ID3': 0,
+                              'Stat': rand.randrange(3), 'NewValue': rand.randrange(20000)}
+        elif roll < 0.85:
+            msg = header(272, 'SRV_MOVE_OBJECT')
+            msg['Payload'] = {'ObjectID': rand.randrange(1, 60000), 'Coord1': rand.randrange(1000),
+                              'Coord2': rand.randrange(1000), 'Unk1': 0, 'Unk2': 0, 'Flags': 8}
+        elif roll < 0.97:
+            msg = header(309, 'SRV_ADD_OBJECT')
+            msg['Payload'] = {'ID1': rand.randrange(1, 60000), 'ID2': 0, 'ID3': 0,
+                              'objHash': rand.randrange(2 ** 32), 'DataLen': rand.randrange(40, 400),
+                              'HashCategory': 'Monster',
+                              'HashResult': 'Metadata/Monsters/Skeletons/SkeletonBowPuncture' + str(rand.randrange(5))}
+        else:
+            msg = header(10, 'SRV_CHAT_MESSAGE')
+            msg['Payload'] = {'Name': 'Exile%d' % rand.randrange(100), 'Text': 'wtb 20 chaos orbs → ' * rand.randrange(1, 4),
+                              'Tag': '', 'Dev': 0, 'Challenges': 0, 'Hide': 0}
+        messages.append(msg)
+    return messages
+
+
+def load_messages(path):
+    with open(path, 'rb') as jsonl:
+        return [json.loads(line) for line in jsonl if line.strip()]
+
+
+#what each format puts on the wire for one message, rapidjson writes no spaces
+def json_line(msg):
+    return json.dumps(msg, separators=(',', ':'), ensure_ascii=False)
+
+
+def encode_all(messages):
+    utf16 = [(json_line(msg) + '\r').encode('utf-16-le') for msg in messages]
+    utf8 = [(json_line(msg) + '\n').encode('utf-8') for msg in messages]
+    frames = [exilefeed.frame(msg) for msg in messages]
+    return utf16, utf8, frames
+
+
+def best_time(decode, items):
+    best = None
+    for _ in range(REPEATS):
+        start = time.perf_counter()
+        for item in items:
+            decode(item)
+        taken = time.perf_counter() - start
+        best = taken if best is None else min(best, taken)
+    return best * 1e6 / len(items)
+
+
+def main():
+    messages = load_messages(sys.argv[1]) if len(sys.argv) > 1 else made_up_messages()
+    utf16, utf8, frames = encode_all(messages)
+
+    for msg, frame in zip(messages, frames):
+        if exilefeed.unpack(bytes(frame[4:])) != msg:
+            raise exilefeed.FeedError('MsgPack frame doesn\'t decode back to its message')
+
+    bodies = [bytes(frame[4:]) for frame in frames]
+    results = [
+        ('json utf-16', utf16, lambda line: json.loads(line[:-2].decode('utf-16-le'))),
+        ('json utf-8', utf8, lambda line: json.loads(line)),
+        ('msgpack (python)', bodies, lambda body: exilefeed._unpack_value(body, 0)),
+    ]
+    if msgpack:
+        results.append(('msgpack (package)', bodies, lambda body: msgpack.unpackb(body, raw=False)))
+
+    print('%d messages' % len(messages))
+    print('%-20s %12s %14s' % ('format', 'bytes/msg', 'decode us/msg'))
+    for name, encoded, decode in results:
+        size = sum(len(item) for item in encoded)
+        if encoded is bodies:
+            size += 4 * len(encoded)
+        print('%-20s %12.1f %14.2f' % (name, size / len(encoded), best_time(decode, encoded)))
+
+
+if __name__ == '__main__':
+    main()
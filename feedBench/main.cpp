@@ -0,0 +1,409 @@
+/*
+Feed transport benchmark
+
+Pushes made up decoded packets through the feed broker to one subscriber on
+each transport over loopback and reports messages per second and latency.
+
+usage: feedBench [messages] [paced messages per second]
+
+Each transport gets a blocking subscriber so nothing is dropped, and two runs:
+flat out for throughput, then paced at a steady rate for latency (publish to
+the subscriber reading the line, the publish time is in the payload).
+The named pipe is only run on Windows and the unix socket everywhere else.
+The shared memory feed is written the way the decode thread writes it and
+read from another thread. It never waits for its reader so the flat out
+run can lose messages, those are counted instead.
+
+Links the Qt-free decode core like exileSnifferCLI: feedBench.vcxproj in the
+solution, or the feedBench target of CMakeLists.txt.
+*/
+#include "stdafx.h"
+#include "feed_broker.h"
+#include "socket_feed_thread.h"
+#include "shm_feed.h"
+#ifdef _WIN32
+#include "json_pipe_thread.h"
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <functional>
+
+#define BENCH_MESSAGES 200000
+#define BENCH_PACED_RATE 20000
+//the paced run is this many seconds long at most
+#define BENCH_PACED_SECONDS 3
+#define BENCH_TCP_PORT 47011
+#define BENCH_PIPE_NAME "exileSnifferFeedBench"
+#define BENCH_UNIX_PATH "/tmp/exileSnifferFeedBench.sock"
+#define BENCH_SHM_NAME "exileSnifferFeedBench"
+#define BENCH_REQUEST "{\"Overflow\":\"Block\",\"QueueSize\":65536}\n"
+#define BENCH_CONNECT_TRIES 200
+
+#ifdef _WIN32
+struct BENCH_CONNECTION {
+	HANDLE pipe = INVALID_HANDLE_VALUE;
+	SOCKET sock = INVALID_SOCKET;
+};
+#else
+struct BENCH_CONNECTION {
+	int sock = -1;
+};
+#endif
+
+struct BENCH_RESULT {
+	size_t received = 0;
+	size_t lost = 0;
+	double seconds = 0;
+	std::vector<long long> latencyNS;
+};
+
+static long long now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//about the size of a common game message with the time it was made in the payload
+static UIDecodedPkt *make_packet(unsigned int sequence)
+{
+	UIDecodedPkt *packet = new UIDecodedPkt(4242, eGame, 1, true, GetTickCount64());
+	std::stringstream json;
+	json << "{\"ProcessID\":4242,\"Direction\":\"Inbound\",\"Stream\":\"Game\",\"StreamID\":1,"
+		"\"MsgID\":270,\"MsgType\":\"SRV_MOBILE_UPDATE_HMS\",\"Payload\":{\"ID1\":" << sequence <<
+		",\"ID2\":0,\"ID3\":0,\"Stat\":1,\"NewValue\":" << (sequence % 5000) << ",\"SentNS\":" << now_ns() << "}}";
+	packet->restore(270, false, false, json.str().c_str());
+	return packet;
+}
+
+static bool connect_feed(std::string transport, BENCH_CONNECTION &connection)
+{
+	for (int attempt = 0; attempt < BENCH_CONNECT_TRIES; ++attempt, Sleep(10))
+	{
+#ifdef _WIN32
+		if (transport == "pipe")
+		{
+			connection.pipe = CreateFileA("\\\\.\\pipe\\" BENCH_PIPE_NAME, GENERIC_READ | GENERIC_WRITE,
+				0, NULL, OPEN_EXISTING, 0, NULL);
+			if (connection.pipe != INVALID_HANDLE_VALUE)
+				return true;
+			continue;
+		}
+		connection.sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(BENCH_TCP_PORT);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (connect(connection.sock, (sockaddr *)&address, sizeof(address)) == 0)
+			return true;
+		closesocket(connection.sock);
+		connection.sock = INVALID_SOCKET;
+#else
+		int result;
+		if (transport == "unix")
+		{
+			sockaddr_un address;
+			memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			strncpy(address.sun_path, BENCH_UNIX_PATH, sizeof(address.sun_path) - 1);
+			connection.sock = socket(AF_UNIX, SOCK_STREAM, 0);
+			result = connect(connection.sock, (sockaddr *)&address, sizeof(address));
+		}
+		else
+		{
+			sockaddr_in address;
+			memset(&address, 0, sizeof(address));
+			address.sin_family = AF_INET;
+			address.sin_port = htons(BENCH_TCP_PORT);
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			connection.sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+			result = connect(connection.sock, (sockaddr *)&address, sizeof(address));
+		}
+		if (result == 0)
+			return true;
+		close(connection.sock);
+		connection.sock = -1;
+#endif
+	}
+	return false;
+}
+
+static bool write_feed(BENCH_CONNECTION &connection, const char *data, int size)
+{
+#ifdef _WIN32
+	if (connection.pipe != INVALID_HANDLE_VALUE)
+	{
+		DWORD written;
+		return WriteFile(connection.pipe, data, size, &written, NULL) && written == (DWORD)size;
+	}
+#endif
+	return send(connection.sock, data, size, 0) == size;
+}
+
+static int read_feed(BENCH_CONNECTION &connection, char *buffer, int size)
+{
+#ifdef _WIN32
+	if (connection.pipe != INVALID_HANDLE_VALUE)
+	{
+		DWORD readBytes;
+		if (!ReadFile(connection.pipe, buffer, size, &readBytes, NULL))
+			return -1;
+		return (int)readBytes;
+	}
+#endif
+	return (int)recv(connection.sock, buffer, size, 0);
+}
+
+static void close_feed(BENCH_CONNECTION &connection)
+{
+#ifdef _WIN32
+	if (connection.pipe != INVALID_HANDLE_VALUE)
+		CloseHandle(connection.pipe);
+	if (connection.sock != INVALID_SOCKET)
+		closesocket(connection.sock);
+#else
+	if (connection.sock != -1)
+		close(connection.sock);
+#endif
+}
+
+//reads lines until it has expected of them, noting how long each took to arrive
+static void read_lines(BENCH_CONNECTION *connection, size_t expected, BENCH_RESULT *result)
+{
+	static const char sentKey[] = "\"SentNS\":";
+	std::vector<char> buffer(1024 * 1024);
+	std::string partial;
+	while (result->received < expected)
+	{
+		int readBytes = read_feed(*connection, buffer.data(), (int)buffer.size());
+		if (readBytes <= 0)
+			return;
+		long long arrived = now_ns();
+
+		partial.append(buffer.data(), readBytes);
+		size_t lineStart = 0, lineEnd;
+		while ((lineEnd = partial.find('\n', lineStart)) != std::string::npos)
+		{
+			size_t sent = partial.find(sentKey, lineStart);
+			if (sent != std::string::npos && sent < lineEnd)
+				result->latencyNS.push_back(arrived - atoll(partial.c_str() + sent + sizeof(sentKey) - 1));
+			++result->received;
+			lineStart = lineEnd + 1;
+		}
+		partial.erase(0, lineStart);
+	}
+}
+
+//the MsgPack encoded SentNS is a uint64, or uint32 very soon after boot
+static long long msgpack_sent_ns(std::vector<char> &message)
+{
+	static const char sentKey[] = "\xa6SentNS";
+	auto found = std::search(message.begin(), message.end(), sentKey, sentKey + sizeof(sentKey) - 1);
+	if (message.end() - found < (ptrdiff_t)sizeof(sentKey))
+		return -1;
+	found += sizeof(sentKey) - 1;
+	int size = (unsigned char)*found == 0xcf ? 8 : ((unsigned char)*found == 0xce ? 4 : 0);
+	if (!size || message.end() - found <= size)
+		return -1;
+
+	unsigned long long value = 0;
+	for (int i = 1; i <= size; ++i)
+		value = (value << 8) | (unsigned char)found[i];
+	return (long long)value;
+}
+
+static void read_shm(shm_feed_reader *reader, size_t expected, BENCH_RESULT *result)
+{
+	std::vector<char> message;
+	reader->lost = 0;
+	while (result->received + reader->lost < expected && reader->read(message, 1000))
+	{
+		long long arrived = now_ns();
+		long long sent = msgpack_sent_ns(message);
+		if (sent > 0)
+			result->latencyNS.push_back(arrived - sent);
+		++result->received;
+	}
+	result->lost = (size_t)reader->lost;
+}
+
+//publishes at rate (0 for flat out) while read collects what arrives
+static BENCH_RESULT run_phase(std::function<void(UIDecodedPkt *)> publish,
+	std::function<void(BENCH_RESULT *)> read, size_t messages, int rate)
+{
+	BENCH_RESULT result;
+	result.latencyNS.reserve(messages);
+	std::thread reader(read, &result);
+
+	long long start = now_ns();
+	for (size_t i = 0; i < messages; ++i)
+	{
+		if (rate)
+		{
+			long long due = start + (long long)(i * (1000000000.0 / rate));
+			while (now_ns() < due)
+				std::this_thread::yield();
+		}
+		publish(make_packet((unsigned int)i));
+	}
+
+	reader.join();
+	result.seconds = (now_ns() - start) / 1e9;
+	return result;
+}
+
+static long long percentile_us(std::vector<long long> &sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0;
+	size_t index = std::min(sorted.size() - 1, (size_t)(sorted.size() * fraction));
+	return sorted[index] / 1000;
+}
+
+static void print_results(std::string transport, BENCH_RESULT &flatOut, BENCH_RESULT &paced, int pacedRate)
+{
+	std::sort(paced.latencyNS.begin(), paced.latencyNS.end());
+	std::sort(flatOut.latencyNS.begin(), flatOut.latencyNS.end());
+
+	printf("%-5s %9.0f msg/s (%zu in %.2fs, p99 %lldus) | paced %d/s: p50 %lldus p99 %lldus max %lldus\n",
+		transport.c_str(), flatOut.received / flatOut.seconds, flatOut.received, flatOut.seconds,
+		percentile_us(flatOut.latencyNS, 0.99), pacedRate,
+		percentile_us(paced.latencyNS, 0.5), percentile_us(paced.latencyNS, 0.99),
+		percentile_us(paced.latencyNS, 1.0));
+	if (flatOut.lost || paced.lost)
+		printf("      lost %zu flat out, %zu paced\n", flatOut.lost, paced.lost);
+}
+
+static void print_log(SafeQueue<UI_MESSAGE *> &uiMsgQueue)
+{
+	while (!uiMsgQueue.empty())
+	{
+		UI_MESSAGE *msg = uiMsgQueue.waitItem();
+		if (msg->msgType == uiMsgType::eMetaLog)
+			std::cerr << "  " << ((UI_METALOG_MSG *)msg)->stringData << std::endl;
+		delete msg;
+	}
+}
+
+static bool run_transport(std::string transport, size_t messages, int pacedRate)
+{
+	SafeQueue<UI_MESSAGE *> uiMsgQueue;
+	feed_broker broker(&uiMsgQueue);
+	std::thread brokerInstance(&feed_broker::ThreadEntry, &broker);
+
+	std::unique_ptr<socket_feed_thread> socketFeed;
+	bool *transportRunning, *transportDed;
+#ifdef _WIN32
+	std::unique_ptr<json_pipe_thread> pipeFeed;
+	if (transport == "pipe")
+	{
+		pipeFeed.reset(new json_pipe_thread(&uiMsgQueue, &broker, BENCH_PIPE_NAME, true));
+		transportRunning = &pipeFeed->running;
+		transportDed = &pipeFeed->ded;
+	}
+	else
+#endif
+	{
+		FEED_ENDPOINT endpoint;
+		std::string error;
+		endpoint.parse(transport == "unix" ? "unix:" BENCH_UNIX_PATH : "tcp:" + std::to_string(BENCH_TCP_PORT), error);
+		socketFeed.reset(new socket_feed_thread(&uiMsgQueue, &broker, endpoint));
+		transportRunning = &socketFeed->running;
+		transportDed = &socketFeed->ded;
+	}
+#ifdef _WIN32
+	std::thread transportInstance = pipeFeed ?
+		std::thread(&json_pipe_thread::ThreadEntry, pipeFeed.get()) :
+		std::thread(&socket_feed_thread::ThreadEntry, socketFeed.get());
+#else
+	std::thread transportInstance(&socket_feed_thread::ThreadEntry, socketFeed.get());
+#endif
+
+	BENCH_CONNECTION connection;
+	bool ok = connect_feed(transport, connection) &&
+		write_feed(connection, BENCH_REQUEST, (int)strlen(BENCH_REQUEST));
+	for (int wait = 0; ok && !broker.subscriber_count() && wait < BENCH_CONNECT_TRIES; ++wait)
+		Sleep(10);
+	ok = ok && broker.subscriber_count();
+
+	if (ok)
+	{
+		auto publish = [&broker](UIDecodedPkt *packet) {
+			if (!broker.publish(packet))
+				delete packet;
+		};
+		size_t pacedMessages = std::min(messages, (size_t)pacedRate * BENCH_PACED_SECONDS);
+		BENCH_RESULT flatOut = run_phase(publish, [&](BENCH_RESULT *result) { read_lines(&connection, messages, result); },
+			messages, 0);
+		BENCH_RESULT paced = run_phase(publish, [&](BENCH_RESULT *result) { read_lines(&connection, pacedMessages, result); },
+			pacedMessages, pacedRate);
+		print_results(transport, flatOut, paced, pacedRate);
+		ok = flatOut.received == messages && paced.received == pacedMessages;
+	}
+	else
+		std::cerr << transport << ": couldn't subscribe" << std::endl;
+
+	close_feed(connection);
+	*transportRunning = false;
+	broker.running = false;
+	transportInstance.join();
+	brokerInstance.join();
+	print_log(uiMsgQueue);
+	return ok && *transportDed;
+}
+
+static bool run_shm(size_t messages, int pacedRate)
+{
+	SafeQueue<UI_MESSAGE *> uiMsgQueue;
+	shm_feed feed(&uiMsgQueue);
+	shm_feed_reader reader;
+	std::string error;
+	if (!feed.open(BENCH_SHM_NAME, "", error) || !reader.open(BENCH_SHM_NAME, error))
+	{
+		std::cerr << "shm: " << error << std::endl;
+		return false;
+	}
+
+	auto publish = [&feed](UIDecodedPkt *packet) {
+		feed.publish(packet);
+		delete packet;
+	};
+	size_t pacedMessages = std::min(messages, (size_t)pacedRate * BENCH_PACED_SECONDS);
+	BENCH_RESULT flatOut = run_phase(publish, [&](BENCH_RESULT *result) { read_shm(&reader, messages, result); },
+		messages, 0);
+	BENCH_RESULT paced = run_phase(publish, [&](BENCH_RESULT *result) { read_shm(&reader, pacedMessages, result); },
+		pacedMessages, pacedRate);
+	print_results("shm", flatOut, paced, pacedRate);
+
+	reader.close();
+	feed.close();
+	print_log(uiMsgQueue);
+	return flatOut.received + flatOut.lost == messages && paced.received + paced.lost == pacedMessages;
+}
+
+int main(int argc, char **argv)
+{
+	size_t messages = argc > 1 ? (size_t)atoll(argv[1]) : BENCH_MESSAGES;
+	int pacedRate = argc > 2 ? atoi(argv[2]) : BENCH_PACED_RATE;
+	if (!messages || pacedRate < 1)
+	{
+		std::cerr << "usage: " << argv[0] << " [messages] [paced messages per second]" << std::endl;
+		return 1;
+	}
+
+#ifdef _WIN32
+	std::vector<std::string> transports = { "pipe", "tcp" };
+#else
+	std::vector<std::string> transports = { "unix", "tcp" };
+#endif
+
+	bool ok = true;
+	for (std::string &transport : transports)
+		ok &= run_transport(transport, messages, pacedRate);
+	ok &= run_shm(messages, pacedRate);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/*
+Hex formatting benchmark
+
+Times the table driven writers in hex_dump.h against the stringstream code
+they replaced, on made up packet segments, and checks both produce the
+same text.
+
+usage: hexBench [segment bytes] [iterations]
+
+Two cases:
+	hex blob - the spaced hex of consume_hexblob and byteVecToHex
+	details pane - the hex rows then the offset labelled ascii rows of decodedCellActivated
+
+Both are written as wchar_t here. The UI writes the same code into QString's
+UTF-16 data and the hex log writer into a char buffer.
+
+Links the Qt-free decode core: hexBench.vcxproj in the solution, or the
+hexBench target of CMakeLists.txt.
+*/
+#include "stdafx.h"
+#include "hex_dump.h"
+#include <chrono>
+#include <functional>
+
+#define BENCH_SEGMENT_SIZE 1400
+#define BENCH_ITERATIONS 20000
+
+static size_t row_size(size_t size, size_t row)
+{
+	return (size - row < HEXDUMP_ROW) ? size - row : HEXDUMP_ROW;
+}
+
+//the old consume_hexblob/byteVecToHex
+static std::wstring hexblob_stream(const std::vector<byte> &blob)
+{
+	std::wstringstream keyhexss;
+	keyhexss << std::setfill(L'0') << std::uppercase;
+	for (size_t i = 0; i < blob.size(); ++i)
+	{
+		byte item = blob.at(i);
+		if (item)
+			keyhexss << " " << std::hex << std::setw(2) << (int)item;
+		else
+			keyhexss << " 00";
+	}
+	return keyhexss.str();
+}
+
+static std::wstring hexblob_table(const std::vector<byte> &blob)
+{
+	std::wstring keyhex(blob.size() * 3, L' ');
+	write_hex_spaced(blob.data(), blob.size(), &keyhex[0]);
+	return keyhex;
+}
+
+//the old decodedCellActivated, minus the header
+static std::wstring details_stream(const std::vector<byte> &pkt)
+{
+	size_t msgSize = pkt.size();
+	std::wstringstream hexdump;
+	hexdump << std::setfill(L'0') << std::uppercase << L" ";
+	for (size_t i = 0; i < msgSize; ++i)
+	{
+		byte item = pkt.at(i);
+		if (item)
+			hexdump << " " << std::hex << std::setw(2) << (int)item;
+		else
+			hexdump << " 00";
+
+		size_t nextIndex = i + 1;
+		if ((nextIndex % 16 == 0) && nextIndex < msgSize)
+		{
+			hexdump << std::endl;
+			hexdump << " ";
+		}
+	}
+
+	std::wstringstream asciiDump;
+	asciiDump << std::setfill(L'0') << std::hex << std::setw(3);
+	asciiDump << "\n\n\n 000:";
+	for (size_t i = 0; i < msgSize; ++i)
+	{
+		byte item = pkt.at(i);
+		if (item >= ' ' && item <= '~')
+			asciiDump << (char)item;
+		else
+			asciiDump << '.';
+
+		size_t nextIndex = i + 1;
+		if ((nextIndex % 16 == 0) && nextIndex < msgSize)
+		{
+			asciiDump << std::endl;
+			asciiDump << " " << std::setw(3) << (i + 1) << ": ";
+		}
+	}
+	return hexdump.str() + asciiDump.str();
+}
+
+static std::wstring details_table(const std::vector<byte> &pkt)
+{
+	size_t msgSize = pkt.size();
+	const byte *pktData = pkt.data();
+	size_t rows = (msgSize + HEXDUMP_ROW - 1) / HEXDUMP_ROW;
+
+	std::wstring dump(1 + msgSize * 3 + rows * 2 + 8 + msgSize + rows * 21, L' ');
+	wchar_t *start = &dump[0];
+	wchar_t *pos = write_text(" ", start);
+	for (size_t row = 0; row < msgSize; row += HEXDUMP_ROW)
+	{
+		pos = write_hex_spaced(pktData + row, row_size(msgSize, row), pos);
+		if (row + HEXDUMP_ROW < msgSize)
+			pos = write_text("\n ", pos);
+	}
+
+	pos = write_text("\n\n\n 000:", pos);
+	for (size_t row = 0; row < msgSize; row += HEXDUMP_ROW)
+	{
+		pos = write_ascii(pktData + row, row_size(msgSize, row), pos);
+		if (row + HEXDUMP_ROW < msgSize)
+		{
+			pos = write_text("\n ", pos);
+			pos = write_hex_number(row + HEXDUMP_ROW, 3, pos);
+			pos = write_text(": ", pos);
+		}
+	}
+	dump.resize(pos - start);
+	return dump;
+}
+
+typedef std::function<std::wstring(const std::vector<byte> &)> formatFunction;
+
+//microseconds per call
+static double time_format(formatFunction format, const std::vector<byte> &segment, size_t iterations)
+{
+	size_t totalLength = 0;
+	auto timeStart = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+		totalLength += format(segment).size();
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - timeStart;
+
+	//keep the calls from being optimised away
+	if (!totalLength)
+		printf("nothing formatted\n");
+	return elapsed.count() / iterations;
+}
+
+static bool run_case(const char *name, formatFunction streamFormat, formatFunction tableFormat,
+	const std::vector<byte> &segment, size_t iterations)
+{
+	bool same = streamFormat(segment) == tableFormat(segment);
+	double streamUs = time_format(streamFormat, segment, iterations);
+	double tableUs = time_format(tableFormat, segment, iterations);
+
+	printf("%-13s stringstream %7.2fus  table %6.2fus  %5.1fx  %s\n", name, streamUs, tableUs,
+		streamUs / tableUs, same ? "same output" : "OUTPUT DIFFERS");
+	return same;
+}
+
+int main(int argc, char **argv)
+{
+	size_t segmentSize = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_SEGMENT_SIZE;
+	size_t iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : BENCH_ITERATIONS;
+	if (!segmentSize || !iterations)
+	{
+		fprintf(stderr, "usage: hexBench [segment bytes] [iterations]\n");
+		return 1;
+	}
+
+	//every byte value including plenty of zeros, which the old code special cased
+	std::vector<byte> segment(segmentSize);
+	unsigned int seed = 12345;
+	for (size_t i = 0; i < segmentSize; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		segment[i] = (i % 5 == 0) ? 0 : (byte)(seed >> 16);
+	}
+
+	printf("%zu byte segment, %zu iterations\n", segmentSize, iterations);
+	bool same = run_case("hex blob", hexblob_stream, hexblob_table, segment, iterations);
+	same = run_case("details pane", details_stream, details_table, segment, iterations) && same;
+	return same ? 0 : 1;
+}
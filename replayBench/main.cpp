@@ -0,0 +1,186 @@
+/*
+Multi-client replay benchmark
+
+Replays recordings of different game clients at the same time through one
+packet processor, the way exileSnifferCLI replays a single capture, and
+reports decoded messages per second as clients are added.
+
+usage: replayBench recording.pcapng recording.pcapng ... [-k keys.txt]
+
+Run k replays the first k recordings together, for k = 1 to the number
+given. Each recording gets its own capture thread and its own range of
+stream IDs. The keys are read from the recordings (the *_capture.pcapng the
+GUI makes with RecordCapture set) or from key files given with -k.
+
+The recordings have to be of different client processes: a client's keys
+are claimed by the first stream they decrypt, so a recording replayed twice
+only decrypts once. A recording holding several clients counts as all of
+them. The clients decrypted are reported for each run so one that didn't
+decrypt stands out.
+
+Decoding is done on the processor's one thread whatever the number of
+sessions, so the total rate should hold steady as clients are added. A
+falling rate is the per-session cost.
+
+Links the Qt-free decode core like exileSnifferCLI: replayBench.vcxproj in
+the solution, or the replayBench target of CMakeLists.txt.
+Like the GUI it wants messageTypes.json and ggpk_exports.json in the working directory.
+*/
+#include "stdafx.h"
+#include "packet_capture_thread.h"
+#include "packet_processor.h"
+#include "gameDataStore.h"
+#include "key_file.h"
+#include <chrono>
+
+//the stream IDs of each recording start this far apart
+#define BENCH_STREAM_ID_SPACING 1000000
+
+struct REPLAY_RESULT {
+	size_t messages = 0;
+	size_t clients = 0;
+	double seconds = 0;
+};
+
+static rapidjson::Document messageTypes;
+
+static bool load_messagetypes_json()
+{
+	FILE* fp = fopen("messageTypes.json", "rb");
+	if (!fp)
+	{
+		std::cerr << "Failed to open messageTypes.json" << std::endl;
+		return false;
+	}
+
+	char readBuffer[65536];
+	rapidjson::FileReadStream is(fp, readBuffer, sizeof(readBuffer));
+	messageTypes.ParseStream(is);
+	fclose(fp);
+
+	if (!messageTypes.IsObject() ||
+		messageTypes.FindMember("Login") == messageTypes.MemberEnd() ||
+		messageTypes.FindMember("Game") == messageTypes.MemberEnd())
+	{
+		std::cerr << "Error: messageTypes.json needs Login and Game packet dicts" << std::endl;
+		return false;
+	}
+
+	UIDecodedPkt::loginMessageTypes = &messageTypes.FindMember("Login")->value;
+	UIDecodedPkt::gameMessageTypes = &messageTypes.FindMember("Game")->value;
+	return true;
+}
+
+//returns the number of decoded packets thrown away
+static size_t drain_ui_queue(SafeQueue<UI_MESSAGE *> &uiMsgQueue)
+{
+	size_t decoded = 0;
+	while (!uiMsgQueue.empty())
+	{
+		UI_MESSAGE *msg = uiMsgQueue.waitItem();
+		if (msg->msgType == uiMsgType::eDecodedPacket)
+			++decoded;
+		delete msg;
+	}
+	return decoded;
+}
+
+static bool replay(const std::vector<std::string> &recordings, size_t count,
+	const std::vector<std::string> &keyFiles, REPLAY_RESULT &result)
+{
+	key_file_source keys;
+	for (const std::string &keyPath : keyFiles)
+		if (!keys.load(keyPath))
+		{
+			std::cerr << "Failed to open key file " << keyPath << std::endl;
+			return false;
+		}
+	if (keyFiles.empty())
+		for (size_t i = 0; i < count; ++i)
+			if (!keys.load_recording(recordings[i]))
+			{
+				std::cerr << recordings[i] << " isn't an exileSniffer recording, give its keys with -k" << std::endl;
+				return false;
+			}
+
+	SafeQueue<UI_MESSAGE *> uiMsgQueue;
+	SafeQueue<GAMEPACKET> gamePktQueue, loginPktQueue;
+	gameDataStore ggpk(&uiMsgQueue);
+
+	std::vector<std::unique_ptr<packet_capture_thread> > captures;
+	for (size_t i = 0; i < count; ++i)
+	{
+		captures.push_back(std::unique_ptr<packet_capture_thread>(
+			new packet_capture_thread(&uiMsgQueue, &gamePktQueue, &loginPktQueue)));
+		captures.back()->set_capture_file(recordings[i]);
+		captures.back()->set_first_stream_id((int)(i * BENCH_STREAM_ID_SPACING));
+	}
+
+	bool inputEnded = false;
+	packet_processor processor(&keys, &uiMsgQueue, &gamePktQueue, &loginPktQueue, &ggpk);
+	processor.set_input_ended_flag(&inputEnded);
+
+	auto replayStart = std::chrono::steady_clock::now();
+	std::vector<std::thread> captureInstances;
+	for (auto &capture : captures)
+		captureInstances.push_back(std::thread(&packet_capture_thread::ThreadEntry, capture.get()));
+	std::thread processorInstance(&packet_processor::ThreadEntry, &processor);
+
+	while (!processor.ded)
+	{
+		result.messages += drain_ui_queue(uiMsgQueue);
+		if (!inputEnded)
+		{
+			bool allQueued = true;
+			for (auto &capture : captures)
+				allQueued = allQueued && capture->ded;
+			inputEnded = allQueued;
+		}
+		Sleep(1);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - replayStart;
+
+	for (std::thread &instance : captureInstances)
+		instance.join();
+	processorInstance.join();
+	result.messages += drain_ui_queue(uiMsgQueue);
+	result.clients = processor.session_count();
+	result.seconds = elapsed.count();
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> recordings, keyFiles;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-k" && i + 1 < argc)
+			keyFiles.push_back(argv[++i]);
+		else
+			recordings.push_back(arg);
+	}
+	if (recordings.empty())
+	{
+		std::cerr << "usage: " << argv[0] << " recording.pcapng recording.pcapng ... [-k keys.txt]" << std::endl;
+		return 1;
+	}
+
+	if (!load_messagetypes_json())
+		return 1;
+
+	double singleRate = 0;
+	for (size_t count = 1; count <= recordings.size(); ++count)
+	{
+		REPLAY_RESULT result;
+		if (!replay(recordings, count, keyFiles, result))
+			return 1;
+
+		double rate = result.seconds > 0 ? result.messages / result.seconds : 0;
+		if (count == 1)
+			singleRate = rate;
+		printf("%zu recordings  %zu clients decrypted  %9zu messages  %7.2fs  %10.0f msg/s  %5.2fx\n",
+			count, result.clients, result.messages, result.seconds, rate, singleRate > 0 ? rate / singleRate : 0);
+	}
+	return 0;
+}
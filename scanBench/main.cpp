@@ -0,0 +1,276 @@
+/*
+Key blob scan benchmark
+
+Plants key blobs in a made up memory image and searches it with each scan
+kernel the cpu supports, the same way the key scan workers do: in
+KEYSCAN_CHUNK_SIZE chunks overlapping by KEYSCAN_CHUNK_OVERLAP.
+Reports MB/s for each kernel against the scalar search and checks every
+kernel finds exactly the planted blobs.
+
+usage: scanBench [image MB] [blobs]
+       scanBench -d dumpfile [hex base address]
+       scanBench -p pid
+
+Some blobs are planted across the chunk boundaries and some signatures are
+planted off the 16 byte alignment, which must not be found.
+
+With -d or -p it scans a real memory source instead, through the same
+region scheduler and worker code as the key grabber: a dump file (an ELF
+core, or a flat image loaded at the base address) or a running process.
+Every readable region is scanned, the key grabber's filters aren't applied.
+It prints where the signatures are and the scan rate.
+
+Links the Qt-free decode core: scanBench.vcxproj in the solution, or the
+scanBench target of CMakeLists.txt.
+*/
+#include "keyblob_scanner.h"
+#include "scan_worker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#define BENCH_IMAGE_MB 256
+#define BENCH_BLOBS 64
+//each kernel scans the image this many times, the fastest run is reported
+#define BENCH_REPEATS 5
+
+static const char keyblobSignature[] = "expand 32-byte k";
+
+//xorshift, the filler only has to be unlikely to contain the signature
+static uint64_t rngState = 0x9E3779B97F4A7C15ull;
+static uint64_t next_random()
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 7;
+	rngState ^= rngState << 17;
+	return rngState;
+}
+
+static void plant_blob(std::vector<uint8_t> &image, size_t offset)
+{
+	memcpy(image.data() + offset, keyblobSignature, KEYBLOB_SIGNATURE_SIZE);
+	for (size_t i = 0; i < KEYBLOB_DATA_SIZE; i += sizeof(uint64_t))
+	{
+		uint64_t value = next_random();
+		memcpy(image.data() + offset + KEYBLOB_SIGNATURE_SIZE + i, &value, sizeof(value));
+	}
+}
+
+/*
+Fill the image and plant the blobs
+Returns the aligned offsets that should be found
+*/
+static std::vector<size_t> build_image(std::vector<uint8_t> &image, size_t blobCount, size_t &boundaryBlobs)
+{
+	for (size_t i = 0; i + sizeof(uint64_t) <= image.size(); i += sizeof(uint64_t))
+	{
+		uint64_t value = next_random();
+		memcpy(image.data() + i, &value, sizeof(value));
+	}
+
+	std::vector<size_t> planted;
+	const size_t blobSpan = KEYBLOB_SIGNATURE_SIZE + KEYBLOB_DATA_SIZE;
+	const size_t stride = KEYSCAN_CHUNK_SIZE - KEYSCAN_CHUNK_OVERLAP;
+
+	//straddling the chunk boundaries - the last aligned place a blob fits
+	//entirely in a chunk, then the first place it only fits in the next one
+	for (size_t chunkEnd = KEYSCAN_CHUNK_SIZE; chunkEnd + blobSpan < image.size() &&
+		planted.size() < blobCount / 2; chunkEnd += stride)
+	{
+		planted.push_back(chunkEnd - blobSpan);
+		planted.push_back(chunkEnd - blobSpan + KEYBLOB_ALIGNMENT);
+	}
+	boundaryBlobs = planted.size();
+
+	while (planted.size() < blobCount)
+	{
+		size_t offset = (size_t)(next_random() % (image.size() - blobSpan)) & ~(size_t)(KEYBLOB_ALIGNMENT - 1);
+		bool clashes = false;
+		for (size_t other : planted)
+			if (offset + blobSpan > other && other + blobSpan > offset)
+				clashes = true;
+		if (!clashes)
+			planted.push_back(offset);
+	}
+
+	for (size_t offset : planted)
+		plant_blob(image, offset);
+
+	//decoys off the alignment, in the gaps between the real ones
+	size_t decoys = 0;
+	while (decoys < blobCount)
+	{
+		size_t offset = (size_t)(next_random() % (image.size() - blobSpan)) | 4;
+		bool clashes = false;
+		for (size_t other : planted)
+			if (offset + blobSpan > other && other + blobSpan > offset)
+				clashes = true;
+		if (clashes)
+			continue;
+		memcpy(image.data() + offset, keyblobSignature, KEYBLOB_SIGNATURE_SIZE);
+		++decoys;
+	}
+
+	std::sort(planted.begin(), planted.end());
+	return planted;
+}
+
+//the worker loop minus the memory reads
+static double scan_chunked(const std::vector<uint8_t> &image, eScanKernel kernel, std::vector<size_t> &found)
+{
+	std::vector<size_t> chunkResults;
+	found.clear();
+
+	auto scanStart = std::chrono::steady_clock::now();
+	size_t offset = 0;
+	while (true)
+	{
+		size_t chunkSize = std::min((size_t)KEYSCAN_CHUNK_SIZE, image.size() - offset);
+		chunkResults.clear();
+		find_keyblob_signatures(image.data() + offset, chunkSize, chunkResults, kernel);
+		for (size_t result : chunkResults)
+			found.push_back(offset + result);
+
+		if (offset + chunkSize >= image.size())
+			break;
+		offset += KEYSCAN_CHUNK_SIZE - KEYSCAN_CHUNK_OVERLAP;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - scanStart;
+	return elapsed.count();
+}
+
+//scan a memory source the way the key grabber does, with every worker
+static int scan_memory_source(memory_source *source)
+{
+	std::string openError;
+	if (!source->open(openError))
+	{
+		fprintf(stderr, "%s\n", openError.c_str());
+		return 1;
+	}
+
+	region_scheduler scheduler;
+	std::vector<std::vector<uint8_t>> workerBuffers(scheduler.worker_count());
+	std::vector<std::vector<size_t>> workerResults(scheduler.worker_count());
+	std::mutex foundMutex;
+	std::vector<uint64_t> foundAddresses;
+	std::atomic<size_t> readErrors{ 0 };
+	keyscan_stats stats;
+
+	stats.start();
+	scheduler.start([&](unsigned int workerIndex, SCAN_JOB &job) {
+		std::vector<size_t> &signatureOffsets = workerResults[workerIndex];
+		signatureOffsets.clear();
+		unsigned long readErr = 0;
+		scan_job_for_keyblobs(source, job, workerBuffers[workerIndex], signatureOffsets, stats, &readErr);
+		if (readErr)
+			++readErrors;
+
+		std::lock_guard<std::mutex> lock(foundMutex);
+		for (size_t signatureOffset : signatureOffsets)
+			foundAddresses.push_back(job.address + signatureOffset);
+	});
+
+	MEMREGION region;
+	uint64_t nextp = 0;
+	size_t regionCount = 0;
+	unsigned long queryErr = 0;
+	eRegionQuery queryResult;
+	while ((queryResult = source->query_region(nextp, region, &queryErr)) == eRegionFound)
+	{
+		nextp = region.base + region.size;
+		if (!region.committed || !(region.protect & MEMPROT_READ))
+			continue;
+		scheduler.submit_region(region, KEYSCAN_CHUNK_SIZE, KEYSCAN_CHUNK_OVERLAP);
+		++regionCount;
+	}
+	if (queryResult != eRegionEnd)
+		fprintf(stderr, "Memory query of %s failed with error %lu\n", source->description().c_str(), queryErr);
+
+	while (scheduler.pending())
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	scheduler.stop();
+	source->close();
+
+	std::sort(foundAddresses.begin(), foundAddresses.end());
+	for (uint64_t address : foundAddresses)
+		printf("key blob signature at 0x%llx\n", (unsigned long long)address);
+
+	printf("%s: %zu regions, %.1fMB scanned by %u workers at %.1f MB/s (%s search: %.1f MB/s), "
+		"%zu signatures, %zu read errors\n", source->description().c_str(), regionCount, 
+		stats.bytes() / (1024.0 * 1024.0), scheduler.worker_count(), stats.wallclock_MBps(), 
+		scan_kernel_name(best_scan_kernel()), stats.kernel_MBps(), foundAddresses.size(), (size_t)readErrors);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2 && !strcmp(argv[1], "-d"))
+	{
+		uint64_t base = argc > 3 ? strtoull(argv[3], NULL, 16) : 0;
+		dump_file_memory_source dump(argv[2], base);
+		return scan_memory_source(&dump);
+	}
+	if (argc > 2 && !strcmp(argv[1], "-p"))
+	{
+		unsigned long pid = strtoul(argv[2], NULL, 10);
+#if defined(_WIN32)
+		win_process_memory_source process(pid);
+#elif defined(__linux__)
+		proc_pid_memory_source process((int)pid);
+#else
+		fprintf(stderr, "-p isn't supported on this platform\n");
+		return 1;
+#endif
+		return scan_memory_source(&process);
+	}
+
+	size_t imageMB = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_IMAGE_MB;
+	size_t blobCount = argc > 2 ? strtoul(argv[2], NULL, 10) : BENCH_BLOBS;
+	if (!imageMB || imageMB * 1024 * 1024 < KEYSCAN_CHUNK_SIZE * 2)
+	{
+		fprintf(stderr, "usage: scanBench [image MB, at least %d] [blobs]\n", (KEYSCAN_CHUNK_SIZE * 2) / (1024 * 1024));
+		fprintf(stderr, "       scanBench -d dumpfile [hex base address]\n");
+		fprintf(stderr, "       scanBench -p pid\n");
+		return 1;
+	}
+
+	std::vector<uint8_t> image(imageMB * 1024 * 1024);
+	size_t boundaryBlobs = 0;
+	std::vector<size_t> planted = build_image(image, blobCount, boundaryBlobs);
+	printf("%zuMB image, %zu blobs planted (%zu at chunk boundaries), %zu misaligned decoys\n",
+		imageMB, planted.size(), boundaryBlobs, blobCount);
+
+	eScanKernel best = best_scan_kernel();
+	double scalarSeconds = 0;
+	bool allFound = true;
+	std::vector<size_t> found;
+
+	for (int k = eScanScalar; k <= best; ++k)
+	{
+		eScanKernel kernel = (eScanKernel)k;
+		double bestSeconds = 0;
+		for (int run = 0; run < BENCH_REPEATS; ++run)
+		{
+			double seconds = scan_chunked(image, kernel, found);
+			if (!run || seconds < bestSeconds)
+				bestSeconds = seconds;
+		}
+		if (kernel == eScanScalar)
+			scalarSeconds = bestSeconds;
+
+		std::sort(found.begin(), found.end());
+		bool correct = found == planted;
+		allFound = allFound && correct;
+
+		printf("%-7s %8.1f MB/s  %5.2fx scalar  found %zu/%zu %s\n", scan_kernel_name(kernel),
+			(double)imageMB / bestSeconds, scalarSeconds / bestSeconds, found.size(), planted.size(),
+			correct ? "ok" : "MISMATCH");
+	}
+
+	return allFound ? 0 : 1;
+}